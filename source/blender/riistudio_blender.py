@@ -29,6 +29,8 @@ import subprocess
 import mmap
 import cProfile
 import json
+import sys
+from array import array
 from enum import Enum
 
 BLENDER_30 = bpy.app.version[0] >= 3
@@ -225,9 +227,9 @@ def export_tex_wimgt(texture, out_folder):
 		os.remove(texture_outpath)
 
 # Uses RSZST to encode the PNG first, with options for mipmaps and format
-def export_tex_rszst(texture, out_folder):
+def rszst_tex_entry(texture, out_folder):
 		if not texture.image:
-				return
+				return None
 
 		tex_name = get_filename_without_extension(texture.image.name) if BLENDER_28 else texture.name
 		print("ExportTex: %s" % tex_name)
@@ -238,7 +240,6 @@ def export_tex_rszst(texture, out_folder):
 		# Save image as PNG with a temporary name
 		temp_output_name = str(binascii.b2a_hex(os.urandom(15)))
 		texture_outpath = os.path.join(out_folder, temp_output_name) + ".png"
-		tex0_outpath = os.path.join(out_folder, tex_name) + ".tex0"
 		texture.image.save_render(texture_outpath)
 		
 		# Determine format
@@ -246,7 +247,7 @@ def export_tex_rszst(texture, out_folder):
 				texture.brres_manual_format if texture.brres_mode == 'manual' else best_tex_format(
 						texture)).upper()
 		
-		tformat_idx = str({
+		tformat_idx = {
 				'I4': 0,
 				'I8': 1,
 				'IA4': 2,
@@ -258,23 +259,39 @@ def export_tex_rszst(texture, out_folder):
 				'C8': 9,
 				# C14 not supported by NW4R g3d
 				'CMPR': 14,
-				}[tformat_string])
+				}[tformat_string]
+
+		# Manifest entry; see import-tex0
+		return {
+				"path": texture_outpath,
+				"name": tex_name,
+				"format": tformat_idx,
+				"mipmaps": texture.brres_mipmap_mode != 'none',
+				"min_mip": int(texture.brres_mipmap_minsize),
+				"max_mip": int(texture.brres_mipmap_manual) if texture.brres_mipmap_mode == 'manual' else 5,
+		}
 
-		# Determine mipmaps
-		mipmaps_flag = "--mipmaps" if texture.brres_mipmap_mode != 'none' else ""
-		min_mip = "--min-mip=%s" % texture.brres_mipmap_minsize
-		max_mip = "--max-mip=%s" % texture.brres_mipmap_manual if texture.brres_mipmap_mode == 'manual' else "--max-mip=5"
+# Uses RSZST to encode the PNGs first, with options for mipmaps and format.
+# All textures go through one rszst process, which encodes them in parallel.
+def export_textures_rszst(textures, out_folder):
+		entries = [e for e in (rszst_tex_entry(tex, out_folder) for tex in textures) if e]
+		if not entries:
+				return
 
-		# Construct the RSZST command
-		print("EncodeTex: %s" % tex_name)
+		manifest_path = os.path.join(out_folder, str(binascii.b2a_hex(os.urandom(15))) + ".json")
+		with open(manifest_path, 'w') as manifest:
+				json.dump({"textures": entries}, manifest)
+
+		print("EncodeTex: %d textures" % len(entries))
 		context = bpy.context
 		bin_root = os.path.abspath(get_rs_prefs(context).riistudio_directory)
 		rszst = os.path.join(bin_root, "rszst.exe")
-		rszst_command = f'{rszst} import-tex0 {mipmaps_flag} {min_mip} {max_mip} --format {tformat_idx} "{texture_outpath}" "{tex0_outpath}"'
-		os.system(rszst_command)
+		subprocess.call([rszst, "import-tex0", manifest_path, out_folder])
 		
-		# Clean up the temporary PNG file
-		os.remove(texture_outpath)
+		# Clean up the temporary files
+		os.remove(manifest_path)
+		for entry in entries:
+				os.remove(entry["path"])
 
 def export_tex(texture, out_folder, mode):
 		if mode == ExportMode.LEGACY:
@@ -282,7 +299,7 @@ def export_tex(texture, out_folder, mode):
 		elif mode == ExportMode.WIMGT:
 				export_tex_wimgt(texture, out_folder)
 		elif mode == ExportMode.RSZST:
-				export_tex_rszst(texture, out_folder)
+				export_textures_rszst([texture], out_folder)
 		else:
 				raise ValueError("Invalid export mode selected")
 
@@ -1029,10 +1046,12 @@ def export_textures(textures_path,selection,params):
 	if not os.path.exists(textures_path):
 		os.makedirs(textures_path)
 
+	if params.flags.texture_encoder == 'rszst':
+		export_textures_rszst(all_textures(selection), textures_path)
+		return
+
 	for tex in all_textures(selection):
-		if params.flags.texture_encoder == 'rszst':
-			mode = ExportMode.RSZST
-		elif wimgt_installed and params.flags.texture_encoder == 'wimgt':
+		if wimgt_installed and params.flags.texture_encoder == 'wimgt':
 			mode = ExportMode.WIMGT
 		else:
 			mode = ExportMode.LEGACY
@@ -1224,6 +1243,26 @@ VCD_COLOR1 = 12
 VCD_UV0 = 13
 VCD_UV7 = 20
 
+class VertexStreams:
+	'''Facepoint data as one float array per attribute, in VCD order.'''
+	def __init__(self, count):
+		self.count = count
+		self.streams = [] # [ (components, data, index or None), ... ]
+
+	def add(self, components, data, index=None):
+		self.streams.append((components, data, index))
+
+	def to_facepoints(self):
+		# [ [ V, N, C0, C1, U0, U1, U2, U3, U4, U5, U6, U7 ], ... ]
+		facepoints = []
+		for i in range(self.count):
+			facepoint = []
+			for components, data, index in self.streams:
+				begin = (i if index is None else index[i]) * components
+				facepoint.append(tuple(data[begin:begin + components]))
+			facepoints.append(facepoint)
+		return facepoints
+
 def export_mesh(
 	Object,
 	magnification,
@@ -1294,6 +1333,12 @@ def export_mesh(
 	for x in range(len(triangulated.uv_layers[:8])):
 		UVInputs[x] = 0
 
+	# Shared by every polygon of this object: facepoints index into them.
+	positions = array('f', [0.0]) * (len(triangulated.vertices) * 3)
+	triangulated.vertices.foreach_get("co", positions)
+	normals = array('f', [0.0]) * (len(triangulated.vertices) * 3)
+	triangulated.vertices.foreach_get("normal", normals)
+
 	for mat_index, mat in enumerate(triangulated.materials):
 		if mat is None:
 			print("ERR: Object %s has materials with unassigned materials?" % Object.name)
@@ -1335,32 +1380,39 @@ def export_mesh(
 			vcd_set[VCD_COLOR0] = 1
 
 		# we'll worry about this when we have to, 1 primitive array should be fine for now.
-		facepoints = [] # [ [ V, N, C0, C1, U0, U1, U2, U3, U4, U5, U6, U7 ], ... ]
+		position_indices = array('I')
+		color_streams = [array('f') for i in ColorInputs if i > -1]
+		uv_streams = [array('f') for _ in triangulated.uv_layers[:8]]
 		num_verts = len(triangulated.polygons) * 3
 		for idx, tri in zip(range(0, num_verts, 3), triangulated.polygons):
 			if tri.material_index != mat_index and split_mesh_by_material:
 				# print("Skipped because tri mat: %u, target: %u" % (tri.material_index, mat_index))
 				continue
 			for global_index, fpVertexIndex in enumerate(tri.vertices, idx):
-				blender_vertex = triangulated.vertices[fpVertexIndex]
-				gvertex = [vec3(blender_vertex.co), vec3(blender_vertex.normal)]
+				position_indices.append(fpVertexIndex)
 				if has_vcolors:
-					for layer in triangulated.vertex_colors[:2]:
+					for stream, layer in zip(color_streams, triangulated.vertex_colors[:2]):
 						# TODO: Is this less if smaller? Add data not index
-						clr = layer.data[global_index].color
-						gvertex += [tuple(attr for attr in clr)]
+						stream.extend(layer.data[global_index].color)
 				elif add_dummy_colors:
-					gvertex += [[1.0, 1.0, 1.0, 1.0]]
-				for layer in triangulated.uv_layers[:8]:
-					raw_uv = vec2(layer.data[global_index].uv)
+					color_streams[0].extend((1.0, 1.0, 1.0, 1.0))
+				for stream, layer in zip(uv_streams, triangulated.uv_layers[:8]):
+					raw_uv = layer.data[global_index].uv
 					# Transform into BRRES-space
-					gvertex += [(raw_uv[0], 1 - raw_uv[1])]
-				facepoints.append(gvertex)		
+					stream.extend((raw_uv[0], 1 - raw_uv[1]))
 
-		if not len(facepoints):
+		if not len(position_indices):
 			print("No vertices: skipping")
 			continue
 
+		facepoints = VertexStreams(len(position_indices))
+		facepoints.add(3, positions, position_indices)
+		facepoints.add(3, normals, position_indices)
+		for stream in color_streams:
+			facepoints.add(4, stream)
+		for stream in uv_streams:
+			facepoints.add(2, stream)
+
 		polygon_object["matrix_primitives"].append({
 			"matrix": [-1, -1, -1, -1, -1, -1, -1, -1, -1, -1],
 			"primitives": [{
@@ -1396,7 +1448,8 @@ class Quantization:
 
 class ConverterFlags:
 	def __init__(self, split_mesh_by_material=True, mesh_conversion_mode='PREVIEW',
-		add_dummy_colors = True, ignore_cache = False, texture_encoder='rszst', write_metadata = False):
+		add_dummy_colors = True, ignore_cache = False, texture_encoder='rszst', write_metadata = False,
+		binary_rhst = True):
 		
 		self.split_mesh_by_material = split_mesh_by_material
 		self.mesh_conversion_mode = mesh_conversion_mode
@@ -1404,6 +1457,7 @@ class ConverterFlags:
 		self.ignore_cache = ignore_cache
 		self.write_metadata = False
 		self.texture_encoder = texture_encoder
+		self.binary_rhst = binary_rhst
 
 class RHSTExportParams:
 	def __init__(self, dest_path, quantization=Quantization(), root_transform = SRT(),
@@ -1417,6 +1471,66 @@ class RHSTExportParams:
 		self.name = name
 
 
+def all_primitives(current_data):
+	for poly in current_data["polygons"]:
+		for mp in poly["matrix_primitives"]:
+			yield from mp["primitives"]
+
+# See librii/rhst/RHSTBinary.hpp
+RHST_BINARY_VERSION = 1
+RHST_BUFFER_S8 = 0
+RHST_BUFFER_U32 = 1
+RHST_BUFFER_F32 = { 2: 2, 3: 3, 4: 4 } # components -> type
+
+def write_binary_rhst(path, obj):
+	# Vertex data goes to aligned buffers; facepoints become [data, index]
+	# buffer pairs. Arrays shared between polygons are stored once.
+	buffers = []
+	buffer_ids = {}
+	def add_buffer(type, components, data):
+		if id(data) not in buffer_ids:
+			buffer_ids[id(data)] = len(buffers)
+			buffers.append((type, len(data) // components, data))
+		return buffer_ids[id(data)]
+
+	for prim in all_primitives(obj["body"]):
+		streams = prim.pop("facepoints")
+		prim["num_facepoints"] = streams.count
+		prim["streams"] = [
+			[add_buffer(RHST_BUFFER_F32[components], components, data),
+			 -1 if index is None else add_buffer(RHST_BUFFER_U32, 1, index)]
+			for components, data, index in streams.streams]
+
+	def align(x):
+		return (x + 15) & ~15
+
+	scene = json.dumps(obj).encode('utf-8')
+	scene_offset = 32
+	buffers_offset = align(scene_offset + len(scene))
+	table = bytearray()
+	offset = align(buffers_offset + 16 * len(buffers))
+	for type, count, data in buffers:
+		size = len(data) * data.itemsize
+		table += struct.pack('<4I', offset, size, type, count)
+		offset = align(offset + size)
+	file_size = offset
+
+	with open(path, 'wb') as file:
+		def pad():
+			file.write(bytes(align(file.tell()) - file.tell()))
+		file.write(struct.pack('<4s7I', b'RHST', RHST_BINARY_VERSION, file_size,
+			scene_offset, len(scene), buffers_offset, len(buffers), 0))
+		file.write(scene)
+		pad()
+		file.write(table)
+		for _, _, data in buffers:
+			pad()
+			if sys.byteorder != 'little':
+				data = array(data.typecode, data)
+				data.byteswap()
+			data.tofile(file)
+		pad()
+
 def export_jres(context, params : RHSTExportParams):
 	current_data = {
 		"name": "" if params.name == "" else params.name,
@@ -1532,8 +1646,13 @@ def export_jres(context, params : RHSTExportParams):
 		'body': current_data,
 	}
 	print(params.dest_path)
-	with open(params.dest_path, 'w') as file:
-		file.write(json.dumps(obj))
+	if params.flags.binary_rhst:
+		write_binary_rhst(params.dest_path, obj)
+	else:
+		for prim in all_primitives(current_data):
+			prim["facepoints"] = prim["facepoints"].to_facepoints()
+		with open(params.dest_path, 'w') as file:
+			file.write(json.dumps(obj))
 
 	end = perf_counter()
 	delta = end - start
@@ -1651,6 +1770,13 @@ class RHST_RNA:
 	)
 	if BLENDER_29: ignore_cache : ignore_cache
 
+	binary_rhst = BoolProperty(
+		name="Binary Intermediate",
+		default=True,
+		description="Write the intermediate .rhst file in binary, which is much faster to write and read. Disable to inspect it as JSON"
+	)
+	if BLENDER_29: binary_rhst : binary_rhst
+
 	keep_build_artifacts = BoolProperty(
 		name="Keep Build Artifacts",
 		default=False,
@@ -1699,6 +1825,7 @@ class RHST_RNA:
 			self.add_dummy_colors,
 			self.ignore_cache,
 			self.texture_encoder,
+			binary_rhst = self.binary_rhst,
 		)
 	
 	def get_wimgt_installed(self):
@@ -1751,6 +1878,7 @@ class RHST_RNA:
 		box.prop(self, "mesh_conversion_mode")
 		box.prop(self, 'add_dummy_colors')
 		box.prop(self, 'ignore_cache')
+		box.prop(self, 'binary_rhst')
 		box.prop(self, 'keep_build_artifacts')
 		box.prop(self, 'verbose')
 
@@ -24,7 +24,7 @@ struct JsonWriteCtx;
 
 std::string ArcToJSON(const g3d::Archive& model, JsonWriteCtx& c);
 Result<g3d::Archive> JSONToArc(std::string_view json,
-                               std::span<const std::vector<u8>> buffers);
+                               std::span<const std::span<const u8>> buffers);
 
 struct JsonReadCtx {
   nlohmann::json j;
@@ -171,28 +171,46 @@ u32 read_u32_at(std::span<const u8> data, u32 pos) {
          (data[pos + 3]);
 }
 
-std::vector<std::vector<u8>> ParseBuffers(std::span<const u8> data) {
-  std::vector<std::vector<u8>> buffers;
-
-  // Check the magic number
-  assert(data[0] == 'R' && data[1] == 'B' && data[2] == 'U' && data[3] == 'F');
-
+//! Views of each buffer of an RBUF file. Nothing is copied: the views borrow
+//! from |data|, so it must outlive them.
+Result<std::vector<std::span<const u8>>>
+ParseBuffers(std::span<const u8> data) {
+  if (data.size() < 16) {
+    return RSL_UNEXPECTED("RBUF: File is too small");
+  }
+  if (data[0] != 'R' || data[1] != 'B' || data[2] != 'U' || data[3] != 'F') {
+    return RSL_UNEXPECTED("RBUF: Invalid magic");
+  }
   u32 version = read_u32_at(data, 4);
-  assert(version == 100);
-
+  if (version != 100) {
+    return RSL_UNEXPECTED("RBUF: Unsupported version " +
+                          std::to_string(version));
+  }
   u32 num_buffers = read_u32_at(data, 8);
   u32 file_size = read_u32_at(data, 12);
+  if (file_size < 16) {
+    return RSL_UNEXPECTED("RBUF: File size is smaller than the header");
+  }
+  if (file_size > data.size()) {
+    return RSL_UNEXPECTED("RBUF: File is truncated");
+  }
+  data = data.subspan(0, file_size);
+  if (num_buffers > (file_size - 16) / 8) {
+    return RSL_UNEXPECTED("RBUF: Buffer table is out of bounds");
+  }
 
+  std::vector<std::span<const u8>> buffers(num_buffers);
   u32 cursor = 16;
-
   for (u32 i = 0; i < num_buffers; ++i) {
     u32 buffer_offset = read_u32_at(data, cursor);
     u32 buffer_size = read_u32_at(data, cursor + 4);
     cursor += 8;
 
-    std::vector<u8> buffer(buffer_size);
-    std::memcpy(buffer.data(), data.data() + buffer_offset, buffer_size);
-    buffers.push_back(buffer);
+    if (buffer_offset > file_size || buffer_size > file_size - buffer_offset) {
+      return RSL_UNEXPECTED("RBUF: Buffer " + std::to_string(i) +
+                            " is out of bounds");
+    }
+    buffers[i] = data.subspan(buffer_offset, buffer_size);
   }
 
   return buffers;
@@ -215,7 +233,7 @@ DumpResult DumpJson(const librii::g3d::Archive& archive) {
 }
 Result<librii::g3d::Archive> ReadJsonArc(std::string_view json,
                                          std::span<const u8> buffer) {
-  auto buffers = ParseBuffers(buffer);
+  auto buffers = TRY(ParseBuffers(buffer));
   return librii::g3d::JSONToArc(json, buffers);
 }
 Result<std::vector<u8>> WriteArchive(std::string_view json,
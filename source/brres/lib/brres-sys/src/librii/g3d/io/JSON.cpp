@@ -373,7 +373,7 @@ struct JSONMatrixPrimitive {
     return json;
   }
 
-  MatrixPrimitive to(std::span<const std::vector<u8>> buffers) const {
+  MatrixPrimitive to(std::span<const std::span<const u8>> buffers) const {
     MatrixPrimitive matPrim;
     matPrim.mDrawMatrixIndices = matrices;
 
@@ -423,7 +423,7 @@ struct JSONPolygonData {
     return json;
   }
 
-  g3d::PolygonData to(std::span<const std::vector<u8>> buffers) const {
+  g3d::PolygonData to(std::span<const std::span<const u8>> buffers) const {
     g3d::PolygonData poly;
 
     // Convert JSONPolygonData to PolygonData members
@@ -1253,7 +1253,7 @@ struct JSONPositionBuffer {
     return json;
   }
 
-  PositionBuffer to(std::span<const std::vector<u8>> buffers) const {
+  PositionBuffer to(std::span<const std::span<const u8>> buffers) const {
     PositionBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1305,7 +1305,7 @@ struct JSONNormalBuffer {
     return json;
   }
 
-  NormalBuffer to(std::span<const std::vector<u8>> buffers) const {
+  NormalBuffer to(std::span<const std::span<const u8>> buffers) const {
     NormalBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1356,7 +1356,7 @@ struct JSONColorBuffer {
     return json;
   }
 
-  ColorBuffer to(std::span<const std::vector<u8>> buffers) const {
+  ColorBuffer to(std::span<const std::span<const u8>> buffers) const {
     ColorBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1408,7 +1408,7 @@ struct JSONTextureCoordinateBuffer {
     return json;
   }
 
-  TextureCoordinateBuffer to(std::span<const std::vector<u8>> buffers) const {
+  TextureCoordinateBuffer to(std::span<const std::span<const u8>> buffers) const {
     TextureCoordinateBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1483,7 +1483,7 @@ struct JSONModel {
     return model;
   }
 
-  Result<Model> lift(std::span<const std::vector<u8>> buffers) const {
+  Result<Model> lift(std::span<const std::span<const u8>> buffers) const {
     Model result;
     result.name = name;
     result.info = TRY(info.to());
@@ -1552,7 +1552,7 @@ struct JSONTextureData {
     return json;
   }
 
-  librii::g3d::TextureData to(std::span<const std::vector<u8>> buffers) const {
+  librii::g3d::TextureData to(std::span<const std::span<const u8>> buffers) const {
     librii::g3d::TextureData tex;
     tex.name = name;
     tex.format = static_cast<librii::gx::TextureFormat>(format);
@@ -1562,7 +1562,8 @@ struct JSONTextureData {
     tex.minLod = minLod;
     tex.maxLod = maxLod;
     tex.sourcePath = sourcePath;
-    tex.data = buffers[dataBufferId];
+    tex.data.assign(buffers[dataBufferId].begin(),
+                    buffers[dataBufferId].end());
     return tex;
   }
 };
@@ -1723,7 +1724,7 @@ struct JSONChrTrack {
     return jsonTrack;
   }
 
-  Result<ChrTrack> to(std::span<const std::vector<u8>> buffers) const {
+  Result<ChrTrack> to(std::span<const std::span<const u8>> buffers) const {
     ChrTrack track;
     track.quant = quant;
     track.scale = scale;
@@ -1791,7 +1792,7 @@ struct JSONChrData {
     return jsonAnim;
   }
 
-  Result<ChrAnim> to(std::span<const std::vector<u8>> buffers) const {
+  Result<ChrAnim> to(std::span<const std::span<const u8>> buffers) const {
     ChrAnim anim;
     anim.name = name;
     anim.sourcePath = sourcePath;
@@ -2136,7 +2137,7 @@ struct JSONVisData {
     return json;
   }
 
-  BinaryVis to(std::span<const std::vector<u8>> buffers) const {
+  BinaryVis to(std::span<const std::span<const u8>> buffers) const {
     BinaryVis vis;
     vis.name = name;
     vis.sourcePath = sourcePath;
@@ -2196,7 +2197,7 @@ struct JSONArchive {
     return archive;
   }
 
-  Result<Archive> lift(std::span<const std::vector<u8>> buffers) const {
+  Result<Archive> lift(std::span<const std::span<const u8>> buffers) const {
     Archive result;
 
     for (const auto& jsonModel : models) {
@@ -2237,7 +2238,7 @@ std::string ArcToJSON(const g3d::Archive& model, JsonWriteCtx& c) {
       mat, JS::SerializerOptions(JS::SerializerOptions::Pretty));
 }
 Result<g3d::Archive> JSONToArc(std::string_view json,
-                               std::span<const std::vector<u8>> buffers) {
+                               std::span<const std::span<const u8>> buffers) {
   JS::ParseContext context(json.data(), json.size());
   JSONArchive mdl;
   auto err = context.parseTo(mdl);
@@ -746,7 +746,8 @@ s32 ssc(const librii::g3d::BinaryBoneData& bone) { return bone.flag & 0x20; }
 s32 ssc(const librii::g3d::BoneData& bone) { return bone.ssc; }
 
 librii::g3d::BoneData fromBinaryBone(const librii::g3d::BinaryBoneData& bin,
-                                     auto&& bones, kpi::IOContext& ctx_,
+                                     const glm::mat4& modelMtx,
+                                     kpi::IOContext& ctx_,
                                      librii::g3d::ScalingRule scalingRule) {
   auto ctx = ctx_.sublet("Bone " + bin.name);
   librii::g3d::BoneData bone;
@@ -767,7 +768,6 @@ librii::g3d::BoneData fromBinaryBone(const librii::g3d::BinaryBoneData& bin,
   bone.forceDisplayMatrix = bin.forceDisplayMatrix;
   bone.omitFromNodeMix = bin.omitFromNodeMix;
 
-  auto modelMtx = calcSrtMtx(bin, bones, scalingRule);
   auto modelMtx34 = glm::mat4x3(modelMtx);
 
   auto invModelMtx =
@@ -801,7 +801,8 @@ librii::g3d::BoneData fromBinaryBone(const librii::g3d::BinaryBoneData& bin,
 Result<librii::g3d::BinaryBoneData>
 toBinaryBone(const librii::g3d::BoneData& bone,
              std::span<const librii::g3d::BoneData> bones, u32 bone_id,
-             librii::g3d::ScalingRule scalingRule, s32 matrixId) {
+             const glm::mat4& modelMtx, librii::g3d::ScalingRule scalingRule,
+             s32 matrixId) {
   librii::g3d::BinaryBoneData bin;
   bin.name = bone.mName;
   bin.matrixId = matrixId;
@@ -835,7 +836,6 @@ toBinaryBone(const librii::g3d::BoneData& bone,
     bin.sibling_right_id = it == siblings.end() - 1 ? -1 : *(it + 1);
   }
 
-  auto modelMtx = calcSrtMtx(bone, bones, scalingRule);
   auto modelMtx34 = glm::mat4x3(modelMtx);
 
   bin.modelMtx = modelMtx34;
@@ -1111,13 +1111,20 @@ Result<void> processModel(const BinaryModel& binary_model,
   }
 
   mdl.bones.resize(0);
+  librii::g3d::BoneMatrixCache modelMtx;
+  modelMtx.update(binary_model.bones, binary_model.info.scalingRule);
   for (size_t i = 0; i < binary_model.bones.size(); ++i) {
     auto& bone = binary_model.bones[i];
     // CTools seemingly doesn't do this???
     if (bone.id != i) {
       ctx.error("Bone IDs are desynced. Is this a CTools minimap???");
     }
-    auto new_bone = fromBinaryBone(bone, binary_model.bones, ctx,
+#ifndef NDEBUG
+    // The cache must match the per-bone walk it replaces exactly.
+    assert(modelMtx.matrices()[i] ==
+           calcSrtMtx(bone, binary_model.bones, binary_model.info.scalingRule));
+#endif
+    auto new_bone = fromBinaryBone(bone, modelMtx.matrices()[i], ctx,
                                    binary_model.info.scalingRule);
     mdl.bones.push_back(new_bone);
   }
@@ -1368,9 +1375,15 @@ Result<librii::g3d::BinaryModel> toBinaryModel(const Model& mdl) {
   for (auto [index, value] : rsl::enumerate(mdl.materials)) {
     bin.materials.push_back(librii::g3d::toBinMat(value, index));
   }
+  librii::g3d::BoneMatrixCache modelMtx;
+  modelMtx.update(bones, mdl.info.scalingRule);
   for (auto&& [index, value] : rsl::enumerate(mdl.bones)) {
-    auto bb = toBinaryBone(value, bones, index, mdl.info.scalingRule,
-                           boneToMatrix[index]);
+#ifndef NDEBUG
+    assert(modelMtx.matrices()[index] ==
+           calcSrtMtx(value, bones, mdl.info.scalingRule));
+#endif
+    auto bb = toBinaryBone(value, bones, index, modelMtx.matrices()[index],
+                           mdl.info.scalingRule, boneToMatrix[index]);
     bin.bones.emplace_back(TRY(bb));
   }
 
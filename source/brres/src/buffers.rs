@@ -1,3 +1,4 @@
+use anyhow::{anyhow, bail};
 use std::vec;
 
 const RBUF_ALIGN: u32 = 64;
@@ -57,8 +58,8 @@ fn round_up(value: u32, alignment: u32) -> u32 {
     (value + alignment - 1) & !(alignment - 1)
 }
 
-// Function to read the buffer back into a Vec<Vec<u8>>
-pub fn read_buffer(data: &[u8]) -> Vec<Vec<u8>> {
+// Function to split the buffer into its sub-buffers. The slices borrow from `data`; nothing is copied.
+pub fn read_buffer(data: &[u8]) -> anyhow::Result<Vec<&[u8]>> {
     // Helper function to read a u32 value from a specific position in big endian format
     let read_u32_at = |data: &[u8], pos: usize| -> u32 {
         ((data[pos] as u32) << 24)
@@ -67,29 +68,45 @@ pub fn read_buffer(data: &[u8]) -> Vec<Vec<u8>> {
             | (data[pos + 3] as u32)
     };
 
+    if data.len() < 16 {
+        bail!("RBUF: File is too small");
+    }
     let magic = read_u32_at(data, 0);
     let version = read_u32_at(data, 4);
     let num_buffers = read_u32_at(data, 8) as usize;
-    let file_size = read_u32_at(data, 12);
+    let file_size = read_u32_at(data, 12) as usize;
 
-    assert!(
-        magic == (('R' as u32) << 24 | ('B' as u32) << 16 | ('U' as u32) << 8 | ('F' as u32) << 0)
-    );
-    assert!(version == 100);
-    assert!(file_size == data.len() as u32);
+    if magic != (('R' as u32) << 24 | ('B' as u32) << 16 | ('U' as u32) << 8 | ('F' as u32) << 0) {
+        bail!("RBUF: Invalid magic");
+    }
+    if version != 100 {
+        bail!("RBUF: Unsupported version {}", version);
+    }
+    if file_size < 16 {
+        bail!("RBUF: File size {} is smaller than the header", file_size);
+    }
+    if file_size > data.len() {
+        bail!("RBUF: File is truncated ({} of {} bytes)", data.len(), file_size);
+    }
+    let data = &data[..file_size];
+    if num_buffers > (file_size - 16) / 8 {
+        bail!("RBUF: Buffer table of {} entries is out of bounds", num_buffers);
+    }
 
     let mut buffers = Vec::with_capacity(num_buffers);
     let mut cursor = 16;
-    for _ in 0..num_buffers {
+    for i in 0..num_buffers {
         let buffer_offset = read_u32_at(data, cursor) as usize;
         let buffer_size = read_u32_at(data, cursor + 4) as usize;
         cursor += 8;
 
-        let buffer = data[buffer_offset..buffer_offset + buffer_size].to_vec();
+        let buffer = data
+            .get(buffer_offset..buffer_offset + buffer_size)
+            .ok_or_else(|| anyhow!("RBUF: Buffer {} is out of bounds", i))?;
         buffers.push(buffer);
     }
 
-    buffers
+    Ok(buffers)
 }
 
 #[cfg(test)]
@@ -100,9 +117,32 @@ mod tests {
         // Example usage
         let buffers = vec![vec![1, 2, 3], vec![4, 5, 6]];
         let collated = collate_buffers(&buffers);
-        let read_buffers = read_buffer(&collated);
+        let read_buffers = read_buffer(&collated).unwrap();
 
         assert_eq!(buffers, read_buffers);
+        // Views start on 64-byte boundaries of the file
+        for view in &read_buffers {
+            assert_eq!((view.as_ptr() as usize - collated.as_ptr() as usize) % 64, 0);
+        }
         println!("Buffers successfully collated and read back!");
     }
+
+    #[test]
+    fn buffer_out_of_bounds() {
+        let mut collated = collate_buffers(&[vec![1, 2, 3]]);
+        // Grow the first buffer past the end of the file
+        collated[20..24].copy_from_slice(&0x1000u32.to_be_bytes());
+        assert!(read_buffer(&collated).is_err());
+        assert!(read_buffer(&collated[..8]).is_err());
+    }
+
+    #[test]
+    fn buffer_header_too_small() {
+        // A file_size below the 16-byte header must not wrap the table bound
+        for file_size in 0u32..16 {
+            let mut collated = collate_buffers(&[vec![1, 2, 3]]);
+            collated[12..16].copy_from_slice(&file_size.to_be_bytes());
+            assert!(read_buffer(&collated).is_err());
+        }
+    }
 }
@@ -474,25 +474,25 @@ impl JsonWriteCtx {
 }
 
 impl Archive {
-    fn from_json(archive: JsonArchive, buffers: Vec<Vec<u8>>) -> Self {
+    fn from_json(archive: JsonArchive, buffers: &[&[u8]]) -> Self {
         Self {
             chrs: archive
                 .chrs
                 .into_iter()
-                .map(|m| ChrData::from_json(m, &buffers))
+                .map(|m| ChrData::from_json(m, buffers))
                 .collect(),
             clrs: archive.clrs,
             models: archive
                 .models
                 .into_iter()
-                .map(|m| Model::from_json(m, &buffers))
+                .map(|m| Model::from_json(m, buffers))
                 .collect(),
             pats: archive.pats,
             srts: archive.srts,
             textures: archive
                 .textures
                 .into_iter()
-                .map(|t| Texture::from_json(t, &buffers))
+                .map(|t| Texture::from_json(t, buffers))
                 .collect(),
             viss: archive.viss,
         }
@@ -520,7 +520,7 @@ impl Archive {
 }
 
 impl Model {
-    fn from_json(model: JsonModel, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(model: JsonModel, buffers: &[&[u8]]) -> Self {
         Self {
             bones: model.bones,
             materials: model.materials,
@@ -572,7 +572,7 @@ impl Model {
 }
 
 impl Mesh {
-    fn from_json(json_mesh: JsonMesh, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(json_mesh: JsonMesh, buffers: &[&[u8]]) -> Self {
         Self {
             clr_buffer: json_mesh.clr_buffer,
             current_matrix: json_mesh.current_matrix,
@@ -606,11 +606,10 @@ impl Mesh {
 }
 
 impl MatrixPrimitive {
-    fn from_json(json_primitive: JsonPrimitive, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(json_primitive: JsonPrimitive, buffers: &[&[u8]]) -> Self {
         let vertex_data_buffer = buffers
             .get(json_primitive.vertexDataBufferId as usize)
-            .cloned()
-            .unwrap_or_else(Vec::new);
+            .map_or_else(Vec::new, |buffer| buffer.to_vec());
 
         Self {
             matrices: json_primitive.matrices,
@@ -630,15 +629,20 @@ impl MatrixPrimitive {
     }
 }
 
+/// Copies the elements out of a buffer view that may not be aligned for `T`.
+/// Trailing bytes that do not form a whole element are ignored.
+fn read_unaligned_vec<T: bytemuck::Pod>(data: &[u8]) -> Vec<T> {
+    data.chunks_exact(std::mem::size_of::<T>())
+        .map(bytemuck::pod_read_unaligned)
+        .collect()
+}
+
 impl VertexPositionBuffer {
-    fn from_json(buffer_data: JsonBufferData<[f32; 3]>, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(buffer_data: JsonBufferData<[f32; 3]>, buffers: &[&[u8]]) -> Self {
         let data = buffers
             .get(buffer_data.dataBufferId as usize)
             .expect("Invalid buffer ID");
-        let elem_count = data.len() / std::mem::size_of::<[f32; 3]>();
-        let data: Vec<[f32; 3]> = unsafe {
-            std::slice::from_raw_parts(data.as_ptr() as *const [f32; 3], elem_count).to_vec()
-        };
+        let data: Vec<[f32; 3]> = read_unaligned_vec(data);
 
         let cached_minmax = if let (Some(cached_min), Some(cached_max)) =
             (buffer_data.cached_min, buffer_data.cached_max)
@@ -678,14 +682,11 @@ impl VertexPositionBuffer {
 }
 
 impl VertexNormalBuffer {
-    fn from_json(buffer_data: JsonBufferData<[f32; 3]>, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(buffer_data: JsonBufferData<[f32; 3]>, buffers: &[&[u8]]) -> Self {
         let data = buffers
             .get(buffer_data.dataBufferId as usize)
             .expect("Invalid buffer ID");
-        let elem_count = data.len() / std::mem::size_of::<[f32; 3]>();
-        let data: Vec<[f32; 3]> = unsafe {
-            std::slice::from_raw_parts(data.as_ptr() as *const [f32; 3], elem_count).to_vec()
-        };
+        let data: Vec<[f32; 3]> = read_unaligned_vec(data);
 
         let cached_minmax = if let (Some(cached_min), Some(cached_max)) =
             (buffer_data.cached_min, buffer_data.cached_max)
@@ -725,14 +726,11 @@ impl VertexNormalBuffer {
 }
 
 impl VertexColorBuffer {
-    fn from_json(buffer_data: JsonBufferData<[u8; 4]>, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(buffer_data: JsonBufferData<[u8; 4]>, buffers: &[&[u8]]) -> Self {
         let data = buffers
             .get(buffer_data.dataBufferId as usize)
             .expect("Invalid buffer ID");
-        let elem_count = data.len() / std::mem::size_of::<[u8; 4]>();
-        let data: Vec<[u8; 4]> = unsafe {
-            std::slice::from_raw_parts(data.as_ptr() as *const [u8; 4], elem_count).to_vec()
-        };
+        let data: Vec<[u8; 4]> = read_unaligned_vec(data);
 
         let cached_minmax = if let (Some(cached_min), Some(cached_max)) =
             (buffer_data.cached_min, buffer_data.cached_max)
@@ -772,14 +770,11 @@ impl VertexColorBuffer {
 }
 
 impl VertexTextureCoordinateBuffer {
-    fn from_json(buffer_data: JsonBufferData<[f32; 2]>, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(buffer_data: JsonBufferData<[f32; 2]>, buffers: &[&[u8]]) -> Self {
         let data = buffers
             .get(buffer_data.dataBufferId as usize)
             .expect("Invalid buffer ID");
-        let elem_count = data.len() / std::mem::size_of::<[f32; 2]>();
-        let data: Vec<[f32; 2]> = unsafe {
-            std::slice::from_raw_parts(data.as_ptr() as *const [f32; 2], elem_count).to_vec()
-        };
+        let data: Vec<[f32; 2]> = read_unaligned_vec(data);
 
         let cached_minmax = if let (Some(cached_min), Some(cached_max)) =
             (buffer_data.cached_min, buffer_data.cached_max)
@@ -819,11 +814,10 @@ impl VertexTextureCoordinateBuffer {
 }
 
 impl Texture {
-    fn from_json(texture: JsonTexture, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(texture: JsonTexture, buffers: &[&[u8]]) -> Self {
         let data = buffers
             .get(texture.dataBufferId as usize)
-            .map(|buffer| buffer.clone())
-            .unwrap_or_else(Vec::new);
+            .map_or_else(Vec::new, |buffer| buffer.to_vec());
 
         Self {
             data,
@@ -855,7 +849,7 @@ impl Texture {
 }
 
 impl ChrData {
-    fn from_json(json_data: JSONChrData, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(json_data: JSONChrData, buffers: &[&[u8]]) -> Self {
         let nodes = json_data
             .nodes
             .into_iter()
@@ -913,7 +907,7 @@ impl ChrNode {
 }
 
 impl ChrTrack {
-    fn from_json(json_track: JSONChrTrack, buffers: &[Vec<u8>]) -> Self {
+    fn from_json(json_track: JSONChrTrack, buffers: &[&[u8]]) -> Self {
         let data = buffers
             .get(json_track.framesDataBufferId as usize)
             .expect("Invalid buffer ID");
@@ -983,8 +977,9 @@ mod tests {
         match read_json(file_path) {
             Ok(json_archive) => {
                 // Assuming buffers are loaded here
-                let buffers = buffers::read_buffer(&fs::read("dummy.bin").unwrap());
-                let archive = Archive::from_json(json_archive, buffers);
+                let bin = fs::read("dummy.bin").unwrap();
+                let buffers = buffers::read_buffer(&bin).unwrap();
+                let archive = Archive::from_json(json_archive, &buffers);
                 // Add more tests to validate Archive methods
                 assert!(archive.get_model("example").is_some());
                 assert!(archive.get_texture("human_A").is_some());
@@ -998,11 +993,12 @@ fn create_archive(json_str: &str, raw_buffer: &[u8]) -> anyhow::Result<Archive>
     // Decode the JSON string to JsonArchive
     let json_archive: JsonArchive = serde_json::from_str(json_str)?;
 
-    // Convert the raw buffer to Vec<Vec<u8>> using read_buffer
-    let buffers = buffers::read_buffer(raw_buffer);
+    // Split the raw buffer into views using read_buffer; the archive copies
+    // out of them as it decodes, so no intermediate buffers are allocated.
+    let buffers = buffers::read_buffer(raw_buffer)?;
 
     // Create and return the Archive
-    Ok(Archive::from_json(json_archive, buffers))
+    Ok(Archive::from_json(json_archive, &buffers))
 }
 
 fn create_json(archive: &Archive) -> anyhow::Result<(String, Vec<u8>)> {
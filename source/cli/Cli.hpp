@@ -57,6 +57,8 @@ enum {
 
   TYPE_BRRES2JSON,
   TYPE_JSON2BRRES,
+
+  TYPE_BENCH_SCENE,
 };
 
 template <size_t L> struct CFixedString {
@@ -92,6 +94,18 @@ struct CliOptions {
   uint32_t szs_algo = 0;
   uint32_t texture_format = 0xE;
   bool32 yay0 = false;
+  uint32_t seek_index = 0; // KiB between checkpoints, 0 = none
+  uint32_t kcl_max_prisms = 16;
+  uint32_t kcl_min_width = 256;
+  uint32_t kcl_max_depth = 10;
+  float kcl_padding = 250.0f;
+  uint32_t jobs = 0; // Shared thread pool size, 0 = all cores
+  bool32 no_validate = false;
+  uint32_t palette_format = 2; // librii::gx::PaletteFormat, RGB5A3
+  CFixedString<256> texture_cache; // Empty = per-user cache folder
+  bool32 use_texture_cache = false;
+  bool32 cmpr_high_quality = false; // Slower, higher-quality CMPR encoding
+  uint32_t frames = 1000;
 };
 
 std::optional<CliOptions> parse(int argc, const char** argv);
@@ -2,33 +2,46 @@
 #include <core/util/oishii.hpp>
 #include <core/util/timestamp.hpp>
 #include <fmt/color.h>
+#include <fstream>
 #include <iostream>
 #include <librii/assimp/LRAssimp.hpp>
 #include <librii/assimp2rhst/Assimp.hpp>
 #include <librii/assimp2rhst/SupportedFiles.hpp>
 #include <librii/crate/g3d_crate.hpp>
 #include <librii/crate/j3d_crate.hpp>
+#include <librii/g3d/data/PaletteData.hpp>
 #include <librii/g3d/io/JSON.hpp>
 #include <librii/g3d/io/TextureIO.hpp>
+#include <librii/image/EncodeCache.hpp>
+#include <librii/image/Palette.hpp>
 #include <librii/j3d/PreciseBMDDump.hpp>
+#include <librii/kcol/Builder.hpp>
 #include <librii/kcol/Model.hpp>
 #include <librii/kmp/io/KMP.hpp>
 #include <librii/rarc/RARC.hpp>
+#include <librii/render/G3dGfx.hpp>
 #include <librii/rhst/MeshUtils.hpp>
 #include <librii/rhst/RHSTOptimizer.hpp>
 #include <librii/szs/SZS.hpp>
 #include <librii/u8/U8.hpp>
 #include <mutex>
+#include <nlohmann/json.hpp>
+#include <oishii/util/util.hxx>
 #include <plugins/g3d/G3dIo.hpp>
 #include <plugins/g3d/collection.hpp>
 #include <plugins/j3d/J3dIo.hpp>
 #include <plugins/j3d/Preset.hpp>
 #include <plugins/rhst/RHSTImporter.hpp>
 #include <rsl/Filesystem.hpp>
+#include <rsl/Hash.hpp>
+#include <rsl/Ranges.hpp>
+#include <rsl/StageTimer.hpp>
 #include <rsl/Stb.hpp>
 #include <rsl/StringManip.hpp>
+#include <rsl/ThreadPool.hpp>
 #include <rsl/Timer.hpp>
 #include <rsl/WriteFile.hpp>
+#include <set>
 #include <sstream>
 
 namespace librii::g3d {
@@ -39,6 +52,9 @@ struct DumpResult {
 };
 
 DumpResult DumpJson(const librii::g3d::Archive& archive);
+Result<void> DumpJsonToFiles(const librii::g3d::Archive& archive,
+                             std::string_view json_path,
+                             std::string_view bin_path);
 Result<std::vector<u8>> WriteArchive(std::string_view json,
                                      std::span<const u8> blob);
 
@@ -101,12 +117,21 @@ static auto GetMips(const CliOptions& opt)
   };
 }
 
+static librii::image::EncodeOptions GetEncodeOptions(const CliOptions& opt) {
+  return {.cmpr_high_quality = static_cast<bool>(opt.cmpr_high_quality)};
+}
+
 #define FS_TRY(expr)                                                           \
   TRY(expr.transform_error([](const std::error_code& ec) -> std::string {      \
     return std::format("Filesystem Error: {} ({}:{})", ec.message(), __FILE__, \
                        __LINE__);                                              \
   }))
 
+static void PrintStageTimes(const rsl::StageTimer& stages) {
+  fmt::print(stderr, "\nStage timings ({} threads):\n{}",
+             rsl::ThreadPool::Shared().threadCount(), stages.report());
+}
+
 class ImportBRRES {
 public:
   ImportBRRES(const CliOptions& opt) : m_opt(opt) {}
@@ -145,8 +170,11 @@ public:
       fmt::print(stdout, "Dumped ASSIMP json\n");
       return {};
     }
+    rsl::StageTimer stages;
+    rsl::StageTimer::Scope import_stage(stages, "Assimp import");
     auto tree = librii::assimp2rhst::DoImport(m_from.string(), on_log,
                                               std::span(*file), settings);
+    import_stage.stop();
     if (!tree) {
       return std::unexpected("Failed to parse: " + tree.error());
     }
@@ -161,9 +189,10 @@ public:
       on_log(kpi::IOMessageClass::Information, c, v);
     };
     auto m_result = std::make_unique<librii::g3d::Archive>();
-    bool ok = riistudio::rhst::CompileRHST(*tree, *m_result, m_from.string(),
-                                           info, progress, GetMips(m_opt),
-                                           !m_opt.no_tristrip, m_opt.verbose);
+    bool ok = riistudio::rhst::CompileRHST(
+        *tree, *m_result, m_from.string(), info, progress, GetMips(m_opt),
+        !m_opt.no_tristrip, m_opt.verbose, !m_opt.no_validate, &stages,
+        GetEncodeOptions(m_opt));
     if (!ok) {
       return std::unexpected("Failed to parse RHST");
     }
@@ -202,7 +231,10 @@ public:
         }
       }
     }
+    rsl::StageTimer::Scope write_stage(stages, "Write");
     TRY(m_result->write(m_to.string()));
+    write_stage.stop();
+    PrintStageTimes(stages);
     return {};
   }
 
@@ -312,8 +344,11 @@ public:
       fmt::print(stdout, "Dumped ASSIMP json\n");
       return {};
     }
+    rsl::StageTimer stages;
+    rsl::StageTimer::Scope import_stage(stages, "Assimp import");
     auto tree = librii::assimp2rhst::DoImport(m_from.string(), on_log,
                                               std::span(*file), settings);
+    import_stage.stop();
     if (!tree) {
       return std::unexpected("Failed to parse: " + tree.error());
     }
@@ -324,9 +359,10 @@ public:
       on_log(kpi::IOMessageClass::Information, c, v);
     };
     auto m_result = std::make_unique<riistudio::j3d::Collection>();
-    bool ok = riistudio::rhst::CompileRHST(*tree, *m_result, m_from.string(),
-                                           info, progress, GetMips(m_opt),
-                                           !m_opt.no_tristrip, m_opt.verbose);
+    bool ok = riistudio::rhst::CompileRHST(
+        *tree, *m_result, m_from.string(), info, progress, GetMips(m_opt),
+        !m_opt.no_tristrip, m_opt.verbose, !m_opt.no_validate, &stages,
+        GetEncodeOptions(m_opt));
     if (!ok) {
       return std::unexpected("Failed to parse RHST");
     }
@@ -368,9 +404,12 @@ public:
         fmt::print(stdout, "{}\n", fmt::styled(s, fmt::fg(fmt::color::green)));
       }
     }
+    rsl::StageTimer::Scope write_stage(stages, "Write");
     oishii::Writer result(std::endian::big);
     TRY(riistudio::j3d::WriteBMD(*m_result, result, false));
     result.saveToDisk(m_to.string());
+    write_stage.stop();
+    PrintStageTimes(stages);
     return {};
   }
 
@@ -442,6 +481,17 @@ private:
   std::filesystem::path m_presets;
 };
 
+// Checks for a YAZ0 header without consuming it.
+static bool IsStreamYaz0(std::istream& in) {
+  std::array<char, 4> magic{};
+  in.read(magic.data(), magic.size());
+  bool yaz0 = in.gcount() == 4 && magic[0] == 'Y' && magic[1] == 'a' &&
+              magic[2] == 'z' && (magic[3] == '0' || magic[3] == '1');
+  in.clear();
+  in.seekg(0);
+  return yaz0;
+}
+
 class DecompressSZS {
 public:
   DecompressSZS(const CliOptions& opt) : m_opt(opt) {}
@@ -454,22 +504,55 @@ public:
     if (!pok) {
       return std::unexpected("Error: failed to parse args: " + pok.error());
     }
+    if (FS_TRY(rsl::filesystem::exists(m_to)) &&
+        FS_TRY(rsl::filesystem::is_directory(m_to))) {
+      return std::unexpected("Failed to extract: |to| is a folder, not a file");
+    }
+    std::ifstream in(m_from.string(), std::ios::binary);
+    if (!in) {
+      return std::unexpected("Error: Failed to read file");
+    }
+    if (IsStreamYaz0(in)) {
+      fmt::print(stderr, "Decompressing SZS: {} => {}\n", m_from.string(),
+                 m_to.string());
+      // Stream straight from disk to disk; neither file is held in memory.
+      // The output only replaces |to| once the whole stream decoded, so a
+      // corrupt file never leaves a partial extract behind.
+      auto tmp = m_to;
+      tmp += ".tmp";
+      Result<void> ok;
+      {
+        std::ofstream out(tmp.string(), std::ios::binary);
+        ok = librii::szs::decodeStream(
+            in, [&](std::span<const u8> chunk) -> Result<void> {
+              out.write(reinterpret_cast<const char*>(chunk.data()),
+                        chunk.size());
+              if (!out) {
+                return std::unexpected("Failed to write " + tmp.string());
+              }
+              return {};
+            });
+      }
+      if (!ok) {
+        (void)rsl::filesystem::remove(tmp);
+        return ok;
+      }
+      FS_TRY(rsl::filesystem::rename(tmp, m_to));
+      return {};
+    }
+    in.close();
+
+    // YAY0 is deinterlaced into separate tables, so it cannot be streamed.
     auto file = ReadFile(m_opt.from.view());
     if (!file.has_value()) {
       return std::unexpected("Error: Failed to read file");
     }
     // Max 4GB
     u32 size = TRY(librii::szs::getExpandedSize(*file));
-    std::string fmt = librii::szs::isDataYaz0Compressed(*file) ? "SZS" : "SZP";
-    fmt::print(stderr, "Decompressing {}: {} => {}\n", fmt, m_from.string(),
+    fmt::print(stderr, "Decompressing SZP: {} => {}\n", m_from.string(),
                m_to.string());
     std::vector<u8> buf(size);
-    TRY(librii::szs::decode(buf, *file,
-                            !librii::szs::isDataYaz0Compressed(*file)));
-    if (FS_TRY(rsl::filesystem::exists(m_to)) &&
-        FS_TRY(rsl::filesystem::is_directory(m_to))) {
-      return std::unexpected("Failed to extract: |to| is a folder, not a file");
-    }
+    TRY(librii::szs::decode(buf, *file, true));
     TRY(rsl::WriteFile(buf, m_to.string()));
     return {};
   }
@@ -526,13 +609,25 @@ public:
     fmt::print(stderr, "Compressing {}: {} => {} ({} strategy)\n",
                m_opt.yay0 ? "SZP (YAY0)" : "SZS (YAZ0)", m_from.string(),
                m_to.string(), fmt::styled(sname, fmt::fg(fmt::color::gold)));
-    auto buf = TRY(librii::szs::encodeAlgo(*file, strat, m_opt.yay0));
+    auto buf =
+        TRY(librii::szs::encodeAlgo(*file, strat, m_opt.yay0, m_opt.jobs));
     float elapsed = static_cast<float>(timer.elapsed()) * 0.001f;
     float rate =
         static_cast<float>(buf.size()) / static_cast<float>(file->size());
     buf.resize(roundUp(buf.size(), 32));
     TRY(rsl::WriteFile(buf, m_to.string()));
 
+    auto index_path = m_to.string() + ".idx";
+    if (m_opt.seek_index != 0 && !m_opt.yay0) {
+      auto index =
+          TRY(librii::szs::buildSeekIndex(buf, m_opt.seek_index * 1024));
+      fmt::print(stderr, "Writing seek index: {}\n", index_path);
+      TRY(rsl::WriteFile(index, index_path));
+    } else if (FS_TRY(rsl::filesystem::exists(index_path))) {
+      // An index of the file we just replaced would only be rejected later.
+      FS_TRY(rsl::filesystem::remove(index_path));
+    }
+
     fmt::print("Elapsed time: {:.2f} seconds. Compression rate: {:.2f}% "
                "(lower is better)",
                fmt::styled(elapsed, fmt::fg(fmt::color::light_green)),
@@ -594,17 +689,20 @@ public:
     if (m_from.extension() != ".rhst") {
       return std::unexpected("File format is unsupported");
     }
-    auto file = ReadFile(m_opt.from.view());
+    auto file = oishii::MappedFile::Open(m_opt.from.view());
     if (!file.has_value()) {
-      return std::unexpected("Failed to read file");
-    }
-    auto tree = librii::rhst::ReadSceneTree(*file);
-    if (!tree) {
-      return std::unexpected("Failed to parse RHST: " + tree.error());
+      return std::unexpected("Failed to read file: " + file.error());
     }
     auto progress = [&](std::string_view s, float f) {
       progress_put(std::string(s), f);
     };
+    rsl::StageTimer stages;
+    rsl::StageTimer::Scope parse_stage(stages, "Parse RHST");
+    auto tree = librii::rhst::ReadSceneTree((*file)->data(), progress);
+    parse_stage.stop();
+    if (!tree) {
+      return std::unexpected("Failed to parse RHST: " + tree.error());
+    }
     const auto on_log = [](kpi::IOMessageClass c, std::string_view d,
                            std::string_view b) {
       rsl::info("message: {} {} {}", magic_enum::enum_name(c), d, b);
@@ -613,15 +711,19 @@ public:
       on_log(kpi::IOMessageClass::Information, c, v);
     };
     auto m_result = std::make_unique<T>();
-    bool ok = riistudio::rhst::CompileRHST(*tree, *m_result, m_from.string(),
-                                           info, progress, GetMips(m_opt),
-                                           !m_opt.no_tristrip, m_opt.verbose);
+    bool ok = riistudio::rhst::CompileRHST(
+        *tree, *m_result, m_from.string(), info, progress, GetMips(m_opt),
+        !m_opt.no_tristrip, m_opt.verbose, !m_opt.no_validate, &stages,
+        GetEncodeOptions(m_opt));
     if (!ok) {
       return std::unexpected("Failed to compile RHST");
     }
+    rsl::StageTimer::Scope write_stage(stages, "Write");
     oishii::Writer result(std::endian::big);
     TRY(WriteIt(*m_result, result));
     result.saveToDisk(m_to.string());
+    write_stage.stop();
+    PrintStageTimes(stages);
     return {};
   }
 
@@ -663,27 +765,30 @@ public:
     if (!pok) {
       return std::unexpected("Error: failed to parse args: " + pok.error());
     }
-    auto file = ReadFile(m_opt.from.view());
-    if (!file.has_value()) {
-      return std::unexpected("Error: Failed to read file");
-    }
-
     std::string fmt = "RAW";
     // Max 4GB
     std::vector<u8> buf;
-    if (librii::szs::isDataYaz0Compressed(*file)) {
-      u32 size = TRY(librii::szs::getExpandedSize(*file));
-      buf.resize(size);
-      TRY(librii::szs::decode(buf, *file));
+    if (TRY(decodeWithIndex(buf))) {
+      fmt = "SZS";
+    } else if (std::ifstream in(m_from.string(), std::ios::binary);
+               in && IsStreamYaz0(in)) {
+      // Decode while reading, so the compressed file is never held in memory.
+      buf = TRY(librii::szs::decodeStream(in));
       fmt = "SZS";
-    } else if (file->size() >= 4 && (*file)[0] == 'Y' && (*file)[1] == 'a' &&
-               (*file)[2] == 'y') {
-      u32 size = TRY(librii::szs::getExpandedSize(*file));
-      buf.resize(size);
-      TRY(librii::szs::decode(buf, *file, true));
-      fmt = "SZP";
     } else {
-      buf = std::move(*file);
+      auto file = ReadFile(m_opt.from.view());
+      if (!file.has_value()) {
+        return std::unexpected("Error: Failed to read file");
+      }
+      if (file->size() >= 4 && (*file)[0] == 'Y' && (*file)[1] == 'a' &&
+          (*file)[2] == 'y') {
+        u32 size = TRY(librii::szs::getExpandedSize(*file));
+        buf.resize(size);
+        TRY(librii::szs::decode(buf, *file, true));
+        fmt = "SZP";
+      } else {
+        buf = std::move(*file);
+      }
     }
 
     fmt::print(stderr, "Extracting ARC.{},{} => {}\n", fmt, m_from.string(),
@@ -703,6 +808,35 @@ public:
   }
 
 private:
+  //! A seek index next to the file lets it be decoded on several cores. The
+  //! index is only a hint: if it is missing, unreadable or was built from a
+  //! different file, returns false and the caller decodes the file normally.
+  Result<bool> decodeWithIndex(std::vector<u8>& buf) {
+    auto index_path = m_from.string() + ".idx";
+    if (!FS_TRY(rsl::filesystem::exists(index_path))) {
+      return false;
+    }
+    auto file = ReadFile(m_opt.from.view());
+    if (!file.has_value()) {
+      return std::unexpected("Error: Failed to read file");
+    }
+    auto ok = [&]() -> Result<void> {
+      auto index = ReadFile(index_path);
+      if (!index.has_value()) {
+        return std::unexpected("Failed to read file");
+      }
+      buf.resize(TRY(librii::szs::getExpandedSize(*file)));
+      return librii::szs::decodeWithIndex(buf, *file, *index, m_opt.jobs);
+    }();
+    if (!ok) {
+      fmt::print(stderr, "Ignoring seek index {}: {}\n", index_path,
+                 ok.error());
+      buf.clear();
+      return false;
+    }
+    return true;
+  }
+
   Result<void> parseArgs() {
     m_from = m_opt.from.view();
     m_to = m_opt.to.view();
@@ -903,9 +1037,6 @@ static Result<void> kcl2json(const CliOptions& m_opt) {
   return {};
 }
 static Result<void> json2kcl(const CliOptions& m_opt) {
-  return std::unexpected("unimplemented!");
-}
-static Result<void> brres2json(const CliOptions& m_opt) {
   if (m_opt.verbose) {
     rsl::logging::init();
   }
@@ -914,7 +1045,7 @@ static Result<void> brres2json(const CliOptions& m_opt) {
 
   if (m_to.empty()) {
     std::filesystem::path p = m_from;
-    p.replace_extension(".json");
+    p.replace_extension(".kcl");
     m_to = p;
   }
   if (!FS_TRY(rsl::filesystem::exists(m_from))) {
@@ -930,16 +1061,69 @@ static Result<void> brres2json(const CliOptions& m_opt) {
   if (!file.has_value()) {
     return std::unexpected("Error: Failed to read file");
   }
-  auto brres = TRY(
-      librii::g3d::Archive::fromMemory(*file, std::string(m_opt.from.view())));
+  const librii::kcol::KclBuildOptions build{
+      .max_prisms_per_leaf = m_opt.kcl_max_prisms,
+      .min_leaf_width = m_opt.kcl_min_width,
+      .max_depth = m_opt.kcl_max_depth,
+      .cube_padding = m_opt.kcl_padding,
+  };
+  std::string_view text{(const char*)file->data(), file->size()};
+
+  librii::kcol::KCollisionData kcl;
+  auto ext = m_from.extension();
+  if (ext == ".obj" || ext == ".rhst") {
+    std::vector<librii::kcol::KclTriangle> tris;
+    if (ext == ".obj") {
+      tris = TRY(librii::kcol::ReadOBJTriangles(text));
+    } else {
+      auto progress = [&](std::string_view s, float f) {
+        progress_put(std::string(s), f);
+      };
+      auto tree = librii::rhst::ReadSceneTree(*file, progress);
+      progress_end();
+      tris = librii::kcol::ReadRHSTTriangles(TRY(tree));
+    }
+    kcl = TRY(librii::kcol::BuildKCollisionData(tris, build));
+    fmt::print(stderr, "Built {} prisms from {} triangles\n",
+               kcl.prism_data.size(), tris.size());
+  } else {
+    kcl = librii::kcol::LoadJSON(text);
+    TRY(librii::kcol::BuildOctree(kcl, build));
+  }
 
-  auto dumped = librii::g3d::DumpJson(brres);
+  TRY(rsl::WriteFile(librii::kcol::WriteKCollisionData(kcl), m_to.string()));
+  return {};
+}
+static Result<void> brres2json(const CliOptions& m_opt) {
+  if (m_opt.verbose) {
+    rsl::logging::init();
+  }
+  std::filesystem::path m_from = m_opt.from.view();
+  std::filesystem::path m_to = m_opt.to.view();
 
-  std::ofstream stream(m_to);
-  stream << dumped.jsonData;
+  if (m_to.empty()) {
+    std::filesystem::path p = m_from;
+    p.replace_extension(".json");
+    m_to = p;
+  }
+  if (!FS_TRY(rsl::filesystem::exists(m_from))) {
+    fmt::print(stderr, "Error: File {} does not exist.\n", m_from.string());
+    return std::unexpected("FolderNotExist");
+  }
+  if (FS_TRY(rsl::filesystem::exists(m_to))) {
+    fmt::print(stderr,
+               "Warning: File {} will be overwritten by this operation.\n",
+               m_to.string());
+  }
+  // Parse straight from the mapped file
+  auto reader = TRY(oishii::BinaryReader::FromFilePath(m_opt.from.view(),
+                                                       std::endian::big));
+  auto brres = TRY(librii::g3d::Archive::fromMemory(
+      reader.slice(), std::string(m_opt.from.view())));
 
-  TRY(rsl::WriteFile(dumped.collatedBuffer,
-                     m_to.replace_extension("bin").string()));
+  auto bin = m_to;
+  bin.replace_extension("bin");
+  TRY(librii::g3d::DumpJsonToFiles(brres, m_to.string(), bin.string()));
 
   return {};
 }
@@ -948,12 +1132,140 @@ static Result<void> json2brres(const CliOptions& m_opt) {
   std::filesystem::path m_from = m_opt.from.view();
   auto file = TRY(ReadFile(m_from.string()));
   std::string_view json(reinterpret_cast<char*>(file.data()), file.size());
-  auto bin = TRY(ReadFile(m_from.replace_extension("bin").string()));
-  auto converted = TRY(librii::g3d::WriteArchive(json, bin));
+  // The archive is decoded straight from views into the mapped .bin file.
+  auto bin =
+      TRY(oishii::MappedFile::Open(m_from.replace_extension("bin").string()));
+  auto converted = TRY(librii::g3d::WriteArchive(json, bin->data()));
   TRY(rsl::WriteFile(converted, m_opt.to.view()));
   return {};
 }
 
+//! Stands in for the GL objects of a scene, so the CPU side of building draws
+//! can be timed without a context.
+struct HeadlessDrawResolver final : public librii::g3d::gfx::DrawResolver {
+  Result<riistudio::lib3d::IndexRange>
+  vertices(const librii::g3d::gfx::DrawCallPath& path) override {
+    u32 start = next_index;
+    next_index += 3;
+    return riistudio::lib3d::IndexRange{.start = start, .size = 3};
+  }
+  u32 vao() override { return 1; }
+  Result<u32> shader(const libcube::IGCMaterial& mat,
+                     riistudio::lib3d::RenderType type) override {
+    return 1;
+  }
+  std::optional<u32> texture(const std::string& name) override {
+    return 1;
+  }
+  Result<u32> defaultTexture() override { return 0; }
+  u32 uniformMin(u32 shader, u32 binding) override { return 0; }
+
+  u32 next_index = 0;
+};
+
+static Result<std::vector<u8>> ReadSceneBrres(const CliOptions& m_opt) {
+  auto file = TRY(ReadFile(m_opt.from.view()));
+  if (file.size() < 4 || file[0] != 'Y' || file[1] != 'a' || file[2] != 'z') {
+    return file;
+  }
+  std::vector<u8> buf(TRY(librii::szs::getExpandedSize(file)));
+  TRY(librii::szs::decode(buf, file, true));
+  auto arc = TRY(librii::U8::LoadU8Archive(buf));
+  for (auto& node : arc.nodes) {
+    if (!node.is_folder && node.name == "course_model.brres") {
+      auto begin = arc.file_data.begin() + node.file.offset;
+      return std::vector<u8>(begin, begin + node.file.size);
+    }
+  }
+  return std::unexpected("Error: No course_model.brres in archive");
+}
+
+//! Times building the draw list of a scene, and keeping it up to date when
+//! nothing or only a bone or material changes.
+static Result<void> benchScene(const CliOptions& m_opt) {
+  if (m_opt.verbose) {
+    rsl::logging::init();
+  }
+  using clock = std::chrono::steady_clock;
+  const auto micros = [](clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+  };
+  const u32 frames = std::max(m_opt.frames, 1u);
+
+  const auto file = TRY(ReadSceneBrres(m_opt));
+  auto brres = TRY(librii::g3d::Archive::fromMemory(
+      file, std::string(m_opt.from.view())));
+  riistudio::g3d::Collection c;
+  TRY(riistudio::g3d::ReadBRRES(c, brres, std::string(m_opt.from.view())));
+  if (c.getModels().empty() || c.getModels()[0].getBones().empty()) {
+    return std::unexpected("Error: File has no models with bones");
+  }
+
+  HeadlessDrawResolver resolver;
+  const glm::mat4 mtx(1.0f);
+  const auto type = riistudio::lib3d::RenderType::Preview;
+  librii::gfx::SceneBuffers buffers;
+  const auto frame = [&](librii::g3d::gfx::G3dDrawList& list)
+      -> Result<void> {
+    buffers.opaque.nodes.clear();
+    buffers.translucent.nodes.clear();
+    TRY(list.sync(c, resolver, type, {}));
+    TRY(list.emit(buffers, mtx, mtx, mtx));
+    return {};
+  };
+  const auto time_frames = [&](librii::g3d::gfx::G3dDrawList& list,
+                               auto&& edit) -> Result<double> {
+    auto begin = clock::now();
+    for (u32 i = 0; i < frames; ++i) {
+      edit(i);
+      TRY(frame(list));
+    }
+    return micros(clock::now() - begin) / frames;
+  };
+
+  // A fresh list each frame: the retained list's own full rebuild. This is not
+  // the removed per-frame scene node path.
+  double full = 0.0;
+  for (u32 i = 0; i < frames; ++i) {
+    librii::g3d::gfx::G3dDrawList fresh;
+    auto begin = clock::now();
+    TRY(frame(fresh));
+    full += micros(clock::now() - begin);
+  }
+  full /= frames;
+
+  librii::g3d::gfx::G3dDrawList list;
+  TRY(frame(list));
+  const auto draws = list.draws.size();
+  const double idle = TRY(time_frames(list, [](u32) {}));
+
+  auto& bone = c.getModels()[0].getBones()[0];
+  const auto srt = bone.getSRT();
+  const double bone_edit = TRY(time_frames(list, [&](u32 i) {
+    auto moved = srt;
+    moved.translation.x += static_cast<f32>(i % 2);
+    bone.setSRT(moved);
+  }));
+  bone.setSRT(srt);
+
+  double mat_edit = 0.0;
+  if (auto mats = c.getModels()[0].getMaterials(); !mats.empty()) {
+    mat_edit = TRY(time_frames(list, [&](u32) {
+      mats[0].getMaterialData().tevKonstColors[0].r ^= 1;
+    }));
+  }
+
+  fmt::print("{}: {} draws, {} frames\n", m_opt.from.view(), draws, frames);
+  const auto row = [](std::string_view what, double us) {
+    fmt::print("  {:<36}{:10.2f} us/frame\n", what, us);
+  };
+  row("Full rebuild of the retained list:", full);
+  row("Retained, no changes:", idle);
+  row("Retained, bone edit:", bone_edit);
+  row("Retained, material edit:", mat_edit);
+  return {};
+}
+
 static Result<void> dumpPresetsG3D(const CliOptions& m_opt) {
   std::filesystem::path m_from = m_opt.from.view();
   std::filesystem::path m_to = m_opt.to.view();
@@ -1087,6 +1399,57 @@ static Result<void> preciseBmdDump(const CliOptions& m_opt) {
   return {};
 }
 
+// Stripifies every mesh of |model|. Meshes share the model's buffers, so they
+// are decompiled and recompiled in order; only the stripification in between
+// runs concurrently.
+template <typename ModelT>
+static Result<void> OptimizeMeshes(ModelT& model, bool verbose, bool validate,
+                                   u32& before, u32& after) {
+  std::vector<librii::rhst::Mesh> meshes;
+  std::vector<std::string> names;
+  for (auto& mesh : model.getMeshes()) {
+    auto rhst = TRY(riistudio::rhst::decompileMesh(mesh, model));
+    before += librii::rhst::VertexCount(rhst);
+    meshes.push_back(TRY(librii::rhst::MeshUtils::TriangulateMesh(rhst)));
+    names.push_back(mesh.getName());
+  }
+  // One task per matrix primitive, so a single large mesh still spreads out.
+  struct Job {
+    librii::rhst::MatrixPrimitive* mp;
+    size_t mesh;
+    Result<librii::rhst::Algo> result;
+  };
+  std::vector<Job> jobs;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    for (auto& mp : meshes[i].matrix_primitives) {
+      jobs.push_back({.mp = &mp, .mesh = i});
+    }
+  }
+  std::atomic<size_t> done = 0;
+  {
+    rsl::TaskGroup group;
+    for (auto& job : jobs) {
+      group.run([&] {
+        job.result = librii::rhst::StripifyTriangles(*job.mp, std::nullopt,
+                                                     names[job.mesh], verbose,
+                                                     validate);
+        auto percent = static_cast<f32>(++done) / static_cast<f32>(jobs.size());
+        progress_put("Optimizing mesh " + names[job.mesh], percent);
+      });
+    }
+  }
+  for (auto& job : jobs) {
+    TRY(job.result);
+  }
+  size_t i = 0;
+  for (auto& mesh : model.getMeshes()) {
+    after += librii::rhst::VertexCount(meshes[i]);
+    TRY(riistudio::rhst::compileMesh(mesh, meshes[i], model, false, false));
+    ++i;
+  }
+  return {};
+}
+
 static Result<void> optimizeG3D(const CliOptions& m_opt) {
   std::filesystem::path m_from = m_opt.from.view();
   std::filesystem::path m_to = m_opt.to.view();
@@ -1120,29 +1483,15 @@ static Result<void> optimizeG3D(const CliOptions& m_opt) {
   riistudio::g3d::Collection c;
   TRY(riistudio::g3d::ReadBRRES(c, brres, m_from.string()));
 
-  fmt::println(
-      "Performing \"facepoint\" reduction strategy (single-core mode)");
+  fmt::println("Performing \"facepoint\" reduction strategy ({} threads)",
+               rsl::ThreadPool::Shared().threadCount());
   u32 before = 0;
   u32 after = 0;
   rsl::Timer timer;
   timer.reset();
   for (auto& model : c.getModels()) {
-    u32 i = 0;
-    for (auto& mesh : model.getMeshes()) {
-      auto percent =
-          static_cast<f32>(i) / static_cast<f32>(model.getMeshes().size());
-      ++i;
-      progress_put("Optimizing mesh " + mesh.getName(), percent);
-      auto rhst = TRY(riistudio::rhst::decompileMesh(mesh, model));
-      before += librii::rhst::VertexCount(rhst);
-      auto rhstP = TRY(librii::rhst::MeshUtils::TriangulateMesh(rhst));
-      for (auto& mp : rhstP.matrix_primitives) {
-        TRY(librii::rhst::StripifyTriangles(mp, std::nullopt, mesh.getName(),
-                                            m_opt.verbose));
-      }
-      after += librii::rhst::VertexCount(rhstP);
-      TRY(riistudio::rhst::compileMesh(mesh, rhstP, model, false, false));
-    }
+    TRY(OptimizeMeshes(model, m_opt.verbose, !m_opt.no_validate, before,
+                       after));
   }
   float elapsed = static_cast<float>(timer.elapsed()) * 0.001f;
   auto rate =
@@ -1192,29 +1541,15 @@ static Result<void> optimizeJ3D(const CliOptions& m_opt) {
   fmt::print(stderr, "Optimizing BMD,{} => {}\n", m_from.string(),
              m_to.string());
   auto bmd = TRY(riistudio::j3d::ReadBMD(m_from.string()));
-  fmt::println(
-      "Performing \"facepoint\" reduction strategy (single-core mode)");
+  fmt::println("Performing \"facepoint\" reduction strategy ({} threads)",
+               rsl::ThreadPool::Shared().threadCount());
   u32 before = 0;
   u32 after = 0;
   rsl::Timer timer;
   timer.reset();
   for (auto& model : bmd.getModels()) {
-    u32 i = 0;
-    for (auto& mesh : model.getMeshes()) {
-      auto percent =
-          static_cast<f32>(i) / static_cast<f32>(model.getMeshes().size());
-      ++i;
-      progress_put("Optimizing mesh " + mesh.getName(), percent);
-      auto rhst = TRY(riistudio::rhst::decompileMesh(mesh, model));
-      before += librii::rhst::VertexCount(rhst);
-      auto rhstP = TRY(librii::rhst::MeshUtils::TriangulateMesh(rhst));
-      for (auto& mp : rhstP.matrix_primitives) {
-        TRY(librii::rhst::StripifyTriangles(mp, std::nullopt, mesh.getName(),
-                                            m_opt.verbose));
-      }
-      after += librii::rhst::VertexCount(rhstP);
-      TRY(riistudio::rhst::compileMesh(mesh, rhstP, model, false, false));
-    }
+    TRY(OptimizeMeshes(model, m_opt.verbose, !m_opt.no_validate, before,
+                       after));
   }
   float elapsed = static_cast<float>(timer.elapsed()) * 0.001f;
   auto rate =
@@ -1233,6 +1568,331 @@ static Result<void> optimizeJ3D(const CliOptions& m_opt) {
   return {};
 }
 
+// One texture of an import-tex0 run.
+struct Tex0Job {
+  std::filesystem::path from;
+  std::string name;
+  librii::gx::TextureFormat format = librii::gx::TextureFormat::CMPR;
+  librii::gx::PaletteFormat palette_format = librii::gx::PaletteFormat::RGB5A3;
+  bool mipmaps = true;
+  u32 min_mip = 32;
+  u32 max_mip = 5;
+};
+struct Tex0Result {
+  librii::g3d::TextureData tex;
+  std::optional<librii::g3d::PaletteData> palette;
+};
+
+static Result<Tex0Job> MakeTex0Job(const CliOptions& m_opt,
+                                   std::filesystem::path from) {
+  return Tex0Job{
+      .from = from,
+      .name = from.stem().string(),
+      .format =
+          TRY(rsl::enum_cast<librii::gx::TextureFormat>(m_opt.texture_format)),
+      .palette_format =
+          TRY(rsl::enum_cast<librii::gx::PaletteFormat>(m_opt.palette_format)),
+      .mipmaps = static_cast<bool>(m_opt.mipmaps),
+      .min_mip = m_opt.min_mip,
+      .max_mip = m_opt.max_mips,
+  };
+}
+
+static Result<Tex0Result>
+ImportTex0Job(const Tex0Job& job, const librii::image::EncodeOptions& options) {
+  auto path = job.from.string();
+  auto image = rsl::stb::load(path);
+  if (!image) {
+    return std::unexpected(
+        std::format("Failed to import texture {}: stb_image didn't "
+                    "recognize it or didn't exist.",
+                    path));
+  }
+  riistudio::g3d::Texture tex;
+  // Palette formats are resized as raw RGBA first, so that the whole mip chain
+  // can be quantized to one palette.
+  const bool paletted = librii::gx::IsPaletteFormat(job.format);
+  const auto ok = riistudio::rhst::importTexture(
+      tex, image->data, job.mipmaps, job.min_mip, job.max_mip, image->width,
+      image->height, image->channels,
+      paletted ? librii::gx::TextureFormat::Extension_RawRGBA32 : job.format,
+      options);
+  if (!ok) {
+    return std::unexpected(
+        std::format("Failed to import texture {}: {}", path, ok.error()));
+  }
+  tex.setName(job.name);
+
+  Tex0Result result;
+  if (paletted) {
+    // The raw mip chain, quantized below.
+    std::vector<u8> raw(tex.getData().begin(), tex.getData().end());
+    tex.setTextureFormat(job.format);
+    tex.resizeData();
+    result.palette = librii::g3d::PaletteData{
+        .name = job.name,
+        .format = job.palette_format,
+    };
+    auto texels = tex.getData();
+    // Entries hold the texels followed by the TLUT.
+    auto* cache = librii::image::EncodeCache::Shared();
+    librii::image::EncodeCacheKey key;
+    std::optional<std::vector<u8>> cached;
+    if (cache != nullptr) {
+      key = {
+          .source_hash = rsl::xxh64(raw),
+          .source_width = tex.getWidth(),
+          .source_height = tex.getHeight(),
+          .width = tex.getWidth(),
+          .height = tex.getHeight(),
+          .format = static_cast<u32>(job.format),
+          .mip_count = tex.getMipmapCount(),
+          .palette_format = static_cast<u32>(job.palette_format),
+      };
+      cached = cache->find(key);
+    }
+    // A TLUT holds 1 to getMaxPaletteSize() entries of 16 bits each; anything
+    // else was not written by this importer.
+    const size_t tlut_size = cached ? cached->size() - texels.size() : 0;
+    if (cached && cached->size() > texels.size() && tlut_size % 2 == 0 &&
+        tlut_size / 2 <= librii::image::getMaxPaletteSize(job.format)) {
+      memcpy(texels.data(), cached->data(), texels.size());
+      result.palette->data.assign(cached->begin() + texels.size(),
+                                  cached->end());
+    } else {
+      auto palette = TRY(librii::image::encodePaletted(
+          texels, raw, tex.getWidth(), tex.getHeight(), job.format,
+          job.palette_format, tex.getMipmapCount()));
+      rsl::info("{}: {} color palette", job.name, palette.colors.size());
+      result.palette->data = librii::image::encodeTlut(palette);
+      if (cache != nullptr) {
+        std::vector<u8> entry(texels.begin(), texels.end());
+        entry.insert(entry.end(), result.palette->data.begin(),
+                     result.palette->data.end());
+        cache->store(key, entry);
+      }
+    }
+  }
+  result.tex = std::move(static_cast<librii::g3d::TextureData&>(tex));
+  return result;
+}
+
+static Result<void> WriteTex0Result(const Tex0Result& result,
+                                    const std::filesystem::path& to) {
+  if (result.palette) {
+    // The texture finds its palette by name, so both share the file stem.
+    auto plt_path = to;
+    plt_path.replace_extension(".plt0");
+    TRY(librii::g3d::WritePLT0ToFile(*result.palette, plt_path.string()));
+  }
+  TRY(librii::g3d::WriteTEX0ToFile(result.tex, to.string()));
+  return {};
+}
+
+// `*` matches any run of characters, `?` any single character.
+static bool MatchWildcard(std::string_view pattern, std::string_view str) {
+  size_t p = 0, s = 0;
+  size_t star = std::string_view::npos, resume = 0;
+  while (s < str.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == str[s])) {
+      ++p;
+      ++s;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      resume = s;
+    } else if (star != std::string_view::npos) {
+      p = star + 1;
+      s = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+
+static bool IsWildcard(const std::filesystem::path& path) {
+  return path.filename().string().find_first_of("*?") != std::string::npos;
+}
+
+// Image files in |folder| whose name matches |pattern|, sorted by name.
+static Result<std::vector<std::filesystem::path>>
+FindImages(const std::filesystem::path& folder, std::string_view pattern) {
+  std::error_code ec;
+  std::vector<std::filesystem::path> paths;
+  for (auto&& it : std::filesystem::directory_iterator(folder, ec)) {
+    auto ext = it.path().extension().string();
+    std::ranges::transform(ext, ext.begin(),
+                           [](unsigned char c) { return std::tolower(c); });
+    if (!it.is_regular_file() ||
+        !MatchWildcard(pattern, it.path().filename().string())) {
+      continue;
+    }
+    if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" ||
+        ext == ".tga") {
+      paths.push_back(it.path());
+    }
+  }
+  if (ec) {
+    return std::unexpected(std::format("Failed to list folder {}: {}",
+                                       folder.string(), ec.message()));
+  }
+  std::ranges::sort(paths);
+  return paths;
+}
+
+// A manifest lists textures to import, relative to the manifest's folder.
+// Settings left out fall back to the command line:
+//
+// {
+//   "textures": [
+//     { "path": "grass.png", "name": "grass", "format": 14, "mipmaps": true,
+//       "min_mip": 32, "max_mip": 5, "palette_format": 2 }
+//   ]
+// }
+static Result<std::vector<Tex0Job>>
+ReadTex0Manifest(const CliOptions& m_opt, const std::filesystem::path& path) {
+  auto file = ReadFile(path.string());
+  if (!file) {
+    return std::unexpected(
+        std::format("Failed to read manifest {}", path.string()));
+  }
+  auto j = nlohmann::json::parse(*file, nullptr, false);
+  if (j.is_discarded() || !j.is_object() || !j["textures"].is_array()) {
+    return std::unexpected(std::format(
+        "Manifest {} must be an object with a \"textures\" array",
+        path.string()));
+  }
+  std::vector<Tex0Job> jobs;
+  for (auto&& [i, entry] : rsl::enumerate(j["textures"])) {
+    if (!entry.is_object() || !entry["path"].is_string()) {
+      return std::unexpected(
+          std::format("Manifest entry {} has no \"path\"", i));
+    }
+    auto from = path.parent_path() / entry["path"].get<std::string>();
+    auto job = TRY(MakeTex0Job(m_opt, from));
+    try {
+      job.name = entry.value("name", job.name);
+      job.format = TRY(rsl::enum_cast<librii::gx::TextureFormat>(
+          entry.value("format", m_opt.texture_format)));
+      job.palette_format = TRY(rsl::enum_cast<librii::gx::PaletteFormat>(
+          entry.value("palette_format", m_opt.palette_format)));
+      job.mipmaps = entry.value("mipmaps", job.mipmaps);
+      job.min_mip = entry.value("min_mip", job.min_mip);
+      job.max_mip = entry.value("max_mip", job.max_mip);
+    } catch (const nlohmann::json::exception& e) {
+      return std::unexpected(
+          std::format("Manifest entry {}: {}", i, e.what()));
+    }
+    jobs.push_back(std::move(job));
+  }
+  return jobs;
+}
+
+// Imports many textures in one process, one task per texture on the shared
+// thread pool. Writes .tex0 (+ .plt0) files to a folder, or a single .brres.
+static Result<void> import_tex0_batch(const CliOptions& m_opt,
+                                      const std::filesystem::path& m_from,
+                                      std::filesystem::path m_to) {
+  const bool manifest = m_from.extension() == ".json";
+  const bool glob = IsWildcard(m_from);
+  // Outputs default to the folder the textures come from.
+  const auto folder = manifest || glob ? m_from.parent_path() : m_from;
+  std::vector<Tex0Job> jobs;
+  if (manifest) {
+    jobs = TRY(ReadTex0Manifest(m_opt, m_from));
+  } else {
+    auto paths = TRY(
+        FindImages(folder.empty() ? "." : folder,
+                   glob ? m_from.filename().string() : std::string("*")));
+    for (auto& path : paths) {
+      jobs.push_back(TRY(MakeTex0Job(m_opt, path)));
+    }
+  }
+  if (jobs.empty()) {
+    return std::unexpected(
+        std::format("No textures to import in {}", m_from.string()));
+  }
+  std::set<std::string> names;
+  for (auto& job : jobs) {
+    if (!names.insert(job.name).second) {
+      return std::unexpected(
+          std::format("Two textures are named {}", job.name));
+    }
+  }
+
+  if (m_to.empty()) {
+    m_to = folder;
+  }
+  const bool brres = m_to.extension() == ".brres";
+  if (brres) {
+    for (auto& job : jobs) {
+      if (librii::gx::IsPaletteFormat(job.format)) {
+        return std::unexpected(std::format(
+            "{}: .brres output does not support palette formats yet. Write "
+            ".tex0 files to a folder instead.",
+            job.name));
+      }
+    }
+  } else if (!m_to.empty()) {
+    FS_TRY(rsl::filesystem::create_directories(m_to));
+  }
+
+  rsl::Timer timer;
+  // Textures already spread over the pool, so each encodes on one thread.
+  auto options = GetEncodeOptions(m_opt);
+  options.num_threads = 1;
+  std::vector<Result<Tex0Result>> results(jobs.size());
+  std::atomic<size_t> done = 0;
+  {
+    rsl::TaskGroup group;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      group.run([&, i] {
+        auto& result = results[i];
+        result = ImportTex0Job(jobs[i], options);
+        if (result && !brres) {
+          auto ok = WriteTex0Result(*result, m_to / (jobs[i].name + ".tex0"));
+          if (!ok) {
+            result = std::unexpected(ok.error());
+          } else {
+            // Written; drop the pixels.
+            *result = {};
+          }
+        }
+        if (m_opt.verbose) {
+          auto percent =
+              static_cast<f32>(++done) / static_cast<f32>(jobs.size());
+          progress_put("Imported " + jobs[i].name, percent);
+        }
+      });
+    }
+  }
+
+  size_t failed = 0;
+  for (auto& result : results) {
+    if (!result) {
+      fmt::print(stderr, "Error: {}\n", result.error());
+      ++failed;
+    }
+  }
+  if (failed) {
+    return std::unexpected(std::format("{} of {} textures failed to import",
+                                       failed, jobs.size()));
+  }
+  if (brres) {
+    librii::g3d::Archive archive;
+    for (auto& result : results) {
+      archive.textures.push_back(std::move(result->tex));
+    }
+    TRY(archive.write(m_to.string()));
+  }
+  fmt::print("Imported {} textures to {} in {:.2f} seconds.\n", jobs.size(),
+             m_to.string(), static_cast<f32>(timer.elapsed()) / 1000.0f);
+  return {};
+}
+
 static Result<void> import_tex0(const CliOptions& m_opt) {
   if (m_opt.verbose) {
     rsl::logging::init();
@@ -1240,9 +1900,11 @@ static Result<void> import_tex0(const CliOptions& m_opt) {
   std::filesystem::path m_from = m_opt.from.view();
   std::filesystem::path m_to = m_opt.to.view();
 
-  auto format =
-      TRY(rsl::enum_cast<librii::gx::TextureFormat>(m_opt.texture_format));
-
+  if (IsWildcard(m_from) || m_from.extension() == ".json" ||
+      (FS_TRY(rsl::filesystem::exists(m_from)) &&
+       FS_TRY(rsl::filesystem::is_directory(m_from)))) {
+    return import_tex0_batch(m_opt, m_from, m_to);
+  }
   if (m_to.empty()) {
     std::filesystem::path p = m_from;
     p.replace_extension(".tex0");
@@ -1257,27 +1919,9 @@ static Result<void> import_tex0(const CliOptions& m_opt) {
                "Warning: File {} will be overwritten by this operation.\n",
                m_to.string());
   }
-  auto path = m_from.string();
-  auto image = rsl::stb::load(path);
-  if (!image) {
-    return std::unexpected(
-        std::format("Failed to import texture {}: stb_image didn't "
-                    "recognize it or didn't exist.",
-                    path));
-  }
-  std::vector<u8> scratch;
-  riistudio::g3d::Texture tex;
-  const auto ok = riistudio::rhst::importTexture(
-      tex, image->data, scratch, m_opt.mipmaps, m_opt.min_mip, m_opt.max_mips,
-      image->width, image->height, image->channels, format);
-  if (!ok) {
-    return std::unexpected(
-        std::format("Failed to import texture {}: {}", path, ok.error()));
-  }
-  std::filesystem::path fsp(m_opt.from.view());
-  tex.setName(fsp.stem().string());
-
-  TRY(librii::g3d::WriteTEX0ToFile(tex, m_to.string()));
+  auto job = TRY(MakeTex0Job(m_opt, m_from));
+  auto result = TRY(ImportTex0Job(job, GetEncodeOptions(m_opt)));
+  TRY(WriteTex0Result(result, m_to));
 
   return {};
 }
@@ -1289,6 +1933,12 @@ int main(int argc, const char** argv) {
     fmt::print("::\n");
     return -1;
   }
+  rsl::ThreadPool::SetSharedThreadCount(args->jobs);
+  if (args->use_texture_cache) {
+    std::filesystem::path cache = args->texture_cache.view();
+    librii::image::EncodeCache::SetSharedFolder(
+        cache.empty() ? librii::image::EncodeCache::DefaultFolder() : cache);
+  }
   if (args->type == TYPE_KMP2JSON) {
     auto ok = kmp2json(*args);
     if (!ok) {
@@ -1332,6 +1982,13 @@ int main(int argc, const char** argv) {
       return -1;
     }
   }
+  if (args->type == TYPE_BENCH_SCENE) {
+    auto ok = benchScene(*args);
+    if (!ok) {
+      fmt::print(stderr, "{}\n", ok.error());
+      return -1;
+    }
+  }
   if (args->type == TYPE_IMPORT_BRRES) {
     progress_put("Processing...", 0.0f);
     ImportBRRES cmd(*args);
@@ -1449,5 +2106,11 @@ int main(int argc, const char** argv) {
       return -1;
     }
   }
+  if (auto* cache = librii::image::EncodeCache::Shared();
+      cache != nullptr && cache->hits() + cache->misses() > 0) {
+    fmt::print("Texture cache: {} of {} textures reused ({})\n",
+               cache->hits(), cache->hits() + cache->misses(),
+               cache->folder().string());
+  }
   return 0;
 }
@@ -19,6 +19,18 @@ use std::ffi::OsString;
 pub struct MyArgs {
     #[command(subcommand)]
     pub command: Commands,
+
+    /// Worker threads for importing, stripifying, encoding textures and compressing (0 = all cores)
+    #[arg(short, long, global = true, default_value = "0")]
+    pub jobs: u32,
+
+    /// Reuse encoded textures across runs, cached in FOLDER (default: the per-user cache folder)
+    #[arg(long, global = true, num_args = 0..=1, require_equals = true, default_missing_value = "", value_name = "FOLDER")]
+    pub texture_cache: Option<String>,
+
+    /// Encode CMPR textures with a slower, higher-quality search
+    #[arg(long, global = true)]
+    pub cmpr_high_quality: bool,
 }
 
 /// Import a .dae/.fbx file as .brres
@@ -99,6 +111,10 @@ pub struct ImportCommand {
     #[clap(long)]
     preset_path: Option<String>,
 
+    /// Skip checking that stripified meshes still match the input (faster)
+    #[clap(long, default_value = "false")]
+    no_validate: bool,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -144,6 +160,8 @@ enum SzsAlgo {
     CTLib,
     LibYaz0,
     MK8,
+    MkwParallel,
+    Optimal,
 }
 
 /// Compress a file as .szs
@@ -164,6 +182,11 @@ pub struct CompressCommand {
     #[clap(short, long, default_value = "false")]
     yay0: bool,
 
+    /// Also write a seek index (<to>.idx) with a checkpoint every N KiB, for
+    /// parallel and random-access decoding. The .szs itself is unchanged.
+    #[clap(long)]
+    seek_index: Option<u32>,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -224,6 +247,21 @@ pub struct JsonToBrres {
     verbose: bool,
 }
 
+/// Benchmark scene building
+#[derive(Parser, Debug)]
+pub struct BenchScene {
+    /// File to load (.brres, .szs)
+    #[arg(required = true)]
+    from: String,
+
+    /// Number of frames to time
+    #[clap(long, default_value = "1000")]
+    frames: u32,
+
+    #[clap(short, long, default_value = "false")]
+    verbose: bool,
+}
+
 /// Dump a kcl as json
 #[derive(Parser, Debug)]
 pub struct KclToJson {
@@ -238,16 +276,32 @@ pub struct KclToJson {
     verbose: bool,
 }
 
-/// Convert to kcl from json
+/// Build a kcl from json, .obj or .rhst
 #[derive(Parser, Debug)]
 pub struct JsonToKcl {
-    /// File to read (.json)
+    /// File to read (.json, .obj, .rhst)
     #[arg(required = true)]
     from: String,
 
     /// Output file for kcl (.kcl)
     to: Option<String>,
 
+    /// Octree cubes holding more prisms than this are split further
+    #[clap(long, default_value = "16")]
+    max_prisms: u32,
+
+    /// Smallest octree cube width
+    #[clap(long, default_value = "256")]
+    min_width: u32,
+
+    /// Maximum octree depth below the root cubes
+    #[clap(long, default_value = "10")]
+    max_depth: u32,
+
+    /// Distance around each cube within which prisms are still listed
+    #[clap(long, default_value = "250.0")]
+    padding: f32,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -262,6 +316,10 @@ pub struct Rhst2BrresCommand {
     /// Output .brres file
     to: Option<String>,
 
+    /// Skip checking that stripified meshes still match the input (faster)
+    #[clap(long, default_value = "false")]
+    no_validate: bool,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -276,6 +334,10 @@ pub struct Rhst2BmdCommand {
     /// Output .bmd file
     to: Option<String>,
 
+    /// Skip checking that stripified meshes still match the input (faster)
+    #[clap(long, default_value = "false")]
+    no_validate: bool,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -340,6 +402,10 @@ pub struct Optimize {
     /// BRRES archive to write (or none for default)
     to: Option<String>,
 
+    /// Skip checking that stripified meshes still match the input (faster)
+    #[clap(long, default_value = "false")]
+    no_validate: bool,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -347,11 +413,13 @@ pub struct Optimize {
 /// Import a .png/etc file as .tex0
 #[derive(Parser, Debug)]
 pub struct ImportTex0 {
-    /// File to import from: .png, .jpg, etc
+    /// File to import from: .png, .jpg, etc. A folder, a wildcard pattern
+    /// ("textures/*.png") or a .json manifest imports many textures at once
     #[arg(required = true)]
     from: String,
 
-    /// File to export to
+    /// File to export to. When importing many textures: a folder for the
+    /// .tex0 files, or a single .brres archive
     to: Option<String>,
 
     /// Whether to generate mipmaps for textures
@@ -370,6 +438,10 @@ pub struct ImportTex0 {
     #[arg(long, default_value = "14")]
     format: u32,
 
+    /// Palette format for C4/C8/C14X2 (format 8/9/10): 0 = IA8, 1 = RGB565, 2 = RGB5A3
+    #[arg(long, default_value = "2")]
+    palette_format: u32,
+
     #[clap(short, long, default_value = "false")]
     verbose: bool,
 }
@@ -412,6 +484,9 @@ pub enum Commands {
     BrresToJson(BrresToJson),
     JsonToBrres(JsonToBrres),
 
+    /// Time building the draw list of a .brres/.szs, without a GPU
+    BenchScene(BenchScene),
+
     DumpPresets(DumpPresets),
 
     PreciseBMDDump(PreciseBMDDump),
@@ -450,6 +525,18 @@ pub struct CliOptions {
     pub szs_algo: c_uint,
     pub format: c_uint,
     pub yay0: c_uint,
+    pub seek_index: c_uint,
+    pub kcl_max_prisms: c_uint,
+    pub kcl_min_width: c_uint,
+    pub kcl_max_depth: c_uint,
+    pub kcl_padding: c_float,
+    pub jobs: c_uint,
+    pub no_validate: c_uint,
+    pub palette_format: c_uint,
+    pub texture_cache: [c_char; 256],
+    pub use_texture_cache: c_uint,
+    pub cmpr_high_quality: c_uint,
+    pub frames: c_uint,
 }
 
 fn is_valid_hexcode(value: String) -> Result<(), String> {
@@ -476,7 +563,7 @@ impl MyArgs {
     fn to_cli_options(&self) -> CliOptions {
         let default_str = String::new();
 
-        match &self.command {
+        let mut opts = match &self.command {
             Commands::ImportCommand(i) => {
                 eprintln!("{}", "\n|--------------------------------\n|\n| Warning: `import-command` has been deprecated in favor of `import-brres`!\n|\n|--------------------------------\n".red().bold());
                 let tint_val = u32::from_str_radix(&i.tint[1..], 16).unwrap_or(0xFF_FFFF);
@@ -515,6 +602,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: i.no_validate as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                 }
             }
             Commands::ImportBrres(i) => {
@@ -552,6 +651,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: i.no_validate as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
 
                     model_name: model_name2,
                 }
@@ -593,6 +704,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: i.no_validate as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -627,6 +750,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -640,6 +775,18 @@ impl MyArgs {
                     verbose: i.verbose as c_uint,
                     szs_algo: i.algorithm.unwrap_or(SzsAlgo::CTGP) as c_uint,
                     yay0: i.yay0 as c_uint,
+                    seek_index: i.seek_index.unwrap_or(0) as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
 
                     // Junk fields
                     preset_path: [0; 256],
@@ -695,6 +842,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -729,6 +888,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -763,6 +934,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -797,6 +980,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: i.max_prisms as c_uint,
+                    kcl_min_width: i.min_width as c_uint,
+                    kcl_max_depth: i.max_depth as c_uint,
+                    kcl_padding: i.padding as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -831,6 +1026,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -865,6 +1072,63 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
+                    model_name: [0; 256],
+                }
+            }
+            Commands::BenchScene(i) => {
+                let from2 = string_to_cstring(i.from.as_str());
+                CliOptions {
+                    c_type: 19,
+                    from: from2,
+                    verbose: i.verbose as c_uint,
+                    frames: i.frames as c_uint,
+
+                    // Junk fields
+                    to: [0; 256],
+                    preset_path: [0; 256],
+                    scale: 0.0 as c_float,
+                    brawlbox_scale: 0 as c_uint,
+                    mipmaps: 0 as c_uint,
+                    min_mip: 0 as c_uint,
+                    max_mips: 0 as c_uint,
+                    auto_transparency: 0 as c_uint,
+                    merge_mats: 0 as c_uint,
+                    bake_uvs: 0 as c_uint,
+                    tint: 0 as c_uint,
+                    cull_degenerates: 0 as c_uint,
+                    cull_invalid: 0 as c_uint,
+                    recompute_normals: 0 as c_uint,
+                    fuse_vertices: 0 as c_uint,
+                    no_tristrip: 0 as c_uint,
+                    ai_json: 0 as c_uint,
+                    no_compression: 0 as c_uint,
+                    rarc: 0 as c_uint,
+                    szs_algo: 0 as c_uint,
+                    format: 0 as c_uint,
+                    yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -899,6 +1163,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: i.no_validate as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -933,6 +1209,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: i.no_validate as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -967,6 +1255,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -1001,6 +1301,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -1035,6 +1347,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -1069,6 +1393,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -1103,6 +1439,18 @@ impl MyArgs {
                     szs_algo: 0 as c_uint,
                     format: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: i.no_validate as c_uint,
+                    palette_format: 0 as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
@@ -1137,10 +1485,27 @@ impl MyArgs {
                     rarc: 0 as c_uint,
                     szs_algo: 0 as c_uint,
                     yay0: 0 as c_uint,
+                    seek_index: 0 as c_uint,
+                    kcl_max_prisms: 0 as c_uint,
+                    kcl_min_width: 0 as c_uint,
+                    kcl_max_depth: 0 as c_uint,
+                    kcl_padding: 0.0 as c_float,
+                    jobs: 0 as c_uint,
+                    no_validate: 0 as c_uint,
+                    palette_format: i.palette_format as c_uint,
+                    texture_cache: [0; 256],
+                    use_texture_cache: 0 as c_uint,
+                    cmpr_high_quality: 0 as c_uint,
+                    frames: 0 as c_uint,
                     model_name: [0; 256],
                 }
             }
-        }
+        };
+        opts.jobs = self.jobs as c_uint;
+        opts.texture_cache = string_to_cstring(self.texture_cache.as_deref().unwrap_or(&default_str));
+        opts.use_texture_cache = self.texture_cache.is_some() as c_uint;
+        opts.cmpr_high_quality = self.cmpr_high_quality as c_uint;
+        opts
     }
 }
 
@@ -42,10 +42,9 @@ Result<librii::g3d::TextureData> ReadTexture(const rsl::File& file) {
                     "recognize it or didn't exist.",
                     path));
   }
-  std::vector<u8> scratch;
   riistudio::g3d::Texture tex;
   const auto ok = riistudio::rhst::importTexture(
-      tex, image->data, scratch, true, 64, 4, image->width, image->height,
+      tex, image->data, true, 64, 4, image->width, image->height,
       image->channels);
   if (!ok) {
     return std::unexpected(
@@ -132,12 +132,11 @@ struct AdvancedTextureConverter {
     u32 src_size = first_width * first_height * 4;
     // If mips are also sent, just ignore
     EXPECT(source_data.size() >= src_size);
-    std::vector<u8> scratch;
     if (should_throw || (is_power_of_2(width) && is_power_of_2(height) &&
                          width > 4 && height > 4)) {
       TRY(riistudio::rhst::importTextureImpl(
-          dst_encoded, source_data, scratch, mip_levels - 1, width, height,
-          first_width, first_height, format, resizer));
+          dst_encoded, source_data, mip_levels - 1, width, height, first_width,
+          first_height, format, resizer, librii::image::MipFilter::Resample));
     }
     // Bust cache
     dst_encoded.nextGenerationId();
@@ -20,6 +20,17 @@ uint32_t rii_compute_image_size_mip(uint32_t format, uint32_t width,
 void rii_encode(uint32_t format, void* dst, uint32_t dst_len, const void* src,
                 uint32_t src_len, uint32_t width, uint32_t height);
 
+//! CMPR endpoint search (see gctex::CmprQuality)
+#define RII_CMPR_QUALITY_STANDARD 0
+#define RII_CMPR_QUALITY_HIGH 1
+
+//! Encode from raw 32-bit color to the specified format. `num_threads` caps
+//! the workers of parallel encoders (CMPR); 0 uses every core.
+void rii_encode_ex(uint32_t format, void* dst, uint32_t dst_len,
+                   const void* src, uint32_t src_len, uint32_t width,
+                   uint32_t height, uint32_t num_threads,
+                   uint32_t cmpr_quality);
+
 //! Decode from the specified format to raw 32-bit color
 void rii_decode(void* dst, uint32_t dst_len, const void* src, uint32_t src_len,
                 uint32_t width, uint32_t height, uint32_t texformat,
@@ -94,6 +105,13 @@ static inline uint32_t compute_image_size_mip(uint32_t format, uint32_t width,
   return ::rii_compute_image_size_mip(format, width, height, number_of_images);
 }
 
+//! Options for encode_into
+struct EncodeOptions {
+  //! Workers of parallel encoders (CMPR). 0 uses every core.
+  uint32_t num_threads = 0;
+  uint32_t cmpr_quality = RII_CMPR_QUALITY_STANDARD;
+};
+
 #ifndef GCTEX_DO_NOT_DEFINE_SPAN_APIS
 
 //! Encode from raw 32-bit color to the specified format
@@ -104,6 +122,14 @@ static inline void encode_into(uint32_t format, std::span<uint8_t> dst,
                height);
 }
 
+//! Encode from raw 32-bit color to the specified format
+static inline void encode_into(uint32_t format, std::span<uint8_t> dst,
+                               std::span<const uint8_t> src, uint32_t width,
+                               uint32_t height, const EncodeOptions& options) {
+  ::rii_encode_ex(format, dst.data(), dst.size(), src.data(), src.size(),
+                  width, height, options.num_threads, options.cmpr_quality);
+}
+
 //! Encode from raw 32-bit color to the specified format
 static inline std::vector<uint8_t> encode(uint32_t format,
                                           std::span<const uint8_t> src,
@@ -1175,6 +1175,8 @@ const CMPR_MAX_COL: u32 = 16;
 struct DXTEncodingPalette {
     opaque_count: u32,
     p: [[u8; 4]; 4],
+    // Pick indices against the colors the GPU decodes (see `cmpr_palette`).
+    gpu_blend: bool,
 }
 
 use heapless;
@@ -1189,6 +1191,7 @@ impl DXTEncodingPalette {
         DXTEncodingPalette {
             opaque_count: 0,
             p: [[0; 4]; 4],
+            gpu_blend: false,
         }
     }
 
@@ -1295,6 +1298,243 @@ impl DXTEncodingPalette {
         self.p[0].copy_from_slice(&freq_buckets[best0].col);
         self.p[1].copy_from_slice(&freq_buckets[best1].col);
     }
+
+    // `CmprQuality::High`: after `calculate_values`, also try endpoints that are
+    // not colors of the block. These come from the principal axis of the
+    // opaque pixels (PCA), refined by a few least-squares passes (cluster fit).
+    // Candidates are scored against the colors the GPU decodes, and only
+    // replace the endpoints when the block error improves.
+    fn refine_values(self: &mut Self, data: &[u8]) {
+        if self.opaque_count == 0 {
+            return;
+        }
+        self.gpu_blend = true;
+        let mut best_error = cmpr_block_error(data, self);
+        if best_error == 0 {
+            return;
+        }
+
+        let mut points = heapless::Vec::<[f32; 3], 16>::new();
+        for color in data.chunks(4) {
+            if color[3] >= 0x80 {
+                let _ = points.push([color[0] as f32, color[1] as f32, color[2] as f32]);
+            }
+        }
+        let n = points.len() as f32;
+
+        let mut mean = [0.0f32; 3];
+        for p in &points {
+            for c in 0..3 {
+                mean[c] += p[c] / n;
+            }
+        }
+        let mut cov = [[0.0f32; 3]; 3];
+        for p in &points {
+            let d = [p[0] - mean[0], p[1] - mean[1], p[2] - mean[2]];
+            for i in 0..3 {
+                for j in 0..3 {
+                    cov[i][j] += d[i] * d[j];
+                }
+            }
+        }
+
+        // Power iteration, seeded with the row of largest variance.
+        let seed = (0..3).fold(0, |best, i| if cov[i][i] > cov[best][best] { i } else { best });
+        let mut axis = cov[seed];
+        for _ in 0..8 {
+            let next = [
+                dot3(&cov[0], &axis),
+                dot3(&cov[1], &axis),
+                dot3(&cov[2], &axis),
+            ];
+            let len = dot3(&next, &next).sqrt();
+            if len < 1e-6 {
+                break;
+            }
+            axis = [next[0] / len, next[1] / len, next[2] / len];
+        }
+        if dot3(&axis, &axis) < 1e-6 {
+            // All opaque pixels share one color.
+            axis = [1.0, 1.0, 1.0];
+        }
+
+        let (mut t_min, mut t_max) = (f32::MAX, f32::MIN);
+        for p in &points {
+            let t = dot3(&[p[0] - mean[0], p[1] - mean[1], p[2] - mean[2]], &axis);
+            t_min = t_min.min(t);
+            t_max = t_max.max(t);
+        }
+        let mut e0 = [0.0f32; 3];
+        let mut e1 = [0.0f32; 3];
+        for c in 0..3 {
+            e0[c] = mean[c] + axis[c] * t_max;
+            e1[c] = mean[c] + axis[c] * t_min;
+        }
+        self.try_endpoints(data, &e0, &e1, &mut best_error);
+
+        // Weight of e0 for each palette entry.
+        let weights: &[f32] = if self.opaque_count < CMPR_MAX_COL {
+            &[1.0, 0.0, 0.5]
+        } else {
+            &[1.0, 0.0, 5.0 / 8.0, 3.0 / 8.0]
+        };
+        for _ in 0..3 {
+            let (mut aa, mut bb, mut ab) = (0.0f32, 0.0f32, 0.0f32);
+            let mut ax = [0.0f32; 3];
+            let mut bx = [0.0f32; 3];
+            for p in &points {
+                let mut best_w = 0.0;
+                let mut best_d = f32::MAX;
+                for &w in weights {
+                    let mut d = 0.0;
+                    for c in 0..3 {
+                        let v = w * e0[c] + (1.0 - w) * e1[c] - p[c];
+                        d += v * v;
+                    }
+                    if d < best_d {
+                        best_d = d;
+                        best_w = w;
+                    }
+                }
+                let (a, b) = (best_w, 1.0 - best_w);
+                aa += a * a;
+                bb += b * b;
+                ab += a * b;
+                for c in 0..3 {
+                    ax[c] += a * p[c];
+                    bx[c] += b * p[c];
+                }
+            }
+            let det = aa * bb - ab * ab;
+            if det.abs() < 1e-6 {
+                break;
+            }
+            for c in 0..3 {
+                e0[c] = ((ax[c] * bb - bx[c] * ab) / det).clamp(0.0, 255.0);
+                e1[c] = ((bx[c] * aa - ax[c] * ab) / det).clamp(0.0, 255.0);
+            }
+            if !self.try_endpoints(data, &e0, &e1, &mut best_error) && best_error == 0 {
+                break;
+            }
+        }
+    }
+
+    fn try_endpoints(
+        self: &mut Self,
+        data: &[u8],
+        e0: &[f32; 3],
+        e1: &[f32; 3],
+        best_error: &mut u32,
+    ) -> bool {
+        let quantize = |e: &[f32; 3]| {
+            let [r, g, b] = e.map(|c| c.round().clamp(0.0, 255.0) as u8);
+            rgb565_to_rgba8(rgb8_to_rgb565(r, g, b))
+        };
+        let mut candidate = DXTEncodingPalette::new();
+        candidate.opaque_count = self.opaque_count;
+        candidate.gpu_blend = self.gpu_blend;
+        candidate.p[0] = quantize(e0);
+        candidate.p[1] = quantize(e1);
+        let error = cmpr_block_error(data, &candidate);
+        if error >= *best_error {
+            return false;
+        }
+        *best_error = error;
+        self.p[0] = candidate.p[0];
+        self.p[1] = candidate.p[1];
+        true
+    }
+}
+
+fn dot3(a: &[f32; 3], b: &[f32; 3]) -> f32 {
+    a[0] * b[0] + a[1] * b[1] + a[2] * b[2]
+}
+
+// The endpoints as written to the block. Their order selects the palette mode:
+// p0 < p1 reserves index 3 for transparency.
+fn cmpr_endpoints(info: &DXTEncodingPalette) -> (u16, u16) {
+    let p0 = rgb8_to_rgb565(info.p[0][0], info.p[0][1], info.p[0][2]);
+    let p1 = rgb8_to_rgb565(info.p[1][0], info.p[1][1], info.p[1][2]);
+    if info.opaque_count < CMPR_MAX_COL {
+        if p0 == p1 {
+            (p0 & !1, p1 | 1)
+        } else if p0 > p1 {
+            (p1, p0)
+        } else {
+            (p0, p1)
+        }
+    } else {
+        if p0 == p1 {
+            (p0 | 1, p1 & !1)
+        } else if p0 < p1 {
+            (p1, p0)
+        } else {
+            (p0, p1)
+        }
+    }
+}
+
+// The colors of a block with endpoints p0, p1. The GPU blends at 3/8 and 5/8
+// (`decode_dxt_block`); WIMGT assumes thirds, which `CmprQuality::Standard`
+// keeps so its output stays unchanged.
+fn cmpr_palette(p0: u16, p1: u16, gpu_blend: bool) -> [[u8; 4]; 4] {
+    if !gpu_blend {
+        let pal0 = rgb565_to_rgba8(p0);
+        let pal1 = rgb565_to_rgba8(p1);
+        if p0 < p1 {
+            let pal2 = mix_1_2(&pal0, &pal1);
+            return [pal0, pal1, pal2, [0; 4]];
+        }
+        let (pal2, pal3) = mix_2_3(&pal0, &pal1);
+        return [pal0, pal1, pal2, pal3];
+    }
+    let expand = |c: u16| {
+        [
+            convert_5_to_8(((c >> 11) & 0x1F) as u8),
+            convert_6_to_8(((c >> 5) & 0x3F) as u8),
+            convert_5_to_8((c & 0x1F) as u8),
+            0xff,
+        ]
+    };
+    let pal0 = expand(p0);
+    let pal1 = expand(p1);
+    let blend = |w0: u32, w1: u32| {
+        let mut c = [0xff; 4];
+        for i in 0..3 {
+            c[i] = ((pal0[i] as u32 * w0 + pal1[i] as u32 * w1) / (w0 + w1)) as u8;
+        }
+        c
+    };
+    if p0 < p1 {
+        [pal0, pal1, blend(1, 1), [0; 4]]
+    } else {
+        [pal0, pal1, blend(5, 3), blend(3, 5)]
+    }
+}
+
+// Total distance of the opaque pixels to the palette entries
+// `encode_dxt_block_with_palette` would pick for them.
+fn cmpr_block_error(data: &[u8], info: &DXTEncodingPalette) -> u32 {
+    let (p0, p1) = cmpr_endpoints(info);
+    let [pal0, pal1, pal2, pal3] = cmpr_palette(p0, p1, info.gpu_blend);
+    let mut error = 0;
+    for pixel in data.chunks(4) {
+        if info.opaque_count < CMPR_MAX_COL {
+            if pixel[3] >= 0x80 {
+                let d0 = calc_distance(pixel, &pal0);
+                let d1 = calc_distance(pixel, &pal1);
+                let d2 = calc_distance(pixel, &pal2);
+                error += min(d0, min(d1, d2));
+            }
+        } else {
+            let d0 = calc_distance(pixel, &pal0);
+            let d1 = calc_distance(pixel, &pal1);
+            let d2 = calc_distance(pixel, &pal2);
+            let d3 = calc_distance(pixel, &pal3);
+            error += min(min(d0, d1), min(d2, d3));
+        }
+    }
+    error
 }
 
 // Ref: WIMGT
@@ -1315,25 +1555,14 @@ fn encode_dxt_block_with_palette(data: &[u8], info: &DXTEncodingPalette, dest: &
         }
 
         // Handle transparent pixels
-        let p0 = rgb8_to_rgb565(info.p[0][0], info.p[0][1], info.p[0][2]);
-        let p1 = rgb8_to_rgb565(info.p[1][0], info.p[1][1], info.p[1][2]);
-        let (p0, p1) = if p0 == p1 {
-            (p0 & !1, p1 | 1)
-        } else if p0 > p1 {
-            (p1, p0)
-        } else {
-            (p0, p1)
-        };
-
+        let (p0, p1) = cmpr_endpoints(info);
         assert!(p0 < p1);
         write_be16(&mut dest[dest_index..], p0);
         dest_index += 2;
         write_be16(&mut dest[dest_index..], p1);
         dest_index += 2;
 
-        let pal0 = rgb565_to_rgba8(p0);
-        let pal1 = rgb565_to_rgba8(p1);
-        let pal2 = mix_1_2(&pal0, &pal1);
+        let [pal0, pal1, pal2, _] = cmpr_palette(p0, p1, info.gpu_blend);
 
         for i in 0..4 {
             let mut val = 0;
@@ -1354,25 +1583,14 @@ fn encode_dxt_block_with_palette(data: &[u8], info: &DXTEncodingPalette, dest: &
         }
     } else {
         // No transparent pixels
-        let p0 = rgb8_to_rgb565(info.p[0][0], info.p[0][1], info.p[0][2]);
-        let p1 = rgb8_to_rgb565(info.p[1][0], info.p[1][1], info.p[1][2]);
-        let (p0, p1) = if p0 == p1 {
-            (p0 | 1, p1 & !1)
-        } else if p0 < p1 {
-            (p1, p0)
-        } else {
-            (p0, p1)
-        };
-
+        let (p0, p1) = cmpr_endpoints(info);
         assert!(p0 > p1);
         write_be16(&mut dest[dest_index..], p0);
         dest_index += 2;
         write_be16(&mut dest[dest_index..], p1);
         dest_index += 2;
 
-        let pal0 = rgb565_to_rgba8(p0);
-        let pal1 = rgb565_to_rgba8(p1);
-        let (pal2, pal3) = mix_2_3(&pal0, &pal1);
+        let [pal0, pal1, pal2, pal3] = cmpr_palette(p0, p1, info.gpu_blend);
 
         for i in 0..4 {
             let mut val = 0;
@@ -1396,7 +1614,80 @@ fn write_be16(dest: &mut [u8], value: u16) {
     dest[1] = value as u8;
 }
 
-fn encode_cmpr_into(dest_img: &mut [u8], source_img: &[u8], width: u32, height: u32) {
+/// Endpoint search used by the CMPR encoder.
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub enum CmprQuality {
+    /// Tries every pair of colors present in each 4x4 block, like WIMGT. The
+    /// output of this mode does not change between releases.
+    #[default]
+    Standard,
+    /// Additionally tries endpoints along each block's principal axis,
+    /// refined by least-squares (cluster fit), keeping whichever pair has the
+    /// lowest error against the colors the GPU decodes. Helps smooth
+    /// gradients, whose ideal endpoints are often not colors of the block.
+    /// Slower.
+    High,
+}
+
+/// Options for `encode_into_with`.
+#[derive(Debug, Copy, Clone, Default)]
+pub struct EncodeOptions {
+    /// Worker threads for formats that are encoded in parallel (CMPR).
+    /// 0 uses every available core.
+    pub num_threads: u32,
+    pub cmpr_quality: CmprQuality,
+}
+
+// Below this many texels, encoding takes less time than starting the workers.
+const CMPR_MIN_PARALLEL_TEXELS: u32 = 128 * 128;
+
+// Encodes one row of 8x8 blocks. `src` starts at the first texel of the row.
+fn encode_cmpr_block_row(
+    dest: &mut [u8],
+    src: &[u8],
+    width: u32,
+    line_size: usize,
+    quality: CmprQuality,
+) {
+    let delta = [0, 16, 4 * line_size, 4 * line_size + 16];
+    let mut src_offset = 0;
+    let mut dest_offset = 0;
+
+    for _x in (0..width).step_by(8) {
+        for subb in 0..4 {
+            let mut vector = [0u8; 16 * 4];
+            let mut vect_offset = 0;
+            let mut src3_offset = src_offset + delta[subb];
+            for _ in 0..4 {
+                vector[vect_offset..vect_offset + 16]
+                    .copy_from_slice(&src[src3_offset..src3_offset + 16]);
+                vect_offset += 16;
+                src3_offset += line_size;
+            }
+
+            let mut palette = DXTEncodingPalette::new();
+            palette.calculate_values(&vector);
+            if quality == CmprQuality::High {
+                palette.refine_values(&vector);
+            }
+            encode_dxt_block_with_palette(&vector, &palette, &mut dest[dest_offset..]);
+            dest_offset += 8;
+        }
+        src_offset += 8 * 4;
+    }
+
+    assert_eq!(dest_offset, dest.len());
+}
+
+// Block rows are independent, so they are handed out to workers one at a
+// time. The output does not depend on the number of threads.
+fn encode_cmpr_into(
+    dest_img: &mut [u8],
+    source_img: &[u8],
+    width: u32,
+    height: u32,
+    options: &EncodeOptions,
+) {
     assert!(!dest_img.is_empty());
     assert!(!source_img.is_empty());
 
@@ -1404,41 +1695,51 @@ fn encode_cmpr_into(dest_img: &mut [u8], source_img: &[u8], width: u32, height:
     let xheight = (height + 7) & !7;
 
     let bits_per_pixel = 4;
-    let block_width = 8;
-    let block_height = 8;
-
     let img_size = (xwidth * xheight * bits_per_pixel / 8) as usize;
 
-    let mut src_offset = 0;
-    let mut dest_offset = 0;
-    let block_size = block_width * 4;
     let line_size = (xwidth * 4) as usize;
-    let delta = [0, 16, 4 * line_size, 4 * line_size + 16];
+    // A row of 8x8 blocks encodes to 32 bytes per block: as many bytes as one
+    // line of source texels.
+    let row_size = line_size;
+    let num_rows = (xheight / 8) as usize;
+    if num_rows == 0 {
+        return;
+    }
 
-    for _y in (0..height).step_by(block_height as usize) {
-        for _x in (0..width).step_by(block_width as usize) {
-            for subb in 0..4 {
-                let mut vector = [0u8; 16 * 4];
-                let mut vect_offset = 0;
-                let mut src3_offset = src_offset + delta[subb];
-                for _ in 0..4 {
-                    vector[vect_offset..vect_offset + 16]
-                        .copy_from_slice(&source_img[src3_offset..src3_offset + 16]);
-                    vect_offset += 16;
-                    src3_offset += line_size;
-                }
+    let encode_row = |y: usize, row: &mut [u8]| {
+        let src = &source_img[y * 8 * line_size..];
+        encode_cmpr_block_row(row, src, width, line_size, options.cmpr_quality);
+    };
 
-                let mut palette = DXTEncodingPalette::new();
-                palette.calculate_values(&vector);
-                encode_dxt_block_with_palette(&vector, &palette, &mut dest_img[dest_offset..]);
-                dest_offset += 8;
-            }
-            src_offset += block_size as usize;
+    let num_threads = if xwidth * xheight < CMPR_MIN_PARALLEL_TEXELS {
+        1
+    } else if options.num_threads != 0 {
+        options.num_threads as usize
+    } else {
+        std::thread::available_parallelism().map_or(1, |n| n.get())
+    };
+    let num_threads = num_threads.clamp(1, num_rows);
+
+    let rows = dest_img[..img_size].chunks_mut(row_size).enumerate();
+    if num_threads == 1 {
+        for (y, row) in rows {
+            encode_row(y, row);
         }
-        src_offset += line_size * (block_height as usize - 1);
+    } else {
+        let rows = std::sync::Mutex::new(rows);
+        let worker = || loop {
+            let next = rows.lock().unwrap().next();
+            let Some((y, row)) = next else {
+                break;
+            };
+            encode_row(y, row);
+        };
+        std::thread::scope(|s| {
+            for _ in 0..num_threads {
+                s.spawn(&worker);
+            }
+        });
     }
-
-    assert_eq!(dest_offset, img_size);
 }
 
 struct Rgba {
@@ -1667,6 +1968,18 @@ pub fn encode_raw_into(dst: &mut [u8], src: &[u8], width: u32, height: u32) {
 /// * An unsupported `TextureFormat` is provided.
 ///
 pub fn encode_fast(format: TextureFormat, dst: &mut [u8], src: &[u8], width: u32, height: u32) {
+    encode_fast_with(format, dst, src, width, height, &EncodeOptions::default());
+}
+
+/// Variant of `encode_fast` taking `EncodeOptions`.
+pub fn encode_fast_with(
+    format: TextureFormat,
+    dst: &mut [u8],
+    src: &[u8],
+    width: u32,
+    height: u32,
+    options: &EncodeOptions,
+) {
     assert!(dst.len() >= compute_image_size(format, width, height) as usize);
     assert!(src.len() >= (width * height * 4) as usize);
     match format {
@@ -1677,7 +1990,7 @@ pub fn encode_fast(format: TextureFormat, dst: &mut [u8], src: &[u8], width: u32
         TextureFormat::RGB565 => encode_rgb565_into(dst, src, width, height),
         TextureFormat::RGB5A3 => encode_rgb5a3_into(dst, src, width, height),
         TextureFormat::RGBA8 => encode_rgba8_into(dst, src, width, height),
-        TextureFormat::CMPR => encode_cmpr_into(dst, src, width, height),
+        TextureFormat::CMPR => encode_cmpr_into(dst, src, width, height, options),
         TextureFormat::ExtensionRawRGBA32 => encode_raw_into(dst, src, width, height),
         _ => panic!("encode_fast: Unsupported texture format: {:?}", format),
     }
@@ -1702,6 +2015,19 @@ pub fn encode_fast(format: TextureFormat, dst: &mut [u8], src: &[u8], width: u32
 /// * An unsupported `TextureFormat` is provided.
 ///
 pub fn encode_into(format: TextureFormat, dst: &mut [u8], src: &[u8], width: u32, height: u32) {
+    encode_into_with(format, dst, src, width, height, &EncodeOptions::default());
+}
+
+/// Variant of `encode_into` taking `EncodeOptions`, e.g. to limit the number of
+/// worker threads when the caller already encodes several textures at once.
+pub fn encode_into_with(
+    format: TextureFormat,
+    dst: &mut [u8],
+    src: &[u8],
+    width: u32,
+    height: u32,
+    options: &EncodeOptions,
+) {
     let info = get_format_info(format);
     let expanded_width = round_up(width, info.block_width_in_texels);
     let expanded_height = round_up(height, info.block_height_in_texels);
@@ -1710,7 +2036,7 @@ pub fn encode_into(format: TextureFormat, dst: &mut [u8], src: &[u8], width: u32
     assert!(src.len() >= (width * height * 4) as usize);
 
     if expanded_width == width && expanded_height == height {
-        encode_fast(format, dst, src, width, height);
+        encode_fast_with(format, dst, src, width, height, options);
     } else {
         let mut tmp_src = vec![0u8; (expanded_width * expanded_height * 4) as usize];
 
@@ -1728,7 +2054,7 @@ pub fn encode_into(format: TextureFormat, dst: &mut [u8], src: &[u8], width: u32
             }
         }
 
-        encode_fast(format, dst, &tmp_src, expanded_width, expanded_height);
+        encode_fast_with(format, dst, &tmp_src, expanded_width, expanded_height, options);
     }
 }
 
@@ -1891,6 +2217,73 @@ mod tests3 {
         }
     }
 
+    #[test]
+    fn test_encode_cmpr_threads() {
+        let raw_image = generate_random_image_data(IMAGE_WIDTH, IMAGE_HEIGHT, 1337);
+        let encode_with = |num_threads| {
+            let mut dst =
+                vec![0u8; compute_image_size(TextureFormat::CMPR, IMAGE_WIDTH, IMAGE_HEIGHT) as usize];
+            let options = EncodeOptions {
+                num_threads,
+                ..Default::default()
+            };
+            encode_into_with(
+                TextureFormat::CMPR,
+                &mut dst,
+                &raw_image,
+                IMAGE_WIDTH,
+                IMAGE_HEIGHT,
+                &options,
+            );
+            dst
+        };
+        let expected = encode_with(1);
+        for num_threads in [2, 3, 8] {
+            assert_buffers_equal(&encode_with(num_threads), &expected, "CMPR");
+        }
+    }
+
+    #[test]
+    fn test_encode_cmpr_high_quality() {
+        let mut raw_image = load_raw_image(RAW_IMAGE_PATH);
+        raw_image.resize((IMAGE_WIDTH * IMAGE_HEIGHT * 4) as usize, 0);
+
+        let error = |quality| {
+            let mut encoded =
+                vec![0u8; compute_image_size(TextureFormat::CMPR, IMAGE_WIDTH, IMAGE_HEIGHT) as usize];
+            let options = EncodeOptions {
+                cmpr_quality: quality,
+                ..Default::default()
+            };
+            encode_into_with(
+                TextureFormat::CMPR,
+                &mut encoded,
+                &raw_image,
+                IMAGE_WIDTH,
+                IMAGE_HEIGHT,
+                &options,
+            );
+            let decoded = decode(
+                &encoded,
+                IMAGE_WIDTH,
+                IMAGE_HEIGHT,
+                TextureFormat::CMPR,
+                &[0],
+                0,
+            );
+            raw_image
+                .chunks(4)
+                .zip(decoded.chunks(4))
+                .filter(|(a, _)| a[3] >= 0x80)
+                .map(|(a, b)| calc_distance(a, b) as u64)
+                .sum::<u64>()
+        };
+        let standard = error(CmprQuality::Standard);
+        let high = error(CmprQuality::High);
+        println!("CMPR error: standard {}, high {}", standard, high);
+        assert!(high <= standard);
+    }
+
     #[test]
     fn test_encode_with_random_data() {
         // Generate random image data with a fixed seed
@@ -2176,6 +2569,37 @@ pub mod c_api {
         encode_into(texture_format, dst_slice, src_slice, width, height);
     }
 
+    #[no_mangle]
+    pub unsafe extern "C" fn rii_encode_ex(
+        format: u32,
+        dst: *mut u8,
+        dst_len: u32,
+        src: *const u8,
+        src_len: u32,
+        width: u32,
+        height: u32,
+        num_threads: u32,
+        cmpr_quality: u32,
+    ) {
+        let dst_slice = slice::from_raw_parts_mut(dst as *mut u8, dst_len as usize);
+        let src_slice = slice::from_raw_parts(src as *const u8, src_len as usize);
+        let texture_format = match TextureFormat::from_u32(format) {
+            Some(tf) => tf,
+            None => {
+                panic!("Invalid texture format: {}", format);
+            }
+        };
+        let options = EncodeOptions {
+            num_threads,
+            cmpr_quality: match cmpr_quality {
+                0 => CmprQuality::Standard,
+                1 => CmprQuality::High,
+                _ => panic!("Invalid CMPR quality: {}", cmpr_quality),
+            },
+        };
+        encode_into_with(texture_format, dst_slice, src_slice, width, height, &options);
+    }
+
     #[no_mangle]
     pub unsafe extern "C" fn rii_encode_cmpr(
         dst: *mut u8,
@@ -2187,7 +2611,7 @@ pub mod c_api {
     ) {
         let dst_slice = slice::from_raw_parts_mut(dst as *mut u8, dst_len as usize);
         let src_slice = slice::from_raw_parts(src as *const u8, src_len as usize);
-        encode_cmpr_into(dst_slice, src_slice, width, height);
+        encode_cmpr_into(dst_slice, src_slice, width, height, &EncodeOptions::default());
     }
 
     #[no_mangle]
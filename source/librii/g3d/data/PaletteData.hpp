@@ -0,0 +1,21 @@
+#pragma once
+
+#include <core/common.h>
+#include <librii/gx.h>
+#include <string>
+#include <vector>
+
+namespace librii::g3d {
+
+//! The TLUT of a C4/C8/C14X2 texture ("PLT0"). BRRES textures reference their
+//! palette by name.
+struct PaletteData {
+  std::string name{"Untitled"};
+  librii::gx::PaletteFormat format = librii::gx::PaletteFormat::RGB5A3;
+  //! Big-endian, 16-bit entries
+  std::vector<u8> data;
+
+  bool operator==(const PaletteData& rhs) const = default;
+};
+
+} // namespace librii::g3d
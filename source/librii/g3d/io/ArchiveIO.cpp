@@ -49,7 +49,7 @@ Result<std::vector<u8>> Archive::write() const {
 Result<Archive> Archive::fromFile(std::string path,
                                   kpi::LightIOTransaction& transaction) {
   auto reader = TRY(oishii::BinaryReader::FromFilePath(path, std::endian::big));
-  return fromMemory(reader.mBuf, path, transaction);
+  return fromMemory(reader.slice(), path, transaction);
 }
 Result<Archive> Archive::fromFile(std::string path) {
   kpi::LightIOTransaction trans;
@@ -64,7 +64,7 @@ Result<Archive> Archive::fromFile(std::string path) {
 }
 Result<Archive> Archive::read(oishii::BinaryReader& reader,
                               kpi::LightIOTransaction& transaction) {
-  return fromMemory(reader.mBuf, reader.getFile(), transaction);
+  return fromMemory(reader.slice(), reader.getFile(), transaction);
 }
 Result<Archive> Archive::fromMemory(std::span<const u8> buf, std::string path,
                                     kpi::LightIOTransaction& trans) {
@@ -21,5 +21,9 @@ struct DumpResult {
 struct Archive;
 
 DumpResult DumpJson(const librii::g3d::Archive& archive);
+//! Writes the JSON and its RBUF sidecar straight to disk, in one pass.
+[[nodiscard]] Result<void> DumpJsonToFiles(const librii::g3d::Archive& archive,
+                                           std::string_view json_path,
+                                           std::string_view bin_path);
 
 } // namespace librii::g3d
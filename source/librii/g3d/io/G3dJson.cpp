@@ -1,5 +1,6 @@
 #include <core/common.h>
 #include <expected>
+#include <fstream>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
@@ -7,6 +8,7 @@
 #include <optional>
 #include <rsl/Try.hpp>
 #include <span>
+#include <sstream>
 
 #include <librii/g3d/data/Archive.hpp>
 #include <librii/g3d/data/BoneData.hpp>
@@ -14,16 +16,17 @@
 #include <librii/g3d/data/TextureData.hpp>
 #include <librii/g3d/data/VertexData.hpp>
 #include <librii/g3d/io/ArchiveIO.hpp>
+#include <librii/g3d/io/JsonBuffers.hpp>
 
 namespace librii::g3d {
 
 template <typename T> using Expected = std::expected<T, std::string>;
 
-struct JsonWriteCtx;
-
 std::string ArcToJSON(const g3d::Archive& model, JsonWriteCtx& c);
+//! Streams compact JSON to |out|.
+void ArcToJSON(const g3d::Archive& model, JsonWriteCtx& c, std::ostream& out);
 Result<g3d::Archive> JSONToArc(std::string_view json,
-                               std::span<const std::vector<u8>> buffers);
+                               std::span<const std::span<const u8>> buffers);
 
 struct JsonReadCtx {
   nlohmann::json j;
@@ -88,110 +91,54 @@ struct JsonReadCtx {
   }
 };
 
-struct JsonWriteCtx {
-  std::vector<std::vector<u8>> buffers;
-
-  int save_buffer_with_move(std::vector<u8>&& buf) {
-    buffers.emplace_back(std::move(buf));
-    return static_cast<int>(buffers.size()) - 1;
-  }
-  template <typename T> int save_buffer_with_copy(std::span<const T> buf) {
-    const u8* begin = reinterpret_cast<const u8*>(buf.data());
-    std::vector<u8> tmp(begin, begin + buf.size() * sizeof(T));
-    return save_buffer_with_move(std::move(tmp));
-  }
-};
-
-void WriteJson(JsonWriteCtx& ctx, nlohmann::json& j,
-               const librii::g3d::Archive& archive) {
-  auto s = librii::g3d::ArcToJSON(archive, ctx);
-  j = nlohmann::json::parse(s);
-}
-
-std::vector<u8> CollateBuffers(const JsonWriteCtx& c) {
-  std::vector<u8> result;
-  /*
-  clang-format off
-
-  big endian
-
-  Format:
-  u32 magic; // RBUF
-  u32 version; // 100
-  u32 num_buffers;
-  u32 file_size;
-
-  // for 0..num_buffers:
-	u32buffer_offset
-	u32 buffer_size
-
-  // Buffers begin...
-
-  clang-format on
-  */
-  auto write_u32_at = [&](u32 u, u32 pos) {
-    result[pos] = u >> 24;
-    result[pos + 1] = u >> 16;
-    result[pos + 2] = u >> 8;
-    result[pos + 3] = u >> 0;
-  };
-  u32 size = 16 + 8 * c.buffers.size();
-  u32 buffer_cursor = roundUp(size, 64);
-  for (auto& buf : c.buffers) {
-    // All entries 64-byte aligned
-    size = roundUp(size, 64);
-    size += buf.size();
-  }
-  size = roundUp(size, 64);
-  result.resize(size);
-
-  result[0] = 'R';
-  result[1] = 'B';
-  result[2] = 'U';
-  result[3] = 'F';
-
-  write_u32_at(100, 4);
-  write_u32_at(c.buffers.size(), 8);
-  write_u32_at(size, 12);
-  u32 cursor = 16;
-  for (auto& buf : c.buffers) {
-    write_u32_at(buffer_cursor, cursor);
-    write_u32_at(buf.size(), cursor + 4);
-    cursor += 8;
-    memcpy(result.data() + buffer_cursor, buf.data(), buf.size());
-    buffer_cursor += buf.size();
-    buffer_cursor = roundUp(buffer_cursor, 64);
-  }
-  assert(buffer_cursor == size);
-  return result;
-}
 u32 read_u32_at(std::span<const u8> data, u32 pos) {
   return (data[pos] << 24) | (data[pos + 1] << 16) | (data[pos + 2] << 8) |
          (data[pos + 3]);
 }
 
-std::vector<std::vector<u8>> ParseBuffers(std::span<const u8> data) {
-  std::vector<std::vector<u8>> buffers;
-
-  // Check the magic number
-  assert(data[0] == 'R' && data[1] == 'B' && data[2] == 'U' && data[3] == 'F');
-
+//! Views of each buffer of an RBUF file. Nothing is copied: the views borrow
+//! from |data| (typically a mapped .bin file), so it must outlive them.
+Result<std::vector<std::span<const u8>>>
+ParseBuffers(std::span<const u8> data) {
+  if (data.size() < 16) {
+    return std::unexpected("RBUF: File is too small");
+  }
+  if (data[0] != 'R' || data[1] != 'B' || data[2] != 'U' || data[3] != 'F') {
+    return std::unexpected("RBUF: Invalid magic");
+  }
   u32 version = read_u32_at(data, 4);
-  assert(version == 100);
-
+  if (version != 100) {
+    return std::unexpected(std::format("RBUF: Unsupported version {}", version));
+  }
   u32 num_buffers = read_u32_at(data, 8);
   u32 file_size = read_u32_at(data, 12);
+  if (file_size < 16) {
+    return std::unexpected(std::format(
+        "RBUF: File size {} is smaller than the header", file_size));
+  }
+  if (file_size > data.size()) {
+    return std::unexpected(std::format(
+        "RBUF: File is truncated ({} of {} bytes)", data.size(), file_size));
+  }
+  data = data.subspan(0, file_size);
+  if (num_buffers > (file_size - 16) / 8) {
+    return std::unexpected(
+        std::format("RBUF: Buffer table of {} entries is out of bounds",
+                    num_buffers));
+  }
 
+  std::vector<std::span<const u8>> buffers(num_buffers);
   u32 cursor = 16;
-
   for (u32 i = 0; i < num_buffers; ++i) {
     u32 buffer_offset = read_u32_at(data, cursor);
     u32 buffer_size = read_u32_at(data, cursor + 4);
     cursor += 8;
 
-    std::vector<u8> buffer(buffer_size);
-    std::memcpy(buffer.data(), data.data() + buffer_offset, buffer_size);
-    buffers.push_back(buffer);
+    if (buffer_offset > file_size || buffer_size > file_size - buffer_offset) {
+      return std::unexpected(
+          std::format("RBUF: Buffer {} is out of bounds", i));
+    }
+    buffers[i] = data.subspan(buffer_offset, buffer_size);
   }
 
   return buffers;
@@ -200,25 +147,39 @@ std::vector<std::vector<u8>> ParseBuffers(std::span<const u8> data) {
 void TestJson(const librii::g3d::Archive& archive) {
 #ifndef __APPLE__
   JsonWriteCtx ctx;
-  nlohmann::json j;
-  WriteJson(ctx, j, archive);
-  std::cout << j << std::endl;
-  std::print(std::cout, "Number of buffers: {}\n", ctx.buffers.size());
-  auto collated = CollateBuffers(ctx);
-  std::print(std::cout, "filesize of raw data: {}\n", collated.size());
+  std::cout << ArcToJSON(archive, ctx) << std::endl;
+  std::print(std::cout, "Number of buffers: {}\n", ctx.entries.size());
+  std::print(std::cout, "filesize of raw data: {}\n", ctx.fileSize());
 #endif
 }
 
 DumpResult DumpJson(const librii::g3d::Archive& archive) {
   JsonWriteCtx ctx;
-  nlohmann::json j;
-  WriteJson(ctx, j, archive);
-  auto collated = CollateBuffers(ctx);
-  return DumpResult{j.dump(), std::move(collated)};
+  std::ostringstream json;
+  ArcToJSON(archive, ctx, json);
+  return DumpResult{std::move(json).str(), ctx.collate()};
+}
+Result<void> DumpJsonToFiles(const librii::g3d::Archive& archive,
+                             std::string_view json_path,
+                             std::string_view bin_path) {
+  JsonWriteCtx ctx;
+  {
+    std::ofstream json{std::string(json_path), std::ios::binary};
+    ArcToJSON(archive, ctx, json);
+    if (!json) {
+      return std::unexpected(std::format("Failed to write {}", json_path));
+    }
+  }
+  std::ofstream bin{std::string(bin_path), std::ios::binary};
+  ctx.write(bin);
+  if (!bin) {
+    return std::unexpected(std::format("Failed to write {}", bin_path));
+  }
+  return {};
 }
 Result<librii::g3d::Archive> ReadJsonArc(std::string_view json,
                                          std::span<const u8> buffer) {
-  auto buffers = ParseBuffers(buffer);
+  auto buffers = TRY(ParseBuffers(buffer));
   return librii::g3d::JSONToArc(json, buffers);
 }
 Result<std::vector<u8>> WriteArchive(std::string_view json,
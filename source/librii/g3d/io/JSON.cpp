@@ -19,6 +19,7 @@
 #endif
 
 #include <librii/g3d/io/ArchiveIO.hpp>
+#include <librii/g3d/io/JsonBuffers.hpp>
 
 #include <magic_enum/magic_enum.hpp>
 
@@ -34,21 +35,6 @@
 #define JS_STD_OPTIONAL
 #include <vendor/json_struct.h>
 
-namespace librii::g3d {
-struct JsonWriteCtx {
-  std::vector<std::vector<u8>> buffers;
-
-  int save_buffer_with_move(std::vector<u8>&& buf) {
-    buffers.emplace_back(std::move(buf));
-    return static_cast<int>(buffers.size()) - 1;
-  }
-  template <typename T> int save_buffer_with_copy(std::span<const T> buf) {
-    const u8* begin = reinterpret_cast<const u8*>(buf.data());
-    std::vector<u8> tmp(begin, begin + buf.size() * sizeof(T));
-    return save_buffer_with_move(std::move(tmp));
-  }
-};
-} // namespace librii::g3d
 
 namespace JS {
 
@@ -315,25 +301,31 @@ struct JSONBoneData {
 };
 using namespace librii::gx;
 
-std::vector<u8>
-packIndexedPrims(std::span<const librii::gx::IndexedPrimitive> prims) {
-  std::vector<u8> vd_buf;
-
+// Packs straight into a buffer of |ctx|, returning its id.
+int packIndexedPrims(std::span<const librii::gx::IndexedPrimitive> prims,
+                     JsonWriteCtx& ctx) {
+  // 26x u16s
+  static_assert(sizeof(librii::gx::IndexedVertex) == 26 * 2);
+  static_assert(alignof(librii::gx::IndexedVertex) == 2);
+  size_t size = 0;
+  for (auto& prim : prims) {
+    size += 4 + prim.mVertices.size() * sizeof(librii::gx::IndexedVertex);
+  }
+  auto [id, vd_buf] = ctx.allocate_buffer(size);
+  u8* cursor = vd_buf.data();
   for (auto& prim : prims) {
-    vd_buf.push_back(static_cast<u8>(prim.mType));
     u32 num_verts = prim.mVertices.size();
-    vd_buf.push_back((num_verts >> 16) & 0xff);
-    vd_buf.push_back((num_verts >> 8) & 0xff);
-    vd_buf.push_back((num_verts >> 0) & 0xff);
-    // 26x u16s
-    static_assert(sizeof(librii::gx::IndexedVertex) == 26 * 2);
-    static_assert(alignof(librii::gx::IndexedVertex) == 2);
-    u32 cursor = vd_buf.size();
-    u32 buf_size = prim.mVertices.size() * sizeof(librii::gx::IndexedVertex);
-    vd_buf.resize(vd_buf.size() + buf_size);
-    memcpy(vd_buf.data() + cursor, prim.mVertices.data(), buf_size);
-  }
-  return vd_buf;
+    *cursor++ = static_cast<u8>(prim.mType);
+    *cursor++ = (num_verts >> 16) & 0xff;
+    *cursor++ = (num_verts >> 8) & 0xff;
+    *cursor++ = (num_verts >> 0) & 0xff;
+    u32 buf_size = num_verts * sizeof(librii::gx::IndexedVertex);
+    if (buf_size != 0) {
+      memcpy(cursor, prim.mVertices.data(), buf_size);
+    }
+    cursor += buf_size;
+  }
+  return id;
 }
 std::vector<librii::gx::IndexedPrimitive>
 unpackIndexedPrims(std::span<const u8> vd_buf, u32 num_prims) {
@@ -375,11 +367,11 @@ struct JSONMatrixPrimitive {
 
     json.num_prims = original.mPrimitives.size();
     json.vertexDataBufferId =
-        ctx.save_buffer_with_move(packIndexedPrims(original.mPrimitives));
+        packIndexedPrims(original.mPrimitives, ctx);
     return json;
   }
 
-  MatrixPrimitive to(std::span<const std::vector<u8>> buffers) const {
+  MatrixPrimitive to(std::span<const std::span<const u8>> buffers) const {
     MatrixPrimitive matPrim;
     matPrim.mDrawMatrixIndices = matrices;
 
@@ -429,7 +421,7 @@ struct JSONPolygonData {
     return json;
   }
 
-  g3d::PolygonData to(std::span<const std::vector<u8>> buffers) const {
+  g3d::PolygonData to(std::span<const std::span<const u8>> buffers) const {
     g3d::PolygonData poly;
 
     // Convert JSONPolygonData to PolygonData members
@@ -1211,14 +1203,6 @@ struct JSONG3dMaterialData {
   }
 };
 
-// Utility function to pack entries into a vector of bytes
-template <typename T>
-std::vector<u8> packEntries(const std::vector<T>& entries) {
-  std::vector<u8> buffer(entries.size() * sizeof(T));
-  std::memcpy(buffer.data(), entries.data(), buffer.size());
-  return buffer;
-}
-
 // Utility function to unpack entries from a vector of bytes
 template <typename T> std::vector<T> unpackEntries(std::span<const u8> buffer) {
   std::vector<T> entries(buffer.size() / sizeof(T));
@@ -1251,7 +1235,7 @@ struct JSONPositionBuffer {
     json.q_stride = original.mQuantize.stride;
     json.q_comp = static_cast<u32>(original.mQuantize.mComp.position);
     json.dataBufferId =
-        ctx.save_buffer_with_move(packEntries(original.mEntries));
+        ctx.save_buffer_with_copy(std::span(original.mEntries));
     if (original.mCachedMinMax) {
       json.cached_min = original.mCachedMinMax->min;
       json.cached_max = original.mCachedMinMax->max;
@@ -1259,7 +1243,7 @@ struct JSONPositionBuffer {
     return json;
   }
 
-  PositionBuffer to(std::span<const std::vector<u8>> buffers) const {
+  PositionBuffer to(std::span<const std::span<const u8>> buffers) const {
     PositionBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1303,7 +1287,7 @@ struct JSONNormalBuffer {
     json.q_stride = original.mQuantize.stride;
     json.q_comp = static_cast<u32>(original.mQuantize.mComp.normal);
     json.dataBufferId =
-        ctx.save_buffer_with_move(packEntries(original.mEntries));
+        ctx.save_buffer_with_copy(std::span(original.mEntries));
     if (original.mCachedMinMax) {
       json.cached_min = original.mCachedMinMax->min;
       json.cached_max = original.mCachedMinMax->max;
@@ -1311,7 +1295,7 @@ struct JSONNormalBuffer {
     return json;
   }
 
-  NormalBuffer to(std::span<const std::vector<u8>> buffers) const {
+  NormalBuffer to(std::span<const std::span<const u8>> buffers) const {
     NormalBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1354,7 +1338,7 @@ struct JSONColorBuffer {
     json.q_stride = original.mQuantize.stride;
     json.q_comp = static_cast<u32>(original.mQuantize.mComp.color);
     json.dataBufferId =
-        ctx.save_buffer_with_move(packEntries(original.mEntries));
+        ctx.save_buffer_with_copy(std::span(original.mEntries));
     if (original.mCachedMinMax) {
       json.cached_min = original.mCachedMinMax->min.to_array();
       json.cached_max = original.mCachedMinMax->max.to_array();
@@ -1362,7 +1346,7 @@ struct JSONColorBuffer {
     return json;
   }
 
-  ColorBuffer to(std::span<const std::vector<u8>> buffers) const {
+  ColorBuffer to(std::span<const std::span<const u8>> buffers) const {
     ColorBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1406,7 +1390,7 @@ struct JSONTextureCoordinateBuffer {
     json.q_stride = original.mQuantize.stride;
     json.q_comp = static_cast<u32>(original.mQuantize.mComp.texcoord);
     json.dataBufferId =
-        ctx.save_buffer_with_move(packEntries(original.mEntries));
+        ctx.save_buffer_with_copy(std::span(original.mEntries));
     if (original.mCachedMinMax) {
       json.cached_min = original.mCachedMinMax->min;
       json.cached_max = original.mCachedMinMax->max;
@@ -1414,7 +1398,7 @@ struct JSONTextureCoordinateBuffer {
     return json;
   }
 
-  TextureCoordinateBuffer to(std::span<const std::vector<u8>> buffers) const {
+  TextureCoordinateBuffer to(std::span<const std::span<const u8>> buffers) const {
     TextureCoordinateBuffer buffer;
     buffer.mName = name;
     buffer.mId = id;
@@ -1489,7 +1473,7 @@ struct JSONModel {
     return model;
   }
 
-  Result<Model> lift(std::span<const std::vector<u8>> buffers) const {
+  Result<Model> lift(std::span<const std::span<const u8>> buffers) const {
     Model result;
     result.name = name;
     result.info = TRY(info.to());
@@ -1558,7 +1542,7 @@ struct JSONTextureData {
     return json;
   }
 
-  librii::g3d::TextureData to(std::span<const std::vector<u8>> buffers) const {
+  librii::g3d::TextureData to(std::span<const std::span<const u8>> buffers) const {
     librii::g3d::TextureData tex;
     tex.name = name;
     tex.format = static_cast<librii::gx::TextureFormat>(format);
@@ -1568,7 +1552,8 @@ struct JSONTextureData {
     tex.minLod = minLod;
     tex.maxLod = maxLod;
     tex.sourcePath = sourcePath;
-    tex.data = buffers[dataBufferId];
+    tex.data.assign(buffers[dataBufferId].begin(),
+                    buffers[dataBufferId].end());
     return tex;
   }
 };
@@ -1699,9 +1684,9 @@ struct ChrFramePacker {
   constexpr static size_t CHR_FRAME_SIZE = 8 * 3;
   static_assert(sizeof(librii::g3d::ChrFrame) == CHR_FRAME_SIZE);
 
-  static std::vector<u8>
-  pack(const std::vector<librii::g3d::ChrFrame>& frames) {
-    return packEntries<librii::g3d::ChrFrame>(frames);
+  static int pack(const std::vector<librii::g3d::ChrFrame>& frames,
+                  JsonWriteCtx& ctx) {
+    return ctx.save_buffer_with_copy(std::span(frames));
   }
   static std::vector<librii::g3d::ChrFrame> unpack(std::span<const u8> bytes) {
     return unpackEntries<librii::g3d::ChrFrame>(bytes);
@@ -1726,12 +1711,12 @@ struct JSONChrTrack {
     jsonTrack.offset = track.offset;
     jsonTrack.step = track.step;
     jsonTrack.framesDataBufferId =
-        ctx.save_buffer_with_move(ChrFramePacker::pack(track.frames));
+        ChrFramePacker::pack(track.frames, ctx);
     jsonTrack.numKeyFrames = track.frames.size();
     return jsonTrack;
   }
 
-  Result<ChrTrack> to(std::span<const std::vector<u8>> buffers) const {
+  Result<ChrTrack> to(std::span<const std::span<const u8>> buffers) const {
     ChrTrack track;
     track.quant = quant;
     track.scale = scale;
@@ -1800,7 +1785,7 @@ struct JSONChrData {
     return jsonAnim;
   }
 
-  Result<ChrAnim> to(std::span<const std::vector<u8>> buffers) const {
+  Result<ChrAnim> to(std::span<const std::span<const u8>> buffers) const {
     ChrAnim anim;
     anim.name = name;
     anim.sourcePath = sourcePath;
@@ -2145,7 +2130,7 @@ struct JSONVisData {
     return json;
   }
 
-  BinaryVis to(std::span<const std::vector<u8>> buffers) const {
+  BinaryVis to(std::span<const std::span<const u8>> buffers) const {
     BinaryVis vis;
     vis.name = name;
     vis.sourcePath = sourcePath;
@@ -2205,7 +2190,7 @@ struct JSONArchive {
     return archive;
   }
 
-  Result<Archive> lift(std::span<const std::vector<u8>> buffers) const {
+  Result<Archive> lift(std::span<const std::span<const u8>> buffers) const {
     Archive result;
 
     for (const auto& jsonModel : models) {
@@ -2245,8 +2230,22 @@ std::string ArcToJSON(const g3d::Archive& model, JsonWriteCtx& c) {
   return JS::serializeStruct(
       mat, JS::SerializerOptions(JS::SerializerOptions::Pretty));
 }
+void ArcToJSON(const g3d::Archive& model, JsonWriteCtx& c, std::ostream& out) {
+  auto mat = JSONArchive::from(model, c);
+  // The serializer only asks for more space once |chunk| is full.
+  std::vector<char> chunk(64 * 1024);
+  JS::Serializer serializer(chunk.data(), chunk.size());
+  serializer.setOptions(JS::SerializerOptions(JS::SerializerOptions::Compact));
+  auto flush = serializer.addRequestBufferCallback([&](JS::Serializer& s) {
+    out.write(chunk.data(), chunk.size());
+    s.setBuffer(chunk.data(), chunk.size());
+  });
+  JS::Token token;
+  JS::TypeHandler<JSONArchive>::from(mat, token, serializer);
+  out.write(chunk.data(), serializer.currentBuffer().used);
+}
 Result<g3d::Archive> JSONToArc(std::string_view json,
-                               std::span<const std::vector<u8>> buffers) {
+                               std::span<const std::span<const u8>> buffers) {
   JS::ParseContext context(json.data(), json.size());
   JSONArchive mdl;
   auto err = context.parseTo(mdl);
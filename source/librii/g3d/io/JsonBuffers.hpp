@@ -0,0 +1,112 @@
+#pragma once
+
+#include <core/common.h>
+
+#include <ostream>
+#include <rsl/Round.hpp>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace librii::g3d {
+
+// clang-format off
+//
+// RBUF: binary sidecar holding the bulk data of a JSON archive.
+//
+// big endian
+//
+// u32 magic; // RBUF
+// u32 version; // 100
+// u32 num_buffers;
+// u32 file_size;
+//
+// // for 0..num_buffers:
+//   u32 buffer_offset
+//   u32 buffer_size
+//
+// // Buffers begin... (each 64-byte aligned)
+//
+// clang-format on
+
+//! Collects the buffers of a JSON archive while it is being written.
+//!
+//! Buffers are packed straight into the RBUF body at their final 64-byte
+//! aligned offsets; only the header, whose size depends on the number of
+//! buffers, is produced at the end.
+struct JsonWriteCtx {
+  static constexpr u32 Alignment = 64;
+
+  //! Buffer data, relative to the end of the header.
+  std::vector<u8> body;
+  //! (offset in `body`, size) of each buffer.
+  std::vector<std::pair<u32, u32>> entries;
+
+  //! Reserves a new buffer of `size` bytes. Returns its id and its storage,
+  //! valid until the next buffer is allocated.
+  std::pair<int, std::span<u8>> allocate_buffer(size_t size) {
+    const u32 offset = roundUp(static_cast<u32>(body.size()), Alignment);
+    body.resize(offset + size);
+    entries.emplace_back(offset, static_cast<u32>(size));
+    return {static_cast<int>(entries.size()) - 1,
+            std::span(body).subspan(offset, size)};
+  }
+  template <typename T> int save_buffer_with_copy(std::span<const T> buf) {
+    auto [id, dst] = allocate_buffer(buf.size_bytes());
+    if (!buf.empty()) {
+      memcpy(dst.data(), buf.data(), buf.size_bytes());
+    }
+    return id;
+  }
+
+  u32 headerSize() const {
+    return roundUp(16 + 8 * static_cast<u32>(entries.size()), Alignment);
+  }
+  u32 fileSize() const {
+    return headerSize() + roundUp(static_cast<u32>(body.size()), Alignment);
+  }
+
+  //! Magic, counts and buffer table, padded to the first buffer.
+  std::vector<u8> header() const {
+    std::vector<u8> result(headerSize());
+    auto write_u32_at = [&](u32 u, u32 pos) {
+      result[pos] = u >> 24;
+      result[pos + 1] = u >> 16;
+      result[pos + 2] = u >> 8;
+      result[pos + 3] = u >> 0;
+    };
+    result[0] = 'R';
+    result[1] = 'B';
+    result[2] = 'U';
+    result[3] = 'F';
+    write_u32_at(100, 4);
+    write_u32_at(static_cast<u32>(entries.size()), 8);
+    write_u32_at(fileSize(), 12);
+    u32 cursor = 16;
+    for (auto [offset, size] : entries) {
+      write_u32_at(headerSize() + offset, cursor);
+      write_u32_at(size, cursor + 4);
+      cursor += 8;
+    }
+    return result;
+  }
+
+  //! Writes the RBUF file to `out`.
+  void write(std::ostream& out) const {
+    auto head = header();
+    out.write(reinterpret_cast<const char*>(head.data()), head.size());
+    out.write(reinterpret_cast<const char*>(body.data()), body.size());
+    static constexpr char padding[Alignment]{};
+    out.write(padding, fileSize() - headerSize() - body.size());
+  }
+  //! The RBUF file as one buffer.
+  std::vector<u8> collate() const {
+    std::vector<u8> result = header();
+    result.reserve(fileSize());
+    result.insert(result.end(), body.begin(), body.end());
+    result.resize(fileSize());
+    return result;
+  }
+};
+
+} // namespace librii::g3d
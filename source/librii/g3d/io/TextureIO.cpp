@@ -1,4 +1,5 @@
 #include "TextureIO.hpp"
+#include <librii/g3d/data/PaletteData.hpp>
 #include <librii/g3d/data/TextureData.hpp>
 #include <rsl/SimpleReader.hpp>
 #include <rsl/WriteFile.hpp>
@@ -106,7 +107,8 @@ bool WriteTexture(std::span<u8> data, const TextureData& tex, s32 brres_ofs,
                .name = tex.name,
                .non_volatile = true};
 
-  rsl::store<u32>(0, data, 24); // flag, ci
+  rsl::store<u32>(librii::gx::IsPaletteFormat(tex.format) ? 1 : 0, data,
+                  24); // flag, ci
   rsl::store<u16>(tex.width, data, 28);
   rsl::store<u16>(tex.height, data, 30);
   rsl::store<u32>(static_cast<u32>(tex.format), data, 32);
@@ -133,6 +135,48 @@ bool WriteTexture(std::span<u8> data, const TextureData& tex, s32 brres_ofs,
   return true;
 }
 
+BlockData CalcPaletteBlockData(const PaletteData& plt) {
+  return {.size = static_cast<u32>(64 + plt.data.size()), .start_align = 32};
+}
+
+bool WritePalette(std::span<u8> data, const PaletteData& plt, s32 brres_ofs,
+                  NameReloc& out_reloc) {
+  const auto block = CalcPaletteBlockData(plt);
+
+  if (data.size_bytes() < block.size)
+    return false;
+
+  rsl::store<u32>('PLT0', data, 0);
+  rsl::store<u32>(block.size, data, 4);
+  rsl::store<u32>(3, data, 8);          // revision
+  rsl::store<u32>(brres_ofs, data, 12); // brres offset
+  rsl::store<u32>(64, data, 16);        // palette offset
+
+  rsl::store<u32>(~0, data, 20);
+  out_reloc = {.offset_of_delta_reference = 0,
+               .offset_of_pointer_in_struct = 20,
+               .name = plt.name,
+               .non_volatile = true};
+
+  rsl::store<u32>(static_cast<u32>(plt.format), data, 24);
+  rsl::store<u16>(static_cast<u16>(plt.data.size() / 2), data, 28);
+  rsl::store<u16>(0, data, 30); // pad
+
+  rsl::store<u32>(0, data, 32); // src path
+
+  rsl::store<u32>(0, data, 36); // user data
+
+  // align
+  for (int i = 40; i < 64; i += sizeof(u32)) {
+    rsl::store<u32>(0, data, i);
+  }
+
+  std::memcpy(data.subspan(64, plt.data.size()).data(), plt.data.data(),
+              plt.data.size());
+
+  return true;
+}
+
 Result<g3d::TextureData, std::string> ReadTEX0(std::span<const u8> file) {
   g3d::TextureData tex;
   // TODO: We trust the .tex0-file provided name to be correct
@@ -198,4 +242,22 @@ Result<void> WriteTEX0ToFile(const g3d::TextureData& tex, std::string path) {
   return {};
 }
 
+std::vector<u8> WritePLT0(const g3d::PaletteData& plt) {
+  auto memory_request = g3d::CalcPaletteBlockData(plt);
+  std::vector<u8> buffer(memory_request.size);
+
+  g3d::NameReloc reloc;
+  g3d::WritePalette(buffer, plt, 0, reloc);
+  SimpleRelocApplier applier(buffer);
+  applier.apply(reloc, 0 /* structure offset */);
+
+  return buffer;
+}
+
+Result<void> WritePLT0ToFile(const g3d::PaletteData& plt, std::string path) {
+  auto buf = WritePLT0(plt);
+  TRY(rsl::WriteFile(buf, path));
+  return {};
+}
+
 } // namespace librii::g3d
@@ -8,6 +8,7 @@
 namespace librii::g3d {
 
 struct TextureData;
+struct PaletteData;
 
 bool ReadTexture(TextureData& tex, std::span<const u8> data,
                  std::string_view name);
@@ -27,4 +28,16 @@ bool WriteTexture(std::span<u8> data, const TextureData& tex, s32 brres_ofs,
 [[nodiscard]] Result<void> WriteTEX0ToFile(const g3d::TextureData& tex,
                                            std::string path);
 
+BlockData CalcPaletteBlockData(const PaletteData& plt);
+
+bool WritePalette(std::span<u8> data, const PaletteData& plt, s32 brres_ofs,
+                  NameReloc& out_reloc);
+
+//! Like "TEX0" files, a "PLT0" file is a lone .brres palette.
+//!
+[[nodiscard]] std::vector<u8> WritePLT0(const g3d::PaletteData& plt);
+
+[[nodiscard]] Result<void> WritePLT0ToFile(const g3d::PaletteData& plt,
+                                           std::string path);
+
 } // namespace librii::g3d
@@ -0,0 +1,145 @@
+#include "EncodeCache.hpp"
+
+#include <rsl/Hash.hpp>
+#include <rsl/Log.hpp>
+#include <rsl/WriteFile.hpp>
+
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+
+namespace librii::image {
+
+// Entry layout (host endian; the cache never leaves the machine):
+//   u32 magic, u32 key[13], u64 data size, u64 xxh64 of data, data
+static constexpr u32 EntryMagic = 0x52545843; // RTXC
+using SerializedKey = std::array<u32, 13>;
+static constexpr size_t EntryHeaderSize =
+    sizeof(u32) + sizeof(SerializedKey) + 2 * sizeof(u64);
+
+static SerializedKey Serialize(const EncodeCacheKey& key) {
+  return {
+      static_cast<u32>(key.source_hash),
+      static_cast<u32>(key.source_hash >> 32),
+      key.source_width,
+      key.source_height,
+      key.width,
+      key.height,
+      key.format,
+      key.mip_count,
+      key.algorithm,
+      key.filter,
+      key.high_quality,
+      key.palette_format,
+      key.version,
+  };
+}
+
+EncodeCache::EncodeCache(std::filesystem::path folder)
+    : mFolder(std::move(folder)) {}
+
+std::filesystem::path EncodeCache::pathOf(const EncodeCacheKey& key) const {
+  const auto fields = Serialize(key);
+  const u64 hash = rsl::xxh64(
+      {reinterpret_cast<const u8*>(fields.data()), sizeof(fields)});
+  return mFolder / std::format("{:016x}.bin", hash);
+}
+
+std::optional<std::vector<u8>>
+EncodeCache::find(const EncodeCacheKey& key) {
+  std::ifstream stream(pathOf(key), std::ios::binary | std::ios::ate);
+  std::vector<u8> file;
+  if (stream) {
+    file.resize(stream.tellg());
+    stream.seekg(0, std::ios::beg);
+    if (!stream.read(reinterpret_cast<char*>(file.data()), file.size())) {
+      file.clear();
+    }
+  }
+  if (file.size() >= EntryHeaderSize) {
+    u32 magic;
+    SerializedKey fields;
+    u64 size, hash;
+    const u8* p = file.data();
+    memcpy(&magic, p, sizeof(magic));
+    p += sizeof(magic);
+    memcpy(fields.data(), p, sizeof(fields));
+    p += sizeof(fields);
+    memcpy(&size, p, sizeof(size));
+    p += sizeof(size);
+    memcpy(&hash, p, sizeof(hash));
+    std::span<const u8> data(file.begin() + EntryHeaderSize, file.end());
+    if (magic == EntryMagic && fields == Serialize(key) &&
+        size == data.size() && hash == rsl::xxh64(data)) {
+      ++mHits;
+      return std::vector<u8>(data.begin(), data.end());
+    }
+  }
+  ++mMisses;
+  return std::nullopt;
+}
+
+void EncodeCache::store(const EncodeCacheKey& key, std::span<const u8> data) {
+  const auto fields = Serialize(key);
+  const u64 size = data.size();
+  const u64 hash = rsl::xxh64(data);
+  std::vector<u8> file(EntryHeaderSize + data.size());
+  u8* p = file.data();
+  memcpy(p, &EntryMagic, sizeof(EntryMagic));
+  p += sizeof(EntryMagic);
+  memcpy(p, fields.data(), sizeof(fields));
+  p += sizeof(fields);
+  memcpy(p, &size, sizeof(size));
+  p += sizeof(size);
+  memcpy(p, &hash, sizeof(hash));
+  p += sizeof(hash);
+  memcpy(p, data.data(), data.size());
+
+  std::error_code ec;
+  std::filesystem::create_directories(mFolder, ec);
+  const auto path = pathOf(key);
+  auto tmp = path;
+  tmp += std::format(".{:08x}.tmp", std::random_device{}());
+  if (auto ok = rsl::WriteFile(file, tmp.string()); !ok) {
+    rsl::warn("Texture cache: {}", ok.error());
+    return;
+  }
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    rsl::warn("Texture cache: Failed to write {}: {}", path.string(),
+              ec.message());
+    std::filesystem::remove(tmp, ec);
+  }
+}
+
+std::filesystem::path EncodeCache::DefaultFolder() {
+  std::filesystem::path root;
+#ifdef _WIN32
+  if (const char* local = std::getenv("LOCALAPPDATA")) {
+    root = local;
+  }
+#else
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    root = xdg;
+  } else if (const char* home = std::getenv("HOME"); home && *home) {
+    root = std::filesystem::path(home) / ".cache";
+  }
+#endif
+  if (root.empty()) {
+    std::error_code ec;
+    root = std::filesystem::temp_directory_path(ec);
+  }
+  return root / "riistudio" / "textures";
+}
+
+static std::unique_ptr<EncodeCache> sSharedCache;
+
+EncodeCache* EncodeCache::Shared() { return sSharedCache.get(); }
+void EncodeCache::SetSharedFolder(std::filesystem::path folder) {
+  sSharedCache = folder.empty()
+                     ? nullptr
+                     : std::make_unique<EncodeCache>(std::move(folder));
+}
+
+} // namespace librii::image
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <core/common.h>
+
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <librii/gx.h>
+
+namespace librii::image {
+
+//! @brief Bump whenever an encoder, resizer or quantizer changes its output,
+//! so stale cache entries are no longer found.
+//!
+constexpr u32 EncoderVersion = 1;
+
+//! @brief Everything that determines the encoded bytes of a texture.
+//!
+struct EncodeCacheKey {
+  //! rsl::xxh64 of the raw source pixels.
+  u64 source_hash = 0;
+  u32 source_width = 0;
+  u32 source_height = 0;
+  u32 width = 0;
+  u32 height = 0;
+  u32 format = 0;         //!< gx::TextureFormat
+  u32 mip_count = 0;      //!< Additional levels of detail
+  u32 algorithm = 0;      //!< ResizingAlgorithm
+  u32 filter = 0;         //!< MipFilter
+  u32 high_quality = 0;   //!< EncodeOptions::cmpr_high_quality
+  u32 palette_format = 0; //!< gx::PaletteFormat, for C4/C8/C14X2
+  u32 version = EncoderVersion;
+
+  bool operator==(const EncodeCacheKey&) const = default;
+};
+
+//! @brief Persistent, content-addressed store of encoded texture data.
+//!
+//! Entries live in one file each, named after the hash of their key. They are
+//! written to a temporary file and renamed into place, so concurrent imports
+//! (and crashes) never leave a partial entry behind. Entries whose key or
+//! checksum does not match are treated as misses.
+//!
+class EncodeCache {
+public:
+  explicit EncodeCache(std::filesystem::path folder);
+
+  //! @brief The encoded data stored for @p key, if any.
+  //!
+  [[nodiscard]] std::optional<std::vector<u8>> find(const EncodeCacheKey& key);
+
+  //! @brief Store @p data for @p key. Failures are logged and ignored; the
+  //! cache is only an optimization.
+  //!
+  void store(const EncodeCacheKey& key, std::span<const u8> data);
+
+  u32 hits() const { return mHits; }
+  u32 misses() const { return mMisses; }
+  const std::filesystem::path& folder() const { return mFolder; }
+
+  //! @brief Per-user cache folder of the platform (e.g. ~/.cache/riistudio).
+  //!
+  static std::filesystem::path DefaultFolder();
+
+  //! @brief Process-wide cache consulted by the texture importers, or nullptr
+  //! when caching is off (the default).
+  //!
+  static EncodeCache* Shared();
+  //! @brief Enable `Shared()` in @p folder, or disable it with an empty path.
+  //! Not thread-safe; call before importing.
+  //!
+  static void SetSharedFolder(std::filesystem::path folder);
+
+private:
+  std::filesystem::path pathOf(const EncodeCacheKey& key) const;
+
+  std::filesystem::path mFolder;
+  std::atomic<u32> mHits = 0;
+  std::atomic<u32> mMisses = 0;
+};
+
+} // namespace librii::image
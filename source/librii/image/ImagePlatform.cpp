@@ -7,6 +7,14 @@
 #include "avir-rs/include/avir_rs.h"
 #include "gctex/include/gctex.h"
 
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RII_MIP_SSE2 1
+#else
+#define RII_MIP_SSE2 0
+#endif
+
 IMPORT_STD;
 
 namespace librii::image {
@@ -36,7 +44,8 @@ void decode(std::span<u8> dst, std::span<const u8> src, int width, int height,
 
 // raw 8-bit RGBA -> X
 Result<void> encode(std::span<u8> dst, std::span<const u8> src, int width,
-                    int height, gx::TextureFormat texformat) {
+                    int height, gx::TextureFormat texformat,
+                    const EncodeOptions& options) {
   bool ok = false;
   switch (texformat) {
   case gx::TextureFormat::CMPR:
@@ -52,12 +61,22 @@ Result<void> encode(std::span<u8> dst, std::span<const u8> src, int width,
   }
 
   if (ok) {
-    gctex::encode_into(static_cast<u32>(texformat), dst, src, width, height);
+    gctex::EncodeOptions gctex_options{
+        .num_threads = options.num_threads,
+        .cmpr_quality = options.cmpr_high_quality ? RII_CMPR_QUALITY_HIGH
+                                                  : RII_CMPR_QUALITY_STANDARD,
+    };
+    gctex::encode_into(static_cast<u32>(texformat), dst, src, width, height,
+                       gctex_options);
     return {};
   }
 
-  // No palette support
-  return std::unexpected("No palette support");
+  if (gx::IsPaletteFormat(texformat)) {
+    // The TLUT is a second output
+    return std::unexpected("Palette formats are encoded with encodePaletted");
+  }
+  return std::unexpected(std::format("Unsupported texture format {}",
+                                     static_cast<u32>(texformat)));
 }
 // Change format, no resizing
 Result<void> reencode(std::span<u8> dst, std::span<const u8> src, int width,
@@ -70,17 +89,130 @@ Result<void> reencode(std::span<u8> dst, std::span<const u8> src, int width,
 
 void resize(std::span<u8> dst, int dx, int dy, std::span<const u8> src, int sx,
             int sy, ResizingAlgorithm type) {
-  std::vector<u8> src_(src.begin(), src.end());
-  std::vector<u8> dst_(dst.begin(), dst.end());
+  // The resizers write |dst| while still reading |src|.
+  std::vector<u8> src_;
+  if (dst.data() < src.data() + src.size() &&
+      src.data() < dst.data() + dst.size()) {
+    src_.assign(src.begin(), src.end());
+    src = src_;
+  }
   if (type == ResizingAlgorithm::AVIR) {
-    avir_resize(dst_.data(), dst_.size(), dx, dy, src_.data(), src_.size(), sx,
+    avir_resize(dst.data(), dst.size(), dx, dy, src.data(), src.size(), sx,
                 sy);
   } else {
-    clancir_resize(dst_.data(), dst_.size(), dx, dy, src_.data(), src_.size(),
-                   sx, sy);
+    clancir_resize(dst.data(), dst.size(), dx, dy, src.data(), src.size(), sx,
+                   sy);
+  }
+}
+
+// Averages each 2x2 block of |src| (sw x sh) into one pixel of |dst|. Odd
+// edges repeat their last row/column.
+static void BoxDownsample(u8* dst, const u8* src, int sw, int sh) {
+  const int dw = std::max(sw / 2, 1);
+  const int dh = std::max(sh / 2, 1);
+  for (int y = 0; y < dh; ++y) {
+    const u8* r0 = src + static_cast<size_t>(std::min(2 * y, sh - 1)) * sw * 4;
+    const u8* r1 =
+        src + static_cast<size_t>(std::min(2 * y + 1, sh - 1)) * sw * 4;
+    u8* out = dst + static_cast<size_t>(y) * dw * 4;
+    int x = 0;
+#if RII_MIP_SSE2
+    // Four source pixels of each row -> two output pixels
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; sw >= 2 && x + 2 <= dw; x += 2) {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1));
+      __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                 _mm_unpacklo_epi8(b, zero));
+      __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                 _mm_unpackhi_epi8(b, zero));
+      lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+      hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+      __m128i sum = _mm_unpacklo_epi64(lo, hi);
+      sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4),
+                       _mm_packus_epi16(sum, sum));
+      r0 += 16;
+      r1 += 16;
+    }
+    r0 -= x * 8;
+    r1 -= x * 8;
+#endif
+    for (; x < dw; ++x) {
+      const int x0 = std::min(2 * x, sw - 1) * 4;
+      const int x1 = std::min(2 * x + 1, sw - 1) * 4;
+      for (int c = 0; c < 4; ++c) {
+        out[x * 4 + c] = static_cast<u8>(
+            (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2);
+      }
+    }
+  }
+}
+
+Result<void> generateMipChain(std::span<u8> dst, int dx, int dy,
+                              gx::TextureFormat format, u32 mipMapCount,
+                              std::span<const u8> src, int sx, int sy,
+                              ResizingAlgorithm algorithm, MipFilter filter,
+                              const EncodeOptions& options) {
+  EXPECT(dx > 0 && dy > 0 && sx > 0 && sy > 0);
+  EXPECT(src.size() >= static_cast<size_t>(sx) * sy * 4);
+  if (gx::IsPaletteFormat(format)) {
+    return std::unexpected("Palette formats are encoded with encodePaletted");
+  }
+  if (mipMapCount >= 1 && (!is_power_of_2(dx) || !is_power_of_2(dy))) {
+    return std::unexpected(
+        "It is a GPU hardware requirement that mipmaps be powers of two");
   }
+  EXPECT(dst.size() >= getEncodedSize(dx, dy, format, mipMapCount));
 
-  memcpy(dst.data(), dst_.data(), dst.size());
+  // Raw chains are filtered in place. Otherwise only the current and next
+  // level are held raw, and each level is encoded as soon as it exists.
+  const bool raw = format == gx::TextureFormat::Extension_RawRGBA32;
+  std::vector<u8> cur, next;
+  auto raw_level = [&](std::vector<u8>& buf, u32 ofs, int w, int h) {
+    const size_t size = static_cast<size_t>(w) * h * 4;
+    if (raw) {
+      return dst.subspan(ofs, size);
+    }
+    buf.resize(size);
+    return std::span<u8>(buf);
+  };
+
+  int w = dx;
+  int h = dy;
+  u32 ofs = 0;
+  std::span<u8> level = raw_level(cur, ofs, w, h);
+  if (sx == w && sy == h) {
+    memcpy(level.data(), src.data(), level.size());
+  } else {
+    resize(level, w, h, src, sx, sy, algorithm);
+  }
+  for (u32 i = 0;; ++i) {
+    if (!raw) {
+      TRY(encode(dst.subspan(ofs), level, w, h, format, options));
+    }
+    ofs += getEncodedSize(w, h, format);
+    if (i == mipMapCount) {
+      break;
+    }
+    const int nw = std::max(w / 2, 1);
+    const int nh = std::max(h / 2, 1);
+    std::span<u8> next_level = raw_level(next, ofs, nw, nh);
+    if (filter == MipFilter::Box) {
+      BoxDownsample(next_level.data(), level.data(), w, h);
+    } else {
+      resize(next_level, nw, nh, level, w, h, algorithm);
+    }
+    if (!raw) {
+      std::swap(cur, next);
+      next_level = cur;
+    }
+    level = next_level;
+    w = nw;
+    h = nh;
+  }
+  return {};
 }
 
 struct RGBA32ImageSource {
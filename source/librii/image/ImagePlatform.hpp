@@ -52,6 +52,16 @@ void decode(std::span<u8> dst, std::span<const u8> src, int width, int height,
             gx::TextureFormat texformat, std::span<const u8> tlut = {},
             gx::PaletteFormat tlutformat = gx::PaletteFormat::IA8);
 
+//! @brief Tuning for encode().
+//!
+struct EncodeOptions {
+  //! Worker threads of parallel encoders (CMPR). Zero uses every core; pass 1
+  //! when encoding several images concurrently.
+  u32 num_threads = 0;
+  //! Slower CMPR endpoint search with lower error. Changes the output.
+  bool cmpr_high_quality = false;
+};
+
 //! @brief Encode an image to a GPU texture.
 //!
 //! @param[in] dst The destination pointer to the decoded data. The encoded
@@ -60,13 +70,15 @@ void decode(std::span<u8> dst, std::span<const u8> src, int width, int height,
 //! @param[in] width The width of the image in pixels.
 //! @param[in] height The height of the image in pixels.
 //! @param[in] texformat The format of the image.
+//! @param[in] options Threading and quality settings.
 //!
 //! @pre For efficiency reasons, this method does not handle the case where dst
 //! == src.
 //!
 [[nodiscard]] Result<void> encode(std::span<u8> dst, std::span<const u8> src,
                                   int width, int height,
-                                  gx::TextureFormat texformat);
+                                  gx::TextureFormat texformat,
+                                  const EncodeOptions& options = {});
 
 //! @brief Specifies an algorithm for downscaling/upscaling an image.
 //!
@@ -87,6 +99,43 @@ enum class ResizingAlgorithm { AVIR, Lanczos };
 void resize(std::span<u8> dst, int dx, int dy, std::span<const u8> src, int sx,
             int sy, ResizingAlgorithm type = ResizingAlgorithm::Lanczos);
 
+//! @brief Specifies how each mip level is derived from the level above it.
+//!
+enum class MipFilter {
+  //! Average each 2x2 block. Fast.
+  Box,
+  //! Resample with the chosen ResizingAlgorithm. Slower, sharper.
+  Resample,
+};
+
+//! @brief Build the mip chain of a raw, 8-bit RGBA image and encode it.
+//!
+//! The base level is resized from the source; every further level is
+//! downsampled from the one before it and encoded as soon as it is produced.
+//! At most two levels are held as raw RGBA at a time.
+//!
+//! @param[in] dst         Destination of the encoded chain. With
+//!                        gx::TextureFormat::Extension_RawRGBA32, the levels
+//!                        are built in place.
+//! @param[in] dx          Width of the base level in pixels.
+//! @param[in] dy          Height of the base level in pixels.
+//! @param[in] format      Format of the target data. Not a palette format.
+//! @param[in] mipMapCount Number of additional levels of detail.
+//! @param[in] src         Raw source image.
+//! @param[in] sx          Width of the source image in pixels.
+//! @param[in] sy          Height of the source image in pixels.
+//! @param[in] algorithm   Algorithm for the base level, and for the others
+//!                        with MipFilter::Resample.
+//! @param[in] filter      How levels past the first are produced.
+//! @param[in] options     Encoder settings.
+//!
+[[nodiscard]] Result<void>
+generateMipChain(std::span<u8> dst, int dx, int dy, gx::TextureFormat format,
+                 u32 mipMapCount, std::span<const u8> src, int sx, int sy,
+                 ResizingAlgorithm algorithm = ResizingAlgorithm::Lanczos,
+                 MipFilter filter = MipFilter::Box,
+                 const EncodeOptions& options = {});
+
 //! @brief Perform a composite transformation on image data, with mipmap
 //! support.
 //!
@@ -0,0 +1,502 @@
+#include "Palette.hpp"
+
+#include <librii/image/ImagePlatform.hpp>
+#include <rsl/ThreadPool.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+
+namespace librii::image {
+
+using Color = std::array<u8, 4>;
+
+// Bit replication, as the GPU expands palette entries.
+static u8 Expand3(u32 v) {
+  return static_cast<u8>((v << 5) | (v << 2) | (v >> 1));
+}
+static u8 Expand4(u32 v) { return static_cast<u8>((v << 4) | v); }
+static u8 Expand5(u32 v) { return static_cast<u8>((v << 3) | (v >> 2)); }
+static u8 Expand6(u32 v) { return static_cast<u8>((v << 2) | (v >> 4)); }
+// Rounds an 8-bit channel to |bits| bits.
+static u32 Reduce(u8 v, u32 bits) {
+  return (v * ((1u << bits) - 1) + 127) / 255;
+}
+
+static u16 EncodeEntry(const Color& c, gx::PaletteFormat format) {
+  switch (format) {
+  case gx::PaletteFormat::IA8: {
+    // Same weights as the IA8 texture encoder.
+    const auto i = static_cast<u8>(c[0] * 0.299 + c[1] * 0.587 + c[2] * 0.114);
+    return static_cast<u16>((c[3] << 8) | i);
+  }
+  case gx::PaletteFormat::RGB565:
+    return static_cast<u16>((Reduce(c[0], 5) << 11) | (Reduce(c[1], 6) << 5) |
+                            Reduce(c[2], 5));
+  case gx::PaletteFormat::RGB5A3:
+    if (Reduce(c[3], 3) == 7) {
+      return static_cast<u16>(0x8000 | (Reduce(c[0], 5) << 10) |
+                              (Reduce(c[1], 5) << 5) | Reduce(c[2], 5));
+    }
+    return static_cast<u16>((Reduce(c[3], 3) << 12) | (Reduce(c[0], 4) << 8) |
+                            (Reduce(c[1], 4) << 4) | Reduce(c[2], 4));
+  }
+  return 0;
+}
+
+static Color DecodeEntry(u16 v, gx::PaletteFormat format) {
+  switch (format) {
+  case gx::PaletteFormat::IA8: {
+    const auto i = static_cast<u8>(v & 0xFF);
+    return {i, i, i, static_cast<u8>(v >> 8)};
+  }
+  case gx::PaletteFormat::RGB565:
+    return {Expand5((v >> 11) & 0x1F), Expand6((v >> 5) & 0x3F),
+            Expand5(v & 0x1F), 0xFF};
+  case gx::PaletteFormat::RGB5A3:
+    if (v & 0x8000) {
+      return {Expand5((v >> 10) & 0x1F), Expand5((v >> 5) & 0x1F),
+              Expand5(v & 0x1F), 0xFF};
+    }
+    return {Expand4((v >> 8) & 0xF), Expand4((v >> 4) & 0xF), Expand4(v & 0xF),
+            Expand3((v >> 12) & 0x7)};
+  }
+  return {};
+}
+
+// The color |c| decodes to once stored in |format|.
+static Color Snap(const Color& c, gx::PaletteFormat format) {
+  return DecodeEntry(EncodeEntry(c, format), format);
+}
+
+static u32 Pack(const Color& c) {
+  return (u32{c[0]} << 24) | (u32{c[1]} << 16) | (u32{c[2]} << 8) | c[3];
+}
+
+static u32 Distance(const Color& a, const Color& b) {
+  u32 d = 0;
+  for (int i = 0; i < 4; ++i) {
+    const int delta = a[i] - b[i];
+    d += delta * delta;
+  }
+  return d;
+}
+
+namespace {
+
+// k-d tree over the palette, for nearest-entry queries. Ties go to the lowest
+// index, so results do not depend on the tree's shape.
+class ColorTree {
+public:
+  explicit ColorTree(std::span<const Color> colors) : mColors(colors) {
+    mOrder.resize(colors.size());
+    std::iota(mOrder.begin(), mOrder.end(), 0);
+    if (!colors.empty()) {
+      build(0, static_cast<u32>(colors.size()));
+    }
+  }
+
+  u32 nearest(const Color& c) const {
+    u32 best = 0;
+    u32 best_d = std::numeric_limits<u32>::max();
+    search(0, c, best, best_d);
+    return best;
+  }
+
+private:
+  static constexpr u32 LeafSize = 8;
+
+  struct Node {
+    u32 begin, end;
+    // Children; 0 for leaves (the root is never a child).
+    u32 left = 0, right = 0;
+    u8 axis = 0;
+    u8 split = 0;
+  };
+
+  u32 build(u32 begin, u32 end) {
+    const auto index = static_cast<u32>(mNodes.size());
+    mNodes.push_back({.begin = begin, .end = end});
+    if (end - begin <= LeafSize) {
+      return index;
+    }
+    // Split the widest channel at its median.
+    Color lo{255, 255, 255, 255}, hi{};
+    for (u32 i = begin; i < end; ++i) {
+      for (int c = 0; c < 4; ++c) {
+        lo[c] = std::min(lo[c], mColors[mOrder[i]][c]);
+        hi[c] = std::max(hi[c], mColors[mOrder[i]][c]);
+      }
+    }
+    u8 axis = 0;
+    for (u8 c = 1; c < 4; ++c) {
+      if (hi[c] - lo[c] > hi[axis] - lo[axis]) {
+        axis = c;
+      }
+    }
+    if (hi[axis] == lo[axis]) {
+      return index;
+    }
+    const u32 mid = (begin + end) / 2;
+    std::nth_element(mOrder.begin() + begin, mOrder.begin() + mid,
+                     mOrder.begin() + end, [&](u32 a, u32 b) {
+                       return mColors[a][axis] < mColors[b][axis];
+                     });
+    const u8 split = mColors[mOrder[mid]][axis];
+    const u32 left = build(begin, mid);
+    const u32 right = build(mid, end);
+    mNodes[index].left = left;
+    mNodes[index].right = right;
+    mNodes[index].axis = axis;
+    mNodes[index].split = split;
+    return index;
+  }
+
+  void search(u32 index, const Color& c, u32& best, u32& best_d) const {
+    const Node& node = mNodes[index];
+    if (node.left == 0) {
+      for (u32 i = node.begin; i < node.end; ++i) {
+        const u32 entry = mOrder[i];
+        const u32 d = Distance(c, mColors[entry]);
+        if (d < best_d || (d == best_d && entry < best)) {
+          best = entry;
+          best_d = d;
+        }
+      }
+      return;
+    }
+    // Entries left of the split are <= it, entries right of it are >= it.
+    const int delta = c[node.axis] - node.split;
+    search(delta < 0 ? node.left : node.right, c, best, best_d);
+    if (static_cast<u32>(delta * delta) <= best_d) {
+      search(delta < 0 ? node.right : node.left, c, best, best_d);
+    }
+  }
+
+  std::span<const Color> mColors;
+  std::vector<u32> mOrder;
+  std::vector<Node> mNodes;
+};
+
+struct Bin {
+  Color color;
+  u32 count;
+};
+
+// Count-weighted run of bins, split along the channel of largest variance.
+struct Box {
+  size_t begin, end;
+  double error; // Summed squared distance to the mean
+  int axis;
+
+  bool operator<(const Box& rhs) const {
+    // Deterministic order for std::priority_queue
+    return error != rhs.error ? error < rhs.error : begin > rhs.begin;
+  }
+};
+
+} // namespace
+
+// Distinct colors of |src| after rounding to |format|, in a fixed order.
+static std::vector<Bin> Histogram(std::span<const u8> src,
+                                  gx::PaletteFormat format) {
+  std::unordered_map<u32, u32> counts;
+  for (size_t i = 0; i + 4 <= src.size(); i += 4) {
+    const Color c = Snap({src[i], src[i + 1], src[i + 2], src[i + 3]}, format);
+    ++counts[Pack(c)];
+  }
+  std::vector<Bin> bins;
+  bins.reserve(counts.size());
+  for (auto [key, count] : counts) {
+    bins.push_back({.color = {static_cast<u8>(key >> 24),
+                              static_cast<u8>(key >> 16),
+                              static_cast<u8>(key >> 8), static_cast<u8>(key)},
+                    .count = count});
+  }
+  std::ranges::sort(bins, {}, [](const Bin& b) { return Pack(b.color); });
+  return bins;
+}
+
+static Box MakeBox(std::span<const Bin> bins, size_t begin, size_t end) {
+  std::array<double, 4> sum{}, sum2{};
+  double n = 0.0;
+  for (size_t i = begin; i < end; ++i) {
+    const double w = bins[i].count;
+    for (int c = 0; c < 4; ++c) {
+      const double v = bins[i].color[c];
+      sum[c] += w * v;
+      sum2[c] += w * v * v;
+    }
+    n += w;
+  }
+  Box box{.begin = begin, .end = end, .error = 0.0, .axis = 0};
+  double best = -1.0;
+  for (int c = 0; c < 4; ++c) {
+    const double var = std::max(sum2[c] - sum[c] * sum[c] / n, 0.0);
+    box.error += var;
+    if (var > best) {
+      best = var;
+      box.axis = c;
+    }
+  }
+  return box;
+}
+
+static Color Mean(std::span<const Bin> bins, gx::PaletteFormat format) {
+  std::array<u64, 4> sum{};
+  u64 n = 0;
+  for (const auto& bin : bins) {
+    for (int c = 0; c < 4; ++c) {
+      sum[c] += u64{bin.color[c]} * bin.count;
+    }
+    n += bin.count;
+  }
+  Color mean;
+  for (int c = 0; c < 4; ++c) {
+    mean[c] = static_cast<u8>((sum[c] + n / 2) / n);
+  }
+  return Snap(mean, format);
+}
+
+static std::vector<Color> MedianCut(std::vector<Bin>& bins, u32 max_colors,
+                                    gx::PaletteFormat format) {
+  std::priority_queue<Box> boxes;
+  boxes.push(MakeBox(bins, 0, bins.size()));
+  std::vector<Box> done;
+  while (!boxes.empty() && boxes.size() + done.size() < max_colors) {
+    const Box box = boxes.top();
+    boxes.pop();
+    if (box.error <= 0.0 || box.end - box.begin < 2) {
+      done.push_back(box);
+      continue;
+    }
+    const auto first = bins.begin() + box.begin;
+    const auto last = bins.begin() + box.end;
+    std::sort(first, last, [&](const Bin& a, const Bin& b) {
+      const u8 ka = a.color[box.axis], kb = b.color[box.axis];
+      return ka != kb ? ka < kb : Pack(a.color) < Pack(b.color);
+    });
+    // Split at the weighted median.
+    u64 total = 0;
+    for (auto it = first; it != last; ++it) {
+      total += it->count;
+    }
+    size_t mid = box.begin;
+    for (u64 acc = 0; mid < box.end && 2 * acc < total; ++mid) {
+      acc += bins[mid].count;
+    }
+    mid = std::clamp(mid, box.begin + 1, box.end - 1);
+    boxes.push(MakeBox(bins, box.begin, mid));
+    boxes.push(MakeBox(bins, mid, box.end));
+  }
+  for (; !boxes.empty(); boxes.pop()) {
+    done.push_back(boxes.top());
+  }
+  std::ranges::sort(done, {}, &Box::begin);
+
+  std::vector<Color> colors;
+  for (const auto& box : done) {
+    colors.push_back(Mean(std::span(bins).subspan(box.begin,
+                                                  box.end - box.begin),
+                          format));
+  }
+  return colors;
+}
+
+// Lloyd's k-means over the histogram, starting from |palette|.
+static void Refine(std::span<const Bin> bins, std::vector<Color>& palette,
+                   gx::PaletteFormat format) {
+  struct Accum {
+    std::array<u64, 4> sum{};
+    u64 count = 0;
+  };
+  const size_t threads = rsl::ThreadPool::Shared().threadCount();
+  const size_t chunk =
+      std::max<size_t>(4096, (bins.size() + threads * 2 - 1) / (threads * 2));
+  const size_t num_chunks = (bins.size() + chunk - 1) / chunk;
+
+  for (int iteration = 0; iteration < 4; ++iteration) {
+    const ColorTree tree(palette);
+    std::vector<std::vector<Accum>> partial(num_chunks);
+    {
+      rsl::TaskGroup group;
+      for (size_t i = 0; i < num_chunks; ++i) {
+        group.run([&, i] {
+          auto& sums = partial[i];
+          sums.resize(palette.size());
+          const size_t end = std::min(bins.size(), (i + 1) * chunk);
+          for (size_t j = i * chunk; j < end; ++j) {
+            auto& acc = sums[tree.nearest(bins[j].color)];
+            for (int c = 0; c < 4; ++c) {
+              acc.sum[c] += u64{bins[j].color[c]} * bins[j].count;
+            }
+            acc.count += bins[j].count;
+          }
+        });
+      }
+    }
+    bool changed = false;
+    for (size_t k = 0; k < palette.size(); ++k) {
+      Accum acc;
+      for (const auto& sums : partial) {
+        for (int c = 0; c < 4; ++c) {
+          acc.sum[c] += sums[k].sum[c];
+        }
+        acc.count += sums[k].count;
+      }
+      if (acc.count == 0) {
+        continue;
+      }
+      Color mean;
+      for (int c = 0; c < 4; ++c) {
+        mean[c] = static_cast<u8>((acc.sum[c] + acc.count / 2) / acc.count);
+      }
+      mean = Snap(mean, format);
+      changed |= mean != palette[k];
+      palette[k] = mean;
+    }
+    if (!changed) {
+      break;
+    }
+  }
+}
+
+u32 getMaxPaletteSize(gx::TextureFormat format) {
+  switch (format) {
+  case gx::TextureFormat::C4:
+    return 16;
+  case gx::TextureFormat::C8:
+    return 256;
+  case gx::TextureFormat::C14X2:
+    return 16384;
+  default:
+    return 0;
+  }
+}
+
+Palette quantize(std::span<const u8> src, u32 max_colors,
+                 gx::PaletteFormat format) {
+  Palette palette{.format = format};
+  auto bins = Histogram(src, format);
+  if (bins.size() <= max_colors) {
+    for (const auto& bin : bins) {
+      palette.colors.push_back(bin.color);
+    }
+    return palette;
+  }
+  palette.colors = MedianCut(bins, max_colors, format);
+  Refine(bins, palette.colors, format);
+  return palette;
+}
+
+Result<void> encodeIndexed(std::span<u8> dst, std::span<const u8> src,
+                           int width, int height, gx::TextureFormat texformat,
+                           const Palette& palette) {
+  const u32 max_colors = getMaxPaletteSize(texformat);
+  if (max_colors == 0) {
+    return std::unexpected(std::format("Texture format {} has no palette",
+                                       static_cast<u32>(texformat)));
+  }
+  if (palette.colors.empty() || palette.colors.size() > max_colors) {
+    return std::unexpected(
+        std::format("A palette of {} colors does not fit texture format {}",
+                    palette.colors.size(), static_cast<u32>(texformat)));
+  }
+  EXPECT(width > 0 && height > 0);
+  EXPECT(src.size() >= static_cast<size_t>(width) * height * 4);
+  EXPECT(dst.size() >= getEncodedSize(width, height, texformat));
+
+  // Texels per 32-byte block
+  const int block_w = texformat == gx::TextureFormat::C14X2 ? 4 : 8;
+  const int block_h = texformat == gx::TextureFormat::C4 ? 8 : 4;
+  const int blocks_x = (width + block_w - 1) / block_w;
+  const int blocks_y = (height + block_h - 1) / block_h;
+
+  const ColorTree tree(palette.colors);
+  auto encode_row = [&](int by) {
+    u8* out = dst.data() + static_cast<size_t>(by) * blocks_x * 32;
+    for (int bx = 0; bx < blocks_x; ++bx, out += 32) {
+      int t = 0;
+      for (int y = 0; y < block_h; ++y) {
+        for (int x = 0; x < block_w; ++x, ++t) {
+          // Padding repeats the edge, like the other encoders.
+          const int px = std::min(bx * block_w + x, width - 1);
+          const int py = std::min(by * block_h + y, height - 1);
+          const u8* p = &src[(static_cast<size_t>(py) * width + px) * 4];
+          // Match in the palette's color space, like `quantize`.
+          const u32 index = tree.nearest(
+              Snap({p[0], p[1], p[2], p[3]}, palette.format));
+          switch (texformat) {
+          case gx::TextureFormat::C4:
+            if (t % 2 == 0) {
+              out[t / 2] = static_cast<u8>(index << 4);
+            } else {
+              out[t / 2] |= static_cast<u8>(index);
+            }
+            break;
+          case gx::TextureFormat::C8:
+            out[t] = static_cast<u8>(index);
+            break;
+          default:
+            out[t * 2] = static_cast<u8>(index >> 8);
+            out[t * 2 + 1] = static_cast<u8>(index);
+            break;
+          }
+        }
+      }
+    }
+  };
+  rsl::TaskGroup group;
+  for (int by = 0; by < blocks_y; ++by) {
+    group.run([&, by] { encode_row(by); });
+  }
+  group.wait();
+  return {};
+}
+
+std::vector<u8> encodeTlut(const Palette& palette) {
+  std::vector<u8> tlut;
+  tlut.reserve(palette.colors.size() * 2);
+  for (const auto& color : palette.colors) {
+    const u16 entry = EncodeEntry(color, palette.format);
+    tlut.push_back(static_cast<u8>(entry >> 8));
+    tlut.push_back(static_cast<u8>(entry));
+  }
+  return tlut;
+}
+
+Result<Palette> encodePaletted(std::span<u8> dst, std::span<const u8> src,
+                               int width, int height,
+                               gx::TextureFormat texformat,
+                               gx::PaletteFormat tlutformat, u32 mipMapCount) {
+  const u32 max_colors = getMaxPaletteSize(texformat);
+  if (max_colors == 0) {
+    return std::unexpected(std::format("Texture format {} has no palette",
+                                       static_cast<u32>(texformat)));
+  }
+  EXPECT(width > 0 && height > 0);
+  EXPECT(dst.size() >= getEncodedSize(width, height, texformat, mipMapCount));
+  size_t raw_size = 0;
+  for (u32 i = 0; i <= mipMapCount; ++i) {
+    raw_size += static_cast<size_t>(std::max(width >> i, 1)) *
+                std::max(height >> i, 1) * 4;
+  }
+  EXPECT(src.size() >= raw_size);
+
+  // Every level indexes the same palette.
+  auto palette = quantize(src.subspan(0, raw_size), max_colors, tlutformat);
+  size_t src_ofs = 0;
+  for (u32 i = 0; i <= mipMapCount; ++i) {
+    const int w = std::max(width >> i, 1);
+    const int h = std::max(height >> i, 1);
+    const u32 dst_ofs =
+        i == 0 ? 0 : getEncodedSize(width, height, texformat, i - 1);
+    TRY(encodeIndexed(dst.subspan(dst_ofs), src.subspan(src_ofs), w, h,
+                      texformat, palette));
+    src_ofs += static_cast<size_t>(w) * h * 4;
+  }
+  return palette;
+}
+
+} // namespace librii::image
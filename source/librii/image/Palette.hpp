@@ -0,0 +1,84 @@
+#pragma once
+
+#include <core/common.h>
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include <librii/gx.h>
+
+namespace librii::image {
+
+//! @brief The color table (TLUT) of a C4, C8 or C14X2 texture.
+//!
+struct Palette {
+  gx::PaletteFormat format = gx::PaletteFormat::RGB5A3;
+  //! Entries as 8-bit RGBA, already rounded to what `format` can store.
+  std::vector<std::array<u8, 4>> colors;
+};
+
+//! @brief Number of palette entries a texture format can address.
+//!
+//! @return 16 for C4, 256 for C8, 16384 for C14X2 and 0 otherwise.
+//!
+[[nodiscard]] u32 getMaxPaletteSize(gx::TextureFormat format);
+
+//! @brief Reduce raw 8-bit RGBA pixels to a palette.
+//!
+//! Colors are first rounded to @p format. If at most @p max_colors distinct
+//! colors remain, they make up the palette as-is. Otherwise the color
+//! histogram is split by median cut, then refined by a few rounds of k-means.
+//! Work is spread over `rsl::ThreadPool::Shared()`; the result does not depend
+//! on the number of threads.
+//!
+//! @param[in] src        Raw pixels. May span a whole mip chain, so that all
+//!                       levels share one palette.
+//! @param[in] max_colors Maximum size of the palette (see getMaxPaletteSize).
+//! @param[in] format     Format the palette will be stored in.
+//!
+[[nodiscard]] Palette quantize(std::span<const u8> src, u32 max_colors,
+                               gx::PaletteFormat format);
+
+//! @brief Encode raw 8-bit RGBA as C4/C8/C14X2 texels indexing @p palette.
+//!
+//! Each pixel takes the closest palette entry.
+//!
+//! @param[in] dst       Destination of the encoded texels.
+//! @param[in] src       Raw pixels of a single image.
+//! @param[in] width     The width of the image in pixels.
+//! @param[in] height    The height of the image in pixels.
+//! @param[in] texformat C4, C8 or C14X2.
+//! @param[in] palette   Palette to index. Must fit @p texformat.
+//!
+[[nodiscard]] Result<void> encodeIndexed(std::span<u8> dst,
+                                         std::span<const u8> src, int width,
+                                         int height,
+                                         gx::TextureFormat texformat,
+                                         const Palette& palette);
+
+//! @brief Serialize a palette as TLUT data: big-endian 16-bit entries.
+//!
+[[nodiscard]] std::vector<u8> encodeTlut(const Palette& palette);
+
+//! @brief Quantize a raw 8-bit RGBA mip chain to a single palette and encode
+//! every level with it.
+//!
+//! @param[in] dst         Destination of the encoded texels, sized for
+//!                        @p mipMapCount additional levels.
+//! @param[in] src         Raw pixels of the base image followed by each
+//!                        mipmap.
+//! @param[in] width       Width of the base image in pixels.
+//! @param[in] height      Height of the base image in pixels.
+//! @param[in] texformat   C4, C8 or C14X2.
+//! @param[in] tlutformat  Format of the generated palette.
+//! @param[in] mipMapCount Number of additional levels of detail.
+//!
+//! @return The palette the texels index.
+//!
+[[nodiscard]] Result<Palette>
+encodePaletted(std::span<u8> dst, std::span<const u8> src, int width,
+               int height, gx::TextureFormat texformat,
+               gx::PaletteFormat tlutformat, u32 mipMapCount = 0);
+
+} // namespace librii::image
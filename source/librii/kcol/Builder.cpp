@@ -0,0 +1,509 @@
+#include "Builder.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+#include <librii/rhst/RHST.hpp>
+#include <rsl/ParallelFor.hpp>
+
+namespace librii::kcol {
+
+namespace {
+
+//! Root cubes are made larger until there are at most this many.
+constexpr size_t MaxRootCubes = 4096;
+
+struct PrismGeometry {
+  float height;
+  glm::vec3 pos, fnrm, enrm1, enrm2, enrm3;
+};
+
+bool IsFinite(const glm::vec3& v) {
+  return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+//! Inverse of `FromPrism`. Returns nothing for degenerate triangles.
+std::optional<PrismGeometry> ToPrism(const std::array<glm::vec3, 3>& v) {
+  const glm::vec3 n = glm::cross(v[1] - v[0], v[2] - v[0]);
+  if (!IsFinite(n) || glm::length(n) < 1e-6f) {
+    return std::nullopt;
+  }
+  PrismGeometry p;
+  p.pos = v[0];
+  p.fnrm = glm::normalize(n);
+  p.enrm1 = glm::normalize(glm::cross(p.fnrm, v[2] - v[0]));
+  p.enrm2 = glm::normalize(glm::cross(v[1] - v[0], p.fnrm));
+  p.enrm3 = glm::normalize(glm::cross(p.fnrm, v[1] - v[2]));
+  p.height = glm::dot(v[1] - v[0], p.enrm3);
+  if (!std::isfinite(p.height) || p.height <= 0.0f || !IsFinite(p.enrm1) ||
+      !IsFinite(p.enrm2) || !IsFinite(p.enrm3)) {
+    return std::nullopt;
+  }
+  return p;
+}
+
+//! Deduplicates bit-identical vectors (+0 and -0 are merged).
+class VecPool {
+public:
+  explicit VecPool(std::vector<glm::vec3>& out) : mOut(out) {}
+
+  size_t insert(glm::vec3 v) {
+    v += 0.0f;
+    const Key key{std::bit_cast<u32>(v.x), std::bit_cast<u32>(v.y),
+                  std::bit_cast<u32>(v.z)};
+    auto [it, inserted] = mIds.try_emplace(key, mOut.size());
+    if (inserted) {
+      mOut.push_back(v);
+    }
+    return it->second;
+  }
+
+private:
+  struct Key {
+    u32 x, y, z;
+    bool operator==(const Key&) const = default;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& k) const {
+      u64 h = k.x * 0x9E3779B97F4A7C15ull;
+      h ^= (h >> 29) + k.y * 0xBF58476D1CE4E5B9ull;
+      h ^= (h >> 31) + k.z * 0x94D049BB133111EBull;
+      return static_cast<size_t>(h ^ (h >> 32));
+    }
+  };
+
+  std::vector<glm::vec3>& mOut;
+  std::unordered_map<Key, size_t, KeyHash> mIds;
+};
+
+//! Separating axis test (Akenine-Moller) of a triangle against an
+//! axis-aligned cube.
+bool TriangleIntersectsCube(const std::array<glm::vec3, 3>& tri,
+                            const glm::vec3& center, float half) {
+  const glm::vec3 v0 = tri[0] - center;
+  const glm::vec3 v1 = tri[1] - center;
+  const glm::vec3 v2 = tri[2] - center;
+
+  for (int a = 0; a < 3; ++a) {
+    if (std::min({v0[a], v1[a], v2[a]}) > half ||
+        std::max({v0[a], v1[a], v2[a]}) < -half) {
+      return false;
+    }
+  }
+
+  const glm::vec3 e0 = v1 - v0;
+  const glm::vec3 e1 = v2 - v1;
+  const glm::vec3 e2 = v0 - v2;
+  auto separates = [&](const glm::vec3& axis) {
+    const float r =
+        half * (std::abs(axis.x) + std::abs(axis.y) + std::abs(axis.z));
+    const float p0 = glm::dot(v0, axis);
+    const float p1 = glm::dot(v1, axis);
+    const float p2 = glm::dot(v2, axis);
+    return std::min({p0, p1, p2}) > r || std::max({p0, p1, p2}) < -r;
+  };
+  if (separates(glm::cross(e0, e1))) {
+    return false;
+  }
+  for (const glm::vec3& e : {e0, e1, e2}) {
+    if (separates({0.0f, -e.z, e.y}) || separates({e.z, 0.0f, -e.x}) ||
+        separates({-e.y, e.x, 0.0f})) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! Child group / triangle list reference within the octree being built.
+struct Entry {
+  bool leaf = true;
+  u32 index = 0;
+};
+
+struct Cube {
+  glm::vec3 origin;
+  s32 shift = 0;
+  u32 depth = 0;
+  //! Where the result goes: `group` -1 is the root array.
+  s32 group = -1;
+  u32 slot = 0;
+  std::shared_ptr<const std::vector<u16>> candidates;
+};
+
+void WriteBE32(std::vector<u8>& out, size_t at, u32 v) {
+  out[at + 0] = static_cast<u8>(v >> 24);
+  out[at + 1] = static_cast<u8>(v >> 16);
+  out[at + 2] = static_cast<u8>(v >> 8);
+  out[at + 3] = static_cast<u8>(v);
+}
+
+Result<void> BuildOctreeImpl(KCollisionData& data,
+                             std::span<const std::array<glm::vec3, 3>> tris,
+                             const KclBuildOptions& opt) {
+  if (tris.size() > 0xFFFF) {
+    return std::unexpected(
+        std::format("Too many prisms: {} (max 65535)", tris.size()));
+  }
+  const float pad = std::max(opt.cube_padding, 0.0f);
+  const u32 leaf_width =
+      std::bit_ceil(std::clamp<u32>(opt.min_leaf_width, 1, 1u << 30));
+  const s32 leaf_shift = std::countr_zero(leaf_width);
+
+  glm::vec3 lo(0.0f), hi(0.0f);
+  if (!tris.empty()) {
+    lo = hi = tris[0][0];
+    for (auto& tri : tris) {
+      for (auto& v : tri) {
+        if (!IsFinite(v)) {
+          return std::unexpected("Collision contains non-finite positions");
+        }
+        lo = glm::min(lo, v);
+        hi = glm::max(hi, v);
+      }
+    }
+  }
+  lo = glm::floor(lo - pad);
+  hi = hi + pad;
+
+  std::array<u32, 3> width;
+  for (int a = 0; a < 3; ++a) {
+    const double extent = std::ceil(double(hi[a]) - double(lo[a])) + 1.0;
+    if (extent > double(1u << 30)) {
+      return std::unexpected("Collision is too large to index");
+    }
+    width[a] = std::bit_ceil(std::max(static_cast<u32>(extent), leaf_width));
+  }
+  s32 shift = std::countr_zero(std::min({width[0], width[1], width[2]}));
+  auto blocks = [&](int a) { return std::max<u32>(width[a] >> shift, 1); };
+  while (size_t(blocks(0)) * blocks(1) * blocks(2) > MaxRootCubes) {
+    ++shift;
+  }
+  for (auto& w : width) {
+    w = std::max(w, 1u << shift);
+  }
+  const s32 x_shift = std::countr_zero(width[0]) - shift;
+  const s32 y_shift = std::countr_zero(width[1]) - shift;
+
+  data.area_min_pos = lo;
+  data.area_x_width_mask = ~(width[0] - 1);
+  data.area_y_width_mask = ~(width[1] - 1);
+  data.area_z_width_mask = ~(width[2] - 1);
+  data.block_width_shift = shift;
+  data.area_x_blocks_shift = x_shift;
+  data.area_xy_blocks_shift = x_shift + y_shift;
+
+  auto all = std::make_shared<std::vector<u16>>(tris.size());
+  for (size_t i = 0; i < tris.size(); ++i) {
+    (*all)[i] = static_cast<u16>(i);
+  }
+
+  std::vector<Entry> roots(size_t(blocks(0)) * blocks(1) * blocks(2));
+  std::vector<std::array<Entry, 8>> groups;
+  std::map<std::vector<u16>, u32> list_ids;
+  std::vector<const std::vector<u16>*> lists;
+
+  std::vector<Cube> level;
+  for (u32 z = 0; z < blocks(2); ++z) {
+    for (u32 y = 0; y < blocks(1); ++y) {
+      for (u32 x = 0; x < blocks(0); ++x) {
+        const u32 slot = (z << (x_shift + y_shift)) | (y << x_shift) | x;
+        level.push_back(Cube{
+            .origin = lo + glm::vec3(x, y, z) * float(1u << shift),
+            .shift = shift,
+            .group = -1,
+            .slot = slot,
+            .candidates = all,
+        });
+      }
+    }
+  }
+
+  while (!level.empty()) {
+    std::vector<std::shared_ptr<const std::vector<u16>>> found(level.size());
+    rsl::ParallelFor(level.size(), opt.num_threads, [&](size_t i) {
+      const Cube& cube = level[i];
+      const float half = float(1u << cube.shift) * 0.5f;
+      const glm::vec3 center = cube.origin + half;
+      auto inside = std::make_shared<std::vector<u16>>();
+      for (u16 p : *cube.candidates) {
+        if (TriangleIntersectsCube(tris[p], center, half + pad)) {
+          inside->push_back(p);
+        }
+      }
+      found[i] = std::move(inside);
+    });
+
+    std::vector<Cube> next;
+    for (size_t i = 0; i < level.size(); ++i) {
+      const Cube& cube = level[i];
+      Entry entry;
+      const bool split = found[i]->size() > opt.max_prisms_per_leaf &&
+                         cube.shift > leaf_shift && cube.depth < opt.max_depth;
+      if (split) {
+        entry = {.leaf = false, .index = static_cast<u32>(groups.size())};
+        groups.emplace_back();
+        const float child_w = float(1u << (cube.shift - 1));
+        for (u32 c = 0; c < 8; ++c) {
+          next.push_back(Cube{
+              .origin = cube.origin +
+                        glm::vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1) * child_w,
+              .shift = cube.shift - 1,
+              .depth = cube.depth + 1,
+              .group = static_cast<s32>(entry.index),
+              .slot = c,
+              .candidates = found[i],
+          });
+        }
+      } else {
+        auto [it, inserted] =
+            list_ids.try_emplace(*found[i], static_cast<u32>(lists.size()));
+        if (inserted) {
+          lists.push_back(&it->first);
+        }
+        entry = {.leaf = true, .index = it->second};
+      }
+      if (cube.group < 0) {
+        roots[cube.slot] = entry;
+      } else {
+        groups[cube.group][cube.slot] = entry;
+      }
+    }
+    level = std::move(next);
+  }
+
+  // Layout: root array, child groups, then the prism lists. Leaves point at
+  // the u16 *before* their list (the game pre-increments), and every list is
+  // zero-terminated with 1-based prism indices.
+  const size_t groups_start = roots.size() * 4;
+  const size_t lists_start = groups_start + groups.size() * 32;
+  std::vector<size_t> list_ptrs(lists.size());
+  size_t size = lists_start;
+  for (size_t i = 0; i < lists.size(); ++i) {
+    list_ptrs[i] = size - 2;
+    size += (lists[i]->size() + 1) * 2;
+  }
+  if (size > 0x7FFF'FFFF) {
+    return std::unexpected("Octree is too large");
+  }
+  auto& out = data.block_data;
+  out.assign(size, 0);
+  auto encode = [&](const Entry& e, size_t base) -> u32 {
+    if (e.leaf) {
+      return 0x8000'0000 | static_cast<u32>(list_ptrs[e.index] - base);
+    }
+    return static_cast<u32>(groups_start + e.index * 32 - base);
+  };
+  for (size_t i = 0; i < roots.size(); ++i) {
+    WriteBE32(out, i * 4, encode(roots[i], 0));
+  }
+  for (size_t g = 0; g < groups.size(); ++g) {
+    const size_t base = groups_start + g * 32;
+    for (size_t c = 0; c < 8; ++c) {
+      WriteBE32(out, base + c * 4, encode(groups[g][c], base));
+    }
+  }
+  for (size_t i = 0; i < lists.size(); ++i) {
+    size_t at = list_ptrs[i] + 2;
+    for (u16 p : *lists[i]) {
+      const u16 id = p + 1;
+      out[at++] = static_cast<u8>(id >> 8);
+      out[at++] = static_cast<u8>(id);
+    }
+  }
+  return {};
+}
+
+} // namespace
+
+Result<KCollisionData> BuildKCollisionData(std::span<const KclTriangle> tris,
+                                           const KclBuildOptions& opt) {
+  KCollisionData data;
+  data.prism_thickness = opt.prism_thickness;
+  data.sphere_radius = opt.sphere_radius;
+
+  std::vector<std::array<glm::vec3, 3>> kept;
+  VecPool positions(data.pos_data);
+  VecPool normals(data.nrm_data);
+  for (auto& tri : tris) {
+    auto prism = ToPrism(tri.verts);
+    if (!prism) {
+      continue;
+    }
+    data.prism_data.push_back(KCollisionPrismData{
+        .height = prism->height,
+        .pos_i = static_cast<u16>(positions.insert(prism->pos)),
+        .fnrm_i = static_cast<u16>(normals.insert(prism->fnrm)),
+        .enrm1_i = static_cast<u16>(normals.insert(prism->enrm1)),
+        .enrm2_i = static_cast<u16>(normals.insert(prism->enrm2)),
+        .enrm3_i = static_cast<u16>(normals.insert(prism->enrm3)),
+        .attribute = tri.attribute,
+    });
+    kept.push_back(tri.verts);
+  }
+  if (data.pos_data.size() > 0x10000) {
+    return std::unexpected(std::format(
+        "Too many unique positions: {} (max 65536)", data.pos_data.size()));
+  }
+  if (data.nrm_data.size() > 0x10000) {
+    return std::unexpected(std::format(
+        "Too many unique normals: {} (max 65536)", data.nrm_data.size()));
+  }
+  TRY(BuildOctreeImpl(data, kept, opt));
+  return data;
+}
+
+Result<void> BuildOctree(KCollisionData& data, const KclBuildOptions& opt) {
+  std::vector<std::array<glm::vec3, 3>> tris(data.prism_data.size());
+  for (size_t i = 0; i < tris.size(); ++i) {
+    const auto& prism = data.prism_data[i];
+    if (prism.pos_i >= data.pos_data.size()) {
+      return std::unexpected(
+          std::format("Prism {} references a missing position", i));
+    }
+    if (std::max({*prism.fnrm_i, *prism.enrm1_i, *prism.enrm2_i,
+                  *prism.enrm3_i}) >= data.nrm_data.size()) {
+      return std::unexpected(
+          std::format("Prism {} references a missing normal", i));
+    }
+    tris[i] = FromPrism(data, prism);
+  }
+  return BuildOctreeImpl(data, tris, opt);
+}
+
+u16 AttributeFromMaterialName(std::string_view name) {
+  auto pos = name.find_last_of('_');
+  std::string_view digits =
+      pos == std::string_view::npos ? name : name.substr(pos + 1);
+  if (digits.starts_with("0x") || digits.starts_with("0X")) {
+    digits.remove_prefix(2);
+  }
+  if (digits.empty() || digits.size() > 4 ||
+      !std::all_of(digits.begin(), digits.end(),
+                   [](char c) { return std::isxdigit(u8(c)); })) {
+    return 0;
+  }
+  return static_cast<u16>(
+      std::strtoul(std::string(digits).c_str(), nullptr, 16));
+}
+
+Result<std::vector<KclTriangle>> ReadOBJTriangles(std::string_view obj) {
+  std::vector<glm::vec3> positions;
+  std::vector<KclTriangle> tris;
+  u16 attribute = 0;
+  size_t line_no = 0;
+
+  std::vector<std::string> tokens;
+  while (!obj.empty()) {
+    ++line_no;
+    auto eol = obj.find('\n');
+    std::string_view line = obj.substr(0, eol);
+    obj = eol == std::string_view::npos ? std::string_view{}
+                                        : obj.substr(eol + 1);
+    if (auto comment = line.find('#'); comment != std::string_view::npos) {
+      line = line.substr(0, comment);
+    }
+
+    tokens.clear();
+    for (size_t i = 0; i < line.size();) {
+      if (std::isspace(u8(line[i]))) {
+        ++i;
+        continue;
+      }
+      size_t j = i;
+      while (j < line.size() && !std::isspace(u8(line[j]))) {
+        ++j;
+      }
+      tokens.emplace_back(line.substr(i, j - i));
+      i = j;
+    }
+    if (tokens.empty()) {
+      continue;
+    }
+
+    if (tokens[0] == "v") {
+      if (tokens.size() < 4) {
+        return std::unexpected(std::format("Line {}: bad vertex", line_no));
+      }
+      positions.emplace_back(std::strtof(tokens[1].c_str(), nullptr),
+                             std::strtof(tokens[2].c_str(), nullptr),
+                             std::strtof(tokens[3].c_str(), nullptr));
+    } else if (tokens[0] == "usemtl") {
+      attribute = tokens.size() > 1 ? AttributeFromMaterialName(tokens[1]) : 0;
+    } else if (tokens[0] == "f") {
+      std::vector<glm::vec3> face;
+      for (size_t i = 1; i < tokens.size(); ++i) {
+        // "v", "v/vt", "v//vn" or "v/vt/vn"; negative indices are relative
+        const long idx = std::strtol(tokens[i].c_str(), nullptr, 10);
+        const long resolved =
+            idx < 0 ? static_cast<long>(positions.size()) + idx : idx - 1;
+        if (idx == 0 || resolved < 0 ||
+            resolved >= static_cast<long>(positions.size())) {
+          return std::unexpected(
+              std::format("Line {}: bad vertex index {}", line_no, tokens[i]));
+        }
+        face.push_back(positions[resolved]);
+      }
+      for (size_t i = 2; i < face.size(); ++i) {
+        tris.push_back({.verts = {face[0], face[i - 1], face[i]},
+                        .attribute = attribute});
+      }
+    }
+  }
+  return tris;
+}
+
+std::vector<KclTriangle>
+ReadRHSTTriangles(const librii::rhst::SceneTree& tree) {
+  std::vector<KclTriangle> tris;
+  for (auto& bone : tree.bones) {
+    for (auto& draw : bone.draw_calls) {
+      if (draw.poly_index < 0 || draw.poly_index >= std::ssize(tree.meshes)) {
+        continue;
+      }
+      u16 attribute = 0;
+      if (draw.mat_index >= 0 && draw.mat_index < std::ssize(tree.materials)) {
+        attribute =
+            AttributeFromMaterialName(tree.materials[draw.mat_index].name);
+      }
+      for (auto& mp : tree.meshes[draw.poly_index].matrix_primitives) {
+        for (auto& prim : mp.primitives) {
+          auto& v = prim.vertices;
+          auto emit = [&](size_t a, size_t b, size_t c) {
+            tris.push_back({.verts = {v[a].position, v[b].position,
+                                      v[c].position},
+                            .attribute = attribute});
+          };
+          switch (prim.topology) {
+          case librii::rhst::Topology::Triangles:
+            for (size_t i = 0; i + 2 < v.size(); i += 3) {
+              emit(i, i + 1, i + 2);
+            }
+            break;
+          case librii::rhst::Topology::TriangleStrip:
+            for (size_t i = 2; i < v.size(); ++i) {
+              if (i % 2 == 0) {
+                emit(i - 2, i - 1, i);
+              } else {
+                emit(i - 1, i - 2, i);
+              }
+            }
+            break;
+          case librii::rhst::Topology::TriangleFan:
+            for (size_t i = 2; i < v.size(); ++i) {
+              emit(0, i - 1, i);
+            }
+            break;
+          }
+        }
+      }
+    }
+  }
+  return tris;
+}
+
+} // namespace librii::kcol
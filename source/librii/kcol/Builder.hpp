@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Model.hpp"
+
+namespace librii::rhst {
+struct SceneTree;
+}
+
+namespace librii::kcol {
+
+struct KclTriangle {
+  std::array<glm::vec3, 3> verts;
+  u16 attribute = 0;
+};
+
+struct KclBuildOptions {
+  //! Cubes holding more prisms than this are split further.
+  u32 max_prisms_per_leaf = 16;
+  //! Cubes are never split below this width. Rounded up to a power of two.
+  u32 min_leaf_width = 256;
+  //! Maximum number of splits below a root cube.
+  u32 max_depth = 10;
+  //! Cubes are grown by this much on each side when testing triangles, so a
+  //! sphere centered in a cube still sees the prisms it can touch.
+  float cube_padding = 250.0f;
+  //! Shared pool threads to use (0 = all of them)
+  u32 num_threads = 0;
+
+  float prism_thickness = 300.0f;
+  float sphere_radius = 250.0f;
+};
+
+//! Convert triangles to prisms (deduplicating positions and normals) and build
+//! the octree. Degenerate triangles are dropped.
+Result<KCollisionData> BuildKCollisionData(std::span<const KclTriangle> tris,
+                                           const KclBuildOptions& opt = {});
+
+//! Rebuild `block_data` and the area/block header fields from `prism_data`.
+Result<void> BuildOctree(KCollisionData& data, const KclBuildOptions& opt = {});
+
+//! Material names ending in a hex number ("road_0x0000", "T4_0040", "0001")
+//! select the collision attribute. Anything else maps to 0.
+u16 AttributeFromMaterialName(std::string_view name);
+
+//! `v` and `f` records; `usemtl` selects the attribute.
+Result<std::vector<KclTriangle>> ReadOBJTriangles(std::string_view obj);
+//! Positions are taken as-is (bone transforms are not applied).
+std::vector<KclTriangle> ReadRHSTTriangles(const librii::rhst::SceneTree& tree);
+
+} // namespace librii::kcol
@@ -1,5 +1,6 @@
 #include "Model.hpp"
 #include <algorithm>
+#include <cstring>
 #include <math.h>
 #include <nlohmann/json.hpp>
 
@@ -146,6 +147,55 @@ Result<KCollisionData> ReadKCollisionData(std::span<const u8> bytes,
   return data;
 }
 
+std::vector<u8> WriteKCollisionData(const KCollisionData& data) {
+  // Sections are laid out in header order, with no padding
+  const u32 pos_data_offset = sizeof(KCollisionV1Header);
+  const u32 nrm_data_offset =
+      pos_data_offset + data.pos_data.size() * sizeof(Vector3f);
+  const u32 prism_begin =
+      nrm_data_offset + data.nrm_data.size() * sizeof(Vector3f);
+  const u32 block_data_offset =
+      prism_begin + data.prism_data.size() * sizeof(KCollisionPrismData);
+
+  std::vector<u8> out(block_data_offset + data.block_data.size());
+  auto put = [&](u32 offset, const auto& value) {
+    std::memcpy(out.data() + offset, &value, sizeof(value));
+  };
+
+  KCollisionV1Header header;
+  header.pos_data_offset = pos_data_offset;
+  header.nrm_data_offset = nrm_data_offset;
+  // 1-indexed
+  header.prism_data_offset = prism_begin - sizeof(KCollisionPrismData);
+  header.block_data_offset = block_data_offset;
+  header.prism_thickness = data.prism_thickness;
+  header.area_min_pos = {data.area_min_pos.x, data.area_min_pos.y,
+                         data.area_min_pos.z};
+  header.area_x_width_mask = data.area_x_width_mask;
+  header.area_y_width_mask = data.area_y_width_mask;
+  header.area_z_width_mask = data.area_z_width_mask;
+  header.block_width_shift = data.block_width_shift;
+  header.area_x_blocks_shift = data.area_x_blocks_shift;
+  header.area_xy_blocks_shift = data.area_xy_blocks_shift;
+  header.sphere_radius = data.sphere_radius;
+  put(0, header);
+
+  for (size_t i = 0; i < data.pos_data.size(); ++i) {
+    const auto& v = data.pos_data[i];
+    put(pos_data_offset + i * sizeof(Vector3f), Vector3f{v.x, v.y, v.z});
+  }
+  for (size_t i = 0; i < data.nrm_data.size(); ++i) {
+    const auto& v = data.nrm_data[i];
+    put(nrm_data_offset + i * sizeof(Vector3f), Vector3f{v.x, v.y, v.z});
+  }
+  for (size_t i = 0; i < data.prism_data.size(); ++i) {
+    put(prism_begin + i * sizeof(KCollisionPrismData), data.prism_data[i]);
+  }
+  std::copy(data.block_data.begin(), data.block_data.end(),
+            out.begin() + block_data_offset);
+  return out;
+}
+
 constexpr std::array<char, 8> WiimmSZSIdentifier = {'W', 'i', 'i', 'm',
                                                     'm', 'S', 'Z', 'S'};
 
@@ -116,6 +116,8 @@ struct KCollisionData {
 
 Result<KCollisionData> ReadKCollisionData(std::span<const u8> bytes,
                                           u32 file_size);
+//! `block_data` is written as-is; see `BuildOctree` to regenerate it.
+std::vector<u8> WriteKCollisionData(const KCollisionData& data);
 
 static inline std::array<glm::vec3, 3>
 FromPrism(const KCollisionData& data, const KCollisionPrismData& prism) {
@@ -0,0 +1,463 @@
+#include "Query.hpp"
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <unordered_map>
+#include <rsl/ParallelFor.hpp>
+
+namespace librii::kcol {
+
+namespace {
+
+u32 ReadBE32(std::span<const u8> data, u64 at) {
+  return u32(data[at]) << 24 | u32(data[at + 1]) << 16 |
+         u32(data[at + 2]) << 8 | u32(data[at + 3]);
+}
+u16 ReadBE16(std::span<const u8> data, u64 at) {
+  return static_cast<u16>(data[at] << 8 | data[at + 1]);
+}
+
+//! Clips [t0, t1] to the part of the ray inside the box [lo, hi].
+bool ClipToBox(const KclRay& ray, const glm::vec3& inv_dir,
+               const glm::vec3& lo, const glm::vec3& hi, float& t0,
+               float& t1) {
+  for (int a = 0; a < 3; ++a) {
+    if (ray.dir[a] == 0.0f) {
+      if (ray.origin[a] < lo[a] || ray.origin[a] > hi[a]) {
+        return false;
+      }
+      continue;
+    }
+    float near = (lo[a] - ray.origin[a]) * inv_dir[a];
+    float far = (hi[a] - ray.origin[a]) * inv_dir[a];
+    if (near > far) {
+      std::swap(near, far);
+    }
+    t0 = std::max(t0, near);
+    t1 = std::min(t1, far);
+    if (t0 > t1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! Moller-Trumbore, either winding.
+std::optional<float> IntersectTriangle(const KclRay& ray,
+                                       const std::array<glm::vec3, 3>& tri) {
+  const glm::vec3 e1 = tri[1] - tri[0];
+  const glm::vec3 e2 = tri[2] - tri[0];
+  const glm::vec3 p = glm::cross(ray.dir, e2);
+  const float det = glm::dot(e1, p);
+  if (det == 0.0f || !std::isfinite(det)) {
+    return std::nullopt;
+  }
+  const float inv_det = 1.0f / det;
+  const glm::vec3 s = ray.origin - tri[0];
+  const float u = glm::dot(s, p) * inv_det;
+  if (u < 0.0f || u > 1.0f) {
+    return std::nullopt;
+  }
+  const glm::vec3 q = glm::cross(s, e1);
+  const float v = glm::dot(ray.dir, q) * inv_det;
+  if (v < 0.0f || u + v > 1.0f) {
+    return std::nullopt;
+  }
+  return glm::dot(e2, q) * inv_det;
+}
+
+struct ClosestPoint {
+  glm::vec3 point;
+  bool interior; //!< Not on an edge or vertex
+};
+
+//! Closest point on a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+ClosestPoint ClosestPointOnTriangle(const glm::vec3& p,
+                                    const std::array<glm::vec3, 3>& tri) {
+  const glm::vec3& a = tri[0];
+  const glm::vec3& b = tri[1];
+  const glm::vec3& c = tri[2];
+  const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+  const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    return {a, false};
+  }
+  const glm::vec3 bp = p - b;
+  const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) {
+    return {b, false};
+  }
+  const float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+    return {a + ab * (d1 / (d1 - d3)), false};
+  }
+  const glm::vec3 cp = p - c;
+  const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) {
+    return {c, false};
+  }
+  const float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+    return {a + ac * (d2 / (d2 - d6)), false};
+  }
+  const float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+    return {b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))), false};
+  }
+  const float denom = 1.0f / (va + vb + vc);
+  return {a + ab * (vb * denom) + ac * (vc * denom), true};
+}
+
+glm::vec3 ChildOffset(u32 child) {
+  return glm::vec3(child & 1, (child >> 1) & 1, (child >> 2) & 1);
+}
+
+} // namespace
+
+struct KclQuery::DecodeState {
+  std::span<const u8> blocks;
+  // File offset -> decoded id, for groups and lists shared between entries
+  std::unordered_map<u64, u32> group_ids;
+  std::unordered_map<u64, u32> list_ids;
+};
+
+u32 KclQuery::rootIndex(u32 x, u32 y, u32 z) const {
+  return (z << mData->area_xy_blocks_shift) |
+         (y << mData->area_x_blocks_shift) | x;
+}
+
+Result<KclQuery::Entry> KclQuery::decodeEntry(DecodeState& state, u32 base,
+                                              u32 index, s32 shift) {
+  const auto& blocks = state.blocks;
+  const u64 at = u64(base) + index * 4;
+  if (at + 4 > blocks.size()) {
+    return std::unexpected(std::format("Octree entry at {:#x} is out of bounds",
+                                       at));
+  }
+  const u32 offset = ReadBE32(blocks, at);
+
+  if (offset & LeafBit) {
+    // Points at the u16 before the list (the game pre-increments)
+    const u64 ptr = base + u64(offset & ~LeafBit);
+    auto [it, inserted] = state.list_ids.try_emplace(ptr, mLists.size());
+    if (inserted) {
+      const u32 begin = mListData.size();
+      for (u64 p = ptr + 2;; p += 2) {
+        if (p + 2 > blocks.size()) {
+          return std::unexpected(
+              std::format("Prism list at {:#x} is not terminated", ptr));
+        }
+        const u16 id = ReadBE16(blocks, p);
+        if (id == 0) {
+          break;
+        }
+        if (id > mTris.size()) {
+          return std::unexpected(std::format(
+              "Prism list at {:#x} references missing prism {}", ptr, id));
+        }
+        mListData.push_back(id - 1);
+      }
+      mLists.emplace_back(begin, static_cast<u32>(mListData.size()));
+    }
+    return LeafBit | it->second;
+  }
+
+  if (shift <= 0 || offset == 0) {
+    return std::unexpected(
+        std::format("Octree branch at {:#x} is invalid", at));
+  }
+  const u64 child = base + u64(offset);
+  if (child + 32 > blocks.size()) {
+    return std::unexpected(
+        std::format("Octree branch at {:#x} is out of bounds", at));
+  }
+  auto [it, inserted] = state.group_ids.try_emplace(child, mGroups.size());
+  const u32 id = it->second;
+  if (inserted) {
+    mGroups.emplace_back();
+    for (u32 c = 0; c < 8; ++c) {
+      const Entry entry =
+          TRY(decodeEntry(state, static_cast<u32>(child), c, shift - 1));
+      mGroups[id][c] = entry;
+    }
+  }
+  return id;
+}
+
+Result<KclQuery> KclQuery::Create(const KCollisionData& data) {
+  KclQuery query(data);
+
+  query.mTris.reserve(data.prism_data.size());
+  query.mFaceNormals.reserve(data.prism_data.size());
+  for (size_t i = 0; i < data.prism_data.size(); ++i) {
+    const auto& prism = data.prism_data[i];
+    if (prism.pos_i >= data.pos_data.size() ||
+        std::max({*prism.fnrm_i, *prism.enrm1_i, *prism.enrm2_i,
+                  *prism.enrm3_i}) >= data.nrm_data.size()) {
+      return std::unexpected(
+          std::format("Prism {} references a missing vertex", i));
+    }
+    query.mTris.push_back(FromPrism(data, prism));
+    query.mFaceNormals.push_back(data.nrm_data[prism.fnrm_i]);
+  }
+
+  const s32 shift = data.block_width_shift;
+  const s32 x_shift = data.area_x_blocks_shift;
+  const s32 xy_shift = data.area_xy_blocks_shift;
+  if (shift < 0 || shift > 30 || x_shift < 0 || xy_shift < x_shift ||
+      xy_shift > 30) {
+    return std::unexpected("Invalid octree header");
+  }
+  auto blocks = [&](u32 mask) {
+    return static_cast<u32>((u64(~mask) + 1) >> shift);
+  };
+  query.mAreaMin = data.area_min_pos;
+  query.mRootCount = {blocks(data.area_x_width_mask),
+                      blocks(data.area_y_width_mask),
+                      blocks(data.area_z_width_mask)};
+  const auto& count = query.mRootCount;
+  if (count.x == 0 || count.y == 0 || count.z == 0 ||
+      count.x > (1u << x_shift) || count.y > (1u << (xy_shift - x_shift)) ||
+      count.z > (1u << (31 - xy_shift))) {
+    return std::unexpected("Invalid octree header");
+  }
+
+  DecodeState state{.blocks = data.block_data};
+  query.mRoots.resize(query.rootIndex(count.x - 1, count.y - 1, count.z - 1) +
+                      1);
+  for (u32 z = 0; z < count.z; ++z) {
+    for (u32 y = 0; y < count.y; ++y) {
+      for (u32 x = 0; x < count.x; ++x) {
+        const u32 i = query.rootIndex(x, y, z);
+        query.mRoots[i] = TRY(query.decodeEntry(state, 0, i, shift));
+      }
+    }
+  }
+  return query;
+}
+
+std::span<const u16> KclQuery::prismsAt(const glm::vec3& point) const {
+  const glm::vec3 rel = point - mAreaMin;
+  const s32 root_shift = mData->block_width_shift;
+  const glm::vec3 size = glm::vec3(mRootCount) * std::ldexp(1.0f, root_shift);
+  if (!(glm::all(glm::greaterThanEqual(rel, glm::vec3(0.0f))) &&
+        glm::all(glm::lessThan(rel, size)))) {
+    return {};
+  }
+  const u32 x = static_cast<u32>(rel.x);
+  const u32 y = static_cast<u32>(rel.y);
+  const u32 z = static_cast<u32>(rel.z);
+  s32 shift = root_shift;
+  Entry entry = mRoots[rootIndex(x >> shift, y >> shift, z >> shift)];
+  while (!(entry & LeafBit)) {
+    --shift;
+    entry = mGroups[entry][((z >> shift) & 1) << 2 | ((y >> shift) & 1) << 1 |
+                           ((x >> shift) & 1)];
+  }
+  const auto [begin, end] = mLists[entry & ~LeafBit];
+  return std::span(mListData).subspan(begin, end - begin);
+}
+
+void KclQuery::raycastLeaf(Entry entry, const KclRay& ray, KclFilter filter,
+                           std::optional<KclRayHit>& best) const {
+  const auto [begin, end] = mLists[entry & ~LeafBit];
+  for (u32 i = begin; i < end; ++i) {
+    const u16 prism = mListData[i];
+    const u16 attribute = mData->prism_data[prism].attribute;
+    if (!filter.accepts(attribute)) {
+      continue;
+    }
+    const auto t = IntersectTriangle(ray, mTris[prism]);
+    if (!t || *t < 0.0f || *t > (best ? best->t : ray.max_t)) {
+      continue;
+    }
+    best = KclRayHit{
+        .prism = prism,
+        .t = *t,
+        .position = ray.origin + ray.dir * *t,
+        .normal = mFaceNormals[prism],
+        .attribute = attribute,
+    };
+  }
+}
+
+void KclQuery::raycastNode(Entry entry, const glm::vec3& origin, s32 shift,
+                           const KclRay& ray, const glm::vec3& inv_dir,
+                           KclFilter filter,
+                           std::optional<KclRayHit>& best) const {
+  if (entry & LeafBit) {
+    raycastLeaf(entry, ray, filter, best);
+    return;
+  }
+  // Visit children front to back, so farther ones can be skipped once a hit
+  // is closer than where they start.
+  const float half = std::ldexp(1.0f, shift - 1);
+  std::array<std::pair<float, u32>, 8> order;
+  size_t n = 0;
+  for (u32 c = 0; c < 8; ++c) {
+    const glm::vec3 lo = origin + ChildOffset(c) * half;
+    float t0 = 0.0f, t1 = best ? best->t : ray.max_t;
+    if (ClipToBox(ray, inv_dir, lo, lo + half, t0, t1)) {
+      order[n++] = {t0, c};
+    }
+  }
+  std::sort(order.begin(), order.begin() + n);
+  for (size_t i = 0; i < n; ++i) {
+    const auto [t0, c] = order[i];
+    if (best && t0 > best->t) {
+      break;
+    }
+    raycastNode(mGroups[entry][c], origin + ChildOffset(c) * half, shift - 1,
+                ray, inv_dir, filter, best);
+  }
+}
+
+std::optional<KclRayHit> KclQuery::raycast(const KclRay& ray,
+                                           KclFilter filter) const {
+  std::optional<KclRayHit> best;
+  const s32 shift = mData->block_width_shift;
+  const float cell = std::ldexp(1.0f, shift);
+  const glm::vec3 inv_dir = 1.0f / ray.dir;
+
+  float t0 = 0.0f, t1 = ray.max_t;
+  if (!ClipToBox(ray, inv_dir, mAreaMin,
+                 mAreaMin + glm::vec3(mRootCount) * cell, t0, t1)) {
+    return best;
+  }
+
+  // Walk the root grid cell by cell (Amanatides-Woo)
+  const glm::vec3 start = ray.origin + ray.dir * t0 - mAreaMin;
+  glm::ivec3 pos, step;
+  glm::vec3 t_next, t_delta;
+  for (int a = 0; a < 3; ++a) {
+    pos[a] = std::clamp(static_cast<int>(std::floor(start[a] / cell)), 0,
+                        static_cast<int>(mRootCount[a]) - 1);
+    if (ray.dir[a] > 0.0f) {
+      step[a] = 1;
+      t_next[a] = t0 + ((pos[a] + 1) * cell - start[a]) / ray.dir[a];
+      t_delta[a] = cell / ray.dir[a];
+    } else if (ray.dir[a] < 0.0f) {
+      step[a] = -1;
+      t_next[a] = t0 + (pos[a] * cell - start[a]) / ray.dir[a];
+      t_delta[a] = -cell / ray.dir[a];
+    } else {
+      step[a] = 0;
+      t_next[a] = t_delta[a] = std::numeric_limits<float>::infinity();
+    }
+  }
+  for (float t = t0; !best || t <= best->t;) {
+    raycastNode(mRoots[rootIndex(pos.x, pos.y, pos.z)],
+                mAreaMin + glm::vec3(pos) * cell, shift, ray, inv_dir, filter,
+                best);
+    const int a = t_next.x < t_next.y ? (t_next.x < t_next.z ? 0 : 2)
+                                      : (t_next.y < t_next.z ? 1 : 2);
+    if (t_next[a] > t1) {
+      break;
+    }
+    t = t_next[a];
+    pos[a] += step[a];
+    if (pos[a] < 0 || pos[a] >= static_cast<int>(mRootCount[a])) {
+      break;
+    }
+    t_next[a] += t_delta[a];
+  }
+  return best;
+}
+
+std::vector<std::optional<KclRayHit>>
+KclQuery::raycastBatch(std::span<const KclRay> rays, KclFilter filter,
+                       u32 num_threads) const {
+  std::vector<std::optional<KclRayHit>> hits(rays.size());
+  rsl::ParallelFor(rays.size(), num_threads,
+                   [&](size_t i) { hits[i] = raycast(rays[i], filter); });
+  return hits;
+}
+
+void KclQuery::collectBox(Entry entry, const glm::vec3& origin, s32 shift,
+                          const glm::vec3& lo, const glm::vec3& hi,
+                          std::vector<u16>& out) const {
+  if (entry & LeafBit) {
+    const auto [begin, end] = mLists[entry & ~LeafBit];
+    out.insert(out.end(), mListData.begin() + begin, mListData.begin() + end);
+    return;
+  }
+  const float half = std::ldexp(1.0f, shift - 1);
+  for (u32 c = 0; c < 8; ++c) {
+    const glm::vec3 child = origin + ChildOffset(c) * half;
+    if (glm::all(glm::lessThanEqual(child, hi)) &&
+        glm::all(glm::greaterThanEqual(child + half, lo))) {
+      collectBox(mGroups[entry][c], child, shift - 1, lo, hi, out);
+    }
+  }
+}
+
+std::vector<KclSphereHit> KclQuery::checkSphere(const glm::vec3& center,
+                                                float radius,
+                                                KclFilter filter) const {
+  std::vector<KclSphereHit> hits;
+  const s32 shift = mData->block_width_shift;
+  const float cell = std::ldexp(1.0f, shift);
+  const glm::vec3 lo = center - radius;
+  const glm::vec3 hi = center + radius;
+  const glm::vec3 area_max = mAreaMin + glm::vec3(mRootCount) * cell;
+  if (glm::any(glm::greaterThan(lo, area_max)) ||
+      glm::any(glm::lessThan(hi, mAreaMin))) {
+    return hits;
+  }
+
+  const glm::ivec3 max_cell = glm::ivec3(mRootCount) - 1;
+  const glm::ivec3 first =
+      glm::clamp(glm::ivec3(glm::floor((lo - mAreaMin) / cell)),
+                 glm::ivec3(0), max_cell);
+  const glm::ivec3 last =
+      glm::clamp(glm::ivec3(glm::floor((hi - mAreaMin) / cell)),
+                 glm::ivec3(0), max_cell);
+  std::vector<u16> candidates;
+  for (int z = first.z; z <= last.z; ++z) {
+    for (int y = first.y; y <= last.y; ++y) {
+      for (int x = first.x; x <= last.x; ++x) {
+        collectBox(mRoots[rootIndex(x, y, z)],
+                   mAreaMin + glm::vec3(x, y, z) * cell, shift, lo, hi,
+                   candidates);
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+
+  for (u16 prism : candidates) {
+    const u16 attribute = mData->prism_data[prism].attribute;
+    if (!filter.accepts(attribute)) {
+      continue;
+    }
+    const auto& tri = mTris[prism];
+    const glm::vec3& fnrm = mFaceNormals[prism];
+    const float plane = glm::dot(center - tri[0], fnrm);
+    if (plane > radius || plane < -mData->prism_thickness) {
+      continue;
+    }
+    const auto closest = ClosestPointOnTriangle(center, tri);
+    KclSphereHit hit{.prism = prism, .attribute = attribute};
+    if (closest.interior) {
+      hit.depth = radius - plane;
+      hit.normal = fnrm;
+    } else {
+      // Edges and corners only collide from above
+      if (plane < 0.0f) {
+        continue;
+      }
+      const glm::vec3 d = center - closest.point;
+      const float dist = glm::length(d);
+      if (dist > radius) {
+        continue;
+      }
+      hit.depth = radius - dist;
+      hit.normal = dist > 0.0f ? d / dist : fnrm;
+    }
+    hits.push_back(hit);
+  }
+  return hits;
+}
+
+} // namespace librii::kcol
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Model.hpp"
+#include <optional>
+
+namespace librii::kcol {
+
+//! Accepts prisms whose base type (`attribute & 31`) has its bit set, like the
+//! level editor's attribute mask.
+struct KclFilter {
+  u32 type_mask = 0xFFFF'FFFF;
+
+  bool accepts(u16 attribute) const {
+    return (type_mask >> (attribute & 31)) & 1;
+  }
+};
+
+struct KclRay {
+  glm::vec3 origin{0.0f};
+  //! Need not be normalized; hit distances are in units of `dir`.
+  glm::vec3 dir{0.0f, -1.0f, 0.0f};
+  float max_t = 1.0e30f;
+};
+
+struct KclRayHit {
+  u32 prism = 0; //!< Index into `prism_data`
+  float t = 0.0f;
+  glm::vec3 position{0.0f};
+  glm::vec3 normal{0.0f}; //!< Face normal
+  u16 attribute = 0;
+};
+
+struct KclSphereHit {
+  u32 prism = 0; //!< Index into `prism_data`
+  //! How far the sphere must move along `normal` to stop touching the prism.
+  float depth = 0.0f;
+  glm::vec3 normal{0.0f};
+  u16 attribute = 0;
+};
+
+//! Spatial queries over the octree in `KCollisionData::block_data`.
+//!
+//! Lookups follow the game's own block search, so results also reflect how the
+//! octree was built (e.g. a prism missing from a leaf is missed here too).
+class KclQuery {
+public:
+  //! Decodes and validates the octree. `data` must outlive the query.
+  static Result<KclQuery> Create(const KCollisionData& data);
+
+  //! Prisms (0-based) listed in the leaf containing `point`. Empty outside the
+  //! indexed area.
+  std::span<const u16> prismsAt(const glm::vec3& point) const;
+
+  //! Nearest prism face hit by `ray` (either side).
+  std::optional<KclRayHit> raycast(const KclRay& ray,
+                                   KclFilter filter = {}) const;
+  //! Independent rays, spread over `num_threads` shared pool threads (0 = all).
+  std::vector<std::optional<KclRayHit>>
+  raycastBatch(std::span<const KclRay> rays, KclFilter filter = {},
+               u32 num_threads = 0) const;
+
+  //! First surface straight below `point`, e.g. to check that a respawn point
+  //! lies above road.
+  std::optional<KclRayHit> groundBelow(const glm::vec3& point,
+                                       float max_distance = 1.0e30f,
+                                       KclFilter filter = {}) const {
+    return raycast({.origin = point, .dir = {0.0f, -1.0f, 0.0f},
+                    .max_t = max_distance},
+                   filter);
+  }
+
+  //! Every prism a sphere touches: above the face (or within
+  //! `prism_thickness` below it) and within `radius` of the triangle.
+  std::vector<KclSphereHit> checkSphere(const glm::vec3& center, float radius,
+                                        KclFilter filter = {}) const;
+
+private:
+  //! Bit 31 set: leaf, low bits index `mLists`. Otherwise indexes `mGroups`.
+  using Entry = u32;
+  static constexpr Entry LeafBit = 0x8000'0000;
+
+  struct DecodeState;
+
+  KclQuery(const KCollisionData& data) : mData(&data) {}
+
+  u32 rootIndex(u32 x, u32 y, u32 z) const;
+  Result<Entry> decodeEntry(DecodeState& state, u32 base, u32 index,
+                            s32 shift);
+
+  void raycastNode(Entry entry, const glm::vec3& origin, s32 shift,
+                   const KclRay& ray, const glm::vec3& inv_dir,
+                   KclFilter filter, std::optional<KclRayHit>& best) const;
+  void raycastLeaf(Entry entry, const KclRay& ray, KclFilter filter,
+                   std::optional<KclRayHit>& best) const;
+  void collectBox(Entry entry, const glm::vec3& origin, s32 shift,
+                  const glm::vec3& lo, const glm::vec3& hi,
+                  std::vector<u16>& out) const;
+
+  const KCollisionData* mData;
+  std::vector<std::array<glm::vec3, 3>> mTris;
+  std::vector<glm::vec3> mFaceNormals;
+
+  glm::vec3 mAreaMin{0.0f};
+  glm::uvec3 mRootCount{0};
+  std::vector<Entry> mRoots; //!< Indexed like the game: (z, y, x)
+  std::vector<std::array<Entry, 8>> mGroups;
+  std::vector<std::pair<u32, u32>> mLists; //!< [begin, end) of `mListData`
+  std::vector<u16> mListData;              //!< 0-based prism indices
+};
+
+} // namespace librii::kcol
@@ -5,17 +5,6 @@
 
 #include <librii/image/CheckerBoard.hpp>
 
-// TRAITS FOR WIITRIG
-librii::math::SRT3 getSrt(const libcube::IBoneDelegate& bone) {
-  return bone.getSRT();
-}
-s32 parentOf(const libcube::IBoneDelegate& bone) {
-  return bone.getBoneParent();
-}
-bool ssc(const libcube::IBoneDelegate& bone) { return bone.getSSC(); }
-
-#include <librii/trig/WiiTrig.hpp>
-
 namespace librii::g3d::gfx {
 
 using namespace riistudio;
@@ -24,12 +13,6 @@ using namespace riistudio;
 // Render Data
 //
 
-struct Node {
-  ModelView& model;
-  const lib3d::Bone& bone;
-  const libcube::IGCMaterial& mat;
-  const libcube::IndexedPolygon& poly;
-};
 template <typename T>
 librii::gfx::SceneNode::UniformData pushUniform(u32 binding_point,
                                                 const T& data) {
@@ -47,243 +30,226 @@ struct MyDefTex : public librii::image::NullTexture<64, 64> {
 };
 static MyDefTex DefaultTex(NullCheckerboard);
 
-Result<std::vector<glm::mat4>> getPosMtx(const libcube::IndexedPolygon& p,
-                                         ModelView& model, u64 mpid) {
-  std::vector<glm::mat4> out;
-
-  const auto& mp = p.getMeshData().mMatrixPrimitives[mpid];
+//
+// Retained draw list
+//
 
-  struct Bones_ {
-    size_t size() const { return m.bones.size(); }
-    libcube::IBoneDelegate& operator[](size_t i) {
-      return const_cast<libcube::IBoneDelegate&>(*m.bones[i]);
+static u64 hashName(const std::string& name) {
+  return std::hash<std::string>{}(name);
+}
+static u64 addressOf(const void* p) { return reinterpret_cast<uintptr_t>(p); }
+
+//! Everything the shape of the draw list depends on: which draws exist, which
+//! material and mesh each uses and where its vertices are.
+static void buildStructureSignature(std::vector<u64>& sig,
+                                    const libcube::Scene& scene,
+                                    lib3d::RenderType type,
+                                    std::span<std::string> hide_mat) {
+  sig.clear();
+  sig.push_back(static_cast<u64>(type));
+  sig.push_back(hide_mat.size());
+  for (auto& name : hide_mat) {
+    sig.push_back(hashName(name));
+  }
+  for (auto& model : scene.getModels()) {
+    sig.push_back(addressOf(&model));
+    for (auto& bone : model.getBones()) {
+      sig.push_back(addressOf(&bone));
+      sig.push_back(bone.getBoneParent());
+      sig.push_back(bone.getNumDisplays());
+      for (u64 i = 0; i < bone.getNumDisplays(); ++i) {
+        const auto display = bone.getDisplay(i);
+        sig.push_back((u64(display.matId) << 32) | display.polyId);
+      }
+      sig.push_back(bone.getNumChildren());
+      for (u64 i = 0; i < bone.getNumChildren(); ++i) {
+        sig.push_back(bone.getChild(i));
+      }
     }
-    ModelView& m;
-  };
-  Bones_ bones{model};
-
-  const auto handle_drw = [&](const libcube::DrawMatrix& drw) -> Result<void> {
-    glm::mat4x4 curMtx(0.0f);
-
-    // Rigid -- bone space
-    if (drw.mWeights.size() == 1) {
-      u32 boneID = drw.mWeights[0].boneId;
-      EXPECT(boneID < model.bones.size());
-      curMtx = calcSrtMtx(*model.bones[boneID], bones,
-                          librii::g3d::ScalingRule::Maya);
-    } else {
-      // already world space
-      curMtx = glm::mat4x4(1.0f);
+    for (auto& poly : model.getMeshes()) {
+      sig.push_back(addressOf(&poly));
+      sig.push_back(hashName(poly.getName()));
+      sig.push_back(static_cast<u32>(poly.getGenerationId()));
+      sig.push_back(poly.isVisible());
+      sig.push_back(poly.getMeshData().mMatrixPrimitives.size());
     }
-    out.push_back(curMtx);
-    return {};
-  };
-
-  if (mp.mDrawMatrixIndices.empty()) {
-    // TODO: For G3D this isn't configurable per-mp
-    if (model.drawMatrices.size() > mp.mCurrentMatrix) {
-      TRY(handle_drw(model.drawMatrices[mp.mCurrentMatrix]));
-    } else {
-      // todo: is there really no rigging info here..?
-      libcube::DrawMatrix tmp;
-      tmp.mWeights.emplace_back(0, 1.0f);
-      TRY(handle_drw(tmp));
-    }
-  } else {
-    for (const auto it : mp.mDrawMatrixIndices) {
-      EXPECT(it < model.drawMatrices.size());
-      TRY(handle_drw(model.drawMatrices[it]));
+    for (auto& mat : model.getMaterials()) {
+      sig.push_back(addressOf(&mat));
+      sig.push_back(hashName(mat.getName()));
     }
   }
-  return out;
+  for (auto& tex : scene.getTextures()) {
+    sig.push_back(addressOf(&tex));
+  }
 }
 
-Result<void> MakeSceneNode(SceneNode& out, lib3d::IndexRange tenant,
-                           librii::glhelper::VBOBuilder& v,
-                           G3dTextureCache& tex_id_map, Node node,
-                           G3dSceneRenderData& render_data,
-                           librii::glhelper::ShaderProgram& prog, u32 mp_id,
-                           glm::mat4 model_matrix, glm::mat4 view_matrix,
-                           glm::mat4 proj_matrix, std::string& err) {
-  out.matName = node.mat.getName();
-  out.vao_id = v.getGlId();
-  out.bound = {};
-  // lib3d::CalcPolyBound(node.poly, node.bone, node.model);
-
-  //
-  out.mega_state = TRY(node.mat.setMegaState());
-  out.shader_id = prog.getId();
-
-  // draw
-  out.primitive_type = librii::gfx::PrimitiveType::Triangles;
-  out.vertex_count = tenant.size;
-  out.vertex_data_type = librii::gfx::DataType::U32;
-  out.indices = reinterpret_cast<void*>(tenant.start * sizeof(u32));
-
-  const libcube::GCMaterialData& gc_mat = node.mat.getMaterialData();
-  for (int i = 0; i < gc_mat.samplers.size(); ++i) {
-    const auto& sampler = gc_mat.samplers[i];
-
-    librii::gfx::TextureObj obj;
-
-    if (sampler.mTexture.empty()) {
-      // No textures specified
-      continue;
+//! Everything the position matrices of a model depend on, besides its bones.
+static void buildSkinSignature(std::vector<u32>& sig,
+                               const libcube::Model& model) {
+  sig.clear();
+  for (auto& drw : model.mDrawMatrices) {
+    sig.push_back(drw.mWeights.size());
+    for (auto& w : drw.mWeights) {
+      sig.push_back(w.boneId);
+      sig.push_back(std::bit_cast<u32>(w.weight));
     }
-
-    {
-      const auto found = tex_id_map.getCachedTexture(sampler.mTexture);
-      if (!found) {
-        err = std::format("Cannot find texture \"{}\"", sampler.mTexture);
-        if (!tex_id_map.isCached(DefaultTex, 0)) {
-          tex_id_map.cache(DefaultTex, 0);
-        }
-        obj.active_id = i;
-        obj.image_id = TRY(tex_id_map.getCachedTexture(DefaultTex, 0));
-      } else {
-        obj.active_id = i;
-        obj.image_id = *found;
+  }
+  for (auto& poly : model.getMeshes()) {
+    for (auto& mp : poly.getMeshData().mMatrixPrimitives) {
+      sig.push_back(static_cast<u16>(mp.mCurrentMatrix));
+      sig.push_back(mp.mDrawMatrixIndices.size());
+      for (auto it : mp.mDrawMatrixIndices) {
+        sig.push_back(static_cast<u16>(it));
       }
     }
-
-    obj.glMinFilter = librii::gl::gxFilterToGl(sampler.mMinFilter);
-    obj.glMagFilter = librii::gl::gxFilterToGl(sampler.mMagFilter);
-    obj.glWrapU = librii::gl::gxTileToGl(sampler.mWrapU);
-    obj.glWrapV = librii::gl::gxTileToGl(sampler.mWrapV);
-
-    out.texture_objects.push_back(obj);
   }
+}
 
-  {
-
-    for (u32 i = 0; i < 3; ++i) {
-      std::pair<u32, u32> id{out.shader_id, i};
-      if (!render_data.query_mins.contains(id)) {
-        int query_min;
-        glGetActiveUniformBlockiv(out.shader_id, i, GL_UNIFORM_BLOCK_DATA_SIZE,
-                                  &query_min);
-        render_data.query_mins[id] = static_cast<u32>(query_min);
-      }
-      out.uniform_mins.push_back({
-          .binding_point = i,
-          .min_size = render_data.query_mins[id],
-      });
+Result<void> G3dDrawList::sync(const libcube::Scene& scene,
+                               DrawResolver& resolver, lib3d::RenderType type,
+                               std::span<std::string> hide_mat) {
+  bool rebuilt = false;
+  buildStructureSignature(mScratch, scene, type, hide_mat);
+  if (mScratch != mStructure) {
+    auto ok = rebuild(scene, resolver, type, hide_mat);
+    if (!ok) {
+      // Try again next frame
+      mStructure.clear();
+      models.clear();
+      draws.clear();
+      errors = ok.error();
+      return std::unexpected(ok.error());
     }
+    std::swap(mStructure, mScratch);
+    // mTextureByName may point into the old scene
+    mTextures.clear();
+    mTextureByName.clear();
+    rebuilt = true;
+    ++num_rebuilds;
   }
 
-  {
-    librii::gl::UniformSceneParams scene;
-
-    scene.projection = proj_matrix * view_matrix * model_matrix;
-    scene.Misc0 = {};
-
-    out.uniform_data.emplace_back(pushUniform(0, scene));
+  // GL ids change when textures are reuploaded, so every material is redone.
+  mScratch.clear();
+  for (auto& tex : scene.getTextures()) {
+    mScratch.push_back(hashName(tex.getName()));
+    mScratch.push_back(static_cast<u64>(tex.getGenerationId()));
   }
-
-  {
-    const auto& data = node.mat.getMaterialData();
-
-    librii::gl::UniformMaterialParams tmp{};
-    librii::gl::setUniformsFromMaterial(tmp, data);
-
-    for (int i = 0; i < data.texMatrices.size(); ++i) {
-      tmp.TexMtx[i] = glm::transpose(TRY(data.texMatrices[i].compute(
-          model_matrix, proj_matrix * view_matrix)));
+  const bool textures_changed = mScratch != mTextures;
+  if (textures_changed) {
+    std::swap(mTextures, mScratch);
+    mTextureByName.clear();
+    for (auto& tex : scene.getTextures()) {
+      mTextureByName.emplace(tex.getName(), &tex);
     }
-    for (int i = 0; i < data.samplers.size(); ++i) {
-      if (data.samplers[i].mTexture.empty())
-        continue;
-      auto tex = data.samplers[i].mTexture;
-      const libcube::Texture* texData = nullptr;
-      for (auto* x : node.model.textures) {
-        if (x->getName() == tex) {
-          texData = x;
-          break;
-        }
-      }
-      if (texData == nullptr)
-        continue;
-      tmp.TexParams[i] = glm::vec4{texData->getWidth(), texData->getHeight(), 0,
-                                   data.samplers[i].mLodBias};
-    }
-
-    out.uniform_data.push_back(pushUniform(1, tmp));
   }
 
-  {
-    // builder.reset(2);
-    librii::gl::PacketParams pack{};
-    for (auto& p : pack.posMtx)
-      p = glm::transpose(glm::mat4{1.0f});
-
-    const auto mtx = TRY(getPosMtx(node.poly, node.model, mp_id));
-    for (int p = 0; p < std::min<std::size_t>(10, mtx.size()); ++p) {
-      pack.posMtx[p] = glm::transpose(mtx[p]);
+  bool any_dirty = rebuilt;
+  for (auto& model : models) {
+    const auto& mats = model.view.mats;
+    model.mat_dirty.assign(mats.size(), rebuilt || textures_changed);
+    for (size_t i = 0; i < mats.size(); ++i) {
+      const auto& data = mats[i]->getMaterialData();
+      const bool changed =
+          model.mat_generation[i] != mats[i]->getGenerationId() ||
+          model.mat_state[i] != data;
+      if (changed || model.mat_dirty[i]) {
+        model.mat_generation[i] = mats[i]->getGenerationId();
+        model.mat_state[i] = data;
+        model.mat_dirty[i] = true;
+        any_dirty = true;
+      }
     }
 
-    out.uniform_data.push_back(pushUniform(2, pack));
+    mJointScratch.clear();
+    for (auto* bone : model.view.bones) {
+      mJointScratch.push_back({
+          .srt = bone->getSRT(),
+          .ssc = bone->getSSC(),
+          .parent = static_cast<s32>(bone->getBoneParent()),
+      });
+    }
+    // Only bones that moved, and their descendants, are recomputed.
+    const u32 moved = model.bone_mtx.updateJoints(
+        mJointScratch, librii::g3d::ScalingRule::Maya);
+    buildSkinSignature(mSkinScratch, *model.source);
+    const bool skin_changed = mSkinScratch != model.skin_state;
+    if (skin_changed) {
+      std::swap(model.skin_state, mSkinScratch);
+    }
+    model.bones_dirty = rebuilt || moved > 0 || skin_changed;
+    if (model.bones_dirty) {
+      ++num_bone_updates;
+      any_dirty = true;
+    }
+  }
+  if (!any_dirty) {
+    return {};
   }
 
-  {
-    G3dSceneRenderData::ShaderKey key{
-        .glId = out.shader_id,
-        .matGenId = node.mat.getGenerationId(),
-    };
-    if (!render_data.hasUploaded.contains(key.packed())) {
-      // WebGL doesn't support binding=n in the shader
-#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
-      glUniformBlockBinding(
-          out.shader_id,
-          glGetUniformBlockIndex(out.shader_id, "ub_SceneParams"), 0);
-      glUniformBlockBinding(
-          out.shader_id,
-          glGetUniformBlockIndex(out.shader_id, "ub_MaterialParams"), 1);
-      glUniformBlockBinding(
-          out.shader_id,
-          glGetUniformBlockIndex(out.shader_id, "ub_PacketParams"), 2);
-#endif // __EMSCRIPTEN__
-      const s32 samplerIds[] = {0, 1, 2, 3, 4, 5, 6, 7};
-      glUseProgram(out.shader_id);
-      u32 uTexLoc = glGetUniformLocation(out.shader_id, "u_Texture");
-      glUniform1iv(uTexLoc, 8, samplerIds);
-      render_data.hasUploaded.insert(key.packed());
+  for (auto& draw : draws) {
+    auto& model = models[draw.model];
+    if (model.mat_dirty[draw.mat]) {
+      updateMaterial(draw, resolver, type);
+      ++num_material_updates;
+    }
+    if (model.bones_dirty) {
+      auto ok = updatePacket(draw);
+      draw.packet_error = ok ? "" : ok.error();
     }
   }
-
+  collectErrors();
   return {};
 }
 
-void pushDisplay(lib3d::IndexRange tenant,
-                 librii::glhelper::VBOBuilder& vbo_builder, Node node,
-                 librii::gfx::SceneBuffers& output, u32 mp_id,
-                 G3dTextureCache& tex_id_map, G3dSceneRenderData& render_data,
-                 librii::glhelper::ShaderProgram& shader, glm::mat4 m_mtx,
-                 glm::mat4 v_mtx, glm::mat4 p_mtx, std::string& err) {
-
-  librii::gfx::SceneNode mnode;
-  auto err_ =
-      MakeSceneNode(mnode, tenant, vbo_builder, tex_id_map, node, render_data,
-                    shader, mp_id, m_mtx, v_mtx, p_mtx, err);
-  if (!err_.has_value()) {
-    err = err + "\n" + err_.error();
-    return;
+void G3dDrawList::collectErrors() {
+  errors.clear();
+  for (auto& draw : draws) {
+    for (auto* err : {&draw.mat_error, &draw.packet_error}) {
+      if (err->size()) {
+        errors += "\n";
+        errors += *err;
+      }
+    }
   }
+}
 
-  auto& nodebuf = node.mat.isXluPass() ? output.translucent : output.opaque;
+Result<void> G3dDrawList::rebuild(const libcube::Scene& scene,
+                                  DrawResolver& resolver,
+                                  lib3d::RenderType type,
+                                  std::span<std::string> hide_mat) {
+  models.clear();
+  draws.clear();
+  errors.clear();
 
-  nodebuf.nodes.push_back(std::move(mnode));
+  for (auto& model : scene.getModels()) {
+    auto& retained = models.emplace_back(model, scene);
+    retained.view.model_id = static_cast<int>(models.size() - 1);
+    const auto num_mats = retained.view.mats.size();
+    retained.mat_generation.resize(num_mats);
+    retained.mat_state.resize(num_mats);
+  }
+  for (u32 i = 0; i < models.size(); ++i) {
+    const auto& view = models[i].view;
+    if (view.mats.empty() || view.polys.empty() || view.bones.empty())
+      continue;
+    // Assumes root at zero
+    TRY(gatherBone(i, 0, resolver, hide_mat, 0));
+  }
+  return {};
 }
 
-Result<void> gatherBoneRecursive(librii::gfx::SceneBuffers& output, u64 boneId,
-                                 ModelView& view, glm::mat4 m_mtx,
-                                 glm::mat4 v_mtx, glm::mat4 p_mtx,
-                                 G3dSceneRenderData& render_data,
-                                 std::string& err, lib3d::RenderType type,
-                                 std::span<std::string> hide_mat) {
-  if (boneId >= view.bones.size()) {
+Result<void> G3dDrawList::gatherBone(u32 model_index, u64 bone_id,
+                                     DrawResolver& resolver,
+                                     std::span<std::string> hide_mat,
+                                     u32 depth) {
+  const auto& view = models[model_index].view;
+  if (bone_id >= view.bones.size()) {
     return std::unexpected("Invalid bone id");
   }
-  const auto& pBone = *view.bones[boneId];
+  if (depth > view.bones.size()) {
+    return std::unexpected("Bone hierarchy contains a cycle");
+  }
+  const auto& pBone = *view.bones[bone_id];
   const u64 nDisplay = pBone.getNumDisplays();
 
   for (u64 i = 0; i < nDisplay; ++i) {
@@ -297,91 +263,288 @@ Result<void> gatherBoneRecursive(librii::gfx::SceneBuffers& output, u64 boneId,
     const auto& mat = *view.mats[display.matId];
     const auto& poly = *view.polys[display.polyId];
 
-    bool isMatHidden = false;
-    for (auto& e : hide_mat) {
-      if (e == mat.getName()) {
-        isMatHidden = true;
-        break;
-      }
+    if (std::ranges::find(hide_mat, mat.getName()) != hide_mat.end()) {
+      continue;
     }
-    if (isMatHidden) {
+    if (!poly.isVisible()) {
       continue;
     }
 
-    // REASON FOR REMOVAL: We will already create the shader if we cache miss
-    //
-    // if (!render_data.mMaterialData.isShaderCached(mat)) {
-    //   render_data.mMaterialData.cacheShader(mat);
-    // }
-
-    for (u32 i = 0; i < poly.getMeshData().mMatrixPrimitives.size(); ++i) {
-      if (!poly.isVisible())
-        continue;
-
+    for (u32 j = 0; j < poly.getMeshData().mMatrixPrimitives.size(); ++j) {
       DrawCallPath mesh_name{.model_name = std::to_string(view.model_id),
                              .mesh_name = poly.getName(),
-                             .mprim_index = i};
-      Node node{
-          .model = view,
-          .bone = pBone,
-          .mat = mat,
-          .poly = poly,
-      };
-      auto shader = render_data.mMaterialData.getCachedShader(mat, type);
-      if (!shader) {
-        err += std::format("\nInvalid shader for material {}: {}",
-                           mat.getName(), shader.error());
-        continue;
-      }
-      assert(*shader && "getCachedShader() should never return nullptr");
-      std::string _err;
-      pushDisplay(
-          TRY(render_data.mVertexRenderData.getDrawCallVertices(mesh_name)),
-          render_data.mVertexRenderData.mVboBuilder, node, output, i,
-          render_data.mTextureData, render_data, **shader, m_mtx, v_mtx, p_mtx,
-          _err);
-      if (_err.size()) {
-        err = err + "\n" + _err;
-      }
+                             .mprim_index = j};
+      const auto tenant = TRY(resolver.vertices(mesh_name));
+
+      auto& draw = draws.emplace_back();
+      draw.model = model_index;
+      draw.mat = display.matId;
+      draw.poly = &poly;
+      draw.mp_id = j;
+
+      auto& out = draw.node;
+      out.vao_id = resolver.vao();
+      out.bound = {};
+      out.primitive_type = librii::gfx::PrimitiveType::Triangles;
+      out.vertex_count = tenant.size;
+      out.vertex_data_type = librii::gfx::DataType::U32;
+      out.indices = reinterpret_cast<void*>(tenant.start * sizeof(u32));
+      out.uniform_data.push_back(
+          pushUniform(0, librii::gl::UniformSceneParams{}));
+      out.uniform_data.push_back(
+          pushUniform(1, librii::gl::UniformMaterialParams{}));
+      out.uniform_data.push_back(pushUniform(2, librii::gl::PacketParams{}));
     }
   }
 
   for (u64 i = 0; i < pBone.getNumChildren(); ++i) {
-    std::string _err;
-    auto err =
-        gatherBoneRecursive(output, pBone.getChild(i), view, m_mtx, v_mtx,
-                            p_mtx, render_data, _err, type, hide_mat);
-    auto err2 = err.has_value() ? "" : err.error();
-    if (_err.size()) {
-      err2 = err2 + "\n" + _err;
+    TRY(gatherBone(model_index, pBone.getChild(i), resolver, hide_mat,
+                   depth + 1));
+  }
+
+  return {};
+}
+
+template <typename T>
+static void writeUniform(SceneNode::UniformData& dst, const T& data,
+                         size_t offset = 0) {
+  assert(offset + sizeof(data) <= dst.raw_data.size());
+  memcpy(dst.raw_data.data() + offset, &data, sizeof(data));
+}
+
+void G3dDrawList::updateMaterial(RetainedDraw& draw, DrawResolver& resolver,
+                                 lib3d::RenderType type) {
+  const auto& model = models[draw.model];
+  const auto& mat = *model.view.mats[draw.mat];
+  const libcube::GCMaterialData& data = model.mat_state[draw.mat];
+  auto& out = draw.node;
+
+  draw.has_shader = false;
+  draw.mat_error.clear();
+  draw.xlu = data.xlu;
+  out.matName = data.name;
+  out.texture_objects.resize(0);
+  out.uniform_mins.clear();
+
+  auto shader = resolver.shader(mat, type);
+  if (!shader) {
+    draw.mat_error = std::format("Invalid shader for material {}: {}",
+                                 data.name, shader.error());
+    return;
+  }
+  auto mega_state = mat.setMegaState();
+  if (!mega_state) {
+    draw.mat_error = mega_state.error();
+    return;
+  }
+  out.shader_id = *shader;
+  out.mega_state = *mega_state;
+
+  for (int i = 0; i < data.samplers.size(); ++i) {
+    const auto& sampler = data.samplers[i];
+
+    librii::gfx::TextureObj obj;
+
+    if (sampler.mTexture.empty()) {
+      // No textures specified
+      continue;
     }
-    if (err2.size()) {
-      return std::unexpected(err2);
+
+    obj.active_id = i;
+    if (auto found = resolver.texture(sampler.mTexture)) {
+      obj.image_id = *found;
+    } else {
+      draw.mat_error = std::format("Cannot find texture \"{}\"",
+                                   sampler.mTexture);
+      auto def = resolver.defaultTexture();
+      if (!def) {
+        draw.mat_error = def.error();
+        return;
+      }
+      obj.image_id = *def;
     }
+
+    obj.glMinFilter = librii::gl::gxFilterToGl(sampler.mMinFilter);
+    obj.glMagFilter = librii::gl::gxFilterToGl(sampler.mMagFilter);
+    obj.glWrapU = librii::gl::gxTileToGl(sampler.mWrapU);
+    obj.glWrapV = librii::gl::gxTileToGl(sampler.mWrapV);
+
+    out.texture_objects.push_back(obj);
   }
 
-  return {};
+  for (u32 i = 0; i < 3; ++i) {
+    out.uniform_mins.push_back({
+        .binding_point = i,
+        .min_size = resolver.uniformMin(out.shader_id, i),
+    });
+  }
+
+  librii::gl::UniformMaterialParams tmp{};
+  librii::gl::setUniformsFromMaterial(tmp, data);
+  for (int i = 0; i < data.samplers.size(); ++i) {
+    if (data.samplers[i].mTexture.empty())
+      continue;
+    auto it = mTextureByName.find(data.samplers[i].mTexture);
+    if (it == mTextureByName.end())
+      continue;
+    const libcube::Texture* texData = it->second;
+    tmp.TexParams[i] = glm::vec4{texData->getWidth(), texData->getHeight(), 0,
+                                 data.samplers[i].mLodBias};
+  }
+  // Texture matrices are filled in by emit()
+  writeUniform(out.uniform_data[1], tmp);
+
+  draw.has_shader = true;
 }
 
-std::string gather(librii::gfx::SceneBuffers& output, ModelView& view,
-                   glm::mat4 m_mtx, glm::mat4 v_mtx, glm::mat4 p_mtx,
-                   G3dSceneRenderData& render_data,
-                   lib3d::RenderType type = lib3d::RenderType::Preview,
-                   std::span<std::string> hide_mat = {}) {
-  if (view.mats.empty() || view.polys.empty() || view.bones.empty())
+Result<void> G3dDrawList::updatePacket(RetainedDraw& draw) {
+  const auto& model = models[draw.model];
+  const auto& drawMatrices = model.source->mDrawMatrices;
+  const auto& mp = draw.poly->getMeshData().mMatrixPrimitives[draw.mp_id];
+
+  librii::gl::PacketParams pack{};
+  for (auto& p : pack.posMtx)
+    p = glm::transpose(glm::mat4{1.0f});
+
+  u32 count = 0;
+  const auto handle_drw = [&](const libcube::DrawMatrix& drw) -> Result<void> {
+    glm::mat4x4 curMtx(1.0f);
+    // Rigid -- bone space. Otherwise, already world space.
+    if (drw.mWeights.size() == 1) {
+      u32 boneID = drw.mWeights[0].boneId;
+      const auto bone_mtx = model.bone_mtx.matrices();
+      EXPECT(boneID < bone_mtx.size());
+      curMtx = bone_mtx[boneID];
+    }
+    if (count < std::size(pack.posMtx)) {
+      pack.posMtx[count] = glm::transpose(curMtx);
+    }
+    ++count;
     return {};
+  };
 
-  // Assumes root at zero
-  std::string _err;
-  auto err = gatherBoneRecursive(output, 0, view, m_mtx, v_mtx, p_mtx,
-                                 render_data, _err, type, hide_mat);
-  auto err2 = err.has_value() ? "" : err.error();
-  if (_err.size()) {
-    err2 = err2 + "\n" + _err;
+  if (mp.mDrawMatrixIndices.empty()) {
+    // TODO: For G3D this isn't configurable per-mp
+    if (mp.mCurrentMatrix >= 0 && drawMatrices.size() > mp.mCurrentMatrix) {
+      TRY(handle_drw(drawMatrices[mp.mCurrentMatrix]));
+    } else {
+      // todo: is there really no rigging info here..?
+      libcube::DrawMatrix tmp;
+      tmp.mWeights.emplace_back(0, 1.0f);
+      TRY(handle_drw(tmp));
+    }
+  } else {
+    for (const auto it : mp.mDrawMatrixIndices) {
+      EXPECT(it >= 0 && it < drawMatrices.size());
+      TRY(handle_drw(drawMatrices[it]));
+    }
+  }
+
+  writeUniform(draw.node.uniform_data[2], pack);
+  return {};
+}
+
+Result<void> G3dDrawList::emit(librii::gfx::SceneBuffers& output,
+                               glm::mat4 m_mtx, glm::mat4 v_mtx,
+                               glm::mat4 p_mtx) const {
+  const librii::gl::UniformSceneParams scene{
+      .projection = p_mtx * v_mtx * m_mtx,
+      .Misc0 = {},
+  };
+  const glm::mat4 vp_mtx = p_mtx * v_mtx;
+  std::string err;
+
+  for (auto& draw : draws) {
+    if (!draw.has_shader || draw.packet_error.size()) {
+      continue;
+    }
+    auto& nodebuf = draw.xlu ? output.translucent : output.opaque;
+    auto& out = nodebuf.nodes.emplace_back(draw.node);
+    writeUniform(out.uniform_data[0], scene);
+
+    const auto& texMatrices =
+        models[draw.model].mat_state[draw.mat].texMatrices;
+    for (size_t i = 0; i < texMatrices.size(); ++i) {
+      auto mtx = texMatrices[i].compute(m_mtx, vp_mtx);
+      if (!mtx) {
+        err += "\n" + mtx.error();
+        nodebuf.nodes.pop_back();
+        break;
+      }
+      const glm::mat3x4 tex_mtx = glm::transpose(*mtx);
+      writeUniform(out.uniform_data[1], tex_mtx,
+                   offsetof(librii::gl::UniformMaterialParams, TexMtx) +
+                       i * sizeof(tex_mtx));
+    }
+  }
+  if (err.size()) {
+    return std::unexpected(err);
   }
-  return err2;
+  return {};
 }
 
+//! Resolves draws against the GL objects of a G3dSceneRenderData.
+struct GlDrawResolver final : public DrawResolver {
+  GlDrawResolver(G3dSceneRenderData& render_data) : mData(render_data) {}
+
+  Result<lib3d::IndexRange> vertices(const DrawCallPath& path) override {
+    return mData.mVertexRenderData.getDrawCallVertices(path);
+  }
+  u32 vao() override { return mData.mVertexRenderData.mVboBuilder.getGlId(); }
+  Result<u32> shader(const libcube::IGCMaterial& mat,
+                     lib3d::RenderType type) override {
+    auto* prog = TRY(mData.mMaterialData.getCachedShader(mat, type));
+    assert(prog && "getCachedShader() should never return nullptr");
+    const u32 shader_id = prog->getId();
+
+    G3dSceneRenderData::ShaderKey key{
+        .glId = shader_id,
+        .matGenId = mat.getGenerationId(),
+    };
+    if (!mData.hasUploaded.contains(key.packed())) {
+      // WebGL doesn't support binding=n in the shader
+#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
+      glUniformBlockBinding(
+          shader_id, glGetUniformBlockIndex(shader_id, "ub_SceneParams"), 0);
+      glUniformBlockBinding(
+          shader_id, glGetUniformBlockIndex(shader_id, "ub_MaterialParams"),
+          1);
+      glUniformBlockBinding(
+          shader_id, glGetUniformBlockIndex(shader_id, "ub_PacketParams"), 2);
+#endif // __EMSCRIPTEN__
+      const s32 samplerIds[] = {0, 1, 2, 3, 4, 5, 6, 7};
+      glUseProgram(shader_id);
+      u32 uTexLoc = glGetUniformLocation(shader_id, "u_Texture");
+      glUniform1iv(uTexLoc, 8, samplerIds);
+      mData.hasUploaded.insert(key.packed());
+    }
+    return shader_id;
+  }
+  std::optional<u32> texture(const std::string& name) override {
+    return mData.mTextureData.getCachedTexture(name);
+  }
+  Result<u32> defaultTexture() override {
+    // Kept out of mTextureData, which evicts textures not in the scene
+    if (!mData.mDefaultTexture) {
+      mData.mDefaultTexture.emplace(DefaultTex);
+    }
+    return mData.mDefaultTexture->getGlId();
+  }
+  u32 uniformMin(u32 shader, u32 binding) override {
+    std::pair<u32, u32> id{shader, binding};
+    if (!mData.query_mins.contains(id)) {
+      int query_min;
+      glGetActiveUniformBlockiv(shader, binding, GL_UNIFORM_BLOCK_DATA_SIZE,
+                                &query_min);
+      mData.query_mins[id] = static_cast<u32>(query_min);
+    }
+    return mData.query_mins[id];
+  }
+
+private:
+  G3dSceneRenderData& mData;
+};
+
 std::unique_ptr<G3dSceneRenderData>
 G3DSceneCreateRenderData(riistudio::g3d::Collection& scene) {
   auto result = std::make_unique<G3dSceneRenderData>();
@@ -398,20 +561,14 @@ Result<void> G3DSceneAddNodesToBuffer(librii::gfx::SceneState& state,
   // Reupload changed textures
   render_data.mTextureData.update(scene);
 
-  state.getBuffers().opaque.nodes.reserve(256);
-  state.getBuffers().translucent.nodes.reserve(256);
-  std::string _err;
-  int i = 0;
-  for (auto& model : scene.getModels()) {
-    ModelView view(model, scene);
-    view.model_id = i++;
-    auto err =
-        gather(state.getBuffers(), view, m_mtx, v_mtx, p_mtx, render_data);
-    if (err.size()) {
-      _err = _err + "\n" + err;
-    }
+  GlDrawResolver resolver(render_data);
+  auto& list = render_data.mDrawList;
+  if (auto ok = list.sync(scene, resolver, lib3d::RenderType::Preview, {});
+      !ok) {
+    return std::unexpected(ok.error());
   }
-  return std::unexpected(_err);
+  auto ok = list.emit(state.getBuffers(), m_mtx, v_mtx, p_mtx);
+  return std::unexpected(list.errors + (ok ? "" : ok.error()));
 }
 
 Result<void> Any3DSceneAddNodesToBuffer(librii::gfx::SceneState& state,
@@ -425,15 +582,12 @@ Result<void> Any3DSceneAddNodesToBuffer(librii::gfx::SceneState& state,
   render_data.mTextureData.update(scene);
   TRY(render_data.mVertexRenderData.update(scene));
 
-  int i = 0;
-  for (auto& model : scene.getModels()) {
-    ModelView view(model, scene);
-    view.model_id = i++;
-    auto err = gather(state.getBuffers(), view, m_mtx, v_mtx, p_mtx,
-                      render_data, type, hide_mat);
-    if (err.size()) {
-      return std::unexpected(err);
-    }
+  GlDrawResolver resolver(render_data);
+  auto& list = render_data.mDrawList;
+  TRY(list.sync(scene, resolver, type, hide_mat));
+  TRY(list.emit(state.getBuffers(), m_mtx, v_mtx, p_mtx));
+  if (list.errors.size()) {
+    return std::unexpected(list.errors);
   }
   return {};
 }
@@ -9,6 +9,7 @@
 #include <librii/gl/EnumConverter.hpp>
 #include <librii/glhelper/GlTexture.hpp>
 #include <librii/glhelper/ShaderProgram.hpp>
+#include <librii/trig/WiiTrig.hpp>
 #include <unordered_map>
 #include <variant>
 
@@ -383,6 +384,137 @@ struct G3dVertexRenderData {
   }
 };
 
+struct ModelView {
+  int model_id = 0;
+  rsl::small_vector<const libcube::IBoneDelegate*, 32> bones;
+  rsl::small_vector<const libcube::IndexedPolygon*, 32> polys;
+  rsl::small_vector<const libcube::IGCMaterial*, 32> mats;
+  rsl::small_vector<const libcube::Texture*, 32> textures;
+  rsl::small_vector<libcube::DrawMatrix, 32> drawMatrices;
+
+  ModelView(const libcube::Model& model, const libcube::Scene& scene) {
+    for (auto& x : model.getBones()) {
+      bones.push_back(&x);
+    }
+    for (auto& x : model.getMeshes()) {
+      polys.push_back(&x);
+    }
+    for (auto& x : model.getMaterials()) {
+      mats.push_back(&x);
+    }
+    for (auto& x : scene.getTextures()) {
+      textures.push_back(&x);
+    }
+    for (auto& x : model.mDrawMatrices) {
+      drawMatrices.push_back(x);
+    }
+  }
+};
+
+//! Supplies the GPU objects a retained draw refers to. The renderer resolves
+//! them through its G3dSceneRenderData; other implementations let the CPU side
+//! of scene building run without a GL context (e.g. for benchmarks).
+struct DrawResolver {
+  virtual ~DrawResolver() = default;
+
+  //! Range of a draw call in the index buffer.
+  virtual Result<lib3d::IndexRange> vertices(const DrawCallPath& path) = 0;
+  virtual u32 vao() = 0;
+  //! Program for a material, compiled if needed, with its blocks bound.
+  virtual Result<u32> shader(const libcube::IGCMaterial& mat,
+                             lib3d::RenderType type) = 0;
+  virtual std::optional<u32> texture(const std::string& name) = 0;
+  //! Stand-in for textures that cannot be found.
+  virtual Result<u32> defaultTexture() = 0;
+  //! GL_UNIFORM_BLOCK_DATA_SIZE of a uniform block.
+  virtual u32 uniformMin(u32 shader, u32 binding) = 0;
+};
+
+struct RetainedModel {
+  RetainedModel(const libcube::Model& model, const libcube::Scene& scene)
+      : source(&model), view(model, scene) {}
+
+  const libcube::Model* source;
+  ModelView view;
+  //! Model-space matrix of each bone.
+  librii::g3d::BoneMatrixCache bone_mtx;
+  //! Draw matrices and matrix primitives the packet uniforms were built from.
+  std::vector<u32> skin_state;
+  //! Generation and contents of each material when its draws were built. Not
+  //! every edit bumps the generation, so the contents are compared too.
+  std::vector<s32> mat_generation;
+  std::vector<libcube::GCMaterialData> mat_state;
+
+  // Set by G3dDrawList::sync() for the draws it has to update
+  std::vector<bool> mat_dirty;
+  bool bones_dirty = false;
+};
+
+struct RetainedDraw {
+  u32 model = 0; //!< Index into G3dDrawList::models
+  u32 mat = 0;   //!< Index into ModelView::mats
+  const libcube::IndexedPolygon* poly = nullptr;
+  u32 mp_id = 0;
+  bool xlu = false;
+  //! False if the material has no usable shader; the draw is skipped.
+  bool has_shader = false;
+  std::string mat_error;
+  //! Set if the position matrices cannot be computed; the draw is skipped.
+  std::string packet_error;
+  //! Uniform blocks are, in order: scene, material, packet. The scene block
+  //! and the texture matrices depend on the camera and are filled in by
+  //! G3dDrawList::emit().
+  librii::gfx::SceneNode node;
+};
+
+//! Draw calls of a scene, retained across frames.
+//!
+//! The list is rebuilt only when the structure of the scene changes (models,
+//! meshes, the bone hierarchy, hidden materials...). Otherwise, only draws
+//! whose material generation changed get new material state, and only models
+//! whose bones moved get new position matrices. Each frame just copies the
+//! nodes out and fills in the camera-dependent uniforms.
+struct G3dDrawList {
+  std::vector<RetainedModel> models;
+  std::vector<RetainedDraw> draws;
+  //! Problems found while building or updating draws. Reported every frame
+  //! until fixed.
+  std::string errors;
+
+  // Statistics
+  u32 num_rebuilds = 0;
+  u32 num_material_updates = 0;
+  u32 num_bone_updates = 0;
+
+  //! Bring the list up to date with @p scene.
+  Result<void> sync(const libcube::Scene& scene, DrawResolver& resolver,
+                    lib3d::RenderType type, std::span<std::string> hide_mat);
+  //! Append one instance of the scene, placed at @p m_mtx, to @p output.
+  Result<void> emit(librii::gfx::SceneBuffers& output, glm::mat4 m_mtx,
+                    glm::mat4 v_mtx, glm::mat4 p_mtx) const;
+
+private:
+  Result<void> rebuild(const libcube::Scene& scene, DrawResolver& resolver,
+                       lib3d::RenderType type,
+                       std::span<std::string> hide_mat);
+  Result<void> gatherBone(u32 model_index, u64 bone_id, DrawResolver& resolver,
+                          std::span<std::string> hide_mat, u32 depth);
+  void updateMaterial(RetainedDraw& draw, DrawResolver& resolver,
+                      lib3d::RenderType type);
+  Result<void> updatePacket(RetainedDraw& draw);
+  void collectErrors();
+
+  //! Signature of what `draws` was built from.
+  std::vector<u64> mStructure;
+  //! Names and generations of the textures `draws` refer to.
+  std::vector<u64> mTextures;
+  std::unordered_map<std::string, const libcube::Texture*> mTextureByName;
+  // Scratch space, kept to avoid allocating every frame.
+  std::vector<u64> mScratch;
+  std::vector<u32> mSkinScratch;
+  std::vector<librii::g3d::BoneMatrixCache::Joint> mJointScratch;
+};
+
 // - One vertex buffer object (VBO) representing the entire model
 // (librii::glhelper::VBOBuilder)
 // - A mapping of draw calls in the model to indices in the VBO
@@ -407,6 +539,10 @@ struct G3dSceneRenderData {
     }
   };
   std::set<u64> hasUploaded;
+  //! Stand-in for missing textures
+  std::optional<CompiledLib3dTexture> mDefaultTexture;
+
+  G3dDrawList mDrawList;
 
   Result<void> init(const libcube::Scene& host) {
     TRY(mVertexRenderData.init(host));
@@ -420,34 +556,6 @@ struct G3dSceneRenderData {
 //
 std::unique_ptr<G3dSceneRenderData>
 G3DSceneCreateRenderData(riistudio::g3d::Collection& scene);
-
-struct ModelView {
-  int model_id = 0;
-  rsl::small_vector<const libcube::IBoneDelegate*, 32> bones;
-  rsl::small_vector<const libcube::IndexedPolygon*, 32> polys;
-  rsl::small_vector<const libcube::IGCMaterial*, 32> mats;
-  rsl::small_vector<const libcube::Texture*, 32> textures;
-  rsl::small_vector<libcube::DrawMatrix, 32> drawMatrices;
-
-  ModelView(const libcube::Model& model, const libcube::Scene& scene) {
-    for (auto& x : model.getBones()) {
-      bones.push_back(&x);
-    }
-    for (auto& x : model.getMeshes()) {
-      polys.push_back(&x);
-    }
-    for (auto& x : model.getMaterials()) {
-      mats.push_back(&x);
-    }
-    for (auto& x : scene.getTextures()) {
-      textures.push_back(&x);
-    }
-    for (auto& x : model.mDrawMatrices) {
-      drawMatrices.push_back(x);
-    }
-  }
-};
-
 Result<void> G3DSceneAddNodesToBuffer(librii::gfx::SceneState& state,
                                       const riistudio::g3d::Collection& scene,
                                       glm::mat4 m_mtx, glm::mat4 v_mtx,
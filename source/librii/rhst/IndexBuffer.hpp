@@ -1,25 +1,116 @@
 #pragma once
 
+#include <bit>
+#include <optional>
 #include <librii/rhst/RHST.hpp>
 
 namespace librii::rhst {
 
+// Consistent with `Vertex::operator==`: +0 and -0 hash alike.
+struct VertexHash {
+  size_t operator()(const Vertex& v) const {
+    u64 h = 0xCBF2'9CE4'8422'2325;
+    auto mix = [&](float f) {
+      h = (h ^ std::bit_cast<u32>(f + 0.0f)) * 0x0000'0100'0000'01B3;
+    };
+    auto mixN = [&](const auto& vec) {
+      for (int i = 0; i < vec.length(); ++i) {
+        mix(vec[i]);
+      }
+    };
+    mixN(v.position);
+    mixN(v.normal);
+    for (auto& uv : v.uvs) {
+      mixN(uv);
+    }
+    for (auto& clr : v.colors) {
+      mixN(clr);
+    }
+    h = (h ^ static_cast<u8>(v.matrix_index)) * 0x0000'0100'0000'01B3;
+    // Final avalanche (splitmix64)
+    h = (h ^ (h >> 30)) * 0xBF58'476D'1CE4'E5B9;
+    h = (h ^ (h >> 27)) * 0x94D0'49BB'1331'11EB;
+    return static_cast<size_t>(h ^ (h >> 31));
+  }
+};
+
+// Assigns each distinct `Vertex` the index of its first occurrence, in
+// insertion order. Open addressing over indices into `vertices`, so vertices
+// are stored once.
+template <typename T = u32> class VertexWelder {
+public:
+  explicit VertexWelder(size_t expected_count = 0) {
+    vertices.reserve(expected_count);
+    rehash(std::bit_ceil(std::max<size_t>(16, expected_count * 2)));
+  }
+
+  T insert(const Vertex& v) {
+    if ((vertices.size() + 1) * 2 > mSlots.size()) {
+      rehash(mSlots.size() * 2);
+    }
+    const size_t mask = mSlots.size() - 1;
+    for (size_t i = VertexHash{}(v) & mask;; i = (i + 1) & mask) {
+      const T slot = mSlots[i];
+      if (slot == Empty) {
+        const T id = static_cast<T>(vertices.size());
+        mSlots[i] = id;
+        vertices.push_back(v);
+        return id;
+      }
+      if (vertices[slot] == v) {
+        return slot;
+      }
+    }
+  }
+
+  // Index of a previously inserted vertex equal to |v|, if any.
+  std::optional<T> find(const Vertex& v) const {
+    const size_t mask = mSlots.size() - 1;
+    for (size_t i = VertexHash{}(v) & mask;; i = (i + 1) & mask) {
+      const T slot = mSlots[i];
+      if (slot == Empty) {
+        return std::nullopt;
+      }
+      if (vertices[slot] == v) {
+        return slot;
+      }
+    }
+  }
+
+  std::vector<Vertex> vertices;
+
+private:
+  static constexpr T Empty = std::numeric_limits<T>::max();
+
+  void rehash(size_t slot_count) {
+    mSlots.assign(slot_count, Empty);
+    const size_t mask = slot_count - 1;
+    for (size_t id = 0; id < vertices.size(); ++id) {
+      size_t i = VertexHash{}(vertices[id]) & mask;
+      while (mSlots[i] != Empty) {
+        i = (i + 1) & mask;
+      }
+      mSlots[i] = static_cast<T>(id);
+    }
+  }
+
+  std::vector<T> mSlots;
+};
+
 // As RHST isn't an indexed format (yet), this class does the conversion.
 template <typename T = u32> struct IndexBuffer {
   static Result<IndexBuffer<T>> create(const MatrixPrimitive& prim) {
     EXPECT(prim.primitives.size() == 1);
     EXPECT(prim.primitives[0].topology == Topology::Triangles);
+    const auto& src = prim.primitives[0].vertices;
+    EXPECT(src.size() < std::numeric_limits<T>::max());
+    VertexWelder<T> welder(src.size());
     IndexBuffer<T> tmp;
-    for (auto& v : prim.primitives[0].vertices) {
-      auto it = std::find(tmp.vertices.begin(), tmp.vertices.end(), v);
-      if (it != tmp.vertices.end()) {
-        tmp.index_data.push_back(it - tmp.vertices.begin());
-        continue;
-      }
-      tmp.index_data.push_back(static_cast<T>(tmp.vertices.size()));
-      tmp.vertices.push_back(v);
-      EXPECT(tmp.vertices[tmp.vertices.size() - 1] == v);
+    tmp.index_data.reserve(src.size());
+    for (auto& v : src) {
+      tmp.index_data.push_back(welder.insert(v));
     }
+    tmp.vertices = std::move(welder.vertices);
     return tmp;
   }
   std::vector<Vertex> vertices;
@@ -1,434 +1,512 @@
 #include "RHST.hpp"
+#include "RHSTBinary.hpp"
+#include <iterator>
 #include <rsl/TaggedUnion.hpp>
+#include <variant>
 #include <vendor/magic_enum/magic_enum.hpp>
 #include <vendor/nlohmann/json.hpp>
 
 namespace librii::rhst {
 
+// Reads the elements of a JSON scene tree. Each is a small subtree handed over
+// by SaxSceneTreeReader, so the DOM of the whole document is never built.
 class JsonSceneTreeReader {
 public:
-  JsonSceneTreeReader(const std::string& data)
-      : json(nlohmann::json::parse(data)) {}
-  SceneTree&& takeResult() { return std::move(out); }
-  Result<void> read() {
-    if (json.contains("head")) {
-      auto head = json["head"];
-      out.meta_data.exporter =
-          get<std::string>(head, "generator").value_or("?");
-      out.meta_data.format = get<std::string>(head, "type").value_or("?");
-      if (out.meta_data.format != "JMDL2") {
-        return std::unexpected("Blender plugin out of date. Please update.");
+  // |buffers| holds the vertex streams of a binary RHST file, if any.
+  explicit JsonSceneTreeReader(const BinarySceneView* buffers = nullptr)
+      : buffers(buffers) {}
+  SceneTree& result() { return out; }
+
+  Result<void> readHead(const nlohmann::json& head) {
+    out.meta_data.exporter =
+        get<std::string>(head, "generator").value_or("?");
+    out.meta_data.format = get<std::string>(head, "type").value_or("?");
+    if (out.meta_data.format != "JMDL2") {
+      return std::unexpected("Blender plugin out of date. Please update.");
+    }
+    out.meta_data.exporter_version =
+        get<std::string>(head, "version").value_or("?");
+    return {};
+  }
+  Result<void> readName(const nlohmann::json& name) {
+    out.name = name.get<std::string>();
+    return {};
+  }
+  Result<void> readBone(const nlohmann::json& bone) {
+    auto& b = out.bones.emplace_back();
+    b.name = get<std::string>(bone, "name").value_or("?");
+    std::string bill_mode =
+        get<std::string>(bone, "billboard").value_or("None");
+    b.billboard_mode =
+        magic_enum::enum_cast<BillboardMode>(cap(bill_mode))
+            .value_or(BillboardMode::None);
+    // Ignored: billboard
+    b.parent = get<s32>(bone, "parent").value_or(-1);
+    // We entirely recompute child links (from the "parent" field) and no
+    // longer read the legacy "child" field
+    b.scale = getVec3(bone, "scale").value_or(glm::vec3(1.0f));
+    b.rotate = getVec3(bone, "rotate").value_or(glm::vec3(0.0f));
+    b.translate = getVec3(bone, "translate").value_or(glm::vec3(0.0f));
+    b.min = getVec3(bone, "min").value_or(glm::vec3(0.0f));
+    b.max = getVec3(bone, "max").value_or(glm::vec3(0.0f));
+    if (bone.contains("draws") && bone["draws"].is_array()) {
+      auto draws = bone["draws"];
+      for (auto& draw : draws) {
+        int mat = draw[0].get<int>();
+        int poly = draw[1].get<int>();
+        int prio = draw[2].get<int>();
+        b.draw_calls.push_back(
+            DrawCall{.mat_index = mat, .poly_index = poly, .prio = prio});
       }
-      out.meta_data.exporter_version =
-          get<std::string>(head, "version").value_or("?");
     }
-    if (json.contains("body")) {
-      auto body = json["body"];
-      if (body.contains("name")) {
-        out.name = get<std::string>(body, "name").value_or("course");
+    return {};
+  }
+  // Everything but the "matrix_primitives" of a polygon.
+  Result<void> readPolygon(const nlohmann::json& poly, Mesh& b) {
+    b.name = get<std::string>(poly, "name").value_or("?");
+    // Ignored: primitive_type
+    b.current_matrix = get<s32>(poly, "current_matrix").value_or(-1);
+    if (!poly.contains("facepoint_format")) {
+      return std::unexpected(
+          std::format("Polygon {} has no facepoint_format", b.name));
+    }
+    const auto& f = poly["facepoint_format"];
+    b.vertex_descriptor = 0;
+    for (s32 i = 0; i < 21; ++i) {
+      b.vertex_descriptor |= f[i].get<s32>() ? (1 << i) : 0;
+    }
+    return {};
+  }
+  Result<void> readMatrix(const nlohmann::json& matrix, MatrixPrimitive& c) {
+    if (matrix.size() > c.draw_matrices.size()) {
+      return std::unexpected(
+          std::format("Too many draw matrices: {} (Max 10)", matrix.size()));
+    }
+    int i = 0;
+    for (auto& x : matrix) {
+      c.draw_matrices[i++] = x.get<s32>();
+    }
+    return {};
+  }
+  // Everything but the "facepoints" of a primitive.
+  Result<void> readPrimitive(const nlohmann::json& prim, u32 vcd,
+                             Primitive& d) {
+    // Ignore name
+    auto t = get<std::string>(prim, "primitive_type").value_or("triangles");
+    if (t == "triangles") {
+      d.topology = Topology::Triangles;
+    } else if (t == "triangle_strips") {
+      d.topology = Topology::TriangleStrip;
+    } else if (t == "triangle_fans") {
+      d.topology = Topology::TriangleFan;
+    } else {
+      return std::unexpected(std::format("Unknown topology {}", t));
+    }
+    if (prim.contains("streams")) {
+      TRY(readStreams(vcd, prim, d.vertices));
+    }
+    return {};
+  }
+  // Assigns the next attribute of a facepoint. Attributes are listed in
+  // vertex descriptor order; |vcd_cursor| tracks the position (LSB first).
+  Result<void> readAttribute(u32 vcd, int& vcd_cursor, std::span<const f32> v,
+                             Vertex& e) {
+    while ((vcd & (1 << vcd_cursor)) == 0) {
+      ++vcd_cursor;
+
+      if (vcd_cursor >= 21) {
+        return std::unexpected("Missing vertex data");
       }
-      if (body.contains("bones") && body["bones"].is_array()) {
-        auto bones = body["bones"];
-        for (auto& bone : bones) {
-          auto& b = out.bones.emplace_back();
-          b.name = get<std::string>(bone, "name").value_or("?");
-          std::string bill_mode =
-              get<std::string>(bone, "billboard").value_or("None");
-          b.billboard_mode =
-              magic_enum::enum_cast<BillboardMode>(cap(bill_mode))
-                  .value_or(BillboardMode::None);
-          // Ignored: billboard
-          b.parent = get<s32>(bone, "parent").value_or(-1);
-          // We entirely recompute child links (from the "parent" field) and no
-          // longer read the legacy "child" field
-          b.scale = getVec3(bone, "scale").value_or(glm::vec3(1.0f));
-          b.rotate = getVec3(bone, "rotate").value_or(glm::vec3(0.0f));
-          b.translate = getVec3(bone, "translate").value_or(glm::vec3(0.0f));
-          b.min = getVec3(bone, "min").value_or(glm::vec3(0.0f));
-          b.max = getVec3(bone, "max").value_or(glm::vec3(0.0f));
-          if (bone.contains("draws") && bone["draws"].is_array()) {
-            auto draws = bone["draws"];
-            for (auto& draw : draws) {
-              int mat = draw[0].get<int>();
-              int poly = draw[1].get<int>();
-              int prio = draw[2].get<int>();
-              b.draw_calls.push_back(
-                  DrawCall{.mat_index = mat, .poly_index = poly, .prio = prio});
-            }
-          }
+    }
+    const int cur_attr = vcd_cursor;
+    ++vcd_cursor;
+
+    // PNMIDX
+    if (cur_attr == 0 && v.size() == 1) {
+      e.matrix_index = static_cast<s8>(v[0]);
+    }
+    // TEXNMTXIDX are implicitly added by binary converter
+    else if (cur_attr >= 1 && cur_attr <= 8) {
+    } else if (cur_attr == 9 && v.size() == 3) {
+      e.position = glm::vec3(v[0], v[1], v[2]);
+    } else if (cur_attr == 10 && v.size() == 3) {
+      e.normal = glm::vec3(v[0], v[1], v[2]);
+    } else if (cur_attr >= 11 && cur_attr <= 12 && v.size() == 4) {
+      const int color_index = cur_attr - 11;
+      e.colors[color_index] = glm::vec4(v[0], v[1], v[2], v[3]);
+    } else if (cur_attr >= 13 && cur_attr <= 20 && v.size() == 2) {
+      const int uv_index = cur_attr - 13;
+      e.uvs[uv_index] = glm::vec2(v[0], v[1]);
+    } else {
+      return std::unexpected(std::format(
+          "Invalid vertex data: attribute {} has {} components", cur_attr,
+          v.size()));
+    }
+    return {};
+  }
+  Result<void> readWeight(const nlohmann::json& weight) {
+    auto& b = out.weights.emplace_back();
+    for (auto& influence : weight) {
+      auto& c = b.weights.emplace_back();
+      c.bone_index = influence[0].get<s32>();
+      c.influence = influence[0].get<s32>();
+    }
+    return {};
+  }
+  Result<void> readMaterial(const nlohmann::json& mat) {
+    auto& b = out.materials.emplace_back();
+    b.name = get<std::string>(mat, "name").value_or("?");
+    b.show_front = get<bool>(mat, "display_front").value_or(true);
+    b.show_back = get<bool>(mat, "display_back").value_or(false);
+    b.alpha_mode =
+        magic_enum::enum_cast<AlphaMode>(
+            cap(get<std::string>(mat, "pe").value_or("Opaque")))
+            .value_or(AlphaMode::Opaque);
+    if (b.alpha_mode == AlphaMode::Custom) {
+      if (mat.contains("pe_settings")) {
+        auto pe = mat["pe_settings"];
+        b.pe.alpha_test = magic_enum::enum_cast<AlphaTest>(
+                              cap(get<std::string>(pe, "alpha_test")
+                                      .value_or("Stencil")))
+                              .value_or(AlphaTest::Stencil);
+        // Alpha Test
+        if (b.pe.alpha_test == AlphaTest::Custom) {
+          b.pe.comparison_left =
+              magic_enum::enum_cast<Comparison>(
+                  cap(get<std::string>(pe, "comparison_left")
+                          .value_or("Always")))
+                  .value_or(Comparison::Always);
+          b.pe.comparison_right =
+              magic_enum::enum_cast<Comparison>(
+                  cap(get<std::string>(pe, "comparison_right")
+                          .value_or("Always")))
+                  .value_or(Comparison::Always);
+          b.pe.comparison_ref_left =
+              get<u8>(pe, "comparison_ref_left").value_or(0);
+          b.pe.comparison_ref_right =
+              get<u8>(pe, "comparison_ref_right").value_or(0);
+          b.pe.comparison_op =
+              magic_enum::enum_cast<AlphaOp>(
+                  cap(get<std::string>(pe, "comparison_op")
+                          .value_or("And")))
+                  .value_or(AlphaOp::And);
         }
+        // Draw Pass
+        b.pe.xlu = get<bool>(pe, "xlu").value_or(false);
+        // Z Buffer
+        b.pe.z_early_comparison =
+            get<bool>(pe, "z_early_compare").value_or(true);
+        b.pe.z_compare = get<bool>(pe, "z_compare").value_or(true);
+        b.pe.z_comparison = magic_enum::enum_cast<Comparison>(
+                                cap(get<std::string>(pe, "z_comparison")
+                                        .value_or("LEqual")))
+                                .value_or(Comparison::LEqual);
+        b.pe.z_update = get<bool>(pe, "z_update").value_or(true);
+        // Dst Alpha
+        b.pe.dst_alpha_enabled =
+            get<bool>(pe, "dst_alpha_enabled").value_or(false);
+        b.pe.dst_alpha = get<u8>(pe, "dst_alpha").value_or(0);
+        // Blend Modes
+        b.pe.blend_type =
+            magic_enum::enum_cast<BlendModeType>(
+                cap(get<std::string>(pe, "blend_mode").value_or("None")))
+                .value_or(BlendModeType::None);
+        b.pe.blend_source = magic_enum::enum_cast<BlendModeFactor>(
+                                cap(get<std::string>(pe, "blend_source")
+                                        .value_or("Src_a")))
+                                .value_or(BlendModeFactor::Src_a);
+        b.pe.blend_dest = magic_enum::enum_cast<BlendModeFactor>(
+                              cap(get<std::string>(pe, "blend_dest")
+                                      .value_or("Inv_rc_a")))
+                              .value_or(BlendModeFactor::Inv_src_a);
+      } else {
+        b.alpha_mode = AlphaMode::Opaque;
       }
-      if (body.contains("polygons") && body["polygons"].is_array()) {
-        auto polygons = body["polygons"];
-        for (auto& poly : polygons) {
-          auto& b = out.meshes.emplace_back();
-          b.name = get<std::string>(poly, "name").value_or("?");
-          // Ignored: primitive_type
-          b.current_matrix = get<s32>(poly, "current_matrix").value_or(-1);
-          auto f = poly["facepoint_format"];
-          b.vertex_descriptor = 0;
-          for (s32 i = 0; i < 21; ++i) {
-            b.vertex_descriptor |= f[i].get<s32>() ? (1 << i) : 0;
-          }
-
-          if (poly.contains("matrix_primitives") &&
-              poly["matrix_primitives"].is_array()) {
-            auto mps = poly["matrix_primitives"];
-            for (auto& mp : mps) {
-              auto& c = b.matrix_primitives.emplace_back();
-              // Ignore name
-              int i = 0;
-              for (auto x : mp["matrix"]) {
-                c.draw_matrices[i++] = x.get<s32>();
-              }
-              for (auto x : mp["primitives"]) {
-                auto& d = c.primitives.emplace_back();
-                // Ignore name
-                auto t =
-                    get<std::string>(x, "primitive_type").value_or("triangles");
-                if (t == "triangles") {
-                  d.topology = Topology::Triangles;
-                } else if (t == "triangle_strips") {
-                  d.topology = Topology::TriangleStrip;
-                } else if (t == "triangle_fans") {
-                  d.topology = Topology::TriangleFan;
-                } else {
-                  return std::unexpected(std::format("Unknown topology {}", t));
-                }
-                for (auto& v : x["facepoints"]) {
-                  auto& e = d.vertices.emplace_back();
-                  int vcd_cursor = 0; // LSB
-                  int P = 0;
-                  for (auto _ : v) {
-                    while ((b.vertex_descriptor & (1 << vcd_cursor)) == 0) {
-                      ++vcd_cursor;
-
-                      if (vcd_cursor >= 21) {
-                        return std::unexpected("Missing vertex data");
-                      }
-                    }
-                    const int cur_attr = vcd_cursor;
-                    ++vcd_cursor;
-
-                    // PNMIDX
-                    if (cur_attr == 0) {
-                      e.matrix_index = v[P].get<s8>();
-                    }
-                    // TEXNMTXIDX are implicitly added by binary converter
-                    else if (cur_attr == 9) {
-                      e.position = getVec3(v, P).value_or(glm::vec3{});
-                    } else if (cur_attr == 10) {
-                      e.normal = getVec3(v, P).value_or(glm::vec3{});
-                    } else if (cur_attr >= 11 && cur_attr <= 12) {
-                      const int color_index = cur_attr - 11;
-                      e.colors[color_index] =
-                          getVec4(v, P).value_or(glm::vec4{});
-                    } else if (cur_attr >= 13 && cur_attr <= 20) {
-                      const int uv_index = cur_attr - 13;
-                      e.uvs[uv_index] = getVec2(v, P).value_or(glm::vec2{});
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
+    }
+
+    b.lightset_index = get<s32>(mat, "lightset").value_or(-1);
+    b.fog_index = get<s32>(mat, "fog").value_or(0);
+    b.preset_path_mdl0mat =
+        get<std::string>(mat, "preset_path_mdl0mat").value_or("");
+
+    // Swap Table
+    if (mat.contains("swap_table") && mat["swap_table"].is_array()) {
+      auto swap = mat["swap_table"];
+      int i = 0;
+      for (auto entry : swap) {
+        b.swap_table[i].r =
+            magic_enum::enum_cast<Colors>(
+                cap(get<std::string>(entry, "red").value_or("Red")))
+                .value_or(Colors::Red);
+        b.swap_table[i].g =
+            magic_enum::enum_cast<Colors>(
+                cap(get<std::string>(entry, "green").value_or("Green")))
+                .value_or(Colors::Green);
+        b.swap_table[i].b =
+            magic_enum::enum_cast<Colors>(
+                cap(get<std::string>(entry, "blue").value_or("Blue")))
+                .value_or(Colors::Blue);
+        b.swap_table[i].a =
+            magic_enum::enum_cast<Colors>(
+                cap(get<std::string>(entry, "alpha").value_or("Alpha")))
+                .value_or(Colors::Alpha);
+        i++;
       }
-      if (body.contains("weights") && body["weights"].is_array()) {
-        auto weights = body["weights"];
-        for (auto weight : weights) {
-          auto& b = out.weights.emplace_back();
-          for (auto influence : weight) {
-            auto& c = b.weights.emplace_back();
-            c.bone_index = influence[0].get<s32>();
-            c.influence = influence[0].get<s32>();
-          }
+    }
+
+    // TEV
+    if (mat.contains("tev") && mat["tev"].is_array()) {
+      auto tevs = mat["tev"];
+      if (tevs.size() > 16) {
+        rsl::error("Too many TEV Stages: {} (Max 16)", tevs.size());
+      } else {
+        for (auto st : tevs) {
+          auto& stage = b.tev_stages.emplace_back();
+
+          stage.ras_channel =
+              magic_enum::enum_cast<ColorSelChan>(
+                  get<std::string>(st, "channel").value_or("color0a0"))
+                  .value_or(ColorSelChan::color0a0);
+          stage.tex_map = get<u8>(st, "sampler").value_or(0);
+          stage.ras_swap = get<u8>(st, "ras_swap").value_or(0);
+          stage.tex_map_swap = get<u8>(st, "sampler_swap").value_or(0);
+
+          auto c_stage = stage.color_stage;
+          c_stage.constant_sel =
+              magic_enum::enum_cast<TevKColorSel>(
+                  get<std::string>(st, "c_konst").value_or("const_1_8"))
+                  .value_or(TevKColorSel::const_1_8);
+          c_stage.formula =
+              magic_enum::enum_cast<TevColorOp>(
+                  get<std::string>(st, "c_formula").value_or("add"))
+                  .value_or(TevColorOp::add);
+          c_stage.a =
+              magic_enum::enum_cast<TevColorArg>(
+                  get<std::string>(st, "c_sel_a").value_or("zero"))
+                  .value_or(TevColorArg::zero);
+          c_stage.b =
+              magic_enum::enum_cast<TevColorArg>(
+                  get<std::string>(st, "c_sel_b").value_or("rasc"))
+                  .value_or(TevColorArg::rasc);
+          c_stage.c =
+              magic_enum::enum_cast<TevColorArg>(
+                  get<std::string>(st, "c_sel_c").value_or("texc"))
+                  .value_or(TevColorArg::texc);
+          c_stage.d =
+              magic_enum::enum_cast<TevColorArg>(
+                  get<std::string>(st, "c_sel_d").value_or("zero"))
+                  .value_or(TevColorArg::zero);
+          c_stage.bias =
+              magic_enum::enum_cast<TevBias>(
+                  get<std::string>(st, "c_bias").value_or("zero"))
+                  .value_or(TevBias::zero);
+          c_stage.scale =
+              magic_enum::enum_cast<TevScale>(
+                  get<std::string>(st, "c_scale").value_or("scale_1"))
+                  .value_or(TevScale::scale_1);
+          c_stage.out =
+              magic_enum::enum_cast<TevReg>(
+                  get<std::string>(st, "c_out").value_or("reg3"))
+                  .value_or(TevReg::reg3);
+          c_stage.clamp = get<bool>(st, "c_output_clamp").value_or(true);
+          stage.color_stage = c_stage;
+
+          auto a_stage = stage.alpha_stage;
+          a_stage.constant_sel =
+              magic_enum::enum_cast<TevKAlphaSel>(
+                  get<std::string>(st, "a_konst").value_or("const_1_8"))
+                  .value_or(TevKAlphaSel::const_1_8);
+          a_stage.formula =
+              magic_enum::enum_cast<TevAlphaOp>(
+                  get<std::string>(st, "a_formula").value_or("add"))
+                  .value_or(TevAlphaOp::add);
+          a_stage.a =
+              magic_enum::enum_cast<TevAlphaArg>(
+                  get<std::string>(st, "a_sel_a").value_or("zero"))
+                  .value_or(TevAlphaArg::zero);
+          a_stage.b =
+              magic_enum::enum_cast<TevAlphaArg>(
+                  get<std::string>(st, "a_sel_b").value_or("rasa"))
+                  .value_or(TevAlphaArg::rasa);
+          a_stage.c =
+              magic_enum::enum_cast<TevAlphaArg>(
+                  get<std::string>(st, "a_sel_c").value_or("texa"))
+                  .value_or(TevAlphaArg::texa);
+          a_stage.d =
+              magic_enum::enum_cast<TevAlphaArg>(
+                  get<std::string>(st, "a_sel_d").value_or("zero"))
+                  .value_or(TevAlphaArg::zero);
+          a_stage.bias =
+              magic_enum::enum_cast<TevBias>(
+                  get<std::string>(st, "a_bias").value_or("zero"))
+                  .value_or(TevBias::zero);
+          a_stage.scale =
+              magic_enum::enum_cast<TevScale>(
+                  get<std::string>(st, "a_scale").value_or("scale_1"))
+                  .value_or(TevScale::scale_1);
+          a_stage.out =
+              magic_enum::enum_cast<TevReg>(
+                  get<std::string>(st, "a_out").value_or("reg3"))
+                  .value_or(TevReg::reg3);
+          a_stage.clamp = get<bool>(st, "a_output_clamp").value_or(true);
+          stage.alpha_stage = a_stage;
         }
       }
-      if (body.contains("materials") && body["materials"].is_array()) {
-        auto materials = body["materials"];
-        for (auto mat : materials) {
-          auto& b = out.materials.emplace_back();
-          b.name = get<std::string>(mat, "name").value_or("?");
-          b.show_front = get<bool>(mat, "display_front").value_or(true);
-          b.show_back = get<bool>(mat, "display_back").value_or(false);
-          b.alpha_mode =
-              magic_enum::enum_cast<AlphaMode>(
-                  cap(get<std::string>(mat, "pe").value_or("Opaque")))
-                  .value_or(AlphaMode::Opaque);
-          if (b.alpha_mode == AlphaMode::Custom) {
-            if (mat.contains("pe_settings")) {
-              auto pe = mat["pe_settings"];
-              b.pe.alpha_test = magic_enum::enum_cast<AlphaTest>(
-                                    cap(get<std::string>(pe, "alpha_test")
-                                            .value_or("Stencil")))
-                                    .value_or(AlphaTest::Stencil);
-              // Alpha Test
-              if (b.pe.alpha_test == AlphaTest::Custom) {
-                b.pe.comparison_left =
-                    magic_enum::enum_cast<Comparison>(
-                        cap(get<std::string>(pe, "comparison_left")
-                                .value_or("Always")))
-                        .value_or(Comparison::Always);
-                b.pe.comparison_right =
-                    magic_enum::enum_cast<Comparison>(
-                        cap(get<std::string>(pe, "comparison_right")
-                                .value_or("Always")))
-                        .value_or(Comparison::Always);
-                b.pe.comparison_ref_left =
-                    get<u8>(pe, "comparison_ref_left").value_or(0);
-                b.pe.comparison_ref_right =
-                    get<u8>(pe, "comparison_ref_right").value_or(0);
-                b.pe.comparison_op =
-                    magic_enum::enum_cast<AlphaOp>(
-                        cap(get<std::string>(pe, "comparison_op")
-                                .value_or("And")))
-                        .value_or(AlphaOp::And);
-              }
-              // Draw Pass
-              b.pe.xlu = get<bool>(pe, "xlu").value_or(false);
-              // Z Buffer
-              b.pe.z_early_comparison =
-                  get<bool>(pe, "z_early_compare").value_or(true);
-              b.pe.z_compare = get<bool>(pe, "z_compare").value_or(true);
-              b.pe.z_comparison = magic_enum::enum_cast<Comparison>(
-                                      cap(get<std::string>(pe, "z_comparison")
-                                              .value_or("LEqual")))
-                                      .value_or(Comparison::LEqual);
-              b.pe.z_update = get<bool>(pe, "z_update").value_or(true);
-              // Dst Alpha
-              b.pe.dst_alpha_enabled =
-                  get<bool>(pe, "dst_alpha_enabled").value_or(false);
-              b.pe.dst_alpha = get<u8>(pe, "dst_alpha").value_or(0);
-              // Blend Modes
-              b.pe.blend_type =
-                  magic_enum::enum_cast<BlendModeType>(
-                      cap(get<std::string>(pe, "blend_mode").value_or("None")))
-                      .value_or(BlendModeType::None);
-              b.pe.blend_source = magic_enum::enum_cast<BlendModeFactor>(
-                                      cap(get<std::string>(pe, "blend_source")
-                                              .value_or("Src_a")))
-                                      .value_or(BlendModeFactor::Src_a);
-              b.pe.blend_dest = magic_enum::enum_cast<BlendModeFactor>(
-                                    cap(get<std::string>(pe, "blend_dest")
-                                            .value_or("Inv_rc_a")))
-                                    .value_or(BlendModeFactor::Inv_src_a);
-            } else {
-              b.alpha_mode = AlphaMode::Opaque;
-            }
-          }
-
-          b.lightset_index = get<s32>(mat, "lightset").value_or(-1);
-          b.fog_index = get<s32>(mat, "fog").value_or(0);
-          b.preset_path_mdl0mat =
-              get<std::string>(mat, "preset_path_mdl0mat").value_or("");
-
-          // Swap Table
-          if (mat.contains("swap_table") && mat["swap_table"].is_array()) {
-            auto swap = mat["swap_table"];
-            int i = 0;
-            for (auto entry : swap) {
-              b.swap_table[i].r =
-                  magic_enum::enum_cast<Colors>(
-                      cap(get<std::string>(entry, "red").value_or("Red")))
-                      .value_or(Colors::Red);
-              b.swap_table[i].g =
-                  magic_enum::enum_cast<Colors>(
-                      cap(get<std::string>(entry, "green").value_or("Green")))
-                      .value_or(Colors::Green);
-              b.swap_table[i].b =
-                  magic_enum::enum_cast<Colors>(
-                      cap(get<std::string>(entry, "blue").value_or("Blue")))
-                      .value_or(Colors::Blue);
-              b.swap_table[i].a =
-                  magic_enum::enum_cast<Colors>(
-                      cap(get<std::string>(entry, "alpha").value_or("Alpha")))
-                      .value_or(Colors::Alpha);
-              i++;
-            }
-          }
-
-          // TEV
-          if (mat.contains("tev") && mat["tev"].is_array()) {
-            auto tevs = mat["tev"];
-            if (tevs.size() > 16) {
-              rsl::error("Too many TEV Stages: {} (Max 16)", tevs.size());
-            } else {
-              for (auto st : tevs) {
-                auto& stage = b.tev_stages.emplace_back();
-
-                stage.ras_channel =
-                    magic_enum::enum_cast<ColorSelChan>(
-                        get<std::string>(st, "channel").value_or("color0a0"))
-                        .value_or(ColorSelChan::color0a0);
-                stage.tex_map = get<u8>(st, "sampler").value_or(0);
-                stage.ras_swap = get<u8>(st, "ras_swap").value_or(0);
-                stage.tex_map_swap = get<u8>(st, "sampler_swap").value_or(0);
-
-                auto c_stage = stage.color_stage;
-                c_stage.constant_sel =
-                    magic_enum::enum_cast<TevKColorSel>(
-                        get<std::string>(st, "c_konst").value_or("const_1_8"))
-                        .value_or(TevKColorSel::const_1_8);
-                c_stage.formula =
-                    magic_enum::enum_cast<TevColorOp>(
-                        get<std::string>(st, "c_formula").value_or("add"))
-                        .value_or(TevColorOp::add);
-                c_stage.a =
-                    magic_enum::enum_cast<TevColorArg>(
-                        get<std::string>(st, "c_sel_a").value_or("zero"))
-                        .value_or(TevColorArg::zero);
-                c_stage.b =
-                    magic_enum::enum_cast<TevColorArg>(
-                        get<std::string>(st, "c_sel_b").value_or("rasc"))
-                        .value_or(TevColorArg::rasc);
-                c_stage.c =
-                    magic_enum::enum_cast<TevColorArg>(
-                        get<std::string>(st, "c_sel_c").value_or("texc"))
-                        .value_or(TevColorArg::texc);
-                c_stage.d =
-                    magic_enum::enum_cast<TevColorArg>(
-                        get<std::string>(st, "c_sel_d").value_or("zero"))
-                        .value_or(TevColorArg::zero);
-                c_stage.bias =
-                    magic_enum::enum_cast<TevBias>(
-                        get<std::string>(st, "c_bias").value_or("zero"))
-                        .value_or(TevBias::zero);
-                c_stage.scale =
-                    magic_enum::enum_cast<TevScale>(
-                        get<std::string>(st, "c_scale").value_or("scale_1"))
-                        .value_or(TevScale::scale_1);
-                c_stage.out =
-                    magic_enum::enum_cast<TevReg>(
-                        get<std::string>(st, "c_out").value_or("reg3"))
-                        .value_or(TevReg::reg3);
-                c_stage.clamp = get<bool>(st, "c_output_clamp").value_or(true);
-                stage.color_stage = c_stage;
-
-                auto a_stage = stage.alpha_stage;
-                a_stage.constant_sel =
-                    magic_enum::enum_cast<TevKAlphaSel>(
-                        get<std::string>(st, "a_konst").value_or("const_1_8"))
-                        .value_or(TevKAlphaSel::const_1_8);
-                a_stage.formula =
-                    magic_enum::enum_cast<TevAlphaOp>(
-                        get<std::string>(st, "a_formula").value_or("add"))
-                        .value_or(TevAlphaOp::add);
-                a_stage.a =
-                    magic_enum::enum_cast<TevAlphaArg>(
-                        get<std::string>(st, "a_sel_a").value_or("zero"))
-                        .value_or(TevAlphaArg::zero);
-                a_stage.b =
-                    magic_enum::enum_cast<TevAlphaArg>(
-                        get<std::string>(st, "a_sel_b").value_or("rasa"))
-                        .value_or(TevAlphaArg::rasa);
-                a_stage.c =
-                    magic_enum::enum_cast<TevAlphaArg>(
-                        get<std::string>(st, "a_sel_c").value_or("texa"))
-                        .value_or(TevAlphaArg::texa);
-                a_stage.d =
-                    magic_enum::enum_cast<TevAlphaArg>(
-                        get<std::string>(st, "a_sel_d").value_or("zero"))
-                        .value_or(TevAlphaArg::zero);
-                a_stage.bias =
-                    magic_enum::enum_cast<TevBias>(
-                        get<std::string>(st, "a_bias").value_or("zero"))
-                        .value_or(TevBias::zero);
-                a_stage.scale =
-                    magic_enum::enum_cast<TevScale>(
-                        get<std::string>(st, "a_scale").value_or("scale_1"))
-                        .value_or(TevScale::scale_1);
-                a_stage.out =
-                    magic_enum::enum_cast<TevReg>(
-                        get<std::string>(st, "a_out").value_or("reg3"))
-                        .value_or(TevReg::reg3);
-                a_stage.clamp = get<bool>(st, "a_output_clamp").value_or(true);
-                stage.alpha_stage = a_stage;
-              }
-            }
-          }
-
-          if (mat.contains("samplers") && mat["samplers"].is_array()) {
-            auto samplers = mat["samplers"];
-            EXPECT(samplers.size() <= 8);
-            for (auto sam : samplers) {
-              auto& sampler = b.samplers.emplace_back();
-              sampler.texture_name =
-                  get<std::string>(sam, "texture").value_or("?");
-              sampler.wrap_u =
-                  magic_enum::enum_cast<WrapMode>(
-                      cap(get<std::string>(sam, "wrap_u").value_or("Repeat")))
-                      .value_or(WrapMode::Repeat);
-              sampler.wrap_v =
-                  magic_enum::enum_cast<WrapMode>(
-                      cap(get<std::string>(sam, "wrap_v").value_or("Repeat")))
-                      .value_or(WrapMode::Repeat);
-              sampler.min_filter = get<bool>(sam, "min_filter").value_or(true);
-              sampler.mag_filter = get<bool>(sam, "mag_filter").value_or(true);
-              sampler.enable_mip = get<bool>(sam, "enable_mip").value_or(true);
-              sampler.mip_filter = get<bool>(sam, "mip_filter").value_or(true);
-              sampler.lod_bias = get<f32>(sam, "lod_bias").value_or(-1.0f);
-              sampler.mapping =
-                  magic_enum::enum_cast<Mapping>(
-                      cap(get<std::string>(sam, "mapping").value_or("UVMap")))
-                      .value_or(Mapping::UVMap);
-              sampler.uv_map_index =
-                  get<int>(sam, "mapping_uv_index").value_or(0);
-              sampler.light_index =
-                  get<int>(sam, "mapping_light_index").value_or(-1);
-              sampler.camera_index =
-                  get<int>(sam, "mapping_cam_index").value_or(-1);
-
-              // Matrix
-              if (sam.contains("transformations")) {
-                auto trans = sam["transformations"];
-                sampler.scale =
-                    getVec2(trans, "scale").value_or(glm::vec2(1.0f));
-                sampler.rotate = get<f32>(trans, "rotate").value_or(0.0f);
-                sampler.trans =
-                    getVec2(trans, "translate").value_or(glm::vec2(0.0f));
-              }
-            }
-          } else {
-            b.min_filter = get<bool>(mat, "min_filter").value_or(true);
-            b.mag_filter = get<bool>(mat, "mag_filter").value_or(true);
-            b.enable_mip = get<bool>(mat, "enable_mip").value_or(true);
-            b.mip_filter = get<bool>(mat, "mip_filter").value_or(true);
-            b.lod_bias = get<f32>(mat, "lod_bias").value_or(-1.0f);
-            b.texture_name = get<std::string>(mat, "texture").value_or("?");
-            b.wrap_u =
-                magic_enum::enum_cast<WrapMode>(
-                    cap(get<std::string>(mat, "wrap_u").value_or("Repeat")))
-                    .value_or(WrapMode::Repeat);
-            b.wrap_v =
-                magic_enum::enum_cast<WrapMode>(
-                    cap(get<std::string>(mat, "wrap_v").value_or("Repeat")))
-                    .value_or(WrapMode::Repeat);
-          }
-          // TEV Colors
-          if (mat.contains("tev_colors") && mat["tev_colors"].is_array()) {
-            auto cols = mat["tev_colors"];
-            int P = 0;
-            b.tev_colors[0] = {0xaa, 0xbb, 0xcc, 0xff};
-            for (int i = 0; i < 3; i++) {
-              b.tev_colors[i + 1] = getVec4(cols, P).value_or(glm::vec4{});
-            }
-          }
-          if (mat.contains("tev_konst_colors") &&
-              mat["tev_konst_colors"].is_array()) {
-            auto cols = mat["tev_konst_colors"];
-            int P = 0;
-            for (int i = 0; i < 4; i++) {
-              b.tev_konst_colors[i] = getVec4(cols, P).value_or(glm::vec4{});
-            }
-          }
+    }
+
+    if (mat.contains("samplers") && mat["samplers"].is_array()) {
+      auto samplers = mat["samplers"];
+      EXPECT(samplers.size() <= 8);
+      for (auto sam : samplers) {
+        auto& sampler = b.samplers.emplace_back();
+        sampler.texture_name =
+            get<std::string>(sam, "texture").value_or("?");
+        sampler.wrap_u =
+            magic_enum::enum_cast<WrapMode>(
+                cap(get<std::string>(sam, "wrap_u").value_or("Repeat")))
+                .value_or(WrapMode::Repeat);
+        sampler.wrap_v =
+            magic_enum::enum_cast<WrapMode>(
+                cap(get<std::string>(sam, "wrap_v").value_or("Repeat")))
+                .value_or(WrapMode::Repeat);
+        sampler.min_filter = get<bool>(sam, "min_filter").value_or(true);
+        sampler.mag_filter = get<bool>(sam, "mag_filter").value_or(true);
+        sampler.enable_mip = get<bool>(sam, "enable_mip").value_or(true);
+        sampler.mip_filter = get<bool>(sam, "mip_filter").value_or(true);
+        sampler.lod_bias = get<f32>(sam, "lod_bias").value_or(-1.0f);
+        sampler.mapping =
+            magic_enum::enum_cast<Mapping>(
+                cap(get<std::string>(sam, "mapping").value_or("UVMap")))
+                .value_or(Mapping::UVMap);
+        sampler.uv_map_index =
+            get<int>(sam, "mapping_uv_index").value_or(0);
+        sampler.light_index =
+            get<int>(sam, "mapping_light_index").value_or(-1);
+        sampler.camera_index =
+            get<int>(sam, "mapping_cam_index").value_or(-1);
+
+        // Matrix
+        if (sam.contains("transformations")) {
+          auto trans = sam["transformations"];
+          sampler.scale =
+              getVec2(trans, "scale").value_or(glm::vec2(1.0f));
+          sampler.rotate = get<f32>(trans, "rotate").value_or(0.0f);
+          sampler.trans =
+              getVec2(trans, "translate").value_or(glm::vec2(0.0f));
         }
       }
+    } else {
+      b.min_filter = get<bool>(mat, "min_filter").value_or(true);
+      b.mag_filter = get<bool>(mat, "mag_filter").value_or(true);
+      b.enable_mip = get<bool>(mat, "enable_mip").value_or(true);
+      b.mip_filter = get<bool>(mat, "mip_filter").value_or(true);
+      b.lod_bias = get<f32>(mat, "lod_bias").value_or(-1.0f);
+      b.texture_name = get<std::string>(mat, "texture").value_or("?");
+      b.wrap_u =
+          magic_enum::enum_cast<WrapMode>(
+              cap(get<std::string>(mat, "wrap_u").value_or("Repeat")))
+              .value_or(WrapMode::Repeat);
+      b.wrap_v =
+          magic_enum::enum_cast<WrapMode>(
+              cap(get<std::string>(mat, "wrap_v").value_or("Repeat")))
+              .value_or(WrapMode::Repeat);
+    }
+    // TEV Colors
+    if (mat.contains("tev_colors") && mat["tev_colors"].is_array()) {
+      auto cols = mat["tev_colors"];
+      int P = 0;
+      b.tev_colors[0] = {0xaa, 0xbb, 0xcc, 0xff};
+      for (int i = 0; i < 3; i++) {
+        b.tev_colors[i + 1] = getVec4(cols, P).value_or(glm::vec4{});
+      }
+    }
+    if (mat.contains("tev_konst_colors") &&
+        mat["tev_konst_colors"].is_array()) {
+      auto cols = mat["tev_konst_colors"];
+      int P = 0;
+      for (int i = 0; i < 4; i++) {
+        b.tev_konst_colors[i] = getVec4(cols, P).value_or(glm::vec4{});
+      }
     }
     return {};
   }
 
 private:
+  // Fills |out| from the "streams" of a binary RHST primitive.
+  Result<void> readStreams(u32 vcd, const nlohmann::json& prim,
+                           std::vector<Vertex>& out) {
+    if (buffers == nullptr) {
+      return std::unexpected("Vertex streams require a binary RHST file");
+    }
+    const auto& streams = prim["streams"];
+    out.resize(get<u32>(prim, "num_facepoints").value_or(0));
+    size_t stream = 0;
+    for (int attr = 0; attr < 21; ++attr) {
+      if ((vcd & (1 << attr)) == 0) {
+        continue;
+      }
+      if (stream >= streams.size()) {
+        return std::unexpected("Missing vertex data");
+      }
+      const auto& s = streams[stream++];
+      const s32 data = s[0].get<s32>();
+      const s32 index = s[1].get<s32>();
+      // PNMIDX
+      if (attr == 0) {
+        TRY(readStream<s8>(data, index, out,
+                           [](Vertex& v, s8 x) { v.matrix_index = x; }));
+      }
+      // TEXNMTXIDX are implicitly added by binary converter
+      else if (attr == 9) {
+        TRY(readStream<glm::vec3>(data, index, out, [](Vertex& v, auto& x) {
+          v.position = x;
+        }));
+      } else if (attr == 10) {
+        TRY(readStream<glm::vec3>(data, index, out,
+                                  [](Vertex& v, auto& x) { v.normal = x; }));
+      } else if (attr >= 11 && attr <= 12) {
+        TRY(readStream<glm::vec4>(
+            data, index, out,
+            [c = attr - 11](Vertex& v, auto& x) { v.colors[c] = x; }));
+      } else if (attr >= 13 && attr <= 20) {
+        TRY(readStream<glm::vec2>(
+            data, index, out,
+            [c = attr - 13](Vertex& v, auto& x) { v.uvs[c] = x; }));
+      }
+    }
+    return {};
+  }
+  template <typename T, typename F>
+  Result<void> readStream(s32 data, s32 index, std::vector<Vertex>& out,
+                          F set) {
+    auto values = TRY(buffers->buffer<T>(data));
+    if (index < 0) {
+      if (values.size() != out.size()) {
+        return std::unexpected(
+            std::format("Buffer {}: Expected {} values, got {}", data,
+                        out.size(), values.size()));
+      }
+      for (size_t i = 0; i < out.size(); ++i) {
+        set(out[i], values[i]);
+      }
+      return {};
+    }
+    auto indices = TRY(buffers->buffer<u32>(index));
+    if (indices.size() != out.size()) {
+      return std::unexpected(
+          std::format("Buffer {}: Expected {} indices, got {}", index,
+                      out.size(), indices.size()));
+    }
+    for (size_t i = 0; i < out.size(); ++i) {
+      if (indices[i] >= values.size()) {
+        return std::unexpected(std::format(
+            "Buffer {}: Index {} exceeds buffer {} ({} values)", index,
+            indices[i], data, values.size()));
+      }
+      set(out[i], values[indices[i]]);
+    }
+    return {};
+  }
   std::string cap(std::string s) {
     if (s.empty())
       return s;
@@ -487,28 +565,474 @@ private:
     return glm::vec4(x, y, z, w);
   }
 
-  nlohmann::json json;
+  const BinarySceneView* buffers = nullptr;
   SceneTree out;
 };
 
+// Iterator over the input that publishes how far the parser has read.
+class ProgressIterator {
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = char;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const char*;
+  using reference = const char&;
+
+  ProgressIterator(const char* pos, const char** cursor)
+      : mPos(pos), mCursor(cursor) {}
+
+  reference operator*() const { return *mPos; }
+  ProgressIterator& operator++() {
+    *mCursor = ++mPos;
+    return *this;
+  }
+  ProgressIterator operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  bool operator==(const ProgressIterator& rhs) const {
+    return mPos == rhs.mPos;
+  }
+
+private:
+  const char* mPos;
+  const char** mCursor;
+};
+
+// Streams a JSON scene tree into a JsonSceneTreeReader while tokenizing.
+// Bones, materials and polygon headers are captured one subtree at a time;
+// facepoints, which make up nearly all of a scene, are decoded straight into
+// Primitive::vertices.
+class SaxSceneTreeReader {
+public:
+  using json = nlohmann::json;
+
+  SaxSceneTreeReader(JsonSceneTreeReader& reader, std::string_view text,
+                     std::function<void(std::string_view, float)> progress)
+      : mReader(reader), mText(text), mProgress(std::move(progress)),
+        mProgressInterval(text.size() / 100 + 1) {}
+
+  Result<void> read() {
+    const char* cursor = mText.data();
+    mCursor = &cursor;
+    ProgressIterator first(mText.data(), &cursor);
+    ProgressIterator last(mText.data() + mText.size(), &cursor);
+    if (!json::sax_parse(first, last, this)) {
+      return std::unexpected(mError.empty() ? "Invalid JSON" : mError);
+    }
+    return {};
+  }
+
+  // SAX interface
+  bool null() {
+    return scalar([](auto& dom) { return dom.null(); });
+  }
+  bool boolean(bool val) {
+    return scalar([&](auto& dom) { return dom.boolean(val); });
+  }
+  bool number_integer(json::number_integer_t val) {
+    if (inVertex()) {
+      return number(static_cast<f32>(val));
+    }
+    return scalar([&](auto& dom) { return dom.number_integer(val); });
+  }
+  bool number_unsigned(json::number_unsigned_t val) {
+    if (inVertex()) {
+      return number(static_cast<f32>(val));
+    }
+    return scalar([&](auto& dom) { return dom.number_unsigned(val); });
+  }
+  bool number_float(json::number_float_t val, const json::string_t& s) {
+    if (inVertex()) {
+      return number(static_cast<f32>(val));
+    }
+    return scalar([&](auto& dom) { return dom.number_float(val, s); });
+  }
+  bool string(json::string_t& val) {
+    return scalar([&](auto& dom) { return dom.string(val); });
+  }
+  bool binary(json::binary_t& val) {
+    return scalar([&](auto& dom) { return dom.binary(val); });
+  }
+  bool start_object(std::size_t elements) {
+    return open(false, [&](auto& dom) { return dom.start_object(elements); });
+  }
+  bool key(json::string_t& val) {
+    if (mCapture) {
+      return mCapture->dom.key(val);
+    }
+    mKey = val;
+    return true;
+  }
+  bool end_object() {
+    return close([](auto& dom) { return dom.end_object(); });
+  }
+  bool start_array(std::size_t elements) {
+    return open(true, [&](auto& dom) { return dom.start_array(elements); });
+  }
+  bool end_array() {
+    return close([](auto& dom) { return dom.end_array(); });
+  }
+  bool parse_error(std::size_t position, const std::string&,
+                   const nlohmann::detail::exception& ex) {
+    mError = std::format("JSON error at byte {}: {}", position, ex.what());
+    return false;
+  }
+
+private:
+  // Containers that are walked event by event.
+  enum class Frame {
+    Root,
+    Body,
+    Bones,
+    Weights,
+    Materials,
+    Polygons,
+    Polygon,
+    MatrixPrimitives,
+    MatrixPrimitive,
+    Primitives,
+    Primitive,
+    Facepoints,
+    Facepoint,
+    Attribute,
+  };
+  // Where a captured subtree goes.
+  enum class Target {
+    Discard,
+    Invalid,
+    Head,
+    Name,
+    Bone,
+    Weight,
+    Material,
+    PolygonField,
+    Matrix,
+    PrimitiveField,
+  };
+  struct Capture {
+    Capture(Target target, std::string key)
+        : target(target), key(std::move(key)) {}
+
+    Target target;
+    std::string key;
+    json value;
+    nlohmann::detail::json_sax_dom_parser<json> dom{value};
+    int depth = 0;
+  };
+
+  // Decides what the value starting now is, from the enclosing frame (and
+  // key): a container to walk, or a subtree to capture.
+  std::variant<Frame, Target> route(bool object, bool array) const {
+    if (mFrames.empty()) {
+      return object ? std::variant<Frame, Target>(Frame::Root)
+                    : Target::Invalid;
+    }
+    switch (mFrames.back()) {
+    case Frame::Root:
+      if (mKey == "head") {
+        return Target::Head;
+      }
+      if (mKey == "body" && object) {
+        return Frame::Body;
+      }
+      return Target::Discard;
+    case Frame::Body:
+      if (mKey == "name") {
+        return Target::Name;
+      }
+      if (mKey == "bones" && array) {
+        return Frame::Bones;
+      }
+      if (mKey == "weights" && array) {
+        return Frame::Weights;
+      }
+      if (mKey == "materials" && array) {
+        return Frame::Materials;
+      }
+      if (mKey == "polygons" && array) {
+        return Frame::Polygons;
+      }
+      return Target::Discard;
+    case Frame::Bones:
+      return Target::Bone;
+    case Frame::Weights:
+      return Target::Weight;
+    case Frame::Materials:
+      return Target::Material;
+    case Frame::Polygons:
+      return object ? std::variant<Frame, Target>(Frame::Polygon)
+                    : Target::Invalid;
+    case Frame::Polygon:
+      if (mKey == "matrix_primitives" && array) {
+        return Frame::MatrixPrimitives;
+      }
+      return Target::PolygonField;
+    case Frame::MatrixPrimitives:
+      return object ? std::variant<Frame, Target>(Frame::MatrixPrimitive)
+                    : Target::Invalid;
+    case Frame::MatrixPrimitive:
+      if (mKey == "primitives" && array) {
+        return Frame::Primitives;
+      }
+      if (mKey == "matrix" && array) {
+        return Target::Matrix;
+      }
+      return Target::Discard;
+    case Frame::Primitives:
+      return object ? std::variant<Frame, Target>(Frame::Primitive)
+                    : Target::Invalid;
+    case Frame::Primitive:
+      if (mKey == "facepoints" && array) {
+        return Frame::Facepoints;
+      }
+      return Target::PrimitiveField;
+    case Frame::Facepoints:
+      return array ? std::variant<Frame, Target>(Frame::Facepoint)
+                   : Target::Invalid;
+    case Frame::Facepoint:
+      return array ? std::variant<Frame, Target>(Frame::Attribute)
+                   : Target::Invalid;
+    case Frame::Attribute:
+      return Target::Invalid;
+    }
+    return Target::Invalid;
+  }
+
+  template <typename F> bool open(bool array, F&& forward) {
+    if (!mCapture) {
+      auto dst = route(!array, array);
+      if (auto* frame = std::get_if<Frame>(&dst)) {
+        return push(*frame);
+      }
+      if (!beginCapture(std::get<Target>(dst))) {
+        return false;
+      }
+    }
+    ++mCapture->depth;
+    return forward(mCapture->dom);
+  }
+  template <typename F> bool close(F&& forward) {
+    if (!mCapture) {
+      return pop();
+    }
+    if (!forward(mCapture->dom)) {
+      return false;
+    }
+    return --mCapture->depth == 0 ? endCapture() : true;
+  }
+  template <typename F> bool scalar(F&& forward) {
+    if (!mCapture) {
+      // Scalars are never walked as frames.
+      if (!beginCapture(std::get<Target>(route(false, false)))) {
+        return false;
+      }
+    }
+    if (!forward(mCapture->dom)) {
+      return false;
+    }
+    return mCapture->depth == 0 ? endCapture() : true;
+  }
+
+  bool beginCapture(Target target) {
+    if (target == Target::Invalid) {
+      return fail("Unexpected JSON value in scene tree");
+    }
+    mCapture.emplace(target, mKey);
+    return true;
+  }
+  bool endCapture() {
+    const Target target = mCapture->target;
+    const std::string key = std::move(mCapture->key);
+    json value = std::move(mCapture->value);
+    mCapture.reset();
+    return check(store(target, key, std::move(value)));
+  }
+  Result<void> store(Target target, const std::string& key, json&& value) {
+    switch (target) {
+    case Target::Discard:
+    case Target::Invalid:
+      return {};
+    case Target::Head:
+      return mReader.readHead(value);
+    case Target::Name:
+      return mReader.readName(value);
+    case Target::Bone:
+      return mReader.readBone(value);
+    case Target::Weight:
+      return mReader.readWeight(value);
+    case Target::Material:
+      return mReader.readMaterial(value);
+    case Target::PolygonField:
+      mPolygon[key] = std::move(value);
+      return {};
+    case Target::Matrix:
+      return mReader.readMatrix(value, mesh().matrix_primitives.back());
+    case Target::PrimitiveField:
+      mPrimitive[key] = std::move(value);
+      return {};
+    }
+    return {};
+  }
+
+  bool push(Frame frame) {
+    switch (frame) {
+    case Frame::Polygon:
+      mPolygon = json::object();
+      mHasMesh = false;
+      break;
+    case Frame::MatrixPrimitives:
+      // Facepoints are decoded with the polygon's vertex descriptor, so
+      // "facepoint_format" must come first (as it does in sorted keys, too).
+      if (!check(beginMesh())) {
+        return false;
+      }
+      break;
+    case Frame::MatrixPrimitive:
+      mesh().matrix_primitives.emplace_back();
+      break;
+    case Frame::Primitive:
+      mesh().matrix_primitives.back().primitives.emplace_back();
+      mPrimitive = json::object();
+      break;
+    case Frame::Facepoint:
+      primitive().vertices.emplace_back();
+      mVcdCursor = 0;
+      break;
+    case Frame::Attribute:
+      mAttributeSize = 0;
+      break;
+    default:
+      break;
+    }
+    mFrames.push_back(frame);
+    return true;
+  }
+  bool pop() {
+    const Frame frame = mFrames.back();
+    mFrames.pop_back();
+    switch (frame) {
+    case Frame::Polygon:
+      // Again, for fields that followed "matrix_primitives" (sorted keys).
+      return check(beginMesh()) &&
+             check(mReader.readPolygon(mPolygon, mesh()));
+    case Frame::Primitive:
+      return check(mReader.readPrimitive(mPrimitive, mesh().vertex_descriptor,
+                                         primitive()));
+    case Frame::Attribute:
+      return check(mReader.readAttribute(
+          mesh().vertex_descriptor, mVcdCursor,
+          std::span(mAttribute.data(), mAttributeSize), vertex()));
+    default:
+      return true;
+    }
+  }
+
+  bool inVertex() const {
+    return !mCapture && !mFrames.empty() &&
+           (mFrames.back() == Frame::Facepoint ||
+            mFrames.back() == Frame::Attribute);
+  }
+  bool number(f32 val) {
+    if (mFrames.back() == Frame::Attribute) {
+      if (mAttributeSize >= mAttribute.size()) {
+        return fail("Invalid vertex data: too many components");
+      }
+      mAttribute[mAttributeSize++] = val;
+      return true;
+    }
+    // Scalar attribute (PNMIDX)
+    return check(mReader.readAttribute(mesh().vertex_descriptor, mVcdCursor,
+                                       std::span(&val, 1), vertex()));
+  }
+
+  Result<void> beginMesh() {
+    if (!mHasMesh) {
+      TRY(mReader.readPolygon(mPolygon,
+                              mReader.result().meshes.emplace_back()));
+      mHasMesh = true;
+    }
+    return {};
+  }
+  Mesh& mesh() { return mReader.result().meshes.back(); }
+  Primitive& primitive() {
+    return mesh().matrix_primitives.back().primitives.back();
+  }
+  Vertex& vertex() { return primitive().vertices.back(); }
+
+  bool check(Result<void> result) {
+    if (!result) {
+      return fail(result.error());
+    }
+    reportProgress();
+    return true;
+  }
+  bool fail(std::string error) {
+    mError = std::move(error);
+    return false;
+  }
+  void reportProgress() {
+    if (!mProgress) {
+      return;
+    }
+    const size_t pos = *mCursor - mText.data();
+    if (pos < mNextProgress) {
+      return;
+    }
+    mNextProgress = pos + mProgressInterval;
+    mProgress(std::format("Reading scene ({} / {} MB)", pos >> 20,
+                          mText.size() >> 20),
+              static_cast<float>(pos) / static_cast<float>(mText.size()));
+  }
+
+  JsonSceneTreeReader& mReader;
+  std::string_view mText;
+  std::function<void(std::string_view, float)> mProgress;
+  size_t mProgressInterval;
+  size_t mNextProgress = 0;
+  const char** mCursor = nullptr;
+  std::string mError;
+
+  std::vector<Frame> mFrames;
+  std::string mKey;
+  std::optional<Capture> mCapture;
+
+  json mPolygon;
+  bool mHasMesh = false;
+  json mPrimitive;
+  int mVcdCursor = 0;
+  std::array<f32, 4> mAttribute{};
+  size_t mAttributeSize = 0;
+};
+
 u64 totalStrippingMs = 0;
 
-Result<SceneTree> ReadSceneTree(std::span<const u8> file_data) {
+Result<SceneTree>
+ReadSceneTree(std::span<const u8> file_data,
+              std::function<void(std::string_view, float)> progress) {
   totalStrippingMs = 0;
-  if (file_data[0] == 'R' && file_data[1] == 'H' && file_data[2] == 'S' &&
-      file_data[3] == 'T') {
-    return std::unexpected("BINARY rhst scene tree unsupported");
-  }
-  std::string tmp(
-      reinterpret_cast<const char*>(file_data.data()),
-      reinterpret_cast<const char*>(file_data.data() + file_data.size()));
-  JsonSceneTreeReader scn_reader(tmp);
-  auto result = scn_reader.read();
+  std::optional<BinarySceneView> binary;
+  std::string_view json(reinterpret_cast<const char*>(file_data.data()),
+                        file_data.size());
+  if (BinarySceneView::IsBinary(file_data)) {
+    auto view = BinarySceneView::Create(file_data);
+    if (!view) {
+      return std::unexpected(std::format(
+          "Failed to read binary rhst scene tree: {}", view.error()));
+    }
+    binary = *view;
+    json = binary->scene();
+  }
+  JsonSceneTreeReader scn_reader(binary ? &*binary : nullptr);
+  SaxSceneTreeReader sax(scn_reader, json, std::move(progress));
+  auto result = sax.read();
   if (!result) {
     return std::unexpected(
-        std::format("Failed to read JSON rhst scene tree: {}", result.error()));
+        std::format("Failed to read {} rhst scene tree: {}",
+                    binary ? "binary" : "JSON", result.error()));
   }
-  SceneTree&& scn = scn_reader.takeResult();
+  SceneTree scn = std::move(scn_reader.result());
   // Recompute child links
   for (auto&& bone : scn.bones) {
     bone.child.clear();
@@ -519,7 +1043,7 @@ Result<SceneTree> ReadSceneTree(std::span<const u8> file_data) {
       scn.bones[bone.parent].child.push_back(i);
     }
   }
-  return std::move(scn_reader.takeResult());
+  return scn;
 }
 
 } // namespace librii::rhst
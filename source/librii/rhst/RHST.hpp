@@ -699,6 +699,11 @@ struct SceneTree {
   std::vector<ProtoMaterial> materials;
 };
 
-Result<SceneTree> ReadSceneTree(std::span<const u8> file_data);
+// Reads a JSON or binary (see RHSTBinary.hpp) scene tree. JSON is streamed, so
+// |file_data| may be a memory-mapped file. |progress| is reported by bytes
+// consumed.
+Result<SceneTree>
+ReadSceneTree(std::span<const u8> file_data,
+              std::function<void(std::string_view, float)> progress = nullptr);
 
 } // namespace librii::rhst
@@ -0,0 +1,81 @@
+#include "RHSTBinary.hpp"
+
+#include <bit>
+#include <rsl/Ranges.hpp>
+
+namespace librii::rhst {
+
+static u64 ElementSize(BufferType type) {
+  switch (type) {
+  case BufferType::S8:
+    return 1;
+  case BufferType::U32:
+    return 4;
+  case BufferType::F32x2:
+    return 8;
+  case BufferType::F32x3:
+    return 12;
+  case BufferType::F32x4:
+    return 16;
+  }
+  return 0;
+}
+
+Result<BinarySceneView> BinarySceneView::Create(std::span<const u8> file) {
+  if constexpr (std::endian::native != std::endian::little) {
+    return std::unexpected("Binary RHST requires a little-endian host");
+  }
+  if (!IsBinary(file) || file.size() < sizeof(BinaryHeader)) {
+    return std::unexpected("Not a binary RHST file");
+  }
+  // Buffers are viewed in place as arrays of floats/u32s.
+  if (reinterpret_cast<uintptr_t>(file.data()) % alignof(BinaryHeader) != 0) {
+    return std::unexpected("Binary RHST data must be 4-byte aligned");
+  }
+  BinarySceneView view;
+  view.mHeader = reinterpret_cast<const BinaryHeader*>(file.data());
+  const auto& header = *view.mHeader;
+  if (header.version != BinaryVersion) {
+    return std::unexpected(
+        std::format("Unsupported binary RHST version {} (expected {}). Please "
+                    "update the Blender plugin.",
+                    header.version, BinaryVersion));
+  }
+  if (header.file_size > file.size()) {
+    return std::unexpected(
+        std::format("Binary RHST is truncated ({} of {} bytes)", file.size(),
+                    header.file_size));
+  }
+  view.mFile = file.subspan(0, header.file_size);
+  auto in_bounds = [&](u64 offset, u64 size) {
+    return offset + size <= header.file_size;
+  };
+  if (!in_bounds(header.scene_offset, header.scene_size)) {
+    return std::unexpected("Binary RHST scene description is out of bounds");
+  }
+  if (header.buffers_offset % alignof(BinaryBufferDesc) != 0 ||
+      !in_bounds(header.buffers_offset,
+                 u64{header.num_buffers} * sizeof(BinaryBufferDesc))) {
+    return std::unexpected("Binary RHST buffer table is out of bounds");
+  }
+  view.mBuffers = {reinterpret_cast<const BinaryBufferDesc*>(
+                       file.data() + header.buffers_offset),
+                   header.num_buffers};
+  for (auto&& [i, desc] : rsl::enumerate(view.mBuffers)) {
+    const u64 element_size = ElementSize(desc.type);
+    if (element_size == 0) {
+      return std::unexpected(std::format("Buffer {}: Unknown type {}", i,
+                                         static_cast<u32>(desc.type)));
+    }
+    if (desc.offset % 16 != 0) {
+      return std::unexpected(std::format("Buffer {}: Misaligned", i));
+    }
+    if (u64{desc.count} * element_size != desc.size ||
+        !in_bounds(desc.offset, desc.size)) {
+      return std::unexpected(std::format("Buffer {}: Out of bounds", i));
+    }
+  }
+  return view;
+}
+
+} // namespace librii::rhst
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <core/common.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include <string_view>
+
+namespace librii::rhst {
+
+// Binary RHST container, as written by the Blender plugin.
+//
+// The scene description (bones, materials, mesh headers) is the usual JMDL2
+// JSON, minus the vertex data: each primitive lists "num_facepoints" and
+// "streams" in place of "facepoints". Vertex attributes live in little-endian
+// buffers placed at 16-byte aligned offsets, so they can be viewed in place.
+//
+//   BinaryHeader
+//   char scene[scene_size]            (UTF-8 JSON)
+//   BinaryBufferDesc buffers[num_buffers]
+//   <buffer data>
+//
+// A stream is a pair [data buffer, index buffer]. Without an index buffer (-1)
+// the data buffer holds one element per facepoint; otherwise facepoint i uses
+// data[index[i]], which lets meshes share position/normal arrays. Streams are
+// listed in vertex descriptor order, like the entries of a JSON facepoint;
+// attributes without data (TEXNMTXIDX) use [-1, -1].
+
+struct BinaryHeader {
+  char magic[4]; // "RHST"
+  u32 version;
+  u32 file_size;
+  u32 scene_offset;
+  u32 scene_size;
+  u32 buffers_offset;
+  u32 num_buffers;
+  u32 reserved;
+};
+static_assert(sizeof(BinaryHeader) == 32);
+
+constexpr u32 BinaryVersion = 1;
+
+enum class BufferType : u32 {
+  S8,
+  U32,
+  F32x2,
+  F32x3,
+  F32x4,
+};
+
+struct BinaryBufferDesc {
+  u32 offset; // From the start of the file
+  u32 size;   // In bytes
+  BufferType type;
+  u32 count; // Of elements
+};
+static_assert(sizeof(BinaryBufferDesc) == 16);
+
+template <typename T> struct BufferTypeOf;
+template <> struct BufferTypeOf<s8> {
+  static constexpr BufferType value = BufferType::S8;
+};
+template <> struct BufferTypeOf<u32> {
+  static constexpr BufferType value = BufferType::U32;
+};
+template <> struct BufferTypeOf<glm::vec2> {
+  static constexpr BufferType value = BufferType::F32x2;
+};
+template <> struct BufferTypeOf<glm::vec3> {
+  static constexpr BufferType value = BufferType::F32x3;
+};
+template <> struct BufferTypeOf<glm::vec4> {
+  static constexpr BufferType value = BufferType::F32x4;
+};
+
+// Validated, zero-copy view of a binary RHST file. Does not own the data.
+class BinarySceneView {
+public:
+  static bool IsBinary(std::span<const u8> file) {
+    return file.size() >= 4 && file[0] == 'R' && file[1] == 'H' &&
+           file[2] == 'S' && file[3] == 'T';
+  }
+  static Result<BinarySceneView> Create(std::span<const u8> file);
+
+  // The JSON scene description.
+  std::string_view scene() const {
+    return {reinterpret_cast<const char*>(mFile.data() + mHeader->scene_offset),
+            mHeader->scene_size};
+  }
+  std::span<const BinaryBufferDesc> buffers() const { return mBuffers; }
+
+  // Buffer |index| as an array of |T|. Fails if the stored type differs.
+  template <typename T> Result<std::span<const T>> buffer(s32 index) const {
+    if (index < 0 || static_cast<size_t>(index) >= mBuffers.size()) {
+      return std::unexpected(std::format("Invalid buffer index {}", index));
+    }
+    const auto& desc = mBuffers[index];
+    if (desc.type != BufferTypeOf<T>::value) {
+      return std::unexpected(
+          std::format("Buffer {} has type {}, expected {}", index,
+                      static_cast<u32>(desc.type),
+                      static_cast<u32>(BufferTypeOf<T>::value)));
+    }
+    return std::span<const T>(
+        reinterpret_cast<const T*>(mFile.data() + desc.offset), desc.count);
+  }
+
+private:
+  BinarySceneView() = default;
+
+  std::span<const u8> mFile;
+  const BinaryHeader* mHeader = nullptr;
+  std::span<const BinaryBufferDesc> mBuffers;
+};
+
+} // namespace librii::rhst
@@ -6,7 +6,9 @@
 #include <rsmeshopt/include/rsmeshopt.h>
 
 #include <fmt/color.h>
+#include <mutex>
 #include <rsl/Ranges.hpp>
+#include <rsl/ThreadPool.hpp>
 #include <thread>
 
 // TODO: Bad, intrusive dependency
@@ -124,18 +126,136 @@ Result<void> ValidateMeshesEqualImpl(const TriList& ll, const TriList& rl) {
   }
   return {};
 }
+// LSD radix sort, 16 bits per pass. Passes where all keys share a digit are
+// skipped, so the short keys of small meshes take fewer.
+static void RadixSort(std::vector<u64>& keys) {
+  if (keys.size() < 1024) {
+    std::ranges::sort(keys);
+    return;
+  }
+  std::vector<u64> tmp(keys.size());
+  std::vector<u32> offsets(1 << 16);
+  for (int shift = 0; shift < 64; shift += 16) {
+    std::ranges::fill(offsets, 0);
+    for (u64 key : keys) {
+      ++offsets[(key >> shift) & 0xFFFF];
+    }
+    if (offsets[(keys[0] >> shift) & 0xFFFF] == keys.size()) {
+      continue;
+    }
+    u32 sum = 0;
+    for (auto& offset : offsets) {
+      sum += std::exchange(offset, sum);
+    }
+    for (u64 key : keys) {
+      tmp[offsets[(key >> shift) & 0xFFFF]++] = key;
+    }
+    keys.swap(tmp);
+  }
+}
+
+// Same semantics as TriList, over vertices welded against a baseline rather
+// than copies of them: each triangle is a 64-bit key of three 21-bit vertex
+// indices, rotated to start at its lowest index. The baseline is welded and
+// sorted once; an experiment is then one hash lookup per stored vertex and a
+// radix sort.
+class WeldedTriList {
+public:
+  static Result<WeldedTriList> Create(const MatrixPrimitive& baseline) {
+    WeldedTriList result;
+    TRY(BuildKeys(
+        baseline,
+        [&](const Vertex& v) -> std::optional<u32> {
+          return result.welder_.insert(v);
+        },
+        result.keys_));
+    if (result.welder_.vertices.size() > MaxVertices) {
+      // Indices do not fit the key. Far beyond what GX can index anyway.
+      TriList list;
+      TRY(list.SetFromMPrim(baseline));
+      result.fallback_ = std::move(list);
+      result.keys_.clear();
+    }
+    return result;
+  }
+
+  [[nodiscard]] Result<void> Validate(const MatrixPrimitive& prim) const {
+    if (fallback_) {
+      TriList list;
+      TRY(list.SetFromMPrim(prim));
+      return ValidateMeshesEqualImpl(*fallback_, list);
+    }
+    std::vector<u64> keys;
+    keys.reserve(keys_.size());
+    TRY(BuildKeys(
+        prim, [&](const Vertex& v) { return welder_.find(v); }, keys));
+    if (keys.size() != keys_.size()) {
+      return std::unexpected(
+          std::format("Number of triangles does not match (l: {}, r: {})",
+                      keys_.size(), keys.size()));
+    }
+    auto [l, r] = std::ranges::mismatch(keys_, keys);
+    if (l != keys_.end()) {
+      return std::unexpected(std::format("Mismatch at triangle {}/{}",
+                                         l - keys_.begin(), keys_.size() - 1));
+    }
+    return {};
+  }
+
+private:
+  static constexpr size_t MaxVertices = 1 << 21;
+
+  static Result<void> BuildKeys(const MatrixPrimitive& prim, auto&& index_of,
+                                std::vector<u64>& keys) {
+    std::vector<u32> indices;
+    for (auto& p : prim.primitives) {
+      indices.clear();
+      for (auto& v : p.vertices) {
+        auto index = index_of(v);
+        if (!index) {
+          return std::unexpected("Vertex does not occur in the original mesh");
+        }
+        indices.push_back(*index);
+      }
+      std::array<u32, 3> tri;
+      int ctr = 0;
+      for (auto idx : MeshUtils::AsTrianglesIdx(p)) {
+        tri[ctr] = indices[TRY(idx)];
+        ++ctr;
+        if (ctr < 3) {
+          continue;
+        }
+        ctr = 0;
+        // Discard degenerate triangles
+        if (IsTriDegenerate(tri)) {
+          continue;
+        }
+        NormalizeTriInplace(tri);
+        keys.push_back((static_cast<u64>(tri[0]) << 42) |
+                       (static_cast<u64>(tri[1]) << 21) | tri[2]);
+      }
+    }
+    RadixSort(keys);
+    return {};
+  }
+
+  VertexWelder<u32> welder_;
+  // Sorted, duplicates allowed
+  std::vector<u64> keys_;
+  std::optional<TriList> fallback_;
+};
+
 Result<void> ValidateMeshesEqual(const MatrixPrimitive& l,
                                  const MatrixPrimitive& r) {
-  TriList ll, rl;
-  if (auto ok = ll.SetFromMPrim(l); !ok) {
+  auto ll = WeldedTriList::Create(l);
+  if (!ll) {
     return std::unexpected("Failed to validate. Initial mprim is invalid: " +
-                           ok.error());
+                           ll.error());
   }
-  if (auto ok = rl.SetFromMPrim(r); !ok) {
-    return std::unexpected("Failed to validate. New mprim is invalid: " +
-                           ok.error());
+  if (auto ok = ll->Validate(r); !ok) {
+    return std::unexpected("Failed to validate: " + ok.error());
   }
-  return ValidateMeshesEqualImpl(ll, rl);
+  return {};
 }
 
 // Instruments collection of Optimizer stats of a certain primitive encoding
@@ -187,6 +307,9 @@ private:
 // Test bench for a variety of "experiments -- different ways to encode a set of
 // Primitives. Experiments are scored by vertex count; only the winning
 // experiment will be selected for actual output.
+//
+// Once all experiments are created, distinct experiments may be run, reset and
+// validated from different threads.
 template <typename KeyT> class MeshOptimizerExperimentHolder {
 public:
   MeshOptimizerExperimentHolder(const MatrixPrimitive& baseline)
@@ -198,35 +321,33 @@ public:
     // operator[] constructs elements as necessary
     return (experiments_[key] = baseline_);
   }
+  // Unlike CreateExperiment, never inserts, so it is safe to call concurrently.
+  void ResetExperiment(KeyT key) { experiments_.at(key) = baseline_; }
+  void RemoveExperiment(KeyT key) {
+    experiments_.erase(key);
+    stats_.erase(key);
+  }
 
+  MatrixPrimitive& GetExperiment(KeyT key) {
+    assert(experiments_.contains(key));
+    return experiments_.at(key);
+  }
   const MatrixPrimitive& GetExperiment(KeyT key) const {
     assert(experiments_.contains(key));
     return experiments_.at(key);
   }
+  bool HasExperiments() const { return !experiments_.empty(); }
 
   [[nodiscard]] Result<void> ValidateExperimentWithBaseline(KeyT key) const {
     assert(experiments_.contains(key));
-    // Constructing a TriList is sufficiently expensive to warrant caching.
-    if (!baselineList_) {
-      TriList list;
-      TRY(list.SetFromMPrim(baseline_));
-      baselineList_ = std::move(list);
-    }
-    TriList ref;
-    TRY(ref.SetFromMPrim(experiments_.at(key)));
-    return ValidateMeshesEqualImpl(*baselineList_, ref);
+    const WeldedTriList& baseline = *TRY(GetBaselineList());
+    return baseline.Validate(experiments_.at(key));
   }
 
   [[nodiscard]] Result<void> ValidateAllWithBaseline() const {
-    if (!baselineList_) {
-      TriList list;
-      TRY(list.SetFromMPrim(baseline_));
-      baselineList_ = std::move(list);
-    }
+    const WeldedTriList& baseline = *TRY(GetBaselineList());
     for (auto& [key, experiment] : experiments_) {
-      TriList ref;
-      TRY(ref.SetFromMPrim(experiments_.at(key)));
-      auto ok = ValidateMeshesEqualImpl(*baselineList_, ref);
+      auto ok = baseline.Validate(experiment);
       if (!ok) {
         return std::unexpected(
             std::format("({}) -> {}", static_cast<int>(key), ok.error()));
@@ -235,7 +356,10 @@ public:
     return {};
   }
 
-  void SetStats(KeyT key, MeshOptimizerStats stats) { stats_[key] = stats; }
+  void SetStats(KeyT key, MeshOptimizerStats stats) {
+    std::unique_lock g(mutex_);
+    stats_[key] = stats;
+  }
   std::optional<MeshOptimizerStats> GetStats(KeyT key) const {
     if (!stats_.contains(key)) {
       return std::nullopt;
@@ -300,11 +424,22 @@ public:
   }
 
 private:
+  // Welding the baseline is sufficiently expensive to warrant caching.
+  Result<const WeldedTriList*> GetBaselineList() const {
+    std::unique_lock g(mutex_);
+    if (!baselineList_) {
+      baselineList_ = TRY(WeldedTriList::Create(baseline_));
+    }
+    return &*baselineList_;
+  }
+
   // Const as baseLineList may be generated based on this within a const
   // function.
   const MatrixPrimitive baseline_{};
+  // Guards baselineList_ and stats_.
+  mutable std::mutex mutex_;
   // For validation. Mutable so ValidateExperimentWithBaseline can remain const.
-  mutable std::optional<TriList> baselineList_;
+  mutable std::optional<WeldedTriList> baselineList_;
   std::unordered_map<KeyT, MatrixPrimitive> experiments_{};
   std::unordered_map<KeyT, MeshOptimizerStats> stats_{};
 };
@@ -475,8 +610,13 @@ Result<MeshOptimizerStats> StripifyTrianglesHaroohie(MatrixPrimitive& prim) {
   return StripifyTrianglesRSMESHOPT(rsmeshopt::StripifyAlgo::Haroohie, prim);
 }
 
+// Returned by experiments that gave up because they could not win.
+static constexpr std::string_view CancelledError =
+    "Cancelled: cannot beat the best experiment";
+
 Result<MeshOptimizerStats> ToFanTriangles(MatrixPrimitive& prim, u32 min_len,
-                                          size_t max_runs) {
+                                          size_t max_runs,
+                                          const ExperimentBound* bound) {
   MeshOptimizerStatsCollector stats(prim);
   auto buf = TRY(IndexBuffer<u32>::create(prim));
 
@@ -494,6 +634,19 @@ Result<MeshOptimizerStats> ToFanTriangles(MatrixPrimitive& prim, u32 min_len,
 #ifndef NDEBUG
   stats.Verify();
 #endif
+  if (bound) {
+    // Leftover triangles end up in at least one strip: two vertices plus one
+    // per triangle.
+    u32 lower_bound = 0;
+    for (auto& p : prim.primitives) {
+      lower_bound += p.topology == Topology::Triangles
+                         ? static_cast<u32>(p.vertices.size() / 3 + 2)
+                         : static_cast<u32>(p.vertices.size());
+    }
+    if (bound->cannotWin(lower_bound)) {
+      return std::unexpected(std::string(CancelledError));
+    }
+  }
   // PrimitiveRestartSplitter puts a batch of triangles at the very end if
   // there remain any.
   if (prim.primitives.size() > 0) {
@@ -515,22 +668,36 @@ Result<MeshOptimizerStats> ToFanTriangles(MatrixPrimitive& prim, u32 min_len,
   return stats.End();
 }
 
-Result<MeshOptimizerStats> ToFanTriangles2(MatrixPrimitive& prim) {
+Result<MeshOptimizerStats> ToFanTriangles2(MatrixPrimitive& prim,
+                                           const ExperimentBound* bound) {
   MeshOptimizerStatsCollector stats(prim);
   auto vc = VertexCount(prim);
-  if (vc >= 20'000) {
-    // TODO: Workaround -- skips on sufficiently complex meshes, for now
-    stats.SetComment("Skipping mesh to save time: too complex");
-    return stats.End();
-  }
-
   std::array<size_t, 6> depths = {vc, 5, 10, 20, 40, 80};
 
   MeshOptimizerExperimentHolder<size_t> experiments(prim);
   for (auto& d : depths) {
-    auto& tmp = experiments.CreateExperiment(d);
-    auto stats = TRY(ToFanTriangles(tmp, 4, d));
-    experiments.SetStats(d, stats);
+    experiments.CreateExperiment(d);
+  }
+  std::array<Result<MeshOptimizerStats>, depths.size()> results;
+  {
+    rsl::TaskGroup group;
+    for (size_t i = 0; i < depths.size(); ++i) {
+      group.run([&, i] {
+        results[i] = ToFanTriangles(experiments.GetExperiment(depths[i]), 4,
+                                    depths[i], bound);
+      });
+    }
+  }
+  for (size_t i = 0; i < depths.size(); ++i) {
+    // Cancelled runs cannot win, but would otherwise compete as the baseline.
+    if (!results[i] && results[i].error() == CancelledError) {
+      experiments.RemoveExperiment(depths[i]);
+      continue;
+    }
+    experiments.SetStats(depths[i], TRY(results[i]));
+  }
+  if (!experiments.HasExperiments()) {
+    return std::unexpected(std::string(CancelledError));
   }
   // TRY(experiments.ValidateAllWithBaseline());
   prim = experiments.GetFirstWinner();
@@ -549,8 +716,9 @@ Result<MeshOptimizerStats> StripifyTrianglesDraco(MatrixPrimitive& prim,
   return StripifyTrianglesRSMESHOPT(rsmeshopt::StripifyAlgo::Draco, prim);
 }
 
-Result<MeshOptimizerStats> StripifyTrianglesAlgo(MatrixPrimitive& prim,
-                                                 Algo algo) {
+Result<MeshOptimizerStats>
+StripifyTrianglesAlgo(MatrixPrimitive& prim, Algo algo,
+                      const ExperimentBound* bound) {
   switch (algo) {
   case Algo::MeshOptmzr:
     return StripifyTrianglesMeshOptimizer(prim);
@@ -566,7 +734,7 @@ Result<MeshOptimizerStats> StripifyTrianglesAlgo(MatrixPrimitive& prim,
     return StripifyTrianglesDraco(prim, true);
   case Algo::RiiFans:
     // This calls everything else on result.
-    return ToFanTriangles2(prim);
+    return ToFanTriangles2(prim, bound);
   }
   return std::unexpected("Invalid mesh algorithm");
 }
@@ -574,9 +742,10 @@ Result<MeshOptimizerStats> StripifyTrianglesAlgo(MatrixPrimitive& prim,
 // Brute-force every algorithm
 Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
                                std::optional<Algo> except,
-                               std::string_view debug_name, bool verbose) {
+                               std::string_view debug_name, bool verbose,
+                               bool validate) {
   MeshOptimizerExperimentHolder<Algo> experiments(prim);
-  u32 ms_on_validate = 0;
+  std::vector<Algo> algos;
   for (auto e : magic_enum::enum_values<Algo>()) {
     if (except && *except == e) {
       // Disabled by user input
@@ -594,23 +763,50 @@ Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
       // This almost *never* wins, and is quite slow at that, but is here so we
       // can never possibly lose to BrawlBox.
     }
-    auto& tmp = experiments.CreateExperiment(e);
-    auto results = StripifyTrianglesAlgo(tmp, e);
-    if (!results) {
-      experiments.CreateExperiment(e);
-      experiments.SetStats(e, {.comment = results.error()});
-      continue;
-    }
-    // If invalid, reset and comment the error
-    rsl::Timer timer;
-    auto ok = experiments.ValidateExperimentWithBaseline(e);
-    ms_on_validate += timer.elapsed();
-    if (!ok) {
-      experiments.CreateExperiment(e);
-      experiments.SetStats(e, {.comment = ok.error()});
-      continue;
+    algos.push_back(e);
+  }
+  // Created up front: the experiment map must not change while they run.
+  for (auto e : algos) {
+    experiments.CreateExperiment(e);
+  }
+  ExperimentBound bound;
+  std::atomic<u32> ms_on_validate = 0;
+  {
+    rsl::TaskGroup group;
+    for (auto e : algos) {
+      group.run([&, e] {
+        auto& tmp = experiments.GetExperiment(e);
+        auto results = StripifyTrianglesAlgo(tmp, e, &bound);
+        if (!results) {
+          experiments.ResetExperiment(e);
+          experiments.SetStats(e, {.comment = results.error()});
+          return;
+        }
+        // A validated experiment already does strictly better, so this one
+        // cannot be selected and is not worth validating.
+        const u32 score = VertexCount(tmp);
+        if (bound.cannotWin(score)) {
+          if (!results->comment.empty()) {
+            results->comment += "; ";
+          }
+          results->comment += "not validated: cannot win";
+          experiments.SetStats(e, *results);
+          return;
+        }
+        // If invalid, reset and comment the error
+        rsl::Timer timer;
+        auto ok = validate ? experiments.ValidateExperimentWithBaseline(e)
+                           : Result<void>{};
+        ms_on_validate += timer.elapsed();
+        if (!ok) {
+          experiments.ResetExperiment(e);
+          experiments.SetStats(e, {.comment = ok.error()});
+          return;
+        }
+        bound.offer(score);
+        experiments.SetStats(e, *results);
+      });
     }
-    experiments.SetStats(e, *results);
   }
   std::vector<std::string_view> winners;
   for (Algo e : experiments.CalcWinners()) {
@@ -625,7 +821,7 @@ Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
     fmt::print(stderr,
                "----\n| Compiling {} on thread {}\n{}| Spent {}ms on "
                "validation\n---\n",
-               debug_name, thread_id.str(), table, ms_on_validate);
+               debug_name, thread_id.str(), table, ms_on_validate.load());
   }
   prim = experiments.GetFirstWinner();
   return experiments.GetFirstWinnerAlgo();
@@ -4,6 +4,8 @@
 
 #include <librii/rhst/RHST.hpp>
 
+#include <atomic>
+
 namespace librii::rhst {
 
 struct MeshOptimizerStats {
@@ -21,6 +23,24 @@ struct MeshOptimizerStats {
   std::string comment;
 };
 
+// Lowest validated vertex count among experiments competing for the same
+// primitive. Shared with the ones still running so they can give up once they
+// provably cannot win.
+class ExperimentBound {
+public:
+  u32 get() const { return best_.load(); }
+  void offer(u32 score) {
+    u32 best = best_.load();
+    while (score < best && !best_.compare_exchange_weak(best, score)) {
+    }
+  }
+  // Ties may still win, so only strictly worse results are ruled out.
+  bool cannotWin(u32 lower_bound) const { return lower_bound > get(); }
+
+private:
+  std::atomic<u32> best_{std::numeric_limits<u32>::max()};
+};
+
 // Uses zeux/meshoptimizer
 Result<MeshOptimizerStats>
 StripifyTrianglesMeshOptimizer(MatrixPrimitive& prim);
@@ -41,9 +61,11 @@ Result<MeshOptimizerStats> StripifyTrianglesHaroohie(MatrixPrimitive& prim);
 Result<MeshOptimizerStats> StripifyTrianglesDraco(MatrixPrimitive& prim,
                                                   bool allow_degen);
 
+// Gives up early if |bound| proves the result cannot win.
 Result<MeshOptimizerStats>
 ToFanTriangles(MatrixPrimitive& prim, u32 min_len = 4,
-               size_t max_runs = std::numeric_limits<size_t>::max());
+               size_t max_runs = std::numeric_limits<size_t>::max(),
+               const ExperimentBound* bound = nullptr);
 
 enum class Algo {
   NvTriStrip,
@@ -54,13 +76,18 @@ enum class Algo {
   DracoDegen,
   RiiFans,
 };
-Result<MeshOptimizerStats> StripifyTrianglesAlgo(MatrixPrimitive& prim,
-                                                 Algo algo);
-
-// Brute-force every algorithm
+Result<MeshOptimizerStats>
+StripifyTrianglesAlgo(MatrixPrimitive& prim, Algo algo,
+                      const ExperimentBound* bound = nullptr);
+
+// Brute-force every algorithm. Algorithms run concurrently on
+// `rsl::ThreadPool::Shared()`; the winner does not depend on scheduling.
+//
+// Unless |validate| is false, each candidate is checked to encode the same
+// triangles as |prim| before it may win.
 Result<Algo> StripifyTriangles(MatrixPrimitive& prim,
                                std::optional<Algo> except = std::nullopt,
                                std::string_view debug_name = "?",
-                               bool verbose = true);
+                               bool verbose = true, bool validate = true);
 
 } // namespace librii::rhst
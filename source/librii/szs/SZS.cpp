@@ -7,10 +7,76 @@
 #define SZS_EXPECTED std::expected
 #include <szs/include/szs.h>
 
+#include <array>
+#include <istream>
+
 namespace librii::szs {
 
+// Feeds `in` to `decoder` in fixed chunks; `next_dst` supplies the output span
+// for each call and `on_output` receives what was written to it.
+template <typename NextDst, typename OnOutput>
+static Result<void> pumpStream(std::istream& in, ::szs::StreamDecoder& decoder,
+                               NextDst next_dst, OnOutput on_output) {
+  std::array<u8, 64 * 1024> in_buf;
+  std::span<const u8> pending;
+  while (!decoder.is_done()) {
+    if (pending.empty()) {
+      in.read(reinterpret_cast<char*>(in_buf.data()), in_buf.size());
+      if (in.gcount() <= 0) {
+        return std::unexpected("Truncated source file: the file could not be "
+                               "decompressed fully");
+      }
+      pending = std::span(in_buf).first(static_cast<size_t>(in.gcount()));
+    }
+    std::span<u8> dst = next_dst();
+    auto progress = TRY(decoder.decode(dst, pending));
+    pending = pending.subspan(progress.consumed);
+    TRY(on_output(dst.first(progress.produced)));
+  }
+  return {};
+}
+
+Result<void>
+decodeStream(std::istream& in,
+             std::function<Result<void>(std::span<const u8>)> sink) {
+  ::szs::StreamDecoder decoder;
+  std::vector<u8> out_buf(64 * 1024);
+  return pumpStream(
+      in, decoder, [&] { return std::span(out_buf); },
+      [&](std::span<const u8> chunk) -> Result<void> {
+        if (chunk.empty()) {
+          return {};
+        }
+        return sink(chunk);
+      });
+}
+
+Result<std::vector<u8>> decodeStream(std::istream& in) {
+  ::szs::StreamDecoder decoder;
+  std::vector<u8> result;
+  size_t produced = 0;
+  // Decode straight into the result; it is sized once the header is known.
+  TRY(pumpStream(
+      in, decoder,
+      [&] {
+        if (auto size = decoder.decoded_size(); size && result.empty()) {
+          result.resize(*size);
+        }
+        return std::span(result).subspan(produced);
+      },
+      [&](std::span<const u8> chunk) -> Result<void> {
+        produced += chunk.size();
+        return {};
+      }));
+  return result;
+}
+
 Result<std::vector<u8>> encodeAlgo(std::span<const u8> buf, Algo algo,
-                                   bool yay0) {
+                                   bool yay0, u32 num_threads) {
+  if (algo == Algo::MkwParallel) {
+    auto yaz0 = TRY(::szs::encode_mkw_parallel(buf, num_threads));
+    return yay0 ? ::szs::deinterlace(yaz0) : yaz0;
+  }
   if (yay0) {
     return ::szs::encode_yay0(buf, static_cast<::szs::Algo>(algo));
   }
@@ -37,6 +103,15 @@ Result<void> decode(std::span<u8> dst, std::span<const u8> src, bool yay0) {
   return ::szs::decode_into(dst, src);
 }
 
+Result<std::vector<u8>> buildSeekIndex(std::span<const u8> src, u32 interval) {
+  return ::szs::build_seek_index(src, interval);
+}
+
+Result<void> decodeWithIndex(std::span<u8> dst, std::span<const u8> src,
+                             std::span<const u8> index, u32 num_threads) {
+  return ::szs::decode_with_index_into(dst, src, index, num_threads);
+}
+
 u32 getWorstEncodingSize(std::span<const u8> src) {
   return ::szs::encoded_upper_bound(static_cast<u32>(src.size()));
 }
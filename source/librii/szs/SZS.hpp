@@ -1,6 +1,8 @@
 #pragma once
 
 #include <core/common.h>
+#include <functional>
+#include <iosfwd>
 #include <span>
 #include <vector>
 
@@ -12,6 +14,24 @@ Result<u32> getExpandedSize(std::span<const u8> src);
 Result<void> decode(std::span<u8> dst, std::span<const u8> src,
                     bool yay0 = false);
 
+//! Decode a YAZ0 stream read from `in` without loading the compressed file into
+//! memory. Decoded data is passed to `sink` in chunks as it is produced.
+Result<void>
+decodeStream(std::istream& in,
+             std::function<Result<void>(std::span<const u8>)> sink);
+//! Decode a YAZ0 stream read from `in` into a buffer sized from its header.
+Result<std::vector<u8>> decodeStream(std::istream& in);
+
+//! Build a seek index for a YAZ0 file: checkpoints every `interval` decoded
+//! bytes from which decoding may start. It is stored as a `.idx` sidecar next
+//! to the file, and never changes the decoded data.
+Result<std::vector<u8>> buildSeekIndex(std::span<const u8> src,
+                                       u32 interval = 128 * 1024);
+//! Decode a YAZ0 file across `num_threads` threads (0: all cores), one
+//! checkpoint interval per task. Fails if `index` was not built from `src`.
+Result<void> decodeWithIndex(std::span<u8> dst, std::span<const u8> src,
+                             std::span<const u8> index, u32 num_threads = 0);
+
 u32 getWorstEncodingSize(std::span<const u8> src);
 
 enum class Algo {
@@ -23,9 +43,12 @@ enum class Algo {
   CTLib,
   LibYaz0,
   MK8,
+  MkwParallel,
+  Optimal,
 };
+//! `num_threads` (0 = all cores) applies to `Algo::MkwParallel`.
 Result<std::vector<u8>> encodeAlgo(std::span<const u8> buf, Algo algo,
-                                   bool yay0 = false);
+                                   bool yay0 = false, u32 num_threads = 0);
 
 std::string_view szs_version();
 
@@ -208,4 +208,143 @@ void CalcEnvelopeContribution(glm::mat4& thisMatrix, glm::vec3& thisScale,
   }
 }
 
+// Envelope contribution of a bone and the model matrix it results in.
+static void EvaluateBone(glm::mat4& envelope, glm::vec3& scale, glm::mat4& out,
+                         const librii::math::SRT3& srt, bool ssc,
+                         const glm::mat4& parentMtx,
+                         const glm::vec3& parentScale,
+                         librii::g3d::ScalingRule scalingRule) {
+  envelope = glm::mat4(1.0f);
+  scale = glm::vec3(1.0f, 1.0f, 1.0f);
+  CalcEnvelopeContribution(/*out*/ envelope, /*out*/ scale, srt, ssc,
+                           parentMtx, parentScale, scalingRule);
+  glm::mat4x3 tmp;
+  librii::g3d::Mtx_scale(tmp, envelope, scale);
+  out = tmp;
+}
+
+void BoneMatrixCache::sortTopologically() {
+  const u32 n = static_cast<u32>(mJoints.size());
+  mParent.resize(n);
+  mOrder.clear();
+  mOrder.reserve(n);
+
+  // Children of bone i are children[first[i]..first[i + 1]]
+  std::vector<u32> first(n + 1, 0);
+  std::vector<u32> children(n);
+  for (u32 i = 0; i < n; ++i) {
+    const s32 parent = mJoints[i].parent;
+    mParent[i] = parent >= 0 && static_cast<u32>(parent) < n ? parent : -1;
+    if (mParent[i] >= 0) {
+      ++first[mParent[i] + 1];
+    }
+  }
+  for (u32 i = 0; i < n; ++i) {
+    first[i + 1] += first[i];
+  }
+  {
+    std::vector<u32> cursor(first.begin(), first.end() - 1);
+    for (u32 i = 0; i < n; ++i) {
+      if (mParent[i] >= 0) {
+        children[cursor[mParent[i]]++] = i;
+      }
+    }
+  }
+
+  // Breadth-first, so parents always come before their children
+  std::vector<u8> visited(n, 0);
+  const auto visit = [&](u32 root) {
+    visited[root] = 1;
+    size_t k = mOrder.size();
+    mOrder.push_back(root);
+    for (; k < mOrder.size(); ++k) {
+      const u32 bone = mOrder[k];
+      for (u32 c = first[bone]; c < first[bone + 1]; ++c) {
+        if (!visited[children[c]]) {
+          visited[children[c]] = 1;
+          mOrder.push_back(children[c]);
+        }
+      }
+    }
+  };
+  for (u32 i = 0; i < n; ++i) {
+    if (mParent[i] < 0) {
+      visit(i);
+    }
+  }
+  // Bones on a loop are never reached from a root
+  for (u32 i = 0; i < n; ++i) {
+    if (!visited[i]) {
+      mParent[i] = -1;
+      visit(i);
+    }
+  }
+}
+
+u32 BoneMatrixCache::updateJoints(std::span<const Joint> joints,
+                                  ScalingRule scalingRule) {
+  const size_t n = joints.size();
+  bool topology = n != mJoints.size();
+  for (size_t i = 0; !topology && i < n; ++i) {
+    topology = joints[i].parent != mJoints[i].parent;
+  }
+  const bool all = topology || scalingRule != mScalingRule;
+
+  mDirty.assign(n, all);
+  if (!all) {
+    for (size_t i = 0; i < n; ++i) {
+      mDirty[i] = !(joints[i] == mJoints[i]);
+    }
+  }
+  mJoints.assign(joints.begin(), joints.end());
+  mScalingRule = scalingRule;
+  if (topology) {
+    sortTopologically();
+    mEnvelope.resize(n);
+    mScale.resize(n);
+    mMatrices.resize(n);
+  }
+
+  const glm::mat4 rootMtx(1.0f);
+  const glm::vec3 rootScale(1.0f, 1.0f, 1.0f);
+  u32 count = 0;
+  for (u32 i : mOrder) {
+    const s32 parent = mParent[i];
+    if (parent >= 0 && mDirty[parent]) {
+      mDirty[i] = 1;
+    }
+    if (!mDirty[i]) {
+      continue;
+    }
+    EvaluateBone(mEnvelope[i], mScale[i], mMatrices[i], mJoints[i].srt,
+                 mJoints[i].ssc, parent >= 0 ? mEnvelope[parent] : rootMtx,
+                 parent >= 0 ? mScale[parent] : rootScale, mScalingRule);
+    ++count;
+  }
+  return count;
+}
+
+void BoneMatrixCache::solvePoses(std::span<const librii::math::SRT3> poses,
+                                 std::span<glm::mat4> out) const {
+  const size_t n = mJoints.size();
+  assert(out.size() == poses.size());
+  if (n == 0) {
+    return;
+  }
+  assert(poses.size() % n == 0);
+
+  const glm::mat4 rootMtx(1.0f);
+  const glm::vec3 rootScale(1.0f, 1.0f, 1.0f);
+  std::vector<glm::mat4> envelope(n);
+  std::vector<glm::vec3> scale(n);
+  for (size_t base = 0; base + n <= poses.size(); base += n) {
+    for (u32 i : mOrder) {
+      const s32 parent = mParent[i];
+      EvaluateBone(envelope[i], scale[i], out[base + i], poses[base + i],
+                   mJoints[i].ssc, parent >= 0 ? envelope[parent] : rootMtx,
+                   parent >= 0 ? scale[parent] : rootScale, mScalingRule);
+    }
+  }
+}
+
 } // namespace librii::g3d
@@ -4,6 +4,8 @@
 #include <glm/mat4x3.hpp>
 #include <glm/mat4x4.hpp>
 #include <optional>
+#include <span>
+#include <vector>
 
 #include <librii/g3d/data/ModelData.hpp> // ScalingRule
 #include <librii/math/srt3.hpp>
@@ -40,7 +42,8 @@ void CalcEnvelopeContribution(glm::mat4& thisMatrix, glm::vec3& thisScale,
                               const glm::vec3& parentScale,
                               librii::g3d::ScalingRule scalingRule);
 
-// SLOW IMPLEMENTATION
+// SLOW IMPLEMENTATION: walks the whole parent chain. To compute the matrices
+// of every bone, use BoneMatrixCache.
 inline glm::mat4 calcSrtMtx(const auto& bone, auto&& bones,
                             librii::g3d::ScalingRule scalingRule) {
   std::vector<s32> path;
@@ -80,4 +83,64 @@ inline glm::mat4 calcSrtMtx(const auto& bone, auto&& bones,
   return tmp;
 }
 
+//! Model matrices of every bone of a skeleton.
+//!
+//! Bones are evaluated parents-first, so each envelope contribution is computed
+//! once per pose rather than once per descendant as with calcSrtMtx(). The last
+//! pose is kept: update() only recomputes bones whose SRT or SSC changed, and
+//! their descendants. Results match calcSrtMtx() exactly.
+//!
+//! A loop in the parent chain is broken at its lowest-indexed bone, which is
+//! evaluated as a root.
+class BoneMatrixCache {
+public:
+  struct Joint {
+    librii::math::SRT3 srt;
+    bool ssc = false;
+    s32 parent = -1;
+
+    bool operator==(const Joint&) const = default;
+  };
+
+  //! Brings the matrices up to date with `bones`, any range calcSrtMtx()
+  //! accepts. Returns the number of bones recomputed.
+  u32 update(auto&& bones, ScalingRule scalingRule) {
+    mScratch.clear();
+    for (size_t i = 0; i < std::ranges::size(bones); ++i) {
+      auto& bone = bones[i];
+      mScratch.push_back({getSrt(bone), static_cast<bool>(ssc(bone)),
+                          static_cast<s32>(parentOf(bone))});
+    }
+    return updateJoints(mScratch, scalingRule);
+  }
+  u32 updateJoints(std::span<const Joint> joints, ScalingRule scalingRule);
+
+  //! Model matrix of each bone, as of the last update().
+  std::span<const glm::mat4> matrices() const { return mMatrices; }
+
+  //! Evaluates many poses of the skeleton given to the last update(), e.g.
+  //! the frames of an animation, without disturbing the cached pose.
+  //!
+  //! `poses` holds one SRT per bone for each pose; `out` receives one matrix
+  //! per bone for each pose and must be the same size.
+  void solvePoses(std::span<const librii::math::SRT3> poses,
+                  std::span<glm::mat4> out) const;
+
+private:
+  void sortTopologically();
+
+  ScalingRule mScalingRule = ScalingRule::Standard;
+  std::vector<Joint> mJoints;
+  //! Bone indices, parents before children
+  std::vector<u32> mOrder;
+  //! Parent used for evaluation, or -1 for roots
+  std::vector<s32> mParent;
+  // Per bone: envelope matrix and scale passed on to children
+  std::vector<glm::mat4> mEnvelope;
+  std::vector<glm::vec3> mScale;
+  std::vector<glm::mat4> mMatrices;
+  std::vector<u8> mDirty;
+  std::vector<Joint> mScratch;
+};
+
 } // namespace librii::g3d
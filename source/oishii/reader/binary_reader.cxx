@@ -172,21 +172,39 @@ void BinaryReader::warnAt(const char* msg, uint32_t selectBegin,
 
 BinaryReader::BinaryReader(std::vector<u8>&& view, std::string_view path,
                            std::endian endian)
-    : VectorStream(std::move(view)), m_endian(endian), m_path(path) {}
+    : VectorStream(std::move(view)), m_endian(endian), m_path(path),
+      mView(mBuf) {}
 BinaryReader::BinaryReader(std::span<const u8> view, std::string_view path,
                            std::endian endian)
     : VectorStream(std::vector<u8>{view.begin(), view.end()}), m_endian(endian),
-      m_path(path) {}
+      m_path(path), mView(mBuf) {}
+BinaryReader::BinaryReader(std::unique_ptr<MappedFile> file,
+                           std::string_view path, std::endian endian)
+    : m_endian(endian), m_path(path), mMapped(std::move(file)),
+      mView(mMapped->data()) {}
 BinaryReader::~BinaryReader() = default;
 
+// Moving |mBuf| keeps its allocation, so |mView| stays valid.
 BinaryReader::BinaryReader(BinaryReader&&) = default;
 
 std::expected<BinaryReader, std::string>
 BinaryReader::FromFilePath(std::string_view path, std::endian endian) {
+  if (auto mapped = MappedFile::Open(path)) {
+    return BinaryReader(std::move(*mapped), path, endian);
+  }
+  // Fall back to reading the file, e.g. where mapping is unsupported
   auto vec = TRY(UtilReadFile(path));
   return BinaryReader(std::move(vec), path, endian);
 }
 
+BinaryReader BinaryReader::FromBorrowedSpan(std::span<const u8> view,
+                                            std::string_view path,
+                                            std::endian endian) {
+  BinaryReader reader(std::vector<u8>{}, path, endian);
+  reader.mView = view;
+  return reader;
+}
+
 template <typename T, EndianSelect E = EndianSelect::Current,
           bool unaligned = false>
 std::expected<T, std::string> tryReadImpl(oishii::BinaryReader& reader) {
@@ -13,6 +13,8 @@ extern bool gTestMode;
 
 namespace oishii {
 
+class MappedFile;
+
 class BinaryReader final : public VectorStream {
 public:
   //! Failure type is always `std::string`
@@ -27,9 +29,15 @@ public:
   BinaryReader(BinaryReader&&);
   ~BinaryReader();
 
-  //! Read file from disc
+  //! Read file from disc. The file is memory-mapped where possible rather than
+  //! copied, so it must not be truncated while the reader is alive.
   static Result<BinaryReader> FromFilePath(std::string_view path,
                                            std::endian endian);
+  //! Read a caller-owned buffer without copying it. |view| must outlive the
+  //! reader.
+  static BinaryReader FromBorrowedSpan(std::span<const u8> view,
+                                       std::string_view path,
+                                       std::endian endian);
 
   // The |BinaryReader| keeps track of the files endianness
   std::endian endian() const { return m_endian; }
@@ -39,7 +47,11 @@ public:
   const char* getFile() const noexcept { return m_path.c_str(); }
 
   //! Get a read-only view of the file
-  std::span<const u8> slice() const { return mBuf; }
+  std::span<const u8> slice() const { return mView; }
+
+  // The file may be owned, borrowed or mapped; |mBuf| is only the owned case.
+  uint32_t endpos() const override { return mView.size(); }
+  const uint8_t* getStreamStart() const { return mView.data(); }
 
   //! Pop a value from the stream (of type |T|)
   template <typename T,                             //
@@ -135,7 +147,7 @@ public:
     readerBpCheck(size, addr - tell());
     if constexpr (sizeof(T) == 1) {
       std::vector<T> out(size);
-      std::copy_n(mBuf.begin() + addr, size, out.begin());
+      std::copy_n(mView.begin() + addr, size, out.begin());
       return out;
     }
     std::vector<T> out(size);
@@ -157,9 +169,15 @@ public:
   }
 
 private:
+  BinaryReader(std::unique_ptr<MappedFile> file, std::string_view path,
+               std::endian endian);
+
   std::endian m_endian = std::endian::big;
   std::string m_path = "Unknown Path";
 
+  std::unique_ptr<MappedFile> mMapped;
+  std::span<const u8> mView;
+
   void readerBpCheck(uint32_t size, s32 trans = 0);
 
   struct DispatchStack;
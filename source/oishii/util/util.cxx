@@ -1,6 +1,11 @@
 // Must be included before <bit> it seems
 #ifdef _MSC_VER
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include "util.hxx"
@@ -69,6 +74,86 @@ UtilReadFile(std::string_view path) {
   return vec;
 }
 
+#ifdef _MSC_VER
+std::expected<std::unique_ptr<MappedFile>, std::string>
+MappedFile::Open(std::string_view path) {
+  std::unique_ptr<MappedFile> result(new MappedFile);
+  HANDLE file = CreateFileA(std::string(path).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return std::unexpected("Failed to open file " + std::string(path));
+  }
+  result->mFile = file;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    return std::unexpected("Failed to read file " + std::string(path));
+  }
+  if (size.QuadPart == 0) {
+    // Empty files cannot be mapped
+    return result;
+  }
+  result->mMapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (result->mMapping == nullptr) {
+    return std::unexpected("Failed to map file " + std::string(path));
+  }
+  const void* view = MapViewOfFile(result->mMapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    return std::unexpected("Failed to map file " + std::string(path));
+  }
+  result->mData = {static_cast<const u8*>(view),
+                   static_cast<size_t>(size.QuadPart)};
+  return result;
+}
+
+MappedFile::~MappedFile() {
+  if (!mData.empty()) {
+    UnmapViewOfFile(mData.data());
+  }
+  if (mMapping != nullptr) {
+    CloseHandle(mMapping);
+  }
+  if (mFile != nullptr) {
+    CloseHandle(mFile);
+  }
+}
+#else
+std::expected<std::unique_ptr<MappedFile>, std::string>
+MappedFile::Open(std::string_view path) {
+  std::unique_ptr<MappedFile> result(new MappedFile);
+  int fd = open(std::string(path).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return std::unexpected("Failed to open file " + std::string(path));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return std::unexpected("Failed to read file " + std::string(path));
+  }
+  if (st.st_size == 0) {
+    // Empty files cannot be mapped
+    close(fd);
+    return result;
+  }
+  void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (view == MAP_FAILED) {
+    return std::unexpected("Failed to map file " + std::string(path));
+  }
+  result->mData = {static_cast<const u8*>(view),
+                   static_cast<size_t>(st.st_size)};
+  return result;
+}
+
+MappedFile::~MappedFile() {
+  if (!mData.empty()) {
+    munmap(const_cast<u8*>(mData.data()), mData.size());
+  }
+}
+#endif
+
 void OishiiDefaultFlushFile(std::span<const uint8_t> buf,
                             std::string_view path) {
   auto ok = rsl::WriteFile(buf, path);
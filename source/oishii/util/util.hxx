@@ -55,6 +55,29 @@ struct ScopedFormatter {
 #endif
 
 std::expected<std::vector<u8>, std::string> UtilReadFile(std::string_view path);
+
+//! Read-only memory mapping of a file. Pages come straight from the OS page
+//! cache, so processes mapping the same file share them.
+class MappedFile {
+public:
+  static std::expected<std::unique_ptr<MappedFile>, std::string>
+  Open(std::string_view path);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::span<const u8> data() const { return mData; }
+
+private:
+  MappedFile() = default;
+
+  std::span<const u8> mData;
+#ifdef _MSC_VER
+  void* mFile = nullptr;
+  void* mMapping = nullptr;
+#endif
+};
+
 using FlushFileHandler = void (*)(std::span<const uint8_t> buf,
                                   std::string_view path);
 void SetGlobalFileWriteFunction(FlushFileHandler handler);
@@ -9,6 +9,7 @@
 #include "node.hxx"
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -23,107 +24,113 @@ namespace oishii {
 // Helpers
 class LinkerHelper {
 public:
+  static std::string layoutSymbol(const Linker::LayoutElement& entry) {
+    return entry.mNamespace.empty()
+               ? entry.mNode->getId()
+               : entry.mNamespace + "::" + entry.mNode->getId();
+  }
+
+  static Linker::SymbolIndex buildIndex(const Linker& linker) {
+    Linker::SymbolIndex index;
+    index.layoutSymbols.reserve(linker.mLayout.size());
+    for (const auto& entry : linker.mLayout) {
+      index.layoutSymbols.push_back(layoutSymbol(entry));
+    }
+    // Views into |layoutSymbols| stay valid: it is not resized past here.
+    for (std::size_t i = 0; i < linker.mLayout.size(); ++i) {
+      index.layoutBySymbol.emplace(index.layoutSymbols[i], i);
+      index.layoutByNode.emplace(linker.mLayout[i].mNode.get(), i);
+    }
+    for (std::size_t i = 0; i < linker.mMap.size(); ++i) {
+      index.mapBySymbol.emplace(linker.mMap[i].symbol, i);
+    }
+    return index;
+  }
+
   static const Node* findNamespacedID(const Linker& linker,
+                                      const Linker::SymbolIndex& index,
                                       const std::string& symbol,
                                       const std::string& nameSpace,
                                       const std::string& blockName,
                                       std::string& resultName) {
-    // TODO: This can be optimized, no need to check two constructed strings
+    const auto find = [&](const std::string& nameSpacedSymbol) -> const Node* {
+      auto it = index.layoutBySymbol.find(nameSpacedSymbol);
+      if (it == index.layoutBySymbol.end()) {
+        return nullptr;
+      }
+      resultName = nameSpacedSymbol;
+      return linker.mLayout[it->second].mNode.get();
+    };
 
     // On same level
-    {
-      const std::string nameSpacedSymbol =
-          nameSpace.empty() ? symbol : nameSpace + "::" + symbol;
-      for (const auto& entry : linker.mLayout)
-        if ((entry.mNamespace.empty()
-                 ? entry.mNode->getId()
-                 : entry.mNamespace + "::" + entry.mNode->getId()) ==
-            nameSpacedSymbol) {
-          // if (resultName)
-          resultName = nameSpacedSymbol;
-          return entry.mNode.get();
-        }
+    if (const Node* node =
+            find(nameSpace.empty() ? symbol : nameSpace + "::" + symbol)) {
+      return node;
     }
     // Children
     {
       std::string nameSpacePrefix = nameSpace.empty() ? "" : nameSpace + "::";
-      //	if (hasEnding(nameSpacePrefix, "::::"))
-      //		nameSpacePrefix = nameSpacePrefix.substr(0,
-      // nameSpacePrefix.size() - 2);
-      const std::string nameSpacedSymbol =
-          nameSpacePrefix + (blockName.empty() ? "" : blockName + "::") +
-          symbol;
-      for (const auto& entry : linker.mLayout)
-        if ((entry.mNamespace.empty()
-                 ? entry.mNode->getId()
-                 : entry.mNamespace + "::" + entry.mNode->getId()) ==
-            nameSpacedSymbol) {
-          // if (resultName)
-          resultName = nameSpacedSymbol;
-          return entry.mNode.get();
-        }
+      if (const Node* node =
+              find(nameSpacePrefix + (blockName.empty() ? "" : blockName + "::") +
+                   symbol)) {
+        return node;
+      }
     }
     // Global
-    {
-      for (const auto& entry : linker.mLayout)
-        if ((entry.mNamespace.empty()
-                 ? entry.mNode->getId()
-                 : entry.mNamespace + "::" + entry.mNode->getId()) == symbol) {
-          // if (resultName)
-          resultName = symbol;
-          return entry.mNode.get();
-        }
+    if (const Node* node = find(symbol)) {
+      return node;
     }
     printf("Search for %s failed!\n", symbol.c_str());
     assert(!"Failed critical namespaced symbol lookup in layout");
     return nullptr;
   }
   // TODO: Offset might be better removed
-  static u32 resolveHook(const Linker& linker, const std::string& symbol,
-                         Hook::RelativePosition pos, int offset = 0) {
+  static u32 resolveHook(const Linker& linker, const Linker::SymbolIndex& index,
+                         const std::string& symbol, Hook::RelativePosition pos,
+                         int offset = 0) {
     std::string symbol_ = symbol;
-    // TODO: This can be much more optimized
     if (pos == Hook::RelativePosition::EndOfChildren) {
       if (!symbol_.empty())
         symbol_ += "::";
       symbol_ += "EndOfChildren";
     }
-    for (const auto& entry : linker.mMap) {
-      if (entry.symbol == symbol_) {
-        switch (pos) {
-        case Hook::RelativePosition::Begin:
-        case Hook::RelativePosition::EndOfChildren: // begin of marker node
-        {
-          auto roundDown = [](u32 in, u32 align) -> u32 {
-            return align ? in & ~(align - 1) : in;
-          };
-          auto roundUp = [roundDown](u32 in, u32 align) -> u32 {
-            return align ? roundDown(in + (align - 1), align) : in;
-          };
-          u32 x = entry.begin + offset;
-          // TODO: We don't need to make another pass from the start
-          u32 align = pos == Hook::RelativePosition::Begin
-                          ? entry.restrict.alignment
-                          : std::find_if(linker.mMap.begin(), linker.mMap.end(),
-                                         [symbol](auto& e) {
-                                           return e.symbol == symbol;
-                                         })
-                                ->restrict.alignment;
-          u32 rounded = roundUp(x, align);
-          return rounded;
-        }
-        case Hook::RelativePosition::End:
-          return entry.end + offset;
-        default:
-          printf("Linker Error: Unknown hook type %u -- assuming Begin (no "
-                 "align)\n",
-                 pos);
-          return entry.begin + offset;
-        }
+    auto found = index.mapBySymbol.find(symbol_);
+    if (found == index.mapBySymbol.end()) {
+      printf("Linker Error: Cannot resolve symbol \"%s\"!\n",
+             symbol_.c_str());
+      return 0xcccccccc;
+    }
+    const auto& entry = linker.mMap[found->second];
+    switch (pos) {
+    case Hook::RelativePosition::Begin:
+    case Hook::RelativePosition::EndOfChildren: // begin of marker node
+    {
+      auto roundDown = [](u32 in, u32 align) -> u32 {
+        return align ? in & ~(align - 1) : in;
+      };
+      auto roundUp = [roundDown](u32 in, u32 align) -> u32 {
+        return align ? roundDown(in + (align - 1), align) : in;
+      };
+      u32 x = entry.begin + offset;
+      // The marker is aligned like the block it ends
+      u32 align = entry.restrict.alignment;
+      if (pos == Hook::RelativePosition::EndOfChildren) {
+        auto parent = index.mapBySymbol.find(symbol);
+        align = parent != index.mapBySymbol.end()
+                    ? linker.mMap[parent->second].restrict.alignment
+                    : 0;
       }
+      u32 rounded = roundUp(x, align);
+      return rounded;
+    }
+    case Hook::RelativePosition::End:
+      return entry.end + offset;
+    default:
+      printf("Linker Error: Unknown hook type %u -- assuming Begin (no "
+             "align)\n",
+             pos);
+      return entry.begin + offset;
     }
-    printf("Linker Error: Cannot resolve symbol \"%s\"!\n", symbol_.c_str());
-    return 0xcccccccc;
   }
 };
 
@@ -134,9 +141,22 @@ struct EndOfChildrenMarker : public Node {
   const Node& mParent;
 };
 
-// We call this recursively
+static u64 MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 void Linker::gather(std::unique_ptr<Node> pRoot,
                     const std::string& nameSpace) noexcept {
+  const auto start = std::chrono::steady_clock::now();
+  gatherImpl(std::move(pRoot), nameSpace);
+  mTimings.gather += MicrosecondsSince(start);
+}
+
+// We call this recursively
+void Linker::gatherImpl(std::unique_ptr<Node> pRoot,
+                        const std::string& nameSpace) {
   // Add the node
   auto& root = *mLayout.emplace_back(std::move(pRoot), nameSpace).mNode.get();
 
@@ -145,8 +165,8 @@ void Linker::gather(std::unique_ptr<Node> pRoot,
   assert(result);
 
   for (auto& child : children)
-    gather(std::move(child),
-           (nameSpace.empty() ? "" : (nameSpace + "::")) + root.getId());
+    gatherImpl(std::move(child),
+               (nameSpace.empty() ? "" : (nameSpace + "::")) + root.getId());
 
   if (!(root.getLinkingRestriction().Leaf)) {
     mLayout.emplace_back(std::make_unique<EndOfChildrenMarker>(root),
@@ -168,6 +188,8 @@ Result<void> Linker::write(Writer& writer, bool doShuffle, bool print_linkmap) {
     enforceRestrictions();
   }
 
+  auto start = std::chrono::steady_clock::now();
+
   // Write data
   for (const auto& entry : mLayout) {
     // align
@@ -206,6 +228,8 @@ Result<void> Linker::write(Writer& writer, bool doShuffle, bool print_linkmap) {
     }
   }
 
+  mTimings.write = MicrosecondsSince(start);
+
   if (print_linkmap) {
     printf("Begin    End      Size     Align    Static Leaf  Symbol\n");
     for (const auto& entry : mMap) {
@@ -218,10 +242,13 @@ Result<void> Linker::write(Writer& writer, bool doShuffle, bool print_linkmap) {
   }
 
   // Resolve
+  start = std::chrono::steady_clock::now();
+  const SymbolIndex index = LinkerHelper::buildIndex(*this);
+  mTimings.index = MicrosecondsSince(start);
 
+  start = std::chrono::steady_clock::now();
   // TODO: map::ktpt::...::enpt is map::enpt
   for (const auto& reserve : writer.mLinkReservations) {
-    // todo: make map
     const u32 addr = static_cast<u32>(reserve.addr);
     const Link& link = reserve.mLink;
 
@@ -237,55 +264,43 @@ Result<void> Linker::write(Writer& writer, bool doShuffle, bool print_linkmap) {
     [[maybe_unused]] const Node& from =
         link.from.mBlock
             ? *link.from.mBlock
-            : *LinkerHelper::findNamespacedID(*this, link.from.mId, nameSpace,
-                                              reserve.blockName,
+            : *LinkerHelper::findNamespacedID(*this, index, link.from.mId,
+                                              nameSpace, reserve.blockName,
                                               fromBlockSymbol);
     [[maybe_unused]] const Node& to =
         link.to.mBlock
             ? *link.to.mBlock
-            : *LinkerHelper::findNamespacedID(*this, link.to.mId, nameSpace,
-                                              reserve.blockName, toBlockSymbol);
+            : *LinkerHelper::findNamespacedID(*this, index, link.to.mId,
+                                              nameSpace, reserve.blockName,
+                                              toBlockSymbol);
     // #endif
     //  TODO: Generalize all of these from/to methods
     if (link.from.mBlock) {
-      bool bSuccess = false;
-      for (const auto& entry : mLayout) {
-        if (entry.mNode.get() == link.from.mBlock) {
-          fromBlockSymbol =
-              entry.mNamespace.empty()
-                  ? entry.mNode->getId()
-                  : entry.mNamespace + "::" + entry.mNode->getId();
-          bSuccess = true;
-          break;
-        }
-      }
-      if (!bSuccess)
+      if (auto it = index.layoutByNode.find(link.from.mBlock);
+          it != index.layoutByNode.end()) {
+        fromBlockSymbol = index.layoutSymbols[it->second];
+      } else {
         printf("Linker Error: Block %s was never written to stream, so canot "
                "be resolved.\n",
                link.from.mBlock->getId().c_str());
+      }
     }
     if (link.to.mBlock) {
-      bool bSuccess = false;
-      for (const auto& entry : mLayout) {
-        if (entry.mNode.get() == link.to.mBlock) {
-          toBlockSymbol = entry.mNamespace.empty()
-                              ? entry.mNode->getId()
-                              : entry.mNamespace + "::" + entry.mNode->getId();
-          bSuccess = true;
-          break;
-        }
-      }
-      if (!bSuccess)
+      if (auto it = index.layoutByNode.find(link.to.mBlock);
+          it != index.layoutByNode.end()) {
+        toBlockSymbol = index.layoutSymbols[it->second];
+      } else {
         printf("Linker Error: Block %s was never written to stream, so canot "
                "be resolved.\n",
                link.to.mBlock->getId().c_str());
+      }
     }
     // TODO: Link: EndOfChildren + put that in map + if not all children static
     // and in shuffle, supply random number
     const u32 fromAddr = LinkerHelper::resolveHook(
-        *this, fromBlockSymbol, link.from.mRelation, link.from.mOffset);
+        *this, index, fromBlockSymbol, link.from.mRelation, link.from.mOffset);
     const u32 toAddr = LinkerHelper::resolveHook(
-        *this, toBlockSymbol, link.to.mRelation, link.to.mOffset);
+        *this, index, toBlockSymbol, link.to.mRelation, link.to.mOffset);
 
     writer.seek<Whence::Set>(addr);
 
@@ -309,6 +324,15 @@ Result<void> Linker::write(Writer& writer, bool doShuffle, bool print_linkmap) {
       break;
     }
   }
+  mTimings.resolve = MicrosecondsSince(start);
+
+  if (print_linkmap) {
+    printf("Linker: gather %.3f ms, write %.3f ms, index %.3f ms, resolve "
+           "%.3f ms (%zu links)\n",
+           mTimings.gather / 1000.0, mTimings.write / 1000.0,
+           mTimings.index / 1000.0, mTimings.resolve / 1000.0,
+           writer.mLinkReservations.size());
+  }
 
   return {};
 }
@@ -11,6 +11,9 @@
 #include "hook.hxx"
 #include "node.hxx"
 
+#include <string_view>
+#include <unordered_map>
+
 namespace oishii {
 
 // class Node;
@@ -56,7 +59,28 @@ public:
   using PadFunction = void (*)(char* dst, u32 size);
   PadFunction mUserPad = nullptr;
 
+  //! Wall time of each phase, in microseconds. Printed with the link map.
+  struct Timings {
+    u64 gather = 0;  //!< Collecting nodes into the layout
+    u64 write = 0;   //!< Serializing nodes
+    u64 index = 0;   //!< Building the symbol index
+    u64 resolve = 0; //!< Patching link reservations
+  };
+  Timings mTimings;
+
 private:
+  void gatherImpl(std::unique_ptr<Node> root, const std::string& nameSpace);
+
+  //! Fully-qualified symbols of the layout and the map, hashed once after
+  //! writing so links resolve without scanning either. Where a symbol occurs
+  //! more than once, the first occurrence wins, as with a linear scan.
+  struct SymbolIndex {
+    std::vector<std::string> layoutSymbols;
+    std::unordered_map<std::string_view, std::size_t> layoutBySymbol;
+    std::unordered_map<const Node*, std::size_t> layoutByNode;
+    std::unordered_map<std::string_view, std::size_t> mapBySymbol;
+  };
+
   struct LayoutElement {
     std::unique_ptr<Node> mNode;
     std::string mNamespace;
@@ -11,6 +11,7 @@
 #include <librii/hx/PixMode.hpp>
 #include <librii/hx/TextureFilter.hpp>
 #include <librii/image/CheckerBoard.hpp>
+#include <librii/image/EncodeCache.hpp>
 #include <librii/rhst/RHST.hpp>
 #include <librii/rhst/RHSTOptimizer.hpp>
 
@@ -21,9 +22,11 @@
 #include <plugins/j3d/Scene.hpp>
 
 #include <rsl/FsDialog.hpp>
+#include <rsl/Hash.hpp>
 #include <rsl/Stb.hpp>
+#include <rsl/ThreadPool.hpp>
 
-#include <future>
+#include <mutex>
 
 // XXX: Hack, though we'll refactor all of this way soon
 std::string rebuild_dest;
@@ -952,46 +955,57 @@ static inline std::string getFileShort(const std::string& path) {
   return tmp;
 }
 Result<void> importTextureImpl(libcube::Texture& data, std::span<u8> image,
-                               std::vector<u8>& scratch, int num_mip, int width,
-                               int height, int source_w, int source_h,
-                               librii::gx::TextureFormat fmt,
-                               librii::image::ResizingAlgorithm resize) {
+                               int num_mip, int width, int height, int source_w,
+                               int source_h, librii::gx::TextureFormat fmt,
+                               librii::image::ResizingAlgorithm resize,
+                               librii::image::MipFilter filter,
+                               const librii::image::EncodeOptions& options) {
   data.setTextureFormat(fmt);
   data.setWidth(width);
   data.setHeight(height);
   data.setMipmapCount(num_mip);
   data.setLod(false, 0.0f, static_cast<f32>(data.getImageCount()));
   data.resizeData();
-  if (num_mip == 0) {
-    std::vector<u8> scratch(4 * width * height);
-    librii::image::resize(scratch, width, height, image, source_w, source_h,
-                          resize);
-    TRY(data.encode(scratch));
-  } else {
-    rsl::trace("Width: {}, Height: {}.", width, height);
-    u32 size = 0;
-    for (int i = 0; i <= num_mip; ++i) {
-      size += (width >> i) * (height >> i) * 4;
-      rsl::trace("Image {}: {}, {}. -> Total Size: {}", i, width >> i,
-                 height >> i, size);
-    }
-    scratch.resize(size);
-
-    u32 slide = 0;
-    for (int i = 0; i <= num_mip; ++i) {
-      librii::image::resize(std::span(scratch).subspan(slide), width >> i,
-                            height >> i, image, source_w, source_h, resize);
-      slide += (width >> i) * (height >> i) * 4;
+  rsl::trace("Width: {}, Height: {}, Mips: {}.", width, height, num_mip);
+  // Raw chains are intermediates (e.g. before palette quantization).
+  auto* cache = fmt != librii::gx::TextureFormat::Extension_RawRGBA32
+                    ? librii::image::EncodeCache::Shared()
+                    : nullptr;
+  librii::image::EncodeCacheKey key;
+  if (cache != nullptr) {
+    EXPECT(image.size() >= static_cast<size_t>(source_w) * source_h * 4);
+    key = {
+        .source_hash = rsl::xxh64(image.subspan(0, source_w * source_h * 4)),
+        .source_width = static_cast<u32>(source_w),
+        .source_height = static_cast<u32>(source_h),
+        .width = static_cast<u32>(width),
+        .height = static_cast<u32>(height),
+        .format = static_cast<u32>(fmt),
+        .mip_count = static_cast<u32>(num_mip),
+        .algorithm = static_cast<u32>(resize),
+        .filter = static_cast<u32>(filter),
+        .high_quality = options.cmpr_high_quality,
+    };
+    auto cached = cache->find(key);
+    if (cached && cached->size() == data.getData().size()) {
+      memcpy(data.getData().data(), cached->data(), cached->size());
+      return {};
     }
-
-    TRY(data.encode(scratch));
+  }
+  // Levels are encoded straight into the texture as they are produced.
+  TRY(librii::image::generateMipChain(data.getData(), width, height, fmt,
+                                      num_mip, image, source_w, source_h,
+                                      resize, filter, options));
+  if (cache != nullptr) {
+    cache->store(key, data.getData());
   }
   return {};
 }
 Result<void> importTexture(libcube::Texture& data, std::span<u8> image,
-                           std::vector<u8>& scratch, bool mip_gen, int min_dim,
-                           int max_mip, int width, int height, int channels,
-                           librii::gx::TextureFormat format) {
+                           bool mip_gen, int min_dim, int max_mip, int width,
+                           int height, int channels,
+                           librii::gx::TextureFormat format,
+                           const librii::image::EncodeOptions& options) {
   if (image.empty()) {
     return std::unexpected(
         "STB failed to parse image. Unsupported file format?");
@@ -1012,22 +1026,24 @@ Result<void> importTexture(libcube::Texture& data, std::span<u8> image,
       ++num_mip;
   }
 
-  return importTextureImpl(data, image, scratch, num_mip, width, height, width,
-                           height, format);
+  return importTextureImpl(data, image, num_mip, width, height, width, height,
+                           format, librii::image::ResizingAlgorithm::Lanczos,
+                           librii::image::MipFilter::Box, options);
 }
 
-Result<void> importTextureFromMemory(libcube::Texture& data,
-                                     std::span<const u8> span,
-                                     std::vector<u8>& scratch, bool mip_gen,
-                                     int min_dim, int max_mip) {
+Result<void>
+importTextureFromMemory(libcube::Texture& data, std::span<const u8> span,
+                        bool mip_gen, int min_dim, int max_mip,
+                        const librii::image::EncodeOptions& options) {
   auto image = TRY(rsl::stb::load_from_memory(span));
-  return importTexture(data, image.data, scratch, mip_gen, min_dim, max_mip,
-                       image.width, image.height, image.channels);
+  return importTexture(data, image.data, mip_gen, min_dim, max_mip,
+                       image.width, image.height, image.channels,
+                       librii::gx::TextureFormat::CMPR, options);
 }
-Result<void> importTextureFromFile(libcube::Texture& data,
-                                   std::string_view path,
-                                   std::vector<u8>& scratch, bool mip_gen,
-                                   int min_dim, int max_mip) {
+Result<void>
+importTextureFromFile(libcube::Texture& data, std::string_view path,
+                      bool mip_gen, int min_dim, int max_mip,
+                      const librii::image::EncodeOptions& options) {
   if (path.ends_with(".tex0")) {
     auto obuf = ReadFile(path);
     if (!obuf) {
@@ -1046,15 +1062,15 @@ Result<void> importTextureFromFile(libcube::Texture& data,
     return {};
   }
   auto image = TRY(rsl::stb::load(path));
-  return importTexture(data, image.data, scratch, mip_gen, min_dim, max_mip,
-                       image.width, image.height, image.channels);
+  return importTexture(data, image.data, mip_gen, min_dim, max_mip,
+                       image.width, image.height, image.channels,
+                       librii::gx::TextureFormat::CMPR, options);
 }
 
 void import_texture(std::string tex, libcube::Texture* pdata,
-                    std::filesystem::path file_path,
-                    std::optional<MipGen> mips) {
+                    std::filesystem::path file_path, std::optional<MipGen> mips,
+                    const librii::image::EncodeOptions& options) {
   libcube::Texture& data = *pdata;
-  std::vector<u8> scratch;
   bool mip_gen = mips.has_value();
   u32 min_dim = mips ? mips->min_dim : 0;
   u32 max_mip = mips ? mips->max_mip : 0;
@@ -1068,8 +1084,8 @@ void import_texture(std::string tex, libcube::Texture* pdata,
   search_paths.push_back(file_path.parent_path() / "textures" / (tex + ".png"));
 
   for (const auto& path : search_paths) {
-    if (importTextureFromFile(data, path.string().c_str(), scratch, mip_gen,
-                              min_dim, max_mip)) {
+    if (importTextureFromFile(data, path.string().c_str(), mip_gen, min_dim,
+                              max_mip, options)) {
       return;
     }
   }
@@ -1080,7 +1096,7 @@ void import_texture(std::string tex, libcube::Texture* pdata,
   const auto dummy_height = 32;
   data.setWidth(dummy_width);
   data.setHeight(dummy_height);
-  scratch.resize(dummy_width * dummy_height * 4);
+  std::vector<u8> scratch(dummy_width * dummy_height * 4);
   // Make a basic checkerboard
   librii::image::generateCheckerboard(scratch, dummy_width, dummy_height);
   data.setMipmapCount(0);
@@ -1093,7 +1109,22 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
                  std::string path,
                  std::function<void(std::string, std::string)> info,
                  std::function<void(std::string_view, float)> progress,
-                 std::optional<MipGen> mips, bool tristrip, bool verbose) {
+                 std::optional<MipGen> mips, bool tristrip, bool verbose,
+                 bool validate, rsl::StageTimer* stages,
+                 const librii::image::EncodeOptions& texture_options) {
+  rsl::StageTimer local_stages;
+  if (stages == nullptr) {
+    stages = &local_stages;
+  }
+  // Callers need not make |progress| thread-safe. Workers skip an update
+  // rather than queue up behind the one being drawn.
+  std::mutex progress_mutex;
+  auto try_progress = [&](std::string_view status, float percent) {
+    if (std::unique_lock g(progress_mutex, std::try_to_lock); g) {
+      progress(status, percent);
+    }
+  };
+
   std::map<std::string, std::string /*path_hint (OPTIONAL)*/> textures_needed;
 
   for (auto& mat : rhst.materials) {
@@ -1138,14 +1169,30 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
     data.setName(getFileShort(tex.first));
   }
 
-  std::vector<std::future<void>> futures;
-
-  for (int i = 0; i < scene.getTextures().size(); ++i) {
-    libcube::Texture* data = &scene.getTextures()[i];
-    std::filesystem::path file_path = textures_needed[data->getName()];
-    futures.push_back(std::async(std::launch::async, [=] {
-      import_texture(data->getName(), data, file_path, mips);
-    }));
+  // Textures are decoded and encoded in the background while meshes are
+  // optimized.
+  auto& texture_stage = stages->begin("Import textures");
+  std::atomic<size_t> textures_left = scene.getTextures().size();
+  if (textures_left == 0) {
+    rsl::StageTimer::end(texture_stage);
+  }
+  rsl::TaskGroup texture_tasks;
+  // Textures already run concurrently on the pool, so each encodes on one
+  // thread rather than starting its own.
+  auto encode_options = texture_options;
+  encode_options.num_threads = 1;
+  {
+    rsl::StageTimer::Charge charge(&texture_stage);
+    for (int i = 0; i < scene.getTextures().size(); ++i) {
+      libcube::Texture* data = &scene.getTextures()[i];
+      std::filesystem::path file_path = textures_needed[data->getName()];
+      texture_tasks.run([=, &textures_left, &texture_stage] {
+        import_texture(data->getName(), data, file_path, mips, encode_options);
+        if (--textures_left == 0) {
+          rsl::StageTimer::end(texture_stage);
+        }
+      });
+    }
   }
 
   // Optimize meshes
@@ -1155,7 +1202,8 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
     int total = rhst.meshes.size();
     progress(std::format("Optimizing meshes ({} / {})", 0, total), 0.0f);
 
-    rsl::Timer timer;
+    rsl::StageTimer::Scope stage(*stages, "Stripify");
+    rsl::TaskGroup mesh_tasks;
     for (auto& mesh : rhst.meshes) {
       auto task = [&](librii::rhst::Mesh* mesh) {
         assert(mesh != nullptr);
@@ -1166,27 +1214,26 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
               mesh->matrix_primitives.size() > 1
                   ? std::format("{}::{}", mesh->name, i)
                   : mesh->name,
-              verbose);
+              verbose, validate);
           ++i;
           if (!ok) {
             rsl::error("Error: Failed to stripify mesh {}. {}", mesh->name,
                        ok.error());
           }
         }
-        ++so_far;
-        int x = static_cast<int>(so_far);
-        progress(std::format("Optimizing meshes ({} / {})", x, total),
-                 static_cast<float>(x) / static_cast<float>(total));
+        int x = ++so_far;
+        try_progress(std::format("Optimizing meshes ({} / {})", x, total),
+                     static_cast<float>(x) / static_cast<float>(total));
       };
-      futures.push_back(std::async(std::launch::async, std::bind(task, &mesh)));
+      mesh_tasks.run(std::bind(task, &mesh));
     }
-
-    futures.clear();
-    rsl::error("Elapsed stripping time (multicore) (or texture import time if "
-               "greater): {}ms",
-               timer.elapsed());
+    mesh_tasks.wait();
+    stage.stop();
+    progress(std::format("Optimizing meshes ({} / {})", total, total), 1.0f);
   }
+  texture_tasks.wait();
 
+  rsl::StageTimer::Scope compile_stage(*stages, "Compile meshes");
   progress(std::format("Compiling meshes {}/{}", 0, rhst.meshes.size()), 0.0f);
   for (auto&& [i, mesh] : rsl::enumerate(rhst.meshes)) {
     progress(std::format("Compiling meshes {}/{}", i, rhst.meshes.size()),
@@ -1290,6 +1337,8 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
     }
   }
 
+  compile_stage.stop();
+  rsl::StageTimer::Scope preset_stage(*stages, "Apply presets");
   progress("Applying material presets", 0.0f);
   // Handle material presets
   if (auto* gmdl = dynamic_cast<g3d::Model*>(&mdl); gmdl != nullptr) {
@@ -1352,7 +1401,11 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, libcube::Scene& scene,
               gscn->getTextures().size() - n, rsl::join(unused_names, ","));
     gscn->getTextures().resize(n);
   }
+  preset_stage.stop();
 
+  if (stages == &local_stages) {
+    rsl::info("RHST compile times:\n{}", local_stages.report());
+  }
   return true;
 }
 
@@ -1360,7 +1413,9 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, librii::g3d::Archive& scene,
                  std::string path,
                  std::function<void(std::string, std::string)> info,
                  std::function<void(std::string_view, float)> progress,
-                 std::optional<MipGen> mips, bool tristrip, bool verbose) {
+                 std::optional<MipGen> mips, bool tristrip, bool verbose,
+                 bool validate, rsl::StageTimer* stages,
+                 const librii::image::EncodeOptions& texture_options) {
   riistudio::g3d::Collection interface_g3d;
   auto ok = riistudio::g3d::ReadBRRES(interface_g3d, scene, "todo_path");
   if (!ok) {
@@ -1368,7 +1423,7 @@ bool CompileRHST(librii::rhst::SceneTree& rhst, librii::g3d::Archive& scene,
   }
 
   if (!CompileRHST(rhst, interface_g3d, path, info, progress, mips, tristrip,
-                   verbose)) {
+                   verbose, validate, stages, texture_options)) {
     return false;
   }
 
@@ -6,47 +6,57 @@
 #include <librii/rhst/RHST.hpp>
 #include <plugins/gc/Export/Scene.hpp>
 #include <plugins/gc/Export/Texture.hpp>
+#include <rsl/StageTimer.hpp>
 
 namespace riistudio::rhst {
 
 [[nodiscard]] Result<void>
-importTextureImpl(libcube::Texture& data, std::span<u8> image,
-                  std::vector<u8>& scratch, int num_mip, int width, int height,
-                  int first_w, int first_h, librii::gx::TextureFormat fmt,
+importTextureImpl(libcube::Texture& data, std::span<u8> image, int num_mip,
+                  int width, int height, int first_w, int first_h,
+                  librii::gx::TextureFormat fmt,
                   librii::image::ResizingAlgorithm resize =
-                      librii::image::ResizingAlgorithm::Lanczos);
+                      librii::image::ResizingAlgorithm::Lanczos,
+                  librii::image::MipFilter filter =
+                      librii::image::MipFilter::Box,
+                  const librii::image::EncodeOptions& options = {});
 
 [[nodiscard]] Result<void> importTexture(
-    libcube::Texture& data, std::span<u8> image, std::vector<u8>& scratch,
-    bool mip_gen, int min_dim, int max_mip, int width, int height, int channels,
-    librii::gx::TextureFormat format = librii::gx::TextureFormat::CMPR);
-[[nodiscard]] Result<void> importTextureFromMemory(libcube::Texture& data,
-                                                   std::span<const u8> span,
-                                                   std::vector<u8>& scratch,
-                                                   bool mip_gen, int min_dim,
-                                                   int max_mip);
-[[nodiscard]] Result<void> importTextureFromFile(libcube::Texture& data,
-                                                 std::string_view path,
-                                                 std::vector<u8>& scratch,
-                                                 bool mip_gen, int min_dim,
-                                                 int max_mip);
+    libcube::Texture& data, std::span<u8> image, bool mip_gen, int min_dim,
+    int max_mip, int width, int height, int channels,
+    librii::gx::TextureFormat format = librii::gx::TextureFormat::CMPR,
+    const librii::image::EncodeOptions& options = {});
+[[nodiscard]] Result<void>
+importTextureFromMemory(libcube::Texture& data, std::span<const u8> span,
+                        bool mip_gen, int min_dim, int max_mip,
+                        const librii::image::EncodeOptions& options = {});
+[[nodiscard]] Result<void>
+importTextureFromFile(libcube::Texture& data, std::string_view path,
+                      bool mip_gen, int min_dim, int max_mip,
+                      const librii::image::EncodeOptions& options = {});
 
 struct MipGen {
   u32 min_dim = 32;
   u32 max_mip = 5;
 };
+// Textures and meshes are processed on `rsl::ThreadPool::Shared()`. Stage
+// timings are added to |stages| if given. |validate| is passed on to
+// `librii::rhst::StripifyTriangles`.
 [[nodiscard]] bool CompileRHST(
     librii::rhst::SceneTree& rhst, libcube::Scene& scene, std::string path,
     std::function<void(std::string, std::string)> info,
     std::function<void(std::string_view, float)> progress,
-    std::optional<MipGen> mips = {}, bool tristrip = true, bool verbose = true);
+    std::optional<MipGen> mips = {}, bool tristrip = true, bool verbose = true,
+    bool validate = true, rsl::StageTimer* stages = nullptr,
+    const librii::image::EncodeOptions& texture_options = {});
 
 bool CompileRHST(librii::rhst::SceneTree& rhst, librii::g3d::Archive& scene,
                  std::string path,
                  std::function<void(std::string, std::string)> info,
                  std::function<void(std::string_view, float)> progress,
                  std::optional<MipGen> mips = {}, bool tristrip = true,
-                 bool verbose = true);
+                 bool verbose = true, bool validate = true,
+                 rsl::StageTimer* stages = nullptr,
+                 const librii::image::EncodeOptions& texture_options = {});
 
 [[nodiscard]] Result<librii::rhst::Mesh>
 decompileMesh(const libcube::IndexedPolygon& src, const libcube::Model& mdl);
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <core/common.h>
+
+#include <bit>
+#include <cstring>
+
+namespace rsl {
+
+namespace detail {
+
+static constexpr u64 xxh_prime1 = 0x9E3779B185EBCA87ull;
+static constexpr u64 xxh_prime2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr u64 xxh_prime3 = 0x165667B19E3779F9ull;
+static constexpr u64 xxh_prime4 = 0x85EBCA77C2B2AE63ull;
+static constexpr u64 xxh_prime5 = 0x27D4EB2F165667C5ull;
+
+inline u64 xxh_read64(const u8* p) {
+  u64 v;
+  std::memcpy(&v, p, sizeof(v));
+  if constexpr (std::endian::native == std::endian::big) {
+    v = std::byteswap(v);
+  }
+  return v;
+}
+inline u32 xxh_read32(const u8* p) {
+  u32 v;
+  std::memcpy(&v, p, sizeof(v));
+  if constexpr (std::endian::native == std::endian::big) {
+    v = std::byteswap(v);
+  }
+  return v;
+}
+inline u64 xxh_round(u64 acc, u64 input) {
+  acc += input * xxh_prime2;
+  acc = std::rotl(acc, 31);
+  return acc * xxh_prime1;
+}
+inline u64 xxh_merge(u64 acc, u64 val) {
+  acc ^= xxh_round(0, val);
+  return acc * xxh_prime1 + xxh_prime4;
+}
+
+} // namespace detail
+
+//! XXH64 of `data`. Fast and well distributed; not cryptographic.
+inline u64 xxh64(std::span<const u8> data, u64 seed = 0) {
+  using namespace detail;
+  const u8* p = data.data();
+  const u8* const end = p + data.size();
+  u64 h;
+  if (data.size() >= 32) {
+    u64 v1 = seed + xxh_prime1 + xxh_prime2;
+    u64 v2 = seed + xxh_prime2;
+    u64 v3 = seed;
+    u64 v4 = seed - xxh_prime1;
+    for (; p + 32 <= end; p += 32) {
+      v1 = xxh_round(v1, xxh_read64(p));
+      v2 = xxh_round(v2, xxh_read64(p + 8));
+      v3 = xxh_round(v3, xxh_read64(p + 16));
+      v4 = xxh_round(v4, xxh_read64(p + 24));
+    }
+    h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+        std::rotl(v4, 18);
+    h = xxh_merge(h, v1);
+    h = xxh_merge(h, v2);
+    h = xxh_merge(h, v3);
+    h = xxh_merge(h, v4);
+  } else {
+    h = seed + xxh_prime5;
+  }
+  h += data.size();
+  for (; p + 8 <= end; p += 8) {
+    h ^= xxh_round(0, xxh_read64(p));
+    h = std::rotl(h, 27) * xxh_prime1 + xxh_prime4;
+  }
+  if (p + 4 <= end) {
+    h ^= u64{xxh_read32(p)} * xxh_prime1;
+    h = std::rotl(h, 23) * xxh_prime2 + xxh_prime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= *p * xxh_prime5;
+    h = std::rotl(h, 11) * xxh_prime1;
+  }
+  h ^= h >> 33;
+  h *= xxh_prime2;
+  h ^= h >> 29;
+  h *= xxh_prime3;
+  h ^= h >> 32;
+  return h;
+}
+
+} // namespace rsl
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include <rsl/ThreadPool.hpp>
+
+namespace rsl {
+
+//! Number of worker threads to use for a request of `num_threads` (0 = all
+//! cores). Always 1 on platforms without threads.
+inline unsigned ResolveThreadCount(unsigned num_threads) {
+#ifdef __EMSCRIPTEN__
+  return 1;
+#else
+  if (num_threads != 0) {
+    return num_threads;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+#endif
+}
+
+//! Runs `f(0) .. f(count - 1)` on up to `num_threads` threads of the shared
+//! pool (0 = the whole pool), including the caller. Items are handed out one at
+//! a time, so uneven work balances itself.
+template <typename F>
+void ParallelFor(size_t count, unsigned num_threads, F&& f) {
+  ThreadPool& pool = ThreadPool::Shared();
+  const unsigned limit = num_threads != 0
+                             ? std::min(num_threads, pool.threadCount())
+                             : pool.threadCount();
+  const size_t n = std::min<size_t>(limit, count);
+  std::atomic<size_t> next = 0;
+  auto drain = [&] {
+    for (size_t i; (i = next.fetch_add(1)) < count;) {
+      f(i);
+    }
+  };
+  TaskGroup group(pool);
+  for (size_t t = 1; t < n; ++t) {
+    group.run(drain);
+  }
+  drain();
+  group.wait();
+}
+
+} // namespace rsl
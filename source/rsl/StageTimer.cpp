@@ -0,0 +1,81 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "StageTimer.hpp"
+
+#include <format>
+
+namespace rsl {
+
+u64 ThreadCpuMicroseconds() {
+#if defined(_WIN32)
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  auto to_u64 = [](const FILETIME& t) {
+    return (static_cast<u64>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+  };
+  // 100ns units
+  return (to_u64(kernel) + to_u64(user)) / 10;
+#elif defined(__EMSCRIPTEN__)
+  // Single-threaded: CPU time is wall time.
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#else
+  timespec ts{};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return 0;
+  }
+  return static_cast<u64>(ts.tv_sec) * 1'000'000 +
+         static_cast<u64>(ts.tv_nsec) / 1'000;
+#endif
+}
+
+// The stage charged by this thread, and the CPU time it started at.
+static thread_local StageTimer::Stage* tStage = nullptr;
+static thread_local u64 tStageStart = 0;
+
+// Bills the running charge up to now and switches to |stage|.
+static void SwitchStage(StageTimer::Stage* stage) {
+  const u64 now = ThreadCpuMicroseconds();
+  if (tStage != nullptr) {
+    tStage->cpu_us += now - tStageStart;
+  }
+  tStage = stage;
+  tStageStart = now;
+}
+
+StageTimer::Charge::Charge(Stage* stage) : mPrevious(tStage) {
+  SwitchStage(stage);
+}
+StageTimer::Charge::~Charge() { SwitchStage(mPrevious); }
+
+StageTimer::Stage* StageTimer::Current() { return tStage; }
+
+std::string StageTimer::report() const {
+  size_t width = 0;
+  for (auto& stage : mStages) {
+    if (stage.name.size() > width) {
+      width = stage.name.size();
+    }
+  }
+  std::string result;
+  for (auto& stage : mStages) {
+    const u64 cpu_ms = stage.cpu_us.load() / 1'000;
+    result += std::format("{:<{}}  {:>7}ms wall  {:>7}ms CPU", stage.name,
+                          width, stage.wall_ms, cpu_ms);
+    if (stage.wall_ms != 0) {
+      result += std::format(" ({:.1f}x)", static_cast<double>(cpu_ms) /
+                                              static_cast<double>(stage.wall_ms));
+    }
+    result += '\n';
+  }
+  return result;
+}
+
+} // namespace rsl
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <core/common.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <string>
+
+namespace rsl {
+
+//! CPU time consumed by the calling thread so far, in microseconds.
+u64 ThreadCpuMicroseconds();
+
+//! Wall and CPU time of the named stages of a pipeline.
+//!
+//! CPU time is charged per thread by the code doing the work, so stages that
+//! overlap (or share a thread pool) are still accounted separately.
+class StageTimer {
+public:
+  struct Stage {
+    std::string name;
+    std::chrono::steady_clock::time_point start{};
+    u32 wall_ms = 0;
+    std::atomic<u64> cpu_us = 0;
+  };
+
+  //! Starts the wall clock of a new stage.
+  Stage& begin(std::string name) {
+    auto& stage = mStages.emplace_back();
+    stage.name = std::move(name);
+    stage.start = std::chrono::steady_clock::now();
+    return stage;
+  }
+  //! Stops the wall clock of `stage`.
+  static void end(Stage& stage) {
+    stage.wall_ms = static_cast<u32>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - stage.start)
+            .count());
+  }
+
+  //! Charges the calling thread's CPU time to `stage` (may be null) until
+  //! destroyed, pausing the enclosing charge. `rsl::TaskGroup` tasks carry the
+  //! stage they were submitted under, so work fanned out to a thread pool is
+  //! charged to the right stage too.
+  class Charge {
+  public:
+    explicit Charge(Stage* stage);
+    ~Charge();
+
+    Charge(const Charge&) = delete;
+    Charge& operator=(const Charge&) = delete;
+
+  private:
+    Stage* mPrevious;
+  };
+  //! The stage the calling thread is currently charging, if any.
+  static Stage* Current();
+
+  //! Times a stage from construction until `stop()` or destruction. Charges
+  //! the calling thread meanwhile.
+  class Scope {
+  public:
+    Scope(StageTimer& timer, std::string name)
+        : mStage(&timer.begin(std::move(name))) {
+      mCharge.emplace(mStage);
+    }
+    ~Scope() { stop(); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    void stop() {
+      if (mCharge) {
+        mCharge.reset();
+        end(*mStage);
+      }
+    }
+
+  private:
+    Stage* mStage;
+    std::optional<Charge> mCharge;
+  };
+
+  //! One line per stage, e.g. "Stripify  1520ms wall  5890ms CPU (3.9x)".
+  std::string report() const;
+
+private:
+  // Deque: stages are referenced while later ones are added.
+  std::deque<Stage> mStages;
+};
+
+} // namespace rsl
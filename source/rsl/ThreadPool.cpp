@@ -0,0 +1,126 @@
+#include "ThreadPool.hpp"
+
+#include <rsl/ParallelFor.hpp>
+
+#include <algorithm>
+
+namespace rsl {
+
+// Identifies the pool (and the deque within it) owned by the current thread.
+static thread_local ThreadPool* tPool = nullptr;
+static thread_local size_t tQueue = 0;
+
+static std::atomic<unsigned> sSharedThreadCount = 0;
+
+ThreadPool::ThreadPool(unsigned num_threads) {
+  const unsigned workers = ResolveThreadCount(num_threads) - 1;
+  mQueues.push_back(std::make_unique<Queue>());
+  for (unsigned i = 0; i < workers; ++i) {
+    mQueues.push_back(std::make_unique<Queue>());
+  }
+  for (unsigned i = 0; i < workers; ++i) {
+    mWorkers.emplace_back([this, i] { workerMain(i + 1); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock g(mSleepMutex);
+    mStop = true;
+  }
+  mWake.notify_all();
+  for (auto& worker : mWorkers) {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::Shared() {
+  static ThreadPool pool(sSharedThreadCount.load());
+  return pool;
+}
+void ThreadPool::SetSharedThreadCount(unsigned num_threads) {
+  sSharedThreadCount = num_threads;
+}
+
+void ThreadPool::push(Task&& task) {
+  const size_t index = tPool == this ? tQueue : 0;
+  mQueued.fetch_add(1);
+  {
+    auto& queue = *mQueues[index];
+    std::unique_lock g(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  notifyAll();
+}
+
+bool ThreadPool::tryRunOne(TaskGroup* group) {
+  if (group != nullptr ? group->mQueued.load() == 0 : mQueued.load() == 0) {
+    return false;
+  }
+  auto matches = [&](const Task& task) {
+    return group == nullptr || task.group == group;
+  };
+  Task task;
+  // Newest local work first: it is most likely to be hot in cache.
+  if (tPool == this && tQueue != 0) {
+    auto& queue = *mQueues[tQueue];
+    std::unique_lock g(queue.mutex);
+    auto it = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), matches);
+    if (it != queue.tasks.rend()) {
+      task = std::move(*it);
+      queue.tasks.erase(std::next(it).base());
+    }
+  }
+  // Otherwise the oldest work anywhere else, which tends to be the largest.
+  for (size_t i = 0; !task.fn && i < mQueues.size(); ++i) {
+    auto& queue = *mQueues[i];
+    std::unique_lock g(queue.mutex);
+    auto it = std::find_if(queue.tasks.begin(), queue.tasks.end(), matches);
+    if (it != queue.tasks.end()) {
+      task = std::move(*it);
+      queue.tasks.erase(it);
+    }
+  }
+  if (!task.fn) {
+    return false;
+  }
+  mQueued.fetch_sub(1);
+  task.group->mQueued.fetch_sub(1);
+  task.fn();
+  return true;
+}
+
+void ThreadPool::notifyAll() {
+  // Taking the lock orders this against a sleeper's predicate check.
+  { std::unique_lock g(mSleepMutex); }
+  mWake.notify_all();
+}
+
+void ThreadPool::waitFor(TaskGroup& group) {
+  while (group.mPending.load() != 0) {
+    if (tryRunOne(&group)) {
+      continue;
+    }
+    std::unique_lock g(mSleepMutex);
+    mWake.wait(g, [&] {
+      return group.mPending.load() == 0 || group.mQueued.load() != 0;
+    });
+  }
+}
+
+void ThreadPool::workerMain(size_t queue) {
+  tPool = this;
+  tQueue = queue;
+  while (true) {
+    if (tryRunOne()) {
+      continue;
+    }
+    std::unique_lock g(mSleepMutex);
+    mWake.wait(g, [&] { return mStop || mQueued.load() != 0; });
+    if (mStop && mQueued.load() == 0) {
+      return;
+    }
+  }
+}
+
+} // namespace rsl
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <rsl/StageTimer.hpp>
+
+namespace rsl {
+
+//! Fixed-size work-stealing pool. Each worker owns a deque: it pushes and pops
+//! its own work at the back and steals from the front of the others. Work
+//! submitted from outside the pool goes to a shared injection queue.
+//!
+//! Threads blocked in `TaskGroup::wait` run that group's own queued tasks in
+//! the meantime, so tasks may spawn and wait on nested groups without
+//! deadlocking. They never pick up unrelated work, which would nest without
+//! bound and could reenter the waiting task's thread-local state.
+class TaskGroup;
+class ThreadPool {
+public:
+  //! `num_threads` counts the thread that waits on the pool, so 1 spawns no
+  //! workers and runs everything inline during `TaskGroup::wait` (0 = all
+  //! cores).
+  explicit ThreadPool(unsigned num_threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned threadCount() const {
+    return static_cast<unsigned>(mWorkers.size()) + 1;
+  }
+
+  //! Process-wide pool, created on first use.
+  static ThreadPool& Shared();
+  //! Sizes `Shared()`. Only has an effect before its first use.
+  static void SetSharedThreadCount(unsigned num_threads);
+
+private:
+  friend class TaskGroup;
+
+  struct Task {
+    std::function<void()> fn;
+    TaskGroup* group = nullptr;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void push(Task&& task);
+  //! Runs one queued task, if any. Only tasks of `group` when it is set.
+  bool tryRunOne(TaskGroup* group = nullptr);
+  void notifyAll();
+  void waitFor(TaskGroup& group);
+  void workerMain(size_t queue);
+
+  //! [0] is the injection queue, [i + 1] belongs to worker i.
+  std::vector<std::unique_ptr<Queue>> mQueues;
+  std::atomic<size_t> mQueued = 0;
+  std::mutex mSleepMutex;
+  std::condition_variable mWake;
+  bool mStop = false;
+  std::vector<std::thread> mWorkers;
+};
+
+//! A batch of tasks on a `ThreadPool` that can be waited on together.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool& pool = ThreadPool::Shared()) : mPool(pool) {}
+  ~TaskGroup() { wait(); }
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  template <typename F> void run(F&& f) {
+    mPending.fetch_add(1);
+    mQueued.fetch_add(1);
+    auto task = [this, f = std::forward<F>(f),
+                 stage = StageTimer::Current()]() mutable {
+      {
+        StageTimer::Charge charge(stage);
+        f();
+      }
+      // The waiter may destroy the group as soon as `mPending` drops to zero.
+      ThreadPool& pool = mPool;
+      if (mPending.fetch_sub(1) == 1) {
+        pool.notifyAll();
+      }
+    };
+    mPool.push({std::move(task), this});
+  }
+
+  //! Blocks until every task has finished, running this group's queued tasks
+  //! meanwhile.
+  void wait() { mPool.waitFor(*this); }
+
+private:
+  friend class ThreadPool;
+
+  ThreadPool& mPool;
+  //! Tasks not yet finished.
+  std::atomic<size_t> mPending = 0;
+  //! Tasks not yet started.
+  std::atomic<size_t> mQueued = 0;
+};
+
+} // namespace rsl
@@ -252,7 +252,7 @@ std::deque<int> TriangleStrip::get_strip()
 	return result;
 }
 
-int TriangleStrip::NUM_STRIPS = 0;
+std::atomic<int> TriangleStrip::NUM_STRIPS = 0;
 
 Experiment::Experiment(int _vertex, MFacePtr _face)
 	: vertex(_vertex), face(_face),
@@ -331,7 +331,7 @@ bool Experiment::build_adjacent(TriangleStripPtr strip, int face_index)
 	return false;
 }
 
-int Experiment::NUM_EXPERIMENTS = 0;
+std::atomic<int> Experiment::NUM_EXPERIMENTS = 0;
 
 ExperimentSelector::ExperimentSelector(int _num_samples, int _min_strip_length)
 	: num_samples(_num_samples), min_strip_length(_min_strip_length),
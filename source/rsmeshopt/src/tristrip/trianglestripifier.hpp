@@ -50,6 +50,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 */
 
+#include <atomic>
 #include <cassert>
 #include <deque>
 #include <list>
@@ -88,7 +89,7 @@ public:
 	int strip_id;
 
 	//! Number of strips declared. Used to determine next strip id.
-	static int NUM_STRIPS; // Initialized to zero in cpp file.
+	static std::atomic<int> NUM_STRIPS; // Initialized to zero in cpp file.
 
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 	//~ Public Methods
@@ -148,7 +149,7 @@ public:
 
 	//! Number of experiments declared. Used to determine next
 	//! experiment id.
-	static int NUM_EXPERIMENTS; // Initialized to zero in cpp file.
+	static std::atomic<int> NUM_EXPERIMENTS; // Initialized to zero in cpp file.
 
 	Experiment(int _vertex, MFacePtr _face);
 
@@ -0,0 +1,51 @@
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use std::fs;
+
+use szs;
+
+pub fn decode_benches(c: &mut Criterion) {
+    let mut paths: Vec<_> = fs::read_dir("../../tests/samples_szs")
+        .expect("Sample folder not found")
+        .map(|entry| entry.expect("Error reading folder").path())
+        .collect();
+    paths.sort();
+
+    let mut group = c.benchmark_group("Yaz0 decoder");
+    for path in paths {
+        let data = fs::read(&path).expect("Error reading file");
+        let name = path.file_name().unwrap().to_string_lossy().into_owned();
+        let encoded = if szs::is_compressed(&data) {
+            data
+        } else {
+            szs::encode(&data, szs::EncodeAlgo::MK8).expect("encode failed")
+        };
+        let mut dst = vec![0u8; szs::decoded_size(&encoded) as usize];
+
+        group.bench_with_input(BenchmarkId::new("C decoder", &name), &encoded, |b, src| {
+            b.iter(|| {
+                szs::decode_into_reference_c_version(black_box(&mut dst), black_box(src))
+                    .expect("decode failed")
+            })
+        });
+        group.bench_with_input(
+            BenchmarkId::new("Rust decoder", &name),
+            &encoded,
+            |b, src| {
+                b.iter(|| {
+                    szs::decode_into(black_box(&mut dst), black_box(src)).expect("decode failed")
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+pub fn configure() -> Criterion {
+    Criterion::default()
+}
+criterion_group! {
+    name = benches;
+    config = configure();
+    targets = decode_benches
+}
+criterion_main!(benches);
@@ -1,4 +1,4 @@
-use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
 use std::fs::File;
 use std::io::Read;
 
@@ -54,12 +54,41 @@ pub fn mk8_benches2(c: &mut Criterion) {
     });
 }
 
+pub fn mkw_parallel_benches(c: &mut Criterion) {
+    let mut file = File::open("../../tests/samples_szs/old_koopa_64.arc").expect("File not found");
+    let mut data = Vec::new();
+    file.read_to_end(&mut data).expect("Error reading file");
+
+    let mut group = c.benchmark_group("MKW thread scaling");
+    group.sample_size(10);
+    group.bench_function("Serial", |b| {
+        b.iter(|| {
+            szs::encode(black_box(&data), black_box(szs::EncodeAlgo::MKW)).expect("encode failed")
+        })
+    });
+    let max_threads = std::thread::available_parallelism().map_or(1, |n| n.get());
+    let mut num_threads = 1;
+    while num_threads <= max_threads {
+        group.bench_with_input(
+            BenchmarkId::new("Parallel", num_threads),
+            &num_threads,
+            |b, &num_threads| {
+                b.iter(|| {
+                    szs::encode_mkw_parallel(black_box(&data), num_threads).expect("encode failed")
+                })
+            },
+        );
+        num_threads *= 2;
+    }
+    group.finish();
+}
+
 pub fn configure() -> Criterion {
     Criterion::default()
 }
 criterion_group! {
     name = benches;
     config = configure();
-    targets = mk8_benches2
+    targets = mk8_benches2, mkw_parallel_benches
 }
 criterion_main!(benches);
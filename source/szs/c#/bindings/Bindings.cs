@@ -40,6 +40,8 @@ public static class szs_native
     CTlib,
     LibYaz0,
     MK8,
+    MkwParallel,
+    Optimal,
   }
 
   [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
@@ -64,6 +66,8 @@ public static class szs
     CTlib = szs_native.RiiszsEncodeAlgo.CTlib,
     LibYaz0 = szs_native.RiiszsEncodeAlgo.LibYaz0,
     MK8 = szs_native.RiiszsEncodeAlgo.MK8,
+    MkwParallel = szs_native.RiiszsEncodeAlgo.MkwParallel,
+    Optimal = szs_native.RiiszsEncodeAlgo.Optimal,
   }
   public static bool IsCompressed(byte[] data)
   {
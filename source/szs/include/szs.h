@@ -1,6 +1,7 @@
 #ifndef RII_SZS_H
 #define RII_SZS_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -27,11 +28,18 @@ enum {
   RII_SZS_ENCODE_ALGO_CTLIB,    // Legacy
   RII_SZS_ENCODE_ALGO_LIBYAZ0,
   RII_SZS_ENCODE_ALGO_MK8,
+  RII_SZS_ENCODE_ALGO_MKW_PARALLEL,
+  RII_SZS_ENCODE_ALGO_OPTIMAL,
 };
 
 const char* riiszs_encode_algo_fast(void* dst, uint32_t dst_len,
                                     const void* src, uint32_t src_len,
                                     uint32_t* used_len, uint32_t algo);
+// RII_SZS_ENCODE_ALGO_MKW_PARALLEL on `num_threads` threads (0: all cores)
+const char* riiszs_encode_mkw_parallel(void* dst, uint32_t dst_len,
+                                       const void* src, uint32_t src_len,
+                                       uint32_t* used_len,
+                                       uint32_t num_threads);
 void riiszs_free_error_message(const char* msg);
 
 int32_t szs_get_version_unstable_api(char* buf, uint32_t len);
@@ -41,12 +49,41 @@ const char* riiszs_deinterlace_into(void* dst, uint32_t dst_len,
                                     const void* src, uint32_t src_len,
                                     uint32_t* used_len);
 
+// Incremental YAZ0 (.szs) decoding
+typedef struct riiszs_stream_decoder riiszs_stream_decoder;
+riiszs_stream_decoder* riiszs_stream_decoder_create(void);
+void riiszs_stream_decoder_free(riiszs_stream_decoder* decoder);
+const char* riiszs_stream_decoder_decode(riiszs_stream_decoder* decoder,
+                                         void* dst, uint32_t dst_len,
+                                         const void* src, uint32_t src_len,
+                                         uint32_t* consumed,
+                                         uint32_t* produced);
+// 0 until the 16-byte header has been fed
+uint32_t
+riiszs_stream_decoder_decoded_size(const riiszs_stream_decoder* decoder);
+bool riiszs_stream_decoder_is_done(const riiszs_stream_decoder* decoder);
+
+// YAZ0 seek index (random-access / parallel decoding)
+uint32_t riiszs_seek_index_upper_bound(uint32_t decoded_size,
+                                       uint32_t interval);
+const char* riiszs_seek_index_build(void* dst, uint32_t dst_len,
+                                    const void* src, uint32_t src_len,
+                                    uint32_t interval, uint32_t* used_len);
+const char* riiszs_decode_with_index(void* dst, uint32_t dst_len,
+                                     const void* src, uint32_t src_len,
+                                     const void* index, uint32_t index_len,
+                                     uint32_t num_threads);
+const char* riiszs_decode_range(void* dst, uint32_t dst_len, uint32_t offset,
+                                const void* src, uint32_t src_len,
+                                const void* index, uint32_t index_len);
+
 #ifdef __cplusplus
 }
 #endif
 
 #ifdef __cplusplus
 
+#include <optional>
 #include <span>
 #include <string>
 #include <vector>
@@ -90,6 +127,12 @@ enum class Algo {
   //! Matching CTGP algorithm
   CTGP = RII_SZS_ENCODE_ALGO_CTGP,
 
+  //! Multithreaded `Nintendo` (not matching, ratio within 0.01%)
+  MkwParallel = RII_SZS_ENCODE_ALGO_MKW_PARALLEL,
+
+  //! Optimal parse: smallest files, CTLib-like speed
+  Optimal = RII_SZS_ENCODE_ALGO_OPTIMAL,
+
   // Legacy algorithms...
   MKWSP = RII_SZS_ENCODE_ALGO_MKWSP,
   Haroohie = RII_SZS_ENCODE_ALGO_HAROOHIE,
@@ -149,6 +192,24 @@ static inline Result<std::vector<uint8_t>> encode(std::span<const uint8_t> buf,
   return tmp;
 }
 
+//! Encode a buffer as YAZ0 data with `Algo::MkwParallel` on `num_threads`
+//! threads (0: all cores). The output does not depend on `num_threads`.
+static inline Result<std::vector<uint8_t>>
+encode_mkw_parallel(std::span<const uint8_t> buf, uint32_t num_threads) {
+  uint32_t worst =
+      ::riiszs_encoded_upper_bound(static_cast<uint32_t>(buf.size()));
+  std::vector<uint8_t> tmp(worst);
+  uint32_t used_len = 0;
+  const char* err = ::riiszs_encode_mkw_parallel(
+      tmp.data(), tmp.size(), buf.data(), buf.size(), &used_len, num_threads);
+  if (err != nullptr) {
+    return std::unexpected(impl::rust_string(err));
+  }
+  SZS_ASSERT(tmp.size() >= used_len);
+  tmp.resize(used_len);
+  return tmp;
+}
+
 //! Directly decode into a buffer.
 //! @see `szs::decoded_size`
 static inline Result<void> decode_into(std::span<uint8_t> dst,
@@ -254,6 +315,98 @@ encode_yay0(std::span<const uint8_t> buf, Algo algo) {
   return tmp;
 }
 
+//! Build a seek index for a YAZ0 file, with a checkpoint every `interval`
+//! decoded bytes. Store it as a `.idx` sidecar next to the file; the file
+//! itself is left untouched.
+static inline Result<std::vector<uint8_t>>
+build_seek_index(std::span<const uint8_t> src, uint32_t interval) {
+  uint32_t worst = ::riiszs_seek_index_upper_bound(
+      ::riiszs_decoded_size(src.data(), src.size()), interval);
+  std::vector<uint8_t> tmp(worst);
+  uint32_t used_len = 0;
+  const char* err = ::riiszs_seek_index_build(
+      tmp.data(), tmp.size(), src.data(), src.size(), interval, &used_len);
+  if (err != nullptr) {
+    return std::unexpected(impl::rust_string(err));
+  }
+  SZS_ASSERT(tmp.size() >= used_len);
+  tmp.resize(used_len);
+  return tmp;
+}
+
+//! Decode a YAZ0 file across `num_threads` threads (0: all cores).
+static inline Result<void> decode_with_index_into(
+    std::span<uint8_t> dst, std::span<const uint8_t> src,
+    std::span<const uint8_t> index, uint32_t num_threads = 0) {
+  const char* err =
+      ::riiszs_decode_with_index(dst.data(), dst.size(), src.data(),
+                                 src.size(), index.data(), index.size(),
+                                 num_threads);
+  if (err == nullptr) {
+    return {};
+  }
+  return std::unexpected(impl::rust_string(err));
+}
+
+//! Decode `dst.size()` bytes at decoded offset `offset`, starting from the
+//! nearest checkpoint instead of the beginning of the file.
+static inline Result<void> decode_range_into(std::span<uint8_t> dst,
+                                             uint32_t offset,
+                                             std::span<const uint8_t> src,
+                                             std::span<const uint8_t> index) {
+  const char* err =
+      ::riiszs_decode_range(dst.data(), dst.size(), offset, src.data(),
+                            src.size(), index.data(), index.size());
+  if (err == nullptr) {
+    return {};
+  }
+  return std::unexpected(impl::rust_string(err));
+}
+
+//! Incrementally decode a YAZ0 file. Input and output may be split at any
+//! byte; the 4 KiB back-reference window is carried across calls.
+class StreamDecoder {
+public:
+  struct Progress {
+    uint32_t consumed; //!< Bytes read from `src`
+    uint32_t produced; //!< Bytes written to `dst`
+  };
+
+  StreamDecoder() : m_impl(::riiszs_stream_decoder_create()) {}
+  ~StreamDecoder() { ::riiszs_stream_decoder_free(m_impl); }
+  StreamDecoder(const StreamDecoder&) = delete;
+  StreamDecoder& operator=(const StreamDecoder&) = delete;
+
+  //! Decode as much of `src` into `dst` as possible. Unconsumed input must be
+  //! passed again in the next call.
+  Result<Progress> decode(std::span<uint8_t> dst,
+                          std::span<const uint8_t> src) {
+    Progress progress{};
+    const char* err = ::riiszs_stream_decoder_decode(
+        m_impl, dst.data(), dst.size(), src.data(), src.size(),
+        &progress.consumed, &progress.produced);
+    if (err == nullptr) {
+      return progress;
+    }
+    return std::unexpected(impl::rust_string(err));
+  }
+
+  //! Known once the 16-byte header has been fed.
+  std::optional<uint32_t> decoded_size() const {
+    if (uint32_t size = ::riiszs_stream_decoder_decoded_size(m_impl);
+        size != 0 || is_done()) {
+      return size;
+    }
+    return std::nullopt;
+  }
+
+  //! Whether the whole file has been decoded. Any further input is padding.
+  bool is_done() const { return ::riiszs_stream_decoder_is_done(m_impl); }
+
+private:
+  ::riiszs_stream_decoder* m_impl;
+};
+
 } // namespace szs
 #endif
 
@@ -36,6 +36,8 @@ class EncodingAlgorithm(Enum):
     CTLIB = 5
     LIBYAZ0 = 6
     MK8 = 7
+    MKW_PARALLEL = 8
+    OPTIMAL = 9
 
 class RIISZSError(Exception):
     pass
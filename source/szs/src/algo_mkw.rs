@@ -1,15 +1,15 @@
-struct EGGContext {
+pub(crate) struct EGGContext {
     s_skip_table: [u16; 256],
 }
 
 impl EGGContext {
-    fn new() -> Self {
+    pub(crate) fn new() -> Self {
         Self {
             s_skip_table: [0; 256],
         }
     }
 
-    fn find_match(
+    pub(crate) fn find_match(
         &mut self,
         src: &[u8],
         src_pos: usize,
@@ -0,0 +1,150 @@
+use crate::algo_mkw::EGGContext;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::OnceLock;
+
+// Each block is match-searched independently. Back-references may still reach
+// up to 4096 bytes *before* the block (the decoder has already produced that
+// data), so only matches straddling a block's end are lost. The block size is
+// fixed, so the output does not depend on the number of threads.
+const BLOCK_SIZE: usize = 0x2_0000;
+
+/// Encoded operations of a single block, without group headers.
+struct BlockOps {
+    /// One entry per operation: `true` for a raw byte, `false` for a back-reference.
+    raw: Vec<bool>,
+    /// Concatenated operation bytes (1 byte raw, 2 or 3 byte back-reference).
+    data: Vec<u8>,
+}
+
+fn encode_block(ctx: &mut EGGContext, src: &[u8], begin: usize, end: usize) -> BlockOps {
+    let mut ops = BlockOps {
+        raw: Vec::with_capacity((end - begin) / 2),
+        data: Vec::with_capacity(end - begin),
+    };
+
+    let mut src_pos = begin;
+    while src_pos < end {
+        let mut match_offset = 0;
+        let mut first_match_len = 0;
+        ctx.find_match(src, src_pos, end, &mut match_offset, &mut first_match_len);
+        if first_match_len > 2 {
+            let mut second_match_offset = 0;
+            let mut second_match_len = 0;
+            ctx.find_match(
+                src,
+                src_pos + 1,
+                end,
+                &mut second_match_offset,
+                &mut second_match_len,
+            );
+            if first_match_len + 1 < second_match_len {
+                ops.raw.push(true);
+                ops.data.push(src[src_pos]);
+                src_pos += 1;
+                first_match_len = second_match_len;
+                match_offset = second_match_offset;
+            }
+            let mut back = src_pos - match_offset - 1;
+            ops.raw.push(false);
+            if first_match_len < 18 {
+                back |= (first_match_len - 2) << 12;
+                ops.data.push((back >> 8) as u8);
+                ops.data.push(back as u8);
+            } else {
+                ops.data.push((back >> 8) as u8);
+                ops.data.push(back as u8);
+                ops.data.push((first_match_len - 18) as u8);
+            }
+            src_pos += first_match_len;
+        } else {
+            ops.raw.push(true);
+            ops.data.push(src[src_pos]);
+            src_pos += 1;
+        }
+    }
+
+    ops
+}
+
+fn write_blocks(blocks: &[OnceLock<BlockOps>], src_size: usize, dst: &mut [u8]) -> usize {
+    dst[0] = b'Y';
+    dst[1] = b'a';
+    dst[2] = b'z';
+    dst[3] = b'0';
+    dst[4] = (src_size >> 24) as u8;
+    dst[5] = (src_size >> 16) as u8;
+    dst[6] = (src_size >> 8) as u8;
+    dst[7] = src_size as u8;
+    dst[8..16].fill(0);
+
+    let mut dst_pos = 16;
+    let mut group_header_pos = 0;
+    let mut group_header_bit = 0u8;
+    for block in blocks {
+        let ops = block.get().expect("Block was not encoded");
+        let mut data_pos = 0;
+        for &raw in &ops.raw {
+            if group_header_bit == 0 {
+                group_header_bit = 0x80;
+                group_header_pos = dst_pos;
+                dst[dst_pos] = 0;
+                dst_pos += 1;
+            }
+            let len = if raw {
+                dst[group_header_pos] |= group_header_bit;
+                1
+            } else if ops.data[data_pos] >> 4 == 0 {
+                3
+            } else {
+                2
+            };
+            dst[dst_pos..dst_pos + len].copy_from_slice(&ops.data[data_pos..data_pos + len]);
+            dst_pos += len;
+            data_pos += len;
+            group_header_bit >>= 1;
+        }
+    }
+
+    dst_pos
+}
+
+/// Number of worker threads used when the caller does not specify one.
+pub fn default_num_threads() -> usize {
+    std::thread::available_parallelism().map_or(1, |n| n.get())
+}
+
+/// Block-parallel variant of `algo_mkw::encode_boyer_moore_horspool`.
+///
+/// Blocks are match-searched on `num_threads` workers and their operations are
+/// then stitched into a single stream of group headers.
+pub fn encode_boyer_moore_horspool_mt(src: &[u8], dst: &mut [u8], num_threads: usize) -> usize {
+    let num_blocks = (src.len() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    let blocks: Vec<OnceLock<BlockOps>> = (0..num_blocks).map(|_| OnceLock::new()).collect();
+    let next_block = AtomicUsize::new(0);
+
+    let worker = || {
+        let mut ctx = EGGContext::new();
+        loop {
+            let i = next_block.fetch_add(1, Ordering::Relaxed);
+            if i >= num_blocks {
+                break;
+            }
+            let begin = i * BLOCK_SIZE;
+            let end = std::cmp::min(begin + BLOCK_SIZE, src.len());
+            let _ = blocks[i].set(encode_block(&mut ctx, src, begin, end));
+        }
+    };
+
+    let num_threads = num_threads.clamp(1, std::cmp::max(num_blocks, 1));
+    if num_threads == 1 {
+        worker();
+    } else {
+        std::thread::scope(|s| {
+            for _ in 0..num_threads {
+                s.spawn(&worker);
+            }
+        });
+    }
+
+    write_blocks(&blocks, src.len(), dst)
+}
@@ -0,0 +1,273 @@
+// Optimal-parse encoder.
+//
+// 1. A rolling hash-chain over 3-byte prefixes finds the longest back-reference
+//    at every position in a single forward pass.
+// 2. A backwards dynamic program then picks, for every position, the operation
+//    minimizing the total encoded size under the exact Yaz0 cost model:
+//      raw byte:               1 flag bit + 8 bits
+//      back-reference N < 18:  1 flag bit + 16 bits
+//      back-reference N >= 18: 1 flag bit + 24 bits
+//    Any prefix of the longest match is itself a valid match at the same
+//    distance, so the longest match is all the DP needs per position.
+
+const WINDOW_SIZE: usize = 0x1000;
+const MIN_MATCH: usize = 3;
+const MAX_MATCH: usize = 0xFF + 18;
+
+const HASH_BITS: u32 = 15;
+const HASH_SIZE: usize = 1 << HASH_BITS;
+const NIL: u32 = u32::MAX;
+
+const COST_RAW: u32 = 9;
+const COST_SHORT: u32 = 17;
+const COST_LONG: u32 = 25;
+
+#[derive(Clone, Copy, Default)]
+struct Match {
+    len: u16,
+    dist: u16,
+}
+
+#[inline]
+fn hash3(src: &[u8], pos: usize) -> usize {
+    let v = (src[pos] as u32) << 16 | (src[pos + 1] as u32) << 8 | src[pos + 2] as u32;
+    (v.wrapping_mul(2654435761) >> (32 - HASH_BITS)) as usize
+}
+
+#[inline]
+fn match_len(src: &[u8], a: usize, b: usize, max_len: usize) -> usize {
+    let mut len = 0;
+    // Compare 8 bytes at a time; the first differing byte is the lowest set bit.
+    while len + 8 <= max_len {
+        let x = u64::from_le_bytes(src[a + len..a + len + 8].try_into().unwrap());
+        let y = u64::from_le_bytes(src[b + len..b + len + 8].try_into().unwrap());
+        if x != y {
+            return len + ((x ^ y).trailing_zeros() / 8) as usize;
+        }
+        len += 8;
+    }
+    while len < max_len && src[a + len] == src[b + len] {
+        len += 1;
+    }
+    len
+}
+
+fn find_longest_matches(src: &[u8], max_chain: usize) -> Vec<Match> {
+    let n = src.len();
+    let mut matches = vec![Match::default(); n];
+    let mut head = vec![NIL; HASH_SIZE];
+    // Only the last WINDOW_SIZE positions are ever reachable, so the chain is a ring.
+    let mut prev = vec![NIL; WINDOW_SIZE];
+
+    if n < MIN_MATCH {
+        return matches;
+    }
+    for pos in 0..=n - MIN_MATCH {
+        let h = hash3(src, pos);
+        let max_len = std::cmp::min(MAX_MATCH, n - pos);
+
+        let mut best = Match::default();
+        let mut candidate = head[h];
+        let mut chain = 0;
+        while candidate != NIL && chain < max_chain {
+            let cand = candidate as usize;
+            let dist = pos - cand;
+            if dist > WINDOW_SIZE {
+                break;
+            }
+            // Quick reject: a candidate can only improve if it also matches the byte after `best.len`.
+            let best_len = best.len as usize;
+            if best_len < max_len && src[cand + best_len] == src[pos + best_len] {
+                let len = match_len(src, cand, pos, max_len);
+                if len > best_len {
+                    best = Match {
+                        len: len as u16,
+                        dist: dist as u16,
+                    };
+                    if len == max_len {
+                        break;
+                    }
+                }
+            }
+            let next = prev[cand % WINDOW_SIZE];
+            // Stale ring entries point forwards (or to ourselves); stop there.
+            if next == NIL || next as usize >= cand {
+                break;
+            }
+            candidate = next;
+            chain += 1;
+        }
+        if best.len as usize >= MIN_MATCH {
+            matches[pos] = best;
+        }
+
+        prev[pos % WINDOW_SIZE] = head[h];
+        head[h] = pos as u32;
+    }
+
+    matches
+}
+
+// Min-segment-tree over a ring of the next `RING_SIZE` positions. A
+// back-reference never reaches further ahead than `MAX_MATCH`, so the DP only
+// queries that range; this keeps long runs (e.g. zero padding) linear.
+const RING_SIZE: usize = 512;
+
+struct RangeMin {
+    tree: [u64; 2 * RING_SIZE],
+}
+
+impl RangeMin {
+    fn new() -> Self {
+        Self {
+            tree: [u64::MAX; 2 * RING_SIZE],
+        }
+    }
+
+    fn set(&mut self, pos: usize, key: u64) {
+        let mut i = pos % RING_SIZE + RING_SIZE;
+        self.tree[i] = key;
+        while i > 1 {
+            i /= 2;
+            self.tree[i] = std::cmp::min(self.tree[2 * i], self.tree[2 * i + 1]);
+        }
+    }
+
+    fn min_slots(&self, lo: usize, hi: usize) -> u64 {
+        let mut result = u64::MAX;
+        let mut l = lo + RING_SIZE;
+        let mut r = hi + RING_SIZE + 1;
+        while l < r {
+            if l & 1 != 0 {
+                result = std::cmp::min(result, self.tree[l]);
+                l += 1;
+            }
+            if r & 1 != 0 {
+                r -= 1;
+                result = std::cmp::min(result, self.tree[r]);
+            }
+            l /= 2;
+            r /= 2;
+        }
+        result
+    }
+
+    /// Minimum key over positions `lo..=hi` (at most `RING_SIZE` apart).
+    fn min(&self, lo: usize, hi: usize) -> u64 {
+        let (l, h) = (lo % RING_SIZE, hi % RING_SIZE);
+        if l <= h {
+            self.min_slots(l, h)
+        } else {
+            std::cmp::min(self.min_slots(l, RING_SIZE - 1), self.min_slots(0, h))
+        }
+    }
+}
+
+// Ties are broken towards the furthest position, i.e. the longest operation:
+// fewer operations means fewer group headers to write.
+#[inline]
+fn make_key(cost: u32, pos: usize) -> u64 {
+    (cost as u64) << 32 | !(pos as u32) as u64
+}
+
+#[inline]
+fn key_cost(key: u64) -> u32 {
+    (key >> 32) as u32
+}
+
+#[inline]
+fn key_pos(key: u64) -> usize {
+    !(key as u32) as usize
+}
+
+/// For every position, the length of the operation to emit there (0 = raw byte).
+fn optimal_parse(matches: &[Match]) -> Vec<u16> {
+    let n = matches.len();
+    let mut choice = vec![0u16; n];
+    let mut costs = RangeMin::new();
+    costs.set(n, make_key(0, n));
+    let mut next_cost = 0;
+
+    for pos in (0..n).rev() {
+        let mut best_cost = COST_RAW + next_cost;
+        let mut best_len = 0;
+
+        let longest = matches[pos].len as usize;
+        if longest >= MIN_MATCH {
+            let short = costs.min(pos + MIN_MATCH, pos + std::cmp::min(longest, 17));
+            if COST_SHORT + key_cost(short) <= best_cost {
+                best_cost = COST_SHORT + key_cost(short);
+                best_len = key_pos(short) - pos;
+            }
+        }
+        if longest >= 18 {
+            let long = costs.min(pos + 18, pos + longest);
+            if COST_LONG + key_cost(long) <= best_cost {
+                best_cost = COST_LONG + key_cost(long);
+                best_len = key_pos(long) - pos;
+            }
+        }
+
+        costs.set(pos, make_key(best_cost, pos));
+        next_cost = best_cost;
+        choice[pos] = best_len as u16;
+    }
+
+    choice
+}
+
+pub fn compress_optimal(src: &[u8], max_chain: usize, dst: &mut [u8]) -> usize {
+    let src_size = src.len();
+
+    dst[0] = b'Y';
+    dst[1] = b'a';
+    dst[2] = b'z';
+    dst[3] = b'0';
+    dst[4] = (src_size >> 24) as u8;
+    dst[5] = (src_size >> 16) as u8;
+    dst[6] = (src_size >> 8) as u8;
+    dst[7] = src_size as u8;
+    dst[8..16].fill(0);
+
+    let matches = find_longest_matches(src, max_chain);
+    let choice = optimal_parse(&matches);
+
+    let mut dst_pos = 16;
+    let mut group_header_pos = 0;
+    let mut group_header_bit = 0u8;
+    let mut src_pos = 0;
+    while src_pos < src_size {
+        if group_header_bit == 0 {
+            group_header_bit = 0x80;
+            group_header_pos = dst_pos;
+            dst[dst_pos] = 0;
+            dst_pos += 1;
+        }
+
+        let len = choice[src_pos] as usize;
+        if len == 0 {
+            dst[group_header_pos] |= group_header_bit;
+            dst[dst_pos] = src[src_pos];
+            dst_pos += 1;
+            src_pos += 1;
+        } else {
+            let back = matches[src_pos].dist as usize - 1;
+            if len < 18 {
+                let back = back | ((len - 2) << 12);
+                dst[dst_pos] = (back >> 8) as u8;
+                dst[dst_pos + 1] = back as u8;
+                dst_pos += 2;
+            } else {
+                dst[dst_pos] = (back >> 8) as u8;
+                dst[dst_pos + 1] = back as u8;
+                dst[dst_pos + 2] = (len - 18) as u8;
+                dst_pos += 3;
+            }
+            src_pos += len;
+        }
+
+        group_header_bit >>= 1;
+    }
+
+    dst_pos
+}
@@ -0,0 +1,207 @@
+// Bounds-checked Yaz0/Yay0 decoders.
+//
+// - Group headers of eight raw bytes (0xFF) are copied with a single 8-byte move.
+// - Back-references at a distance of at least 16 bytes are copied in unaligned
+//   16-byte chunks. The final chunk may overshoot the reference, but never the
+//   decoded size; the overshoot is overwritten by the next operation.
+// - Shorter distances are expanded by doubling the copied pattern, which keeps
+//   every copy non-overlapping.
+
+const CHUNK: usize = 16;
+
+const TRUNCATED: &str = "Truncated source file: the file could not be decompressed fully";
+const BAD_BACK_REFERENCE: &str = "Invalid back-reference: points before the start of the file";
+
+fn error(msg: &str) -> crate::Error {
+    crate::Error::Error(msg.to_string())
+}
+
+#[inline(always)]
+fn read_u32(src: &[u8], pos: usize) -> Result<u32, crate::Error> {
+    match src.get(pos..pos + 4) {
+        Some(bytes) => Ok(u32::from_be_bytes(bytes.try_into().unwrap())),
+        None => Err(error("Truncated source file")),
+    }
+}
+
+/// Copies `len` bytes from `out - dist` to `out`, where `out + len <= dst.len()`.
+#[inline(always)]
+fn copy_back_reference(dst: &mut [u8], out: usize, dist: usize, len: usize) {
+    debug_assert!(dist >= 1 && dist <= out && out + len <= dst.len());
+
+    if dist >= CHUNK && out + len + CHUNK <= dst.len() {
+        let base = dst.as_mut_ptr();
+        let mut copied = 0;
+        while copied < len {
+            // SAFETY: `out + copied + CHUNK <= dst.len()` by the check above, and since
+            // `dist >= CHUNK` each read only touches bytes written before this chunk.
+            unsafe {
+                let v =
+                    std::ptr::read_unaligned(base.add(out - dist + copied) as *const [u8; CHUNK]);
+                std::ptr::write_unaligned(base.add(out + copied) as *mut [u8; CHUNK], v);
+            }
+            copied += CHUNK;
+        }
+        return;
+    }
+
+    if dist == 1 {
+        let value = dst[out - 1];
+        dst[out..out + len].fill(value);
+        return;
+    }
+
+    // Overlapping copy: the output is periodic in `dist`, so after copying `dist`
+    // bytes the pattern can be copied twice as far back, and so on.
+    let mut back = dist;
+    let mut copied = 0;
+    while copied < len {
+        let n = std::cmp::min(back, len - copied);
+        let from = out + copied - back;
+        dst.copy_within(from..from + n, out + copied);
+        copied += n;
+        back *= 2;
+    }
+}
+
+pub fn decode_yaz0(dst: &mut [u8], src: &[u8]) -> Result<(), crate::Error> {
+    if src.len() < 16 {
+        return Err(error("File too small to be a YAZ0 file"));
+    }
+    if !(src.starts_with(b"Yaz0") || src.starts_with(b"Yaz1")) {
+        return Err(error("Source is not a SZS compressed file!"));
+    }
+    let size = read_u32(src, 4)? as usize;
+    if dst.len() < size {
+        return Err(error("Result buffer is too small!"));
+    }
+    let dst = &mut dst[..size];
+
+    decode_yaz0_ops(dst, 0, src, 16)?;
+    Ok(())
+}
+
+/// Decodes operations from `src[in_pos..]` until `dst` is filled, starting at
+/// `dst[out_pos]`. Back-references may reach into `dst[..out_pos]`.
+///
+/// Returns the position in `src` after the last operation.
+pub fn decode_yaz0_ops(
+    dst: &mut [u8],
+    mut out_pos: usize,
+    src: &[u8],
+    mut in_pos: usize,
+) -> Result<usize, crate::Error> {
+    let size = dst.len();
+    while out_pos < size {
+        let Some(&header) = src.get(in_pos) else {
+            return Err(error(TRUNCATED));
+        };
+        in_pos += 1;
+
+        if header == 0xFF && in_pos + 8 <= src.len() && out_pos + 8 <= size {
+            dst[out_pos..out_pos + 8].copy_from_slice(&src[in_pos..in_pos + 8]);
+            in_pos += 8;
+            out_pos += 8;
+            continue;
+        }
+
+        for bit in 0..8 {
+            if out_pos >= size {
+                break;
+            }
+            if header & (0x80 >> bit) != 0 {
+                let Some(&value) = src.get(in_pos) else {
+                    return Err(error(TRUNCATED));
+                };
+                dst[out_pos] = value;
+                in_pos += 1;
+                out_pos += 1;
+                continue;
+            }
+
+            let Some(group) = src.get(in_pos..in_pos + 2) else {
+                return Err(error(TRUNCATED));
+            };
+            let group = (group[0] as usize) << 8 | group[1] as usize;
+            in_pos += 2;
+            let dist = (group & 0xFFF) + 1;
+            let len = if group >> 12 != 0 {
+                (group >> 12) + 2
+            } else {
+                let Some(&extra) = src.get(in_pos) else {
+                    return Err(error(TRUNCATED));
+                };
+                in_pos += 1;
+                extra as usize + 18
+            };
+            if dist > out_pos {
+                return Err(error(BAD_BACK_REFERENCE));
+            }
+            // Encoders may run a final back-reference past the reported size.
+            let len = std::cmp::min(len, size - out_pos);
+            copy_back_reference(dst, out_pos, dist, len);
+            out_pos += len;
+        }
+    }
+
+    Ok(in_pos)
+}
+
+pub fn decode_yay0(dst: &mut [u8], src: &[u8]) -> Result<(), crate::Error> {
+    if src.len() < 16 || !src.starts_with(b"Yay0") {
+        return Err(error("Invalid Identifier. Expected magic."));
+    }
+    let size = read_u32(src, 4)? as usize;
+    let mut link_pos = read_u32(src, 8)? as usize;
+    let mut chunk_pos = read_u32(src, 12)? as usize;
+    if dst.len() < size {
+        return Err(error("Destination buffer too small."));
+    }
+    let dst = &mut dst[..size];
+
+    let mut mask_pos = 16;
+    let mut out_pos = 0;
+    while out_pos < size {
+        let mask = read_u32(src, mask_pos)?;
+        mask_pos += 4;
+
+        for bit in 0..32 {
+            if out_pos >= size {
+                break;
+            }
+            if mask & (0x8000_0000 >> bit) != 0 {
+                let Some(&value) = src.get(chunk_pos) else {
+                    return Err(error("Truncated byte chunk table"));
+                };
+                dst[out_pos] = value;
+                chunk_pos += 1;
+                out_pos += 1;
+                continue;
+            }
+
+            let Some(link) = src.get(link_pos..link_pos + 2) else {
+                return Err(error("Truncated link table"));
+            };
+            let link = (link[0] as usize) << 8 | link[1] as usize;
+            link_pos += 2;
+            let dist = (link & 0xFFF) + 1;
+            let len = if link >> 12 != 0 {
+                (link >> 12) + 2
+            } else {
+                let Some(&extra) = src.get(chunk_pos) else {
+                    return Err(error("Truncated byte chunk table"));
+                };
+                chunk_pos += 1;
+                extra as usize + 18
+            };
+            if dist > out_pos {
+                return Err(error(BAD_BACK_REFERENCE));
+            }
+            let len = std::cmp::min(len, size - out_pos);
+            copy_back_reference(dst, out_pos, dist, len);
+            out_pos += len;
+        }
+    }
+
+    Ok(())
+}
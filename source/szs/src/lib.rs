@@ -1,12 +1,19 @@
 use core::ffi::c_char;
 use core::slice;
-use std::convert::TryInto;
 
 mod algo_libyaz0;
 mod algo_mk8;
 mod algo_mkw;
+mod algo_mkw_mt;
+mod algo_optimal;
+mod decode;
+mod seek_index;
+mod stream;
 mod szs_to_szp;
 
+pub use seek_index::{build_seek_index, Checkpoint, SeekIndex, DEFAULT_SEEK_INTERVAL};
+pub use stream::StreamDecoder;
+
 #[allow(non_upper_case_globals)]
 #[allow(non_camel_case_types)]
 #[allow(non_snake_case)]
@@ -134,6 +141,8 @@ pub enum EncodeAlgoForCApi {
     CTLib,
     LibYaz0,
     MK8,
+    MkwParallel,
+    Optimal,
 }
 
 /// Algorithms available for encoding.
@@ -188,6 +197,36 @@ pub enum EncodeAlgo {
     /// Compression Rate: B+
     MK8_ReferenceCVersion,
     MK8_Rust,
+
+    /// Block-parallel version of `MKW`.
+    ///
+    /// Use Case: Batch compression of large archives.
+    /// Description: The input is split into 128 KiB blocks which are match-searched on all cores.
+    /// Back-references may reach into the previous block, so only matches crossing a block boundary are lost.
+    /// Output is independent of the thread count.
+    ///
+    /// Speed: A (scales with core count)
+    /// Compression Rate: B+ (within 0.01% of `MKW`: +0.0008% on old_koopa_64.szs, +0.0025% at
+    /// worst over the test samples)
+    MKW_RustParallel,
+
+    /// Hash-chain match finder with an optimal parse over the Yaz0 cost model.
+    ///
+    /// Use Case: Smallest files at `FAST`-like speeds.
+    /// Description: Finds the longest match at every position once, then a dynamic program picks
+    /// the raw byte / back-reference sequence with the fewest encoded bits.
+    ///
+    /// Speed: A-
+    /// Compression Rate: A+
+    ///
+    /// # Benchmarks: old_koopa_64.szs, single thread
+    /// ```txt
+    /// Optimal_Rust              1,456,285 bytes   0.52 s
+    /// LibYaz0_ReferenceCVersion 1,458,288 bytes   2.78 s
+    /// CTLib_ReferenceCVersion   1,473,484 bytes   0.59 s
+    /// MKW_Rust                  1,464,098 bytes   9.53 s
+    /// ```
+    Optimal_Rust,
 }
 
 #[allow(non_upper_case_globals)]
@@ -259,6 +298,12 @@ impl EncodeAlgo {
     /// WorstCaseEncoding_ReferenceCVersion time:   [1.1411 ms 1.1685 ms 1.1905 ms]
     /// ```
     pub const WorstCaseEncoding: EncodeAlgo = EncodeAlgo::WorstCaseEncoding_Rust;
+
+    /// Multithreaded `MKW`. See `encode_mkw_parallel` to control the thread count.
+    pub const MkwParallel: EncodeAlgo = EncodeAlgo::MKW_RustParallel;
+
+    /// Optimal parse. Only a Rust version is available.
+    pub const Optimal: EncodeAlgo = EncodeAlgo::Optimal_Rust;
 }
 
 impl From<EncodeAlgo> for EncodeAlgoForCApi {
@@ -277,6 +322,8 @@ impl From<EncodeAlgo> for EncodeAlgoForCApi {
             EncodeAlgo::LibYaz0_RustMemchr => EncodeAlgoForCApi::LibYaz0,
             EncodeAlgo::MK8_ReferenceCVersion => EncodeAlgoForCApi::MK8,
             EncodeAlgo::MK8_Rust => EncodeAlgoForCApi::MK8,
+            EncodeAlgo::MKW_RustParallel => EncodeAlgoForCApi::MkwParallel,
+            EncodeAlgo::Optimal_Rust => EncodeAlgoForCApi::Optimal,
         }
     }
 }
@@ -292,6 +339,8 @@ impl From<EncodeAlgoForCApi> for EncodeAlgo {
             EncodeAlgoForCApi::CTLib => EncodeAlgo::CTLib,
             EncodeAlgoForCApi::LibYaz0 => EncodeAlgo::LibYaz0,
             EncodeAlgoForCApi::MK8 => EncodeAlgo::MK8,
+            EncodeAlgoForCApi::MkwParallel => EncodeAlgo::MkwParallel,
+            EncodeAlgoForCApi::Optimal => EncodeAlgo::Optimal,
         }
     }
 }
@@ -359,6 +408,16 @@ pub fn encode_into(dst: &mut [u8], src: &[u8], algo: EncodeAlgo) -> Result<u32,
     if algo == EncodeAlgo::MKW {
         return Ok(algo_mkw::encode_boyer_moore_horspool(src, dst) as u32);
     }
+    if algo == EncodeAlgo::MKW_RustParallel {
+        return Ok(algo_mkw_mt::encode_boyer_moore_horspool_mt(
+            src,
+            dst,
+            algo_mkw_mt::default_num_threads(),
+        ) as u32);
+    }
+    if algo == EncodeAlgo::Optimal_Rust {
+        return Ok(algo_optimal::compress_optimal(src, 256, dst) as u32);
+    }
     if algo == EncodeAlgo::MK8_Rust {
       return Ok(algo_mk8::compress_mk8(src, dst) as u32);
     }
@@ -445,10 +504,48 @@ pub fn encode(src: &[u8], algo: EncodeAlgo) -> Result<Vec<u8>, Error> {
     }
 }
 
+/// Encodes the source slice with `EncodeAlgo::MkwParallel` on a fixed number of threads.
+///
+/// The output is byte-identical for any `num_threads`; only the speed differs.
+///
+/// # Arguments
+///
+/// * `src`: A byte slice that contains the data to be encoded.
+///
+/// * `num_threads`: Number of worker threads. `0` selects the number of available cores.
+///
+/// # Returns
+///
+/// * `Ok(Vec<u8>)`: A `Vec<u8>` containing the encoded data.
+///
+/// * `Err(Error)`: An error encountered during the encoding process.
+///
+/// # Examples
+///
+/// ```
+/// let src = b"some data to encode";
+///
+/// match szs::encode_mkw_parallel(src, 4) {
+///     Ok(encoded_data) => println!("Encoded data length: {}", encoded_data.len()),
+///     Err(err) => println!("Error: {}", err),
+/// }
+/// ```
+pub fn encode_mkw_parallel(src: &[u8], num_threads: usize) -> Result<Vec<u8>, Error> {
+    let num_threads = if num_threads == 0 {
+        algo_mkw_mt::default_num_threads()
+    } else {
+        num_threads
+    };
+    let mut dst: Vec<u8> = vec![0; encoded_upper_bound(src.len() as u32) as usize];
+    let encoded_len = algo_mkw_mt::encode_boyer_moore_horspool_mt(src, &mut dst, num_threads);
+    dst.truncate(encoded_len);
+    Ok(dst)
+}
+
 /// Decodes the source slice in-place as a SZS (YAZ0) compressed stream, writing the decoded data to the destination slice.
 ///
-/// The function calls into a potentially unsafe C binding to perform the decoding,
-/// and may return an error if the decoding process encounters any issues.
+/// Every read and back-reference is bounds-checked: malformed or truncated input
+/// returns an error rather than reading or writing out of bounds.
 ///
 /// # Arguments
 ///
@@ -463,11 +560,6 @@ pub fn encode(src: &[u8], algo: EncodeAlgo) -> Result<Vec<u8>, Error> {
 ///
 /// * `Err(Error)`: An error encountered during the decoding process.
 ///
-/// # Safety
-///
-/// This function uses unsafe code to call C bindings. Ensure that `dst` has enough capacity
-/// to hold the decoded data to prevent memory corruption or undefined behavior.
-///
 /// # Examples
 ///
 /// ```
@@ -485,6 +577,13 @@ pub fn encode(src: &[u8], algo: EncodeAlgo) -> Result<Vec<u8>, Error> {
 /// }
 /// ```
 pub fn decode_into(dst: &mut [u8], src: &[u8]) -> Result<(), Error> {
+    decode::decode_yaz0(dst, src)
+}
+
+/// Slower, reference C version of `decode_into`. Does not validate back-references.
+///
+/// Kept for benchmarking and differential testing.
+pub fn decode_into_reference_c_version(dst: &mut [u8], src: &[u8]) -> Result<(), Error> {
     let result = unsafe {
         bindings::impl_riiszs_decode(
             dst.as_mut_ptr() as *mut _,
@@ -506,6 +605,42 @@ pub fn decode_into(dst: &mut [u8], src: &[u8]) -> Result<(), Error> {
     }
 }
 
+/// Decodes a SZS (YAZ0) compressed stream, splitting the work across threads at
+/// the checkpoints of `index` (see `build_seek_index`).
+///
+/// `num_threads == 0` uses all available cores.
+///
+/// # Examples
+///
+/// ```
+/// let data = vec![7u8; 1 << 20];
+/// let src = szs::encode(&data, szs::EncodeAlgo::MK8).unwrap();
+/// let index = szs::build_seek_index(&src, 64 * 1024).unwrap();
+///
+/// let mut dst = vec![0u8; data.len()];
+/// szs::decode_with_index_into(&mut dst, &src, &index, 0).unwrap();
+/// assert_eq!(dst, data);
+/// ```
+pub fn decode_with_index_into(
+    dst: &mut [u8],
+    src: &[u8],
+    index: &[u8],
+    num_threads: usize,
+) -> Result<(), Error> {
+    SeekIndex::parse(index)?.decode_parallel(src, dst, num_threads)
+}
+
+/// Decodes `dst.len()` bytes starting at decoded offset `offset`, without
+/// decoding anything before the nearest checkpoint of `index`.
+pub fn decode_range_into(
+    dst: &mut [u8],
+    offset: u32,
+    src: &[u8],
+    index: &[u8],
+) -> Result<(), Error> {
+    SeekIndex::parse(index)?.decode_range(src, offset as usize, dst)
+}
+
 /// Decodes the source slice in-place as a SZS (YAZ0) compressed stream and returns the decoded data.
 ///
 /// This function first calculates the required size of the decoded data,
@@ -571,73 +706,7 @@ pub fn decode(src: &[u8]) -> Result<Vec<u8>, Error> {
 /// }
 /// ```
 pub fn decode_yay0_into(dst: &mut [u8], src: &[u8]) -> Result<(), Error> {
-    let mut index = 0;
-
-    if &src[index..index + 4] != "Yay0".as_bytes() {
-        return Err(Error::Error(
-            "Invalid Identifier. Expected magic.".to_string(),
-        ));
-    }
-    index += 4;
-
-    let uncompressed_size = u32::from_be_bytes(src[index..index + 4].try_into().unwrap());
-    index += 4;
-    let mut link_table_offset =
-        u32::from_be_bytes(src[index..index + 4].try_into().unwrap()) as usize;
-    index += 4;
-    let mut byte_chunk_and_count_modifiers_offset =
-        u32::from_be_bytes(src[index..index + 4].try_into().unwrap()) as usize;
-    index += 4;
-
-    if uncompressed_size as usize > dst.len() {
-        return Err(Error::Error("Destination buffer too small.".to_string()));
-    }
-
-    let mut mask_bit_counter = 0;
-    let mut current_offset_in_dest_buffer = 0;
-    let mut current_mask = 0;
-
-    while current_offset_in_dest_buffer < uncompressed_size as usize {
-        if mask_bit_counter == 0 {
-            current_mask = u32::from_be_bytes(src[index..index + 4].try_into().unwrap());
-            index += 4;
-            mask_bit_counter = 32;
-        }
-
-        if (current_mask & 0x8000_0000) != 0 {
-            dst[current_offset_in_dest_buffer] = src[byte_chunk_and_count_modifiers_offset];
-            byte_chunk_and_count_modifiers_offset += 1;
-            current_offset_in_dest_buffer += 1;
-        } else {
-            let link = u16::from_be_bytes(
-                src[link_table_offset..link_table_offset + 2]
-                    .try_into()
-                    .unwrap(),
-            );
-            link_table_offset += 2;
-
-            let offset = current_offset_in_dest_buffer as isize - (link & 0x0fff) as isize;
-            let mut count = (link >> 12) as usize;
-
-            if count == 0 {
-                let count_modifier = src[byte_chunk_and_count_modifiers_offset];
-                count = count_modifier as usize + 18;
-                byte_chunk_and_count_modifiers_offset += 1;
-            } else {
-                count += 2;
-            }
-
-            for i in 0..count {
-                dst[current_offset_in_dest_buffer + i] = dst[offset as usize + i - 1];
-            }
-            current_offset_in_dest_buffer += count;
-        }
-
-        current_mask <<= 1;
-        mask_bit_counter -= 1;
-    }
-
-    Ok(())
+    decode::decode_yay0(dst, src)
 }
 /// Decompresses the Yay0 (SZP) compressed `src` byte slice and returns the uncompressed data in a `Vec<u8>`.
 ///
@@ -658,8 +727,7 @@ pub fn decode_yay0_into(dst: &mut [u8], src: &[u8]) -> Result<(), Error> {
 /// }
 /// ```
 pub fn decode_yay0(src: &[u8]) -> Result<Vec<u8>, Error> {
-    let uncompressed_size = u32::from_be_bytes(src[4..8].try_into().unwrap()) as usize;
-    let mut dst = vec![0u8; uncompressed_size];
+    let mut dst = vec![0u8; decoded_size(src) as usize];
     decode_yay0_into(&mut dst, src)?;
     Ok(dst)
 }
@@ -1174,6 +1242,126 @@ mod tests {
         );
     }
 
+    #[test]
+    fn test_encode_mkw_parallel() {
+        let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
+        let serial = encode(&src, EncodeAlgo::MKW).unwrap();
+        let parallel = encode_mkw_parallel(&src, 4).unwrap();
+        assert_eq!(decode(&parallel).unwrap(), src);
+
+        // Block boundaries may only cost a handful of bytes each.
+        let tolerance = serial.len() / 1000;
+        assert!(parallel.len() <= serial.len() + tolerance);
+
+        for num_threads in [1, 2, 8] {
+            assert_eq!(encode_mkw_parallel(&src, num_threads).unwrap(), parallel);
+        }
+    }
+
+    #[test]
+    fn test_encode_optimal() {
+        let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
+        test_encode_helper(
+            &src,
+            EncodeAlgo::Optimal_Rust,
+            "014e7704c7b69bcce31932aa4604a9a28b93c9fee2d98b56785c0067ad41bcec",
+            false,
+        );
+    }
+
+    #[test]
+    fn test_decode_yaz0_optimal() {
+        let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
+        let encoded = encode(&src, EncodeAlgo::Optimal).unwrap();
+        assert_eq!(decode(&encoded).unwrap(), src);
+
+        // The match search is capped by `max_chain`, so the parse is not guaranteed to
+        // beat libyaz0; this only checks it does on this sample.
+        let libyaz0 = encode(&src, EncodeAlgo::LibYaz0).unwrap();
+        assert!(encoded.len() <= libyaz0.len());
+    }
+
+    #[test]
+    fn test_decode_matches_reference() {
+        let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
+        for algo in [EncodeAlgo::MKW, EncodeAlgo::MK8, EncodeAlgo::Optimal] {
+            let encoded = encode(&src, algo).unwrap();
+            let mut reference = vec![0u8; src.len()];
+            decode_into_reference_c_version(&mut reference, &encoded).unwrap();
+            assert_eq!(decode(&encoded).unwrap(), reference);
+        }
+    }
+
+    #[test]
+    fn test_decode_malformed() {
+        // Back-reference before the start of the output
+        let bad_ref = b"Yaz0\x00\x00\x00\x10\x00\x00\x00\x00\x00\x00\x00\x00\x00\x10\x00";
+        assert!(decode(bad_ref).is_err());
+
+        // Truncated stream
+        let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
+        let encoded = encode(&src, EncodeAlgo::MK8).unwrap();
+        assert!(decode(&encoded[..encoded.len() / 2]).is_err());
+        let encoded = encode_yay0(&src, EncodeAlgo::MK8).unwrap();
+        assert!(decode_yay0(&encoded[..encoded.len() / 2]).is_err());
+    }
+
+    #[test]
+    fn test_decode_stream() {
+        let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
+        let encoded = encode(&src, EncodeAlgo::MK8).unwrap();
+
+        // Odd chunk sizes split group headers and back-references across calls.
+        for (in_chunk, out_chunk) in [(1, 1), (3, 7), (4096, 100_000), (1 << 20, 1 << 20)] {
+            let mut decoder = StreamDecoder::new();
+            let mut decoded = Vec::new();
+            let mut out = vec![0u8; out_chunk];
+            let mut rest = &encoded[..];
+            while !decoder.is_done() {
+                let take = std::cmp::min(in_chunk, rest.len());
+                let (consumed, produced) = decoder.decode(&rest[..take], &mut out).unwrap();
+                assert!(consumed > 0 || produced > 0, "Decoder stalled");
+                decoded.extend_from_slice(&out[..produced]);
+                rest = &rest[consumed..];
+            }
+            assert_eq!(decoder.decoded_size(), Some(src.len() as u32));
+            assert_eq!(decoded, src);
+        }
+    }
+
+    #[test]
+    fn test_decode_seek_index() {
+        let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
+        let encoded = encode(&src, EncodeAlgo::MK8).unwrap();
+        let index = build_seek_index(&encoded, 64 * 1024).unwrap();
+        assert!(SeekIndex::parse(&index).unwrap().checkpoint_count() > 1);
+
+        for num_threads in [1, 3, 0] {
+            let mut decoded = vec![0u8; src.len()];
+            decode_with_index_into(&mut decoded, &encoded, &index, num_threads).unwrap();
+            assert_eq!(decoded, src);
+        }
+
+        // Ranges straddling checkpoints, and the very end of the file.
+        for (offset, len) in [(0, 16), (65_000, 200_000), (src.len() - 100, 100)] {
+            let mut range = vec![0u8; len];
+            decode_range_into(&mut range, offset as u32, &encoded, &index).unwrap();
+            assert_eq!(range, src[offset..offset + len]);
+        }
+
+        // The index is bound to the exact stream it was built from: a stream
+        // of the same decoded size, compressed differently or edited in place,
+        // is rejected.
+        let recompressed = encode(&src, EncodeAlgo::Nintendo).unwrap();
+        let mut edited = encoded.clone();
+        *edited.last_mut().unwrap() ^= 1;
+        for other in [&recompressed, &edited] {
+            let mut decoded = vec![0u8; src.len()];
+            assert!(decode_with_index_into(&mut decoded, other, &index, 1).is_err());
+            assert!(decode_range_into(&mut decoded[..16], 0, other, &index).is_err());
+        }
+    }
+
     #[test]
     fn test_decode_yaz0_mk8() {
         let src = read_file(&format!("{}{}", SAMPLE_DIR, "old_koopa_64.arc"));
@@ -1283,6 +1471,35 @@ pub mod c_api {
         }
     }
 
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_encode_mkw_parallel(
+        dst: *mut u8,
+        dst_len: u32,
+        src: *const u8,
+        src_len: u32,
+        result: *mut u32,
+        num_threads: u32,
+    ) -> *const c_char {
+        let dst_slice = unsafe { std::slice::from_raw_parts_mut(dst, dst_len as usize) };
+        let src_slice = unsafe { std::slice::from_raw_parts(src, src_len as usize) };
+
+        if dst_len < encoded_upper_bound(src_len) {
+            let c_string = std::ffi::CString::new("Destination buffer is too small").unwrap();
+            return c_string.into_raw();
+        }
+        let num_threads = if num_threads == 0 {
+            crate::algo_mkw_mt::default_num_threads()
+        } else {
+            num_threads as usize
+        };
+        let used_len =
+            crate::algo_mkw_mt::encode_boyer_moore_horspool_mt(src_slice, dst_slice, num_threads);
+        unsafe {
+            *result = used_len as u32;
+        }
+        std::ptr::null()
+    }
+
     #[no_mangle]
     pub unsafe extern "C" fn riiszs_decode(
         dst: *mut u8,
@@ -1333,6 +1550,168 @@ pub mod c_api {
         }
     }
 
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_stream_decoder_create() -> *mut StreamDecoder {
+        Box::into_raw(Box::new(StreamDecoder::new()))
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_stream_decoder_free(decoder: *mut StreamDecoder) {
+        if !decoder.is_null() {
+            let _ = unsafe { Box::from_raw(decoder) };
+        }
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_stream_decoder_decode(
+        decoder: *mut StreamDecoder,
+        dst: *mut u8,
+        dst_len: u32,
+        src: *const u8,
+        src_len: u32,
+        consumed: *mut u32,
+        produced: *mut u32,
+    ) -> *const c_char {
+        let decoder = unsafe {
+            assert!(!decoder.is_null());
+            &mut *decoder
+        };
+        // Empty C++ spans may carry a null pointer, which slices may not.
+        let dst_slice: &mut [u8] = if dst_len == 0 {
+            &mut []
+        } else {
+            unsafe { std::slice::from_raw_parts_mut(dst, dst_len as usize) }
+        };
+        let src_slice: &[u8] = if src_len == 0 {
+            &[]
+        } else {
+            unsafe { std::slice::from_raw_parts(src, src_len as usize) }
+        };
+
+        match decoder.decode(src_slice, dst_slice) {
+            Ok((used_in, used_out)) => {
+                unsafe {
+                    *consumed = used_in as u32;
+                    *produced = used_out as u32;
+                }
+                std::ptr::null()
+            }
+            Err(Error::Error(msg)) => {
+                let c_string = std::ffi::CString::new(msg).unwrap();
+                // Leak the CString into a raw pointer, so we don't deallocate it
+                c_string.into_raw()
+            }
+        }
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_stream_decoder_decoded_size(
+        decoder: *const StreamDecoder,
+    ) -> u32 {
+        unsafe { (*decoder).decoded_size().unwrap_or(0) }
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_stream_decoder_is_done(decoder: *const StreamDecoder) -> bool {
+        unsafe { (*decoder).is_done() }
+    }
+
+    // Serialized index size for a file of `decoded_size` bytes.
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_seek_index_upper_bound(
+        decoded_size: u32,
+        interval: u32,
+    ) -> u32 {
+        let checkpoints = decoded_size / std::cmp::max(interval, 1) + 1;
+        seek_index::HEADER_SIZE as u32 + checkpoints * (12 + 0x1000)
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_seek_index_build(
+        dst: *mut u8,
+        dst_len: u32,
+        src: *const u8,
+        src_len: u32,
+        interval: u32,
+        used_len: *mut u32,
+    ) -> *const c_char {
+        let dst_slice = unsafe { std::slice::from_raw_parts_mut(dst, dst_len as usize) };
+        let src_slice = unsafe { std::slice::from_raw_parts(src, src_len as usize) };
+
+        let result = build_seek_index(src_slice, interval).and_then(|index| {
+            if index.len() > dst_slice.len() {
+                return Err(Error::Error("Result buffer is too small!".to_string()));
+            }
+            dst_slice[..index.len()].copy_from_slice(&index);
+            Ok(index.len() as u32)
+        });
+        match result {
+            Ok(len) => {
+                unsafe {
+                    *used_len = len;
+                }
+                std::ptr::null()
+            }
+            Err(Error::Error(msg)) => {
+                let c_string = std::ffi::CString::new(msg).unwrap();
+                // Leak the CString into a raw pointer, so we don't deallocate it
+                c_string.into_raw()
+            }
+        }
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_decode_with_index(
+        dst: *mut u8,
+        dst_len: u32,
+        src: *const u8,
+        src_len: u32,
+        index: *const u8,
+        index_len: u32,
+        num_threads: u32,
+    ) -> *const c_char {
+        let dst_slice = unsafe { std::slice::from_raw_parts_mut(dst, dst_len as usize) };
+        let src_slice = unsafe { std::slice::from_raw_parts(src, src_len as usize) };
+        let index_slice = unsafe { std::slice::from_raw_parts(index, index_len as usize) };
+
+        match decode_with_index_into(dst_slice, src_slice, index_slice, num_threads as usize) {
+            Ok(()) => std::ptr::null(),
+            Err(Error::Error(msg)) => {
+                let c_string = std::ffi::CString::new(msg).unwrap();
+                // Leak the CString into a raw pointer, so we don't deallocate it
+                c_string.into_raw()
+            }
+        }
+    }
+
+    #[no_mangle]
+    pub unsafe extern "C" fn riiszs_decode_range(
+        dst: *mut u8,
+        dst_len: u32,
+        offset: u32,
+        src: *const u8,
+        src_len: u32,
+        index: *const u8,
+        index_len: u32,
+    ) -> *const c_char {
+        let dst_slice: &mut [u8] = if dst_len == 0 {
+            &mut []
+        } else {
+            unsafe { std::slice::from_raw_parts_mut(dst, dst_len as usize) }
+        };
+        let src_slice = unsafe { std::slice::from_raw_parts(src, src_len as usize) };
+        let index_slice = unsafe { std::slice::from_raw_parts(index, index_len as usize) };
+
+        match decode_range_into(dst_slice, offset, src_slice, index_slice) {
+            Ok(()) => std::ptr::null(),
+            Err(Error::Error(msg)) => {
+                let c_string = std::ffi::CString::new(msg).unwrap();
+                // Leak the CString into a raw pointer, so we don't deallocate it
+                c_string.into_raw()
+            }
+        }
+    }
+
     #[no_mangle]
     pub unsafe extern "C" fn riiszs_is_compressed(src: *const u8, len: u32) -> bool {
         let data = unsafe { std::slice::from_raw_parts(src, len as usize) };
@@ -0,0 +1,324 @@
+// Yaz0 seek index.
+//
+// A Yaz0 stream has no restart points: every back-reference may reach 4 KiB
+// behind it. The index records checkpoints at group-header boundaries, each
+// with the input offset, the output offset and a snapshot of the preceding
+// 4 KiB of output. Decoding may then start at any checkpoint, which allows
+// both random access and splitting a decode across threads.
+//
+// The index never changes the Yaz0 stream itself: it is stored as a `.idx`
+// sidecar file next to it.
+//
+// Layout (big-endian, like the Yaz0 header):
+//   0x00 magic "Yz0I"
+//   0x04 u32 version
+//   0x08 u32 decoded size
+//   0x0C u32 stream size (the whole file, including the 16-byte Yaz0 header)
+//   0x10 u32 checkpoint interval
+//   0x14 u32 checkpoint count
+//   0x18 u64 xxh64 of the stream
+//   0x20 checkpoints: { u32 src offset, u32 dst offset, u32 window offset }
+//   .... window snapshots, min(4096, dst offset) bytes each
+//
+// The stream size and hash bind the index to the exact file it was built
+// from: a recompressed file with the same decoded size is rejected rather than
+// decoded with stale windows.
+
+use crate::decode::decode_yaz0_ops;
+use xxhash_rust::xxh64::xxh64;
+
+const MAGIC: &[u8; 4] = b"Yz0I";
+const VERSION: u32 = 2;
+pub(crate) const HEADER_SIZE: usize = 0x20;
+const ENTRY_SIZE: usize = 12;
+const WINDOW_SIZE: usize = 0x1000;
+
+/// Checkpoint spacing used when the caller does not specify one.
+pub const DEFAULT_SEEK_INTERVAL: u32 = 128 * 1024;
+
+fn error(msg: &str) -> crate::Error {
+    crate::Error::Error(msg.to_string())
+}
+
+fn read_u32(data: &[u8], pos: usize) -> u32 {
+    u32::from_be_bytes(data[pos..pos + 4].try_into().unwrap())
+}
+
+/// A point from which the stream can be decoded without what precedes it.
+pub struct Checkpoint<'a> {
+    pub src_offset: usize,
+    pub dst_offset: usize,
+    /// The `min(4096, dst_offset)` bytes of output before `dst_offset`.
+    pub window: &'a [u8],
+}
+
+/// Validated view of a serialized seek index.
+pub struct SeekIndex<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> SeekIndex<'a> {
+    pub fn parse(data: &'a [u8]) -> Result<Self, crate::Error> {
+        if data.len() < HEADER_SIZE || !data.starts_with(MAGIC) {
+            return Err(error("Not a YAZ0 seek index"));
+        }
+        if read_u32(data, 0x04) != VERSION {
+            return Err(error("Unsupported YAZ0 seek index version"));
+        }
+        let index = Self { data };
+        let count = read_u32(data, 0x14) as usize;
+        if count == 0 || (data.len() - HEADER_SIZE) / ENTRY_SIZE < count {
+            return Err(error("Truncated YAZ0 seek index"));
+        }
+        for i in 0..count {
+            let entry = HEADER_SIZE + i * ENTRY_SIZE;
+            let src_offset = read_u32(data, entry) as usize;
+            let dst_offset = read_u32(data, entry + 4) as usize;
+            let window_offset = read_u32(data, entry + 8) as usize;
+            let window_len = std::cmp::min(WINDOW_SIZE, dst_offset);
+            if window_offset > data.len() || data.len() - window_offset < window_len {
+                return Err(error("Truncated YAZ0 seek index"));
+            }
+            let valid = if i == 0 {
+                src_offset == 16 && dst_offset == 0
+            } else {
+                let prev = HEADER_SIZE + (i - 1) * ENTRY_SIZE;
+                src_offset > read_u32(data, prev) as usize
+                    && dst_offset > read_u32(data, prev + 4) as usize
+                    && src_offset <= index.stream_size()
+                    && dst_offset < index.decoded_size()
+            };
+            if !valid {
+                return Err(error("Invalid YAZ0 seek index checkpoint"));
+            }
+        }
+        Ok(index)
+    }
+
+    pub fn decoded_size(&self) -> usize {
+        read_u32(self.data, 0x08) as usize
+    }
+
+    pub fn stream_size(&self) -> usize {
+        read_u32(self.data, 0x0C) as usize
+    }
+
+    pub fn interval(&self) -> u32 {
+        read_u32(self.data, 0x10)
+    }
+
+    pub fn checkpoint_count(&self) -> usize {
+        read_u32(self.data, 0x14) as usize
+    }
+
+    pub fn stream_hash(&self) -> u64 {
+        u64::from_be_bytes(self.data[0x18..0x20].try_into().unwrap())
+    }
+
+    pub fn checkpoint(&self, i: usize) -> Checkpoint<'a> {
+        let entry = HEADER_SIZE + i * ENTRY_SIZE;
+        let dst_offset = read_u32(self.data, entry + 4) as usize;
+        let window_offset = read_u32(self.data, entry + 8) as usize;
+        let window_len = std::cmp::min(WINDOW_SIZE, dst_offset);
+        Checkpoint {
+            src_offset: read_u32(self.data, entry) as usize,
+            dst_offset,
+            window: &self.data[window_offset..window_offset + window_len],
+        }
+    }
+
+    /// Output offset at which checkpoint `i` ends.
+    fn checkpoint_end(&self, i: usize) -> usize {
+        if i + 1 < self.checkpoint_count() {
+            self.checkpoint(i + 1).dst_offset
+        } else {
+            self.decoded_size()
+        }
+    }
+
+    fn check_stream(&self, src: &[u8]) -> Result<(), crate::Error> {
+        if src.len() < 16 || !(src.starts_with(b"Yaz0") || src.starts_with(b"Yaz1")) {
+            return Err(error("Source is not a SZS compressed file!"));
+        }
+        if read_u32(src, 4) as usize != self.decoded_size()
+            || src.len() != self.stream_size()
+            || xxh64(src, 0) != self.stream_hash()
+        {
+            return Err(error("Seek index does not belong to this file"));
+        }
+        Ok(())
+    }
+
+    /// Decodes `dst.len()` bytes of checkpoint `i`'s output, starting at `skip`.
+    fn decode_from(
+        &self,
+        src: &[u8],
+        i: usize,
+        skip: usize,
+        dst: &mut [u8],
+    ) -> Result<usize, crate::Error> {
+        let cp = self.checkpoint(i);
+        let prefix = cp.window.len() + skip;
+        let mut buf = vec![0u8; prefix + dst.len()];
+        buf[..cp.window.len()].copy_from_slice(cp.window);
+        let end = decode_yaz0_ops(&mut buf, cp.window.len(), src, cp.src_offset)?;
+        dst.copy_from_slice(&buf[prefix..]);
+        Ok(end)
+    }
+
+    /// Decodes `dst.len()` bytes starting at decoded offset `offset`, beginning
+    /// at the nearest preceding checkpoint.
+    pub fn decode_range(
+        &self,
+        src: &[u8],
+        offset: usize,
+        dst: &mut [u8],
+    ) -> Result<(), crate::Error> {
+        self.check_stream(src)?;
+        if offset > self.decoded_size() || self.decoded_size() - offset < dst.len() {
+            return Err(error("Range is out of bounds of the decoded file"));
+        }
+        if dst.is_empty() {
+            return Ok(());
+        }
+        // Last checkpoint at or before `offset`; the first one is always at 0.
+        let (mut lo, mut hi) = (0, self.checkpoint_count());
+        while hi - lo > 1 {
+            let mid = (lo + hi) / 2;
+            if self.checkpoint(mid).dst_offset <= offset {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        let i = lo;
+        self.decode_from(src, i, offset - self.checkpoint(i).dst_offset, dst)?;
+        Ok(())
+    }
+
+    /// Decodes the whole file, one checkpoint interval per task.
+    ///
+    /// `num_threads == 0` uses all available cores.
+    pub fn decode_parallel(
+        &self,
+        src: &[u8],
+        dst: &mut [u8],
+        num_threads: usize,
+    ) -> Result<(), crate::Error> {
+        self.check_stream(src)?;
+        if dst.len() < self.decoded_size() {
+            return Err(error("Result buffer is too small!"));
+        }
+
+        let count = self.checkpoint_count();
+        let mut segments = Vec::with_capacity(count);
+        let mut rest = &mut dst[..self.decoded_size()];
+        for i in 0..count {
+            let (segment, tail) =
+                rest.split_at_mut(self.checkpoint_end(i) - self.checkpoint(i).dst_offset);
+            segments.push((i, segment));
+            rest = tail;
+        }
+
+        let decode_segment = |i: usize, segment: &mut [u8]| -> Result<(), crate::Error> {
+            let end = self.decode_from(src, i, 0, segment)?;
+            // Each interval must end exactly where the next checkpoint begins.
+            if i + 1 < count && end != self.checkpoint(i + 1).src_offset {
+                return Err(error("Seek index does not match the stream"));
+            }
+            Ok(())
+        };
+
+        let num_threads = match num_threads {
+            0 => crate::algo_mkw_mt::default_num_threads(),
+            n => n,
+        };
+        let per_thread = (count + num_threads - 1) / num_threads;
+        if per_thread >= count {
+            for (i, segment) in segments {
+                decode_segment(i, segment)?;
+            }
+            return Ok(());
+        }
+        std::thread::scope(|s| {
+            let workers: Vec<_> = segments
+                .chunks_mut(per_thread)
+                .map(|chunk| {
+                    s.spawn(|| {
+                        for (i, segment) in chunk.iter_mut() {
+                            decode_segment(*i, segment)?;
+                        }
+                        Ok(())
+                    })
+                })
+                .collect();
+            workers
+                .into_iter()
+                .map(|w| w.join().expect("Decoder thread panicked"))
+                .collect::<Result<(), crate::Error>>()
+        })
+    }
+}
+
+/// Builds a seek index for the Yaz0 stream `src`, with a checkpoint at the first
+/// group boundary after every `interval` decoded bytes.
+pub fn build_seek_index(src: &[u8], interval: u32) -> Result<Vec<u8>, crate::Error> {
+    if interval == 0 {
+        return Err(error("Seek index interval must be non-zero"));
+    }
+    let decoded = crate::decode(src)?;
+    let size = decoded.len();
+
+    // Walk the (now known valid) stream for group boundaries.
+    let mut checkpoints = vec![(16usize, 0usize)];
+    let mut in_pos = 16;
+    let mut out_pos = 0;
+    let mut next = interval as usize;
+    while out_pos < size {
+        if out_pos >= next {
+            checkpoints.push((in_pos, out_pos));
+            next = out_pos + interval as usize;
+        }
+        let header = src[in_pos];
+        in_pos += 1;
+        for bit in 0..8 {
+            if out_pos >= size {
+                break;
+            }
+            if header & (0x80 >> bit) != 0 {
+                in_pos += 1;
+                out_pos += 1;
+                continue;
+            }
+            let len = if src[in_pos] >> 4 != 0 {
+                in_pos += 2;
+                (src[in_pos - 2] >> 4) as usize + 2
+            } else {
+                in_pos += 3;
+                src[in_pos - 1] as usize + 18
+            };
+            out_pos += std::cmp::min(len, size - out_pos);
+        }
+    }
+
+    let mut index = Vec::new();
+    index.extend_from_slice(MAGIC);
+    index.extend_from_slice(&VERSION.to_be_bytes());
+    index.extend_from_slice(&(size as u32).to_be_bytes());
+    index.extend_from_slice(&(src.len() as u32).to_be_bytes());
+    index.extend_from_slice(&interval.to_be_bytes());
+    index.extend_from_slice(&(checkpoints.len() as u32).to_be_bytes());
+    index.extend_from_slice(&xxh64(src, 0).to_be_bytes());
+    let mut window_offset = HEADER_SIZE + checkpoints.len() * ENTRY_SIZE;
+    for &(src_offset, dst_offset) in &checkpoints {
+        index.extend_from_slice(&(src_offset as u32).to_be_bytes());
+        index.extend_from_slice(&(dst_offset as u32).to_be_bytes());
+        index.extend_from_slice(&(window_offset as u32).to_be_bytes());
+        window_offset += std::cmp::min(WINDOW_SIZE, dst_offset);
+    }
+    for &(_, dst_offset) in &checkpoints {
+        let window_len = std::cmp::min(WINDOW_SIZE, dst_offset);
+        index.extend_from_slice(&decoded[dst_offset - window_len..dst_offset]);
+    }
+    Ok(index)
+}
@@ -0,0 +1,197 @@
+// Resumable Yaz0 decoder.
+//
+// Input and output may be split at any byte: partially-read operations are
+// buffered, and the last 4 KiB of output are kept in a ring so back-references
+// can reach data already handed back to the caller.
+
+const WINDOW_SIZE: usize = 0x1000;
+
+const BAD_BACK_REFERENCE: &str = "Invalid back-reference: points before the start of the file";
+
+/// Incremental SZS (YAZ0) decoder.
+///
+/// # Examples
+///
+/// ```
+/// let src = szs::encode(b"Hello, hello, hello!", szs::EncodeAlgo::MK8).unwrap();
+///
+/// let mut decoder = szs::StreamDecoder::new();
+/// let mut decoded = Vec::new();
+/// let mut out = [0u8; 4];
+/// for chunk in src.chunks(3) {
+///     let mut chunk = chunk;
+///     while !chunk.is_empty() && !decoder.is_done() {
+///         let (consumed, produced) = decoder.decode(chunk, &mut out).unwrap();
+///         decoded.extend_from_slice(&out[..produced]);
+///         chunk = &chunk[consumed..];
+///     }
+/// }
+/// assert!(decoder.is_done());
+/// assert_eq!(decoded, b"Hello, hello, hello!");
+/// ```
+pub struct StreamDecoder {
+    header: [u8; 16],
+    header_len: usize,
+    size: usize,
+    produced: usize,
+
+    window: Box<[u8; WINDOW_SIZE]>,
+
+    group_header: u8,
+    group_bits_left: u32,
+
+    op: [u8; 3],
+    op_len: usize,
+
+    copy_dist: usize,
+    copy_left: usize,
+}
+
+impl Default for StreamDecoder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl StreamDecoder {
+    pub fn new() -> Self {
+        Self {
+            header: [0; 16],
+            header_len: 0,
+            size: 0,
+            produced: 0,
+            window: Box::new([0; WINDOW_SIZE]),
+            group_header: 0,
+            group_bits_left: 0,
+            op: [0; 3],
+            op_len: 0,
+            copy_dist: 0,
+            copy_left: 0,
+        }
+    }
+
+    /// Decoded size from the stream header, once the first 16 bytes have been fed.
+    pub fn decoded_size(&self) -> Option<u32> {
+        if self.header_len < 16 {
+            return None;
+        }
+        Some(self.size as u32)
+    }
+
+    /// Total number of bytes produced so far.
+    pub fn produced(&self) -> usize {
+        self.produced
+    }
+
+    /// Whether the whole stream has been decoded. Any further input is padding.
+    pub fn is_done(&self) -> bool {
+        self.header_len == 16 && self.produced == self.size && self.copy_left == 0
+    }
+
+    #[inline(always)]
+    fn emit(&mut self, dst: &mut [u8], out: usize, value: u8) {
+        dst[out] = value;
+        self.window[self.produced % WINDOW_SIZE] = value;
+        self.produced += 1;
+    }
+
+    /// Copies as much of the pending back-reference as fits into `dst[out..]`.
+    fn drain_copy(&mut self, dst: &mut [u8], mut out: usize) -> usize {
+        while self.copy_left > 0 && out < dst.len() {
+            let from = (self.produced - self.copy_dist) % WINDOW_SIZE;
+            let to = self.produced % WINDOW_SIZE;
+            // Largest run that neither wraps the ring nor overlaps itself.
+            let n = self
+                .copy_left
+                .min(dst.len() - out)
+                .min(self.copy_dist)
+                .min(WINDOW_SIZE - from)
+                .min(WINDOW_SIZE - to);
+            self.window.copy_within(from..from + n, to);
+            dst[out..out + n].copy_from_slice(&self.window[to..to + n]);
+            self.produced += n;
+            self.copy_left -= n;
+            out += n;
+        }
+        out
+    }
+
+    /// Decodes as much of `src` into `dst` as possible.
+    ///
+    /// Returns `(consumed, produced)`: the number of bytes read from `src` and
+    /// written to `dst`. Unconsumed input must be passed again in the next call.
+    pub fn decode(&mut self, src: &[u8], dst: &mut [u8]) -> Result<(usize, usize), crate::Error> {
+        let mut i = 0;
+        let mut out = 0;
+
+        if self.header_len < 16 {
+            let n = std::cmp::min(16 - self.header_len, src.len());
+            self.header[self.header_len..self.header_len + n].copy_from_slice(&src[..n]);
+            self.header_len += n;
+            i += n;
+            if self.header_len < 16 {
+                return Ok((i, out));
+            }
+            if !(self.header.starts_with(b"Yaz0") || self.header.starts_with(b"Yaz1")) {
+                return Err(crate::Error::Error(
+                    "Source is not a SZS compressed file!".to_string(),
+                ));
+            }
+            self.size = u32::from_be_bytes(self.header[4..8].try_into().unwrap()) as usize;
+        }
+
+        loop {
+            out = self.drain_copy(dst, out);
+            if self.copy_left > 0 || self.produced == self.size {
+                return Ok((i, out));
+            }
+
+            if self.group_bits_left == 0 {
+                let Some(&header) = src.get(i) else {
+                    return Ok((i, out));
+                };
+                self.group_header = header;
+                self.group_bits_left = 8;
+                i += 1;
+            }
+
+            if self.group_header & 0x80 != 0 {
+                if out == dst.len() {
+                    return Ok((i, out));
+                }
+                let Some(&value) = src.get(i) else {
+                    return Ok((i, out));
+                };
+                i += 1;
+                self.emit(dst, out, value);
+                out += 1;
+            } else {
+                while self.op_len < 2 || (self.op[0] >> 4 == 0 && self.op_len < 3) {
+                    let Some(&byte) = src.get(i) else {
+                        return Ok((i, out));
+                    };
+                    self.op[self.op_len] = byte;
+                    self.op_len += 1;
+                    i += 1;
+                }
+                let group = (self.op[0] as usize) << 8 | self.op[1] as usize;
+                let dist = (group & 0xFFF) + 1;
+                let len = if group >> 12 != 0 {
+                    (group >> 12) + 2
+                } else {
+                    self.op[2] as usize + 18
+                };
+                self.op_len = 0;
+                if dist > self.produced {
+                    return Err(crate::Error::Error(BAD_BACK_REFERENCE.to_string()));
+                }
+                // Encoders may run a final back-reference past the reported size.
+                self.copy_dist = dist;
+                self.copy_left = std::cmp::min(len, self.size - self.produced);
+            }
+
+            self.group_header <<= 1;
+            self.group_bits_left -= 1;
+        }
+    }
+}
@@ -20,6 +20,8 @@ fn to_encode_algo(s: &str) -> anyhow::Result<EncodeAlgo> {
         "lib-yaz0-rustmemchr" => Ok(EncodeAlgo::LibYaz0_RustMemchr),
         "mk8" => Ok(EncodeAlgo::MK8),
         "mk8-rust" => Ok(EncodeAlgo::MK8_Rust),
+        "mkw-parallel" => Ok(EncodeAlgo::MkwParallel),
+        "optimal" => Ok(EncodeAlgo::Optimal),
         _ => Err(anyhow::Error::msg(format!("Invalid Yaz0 algorithm: '{}'", s))),
     }
 }
@@ -50,6 +52,12 @@ fn main() {
                 .value_name("ALGO")
                 .required(true),
         )
+        .arg(
+            Arg::new("seek-index")
+                .long("seek-index")
+                .value_name("KIB")
+                .help("Write a seek index with a checkpoint every KIB KiB of output to <OUTPUT>.idx"),
+        )
         .get_matches();
 
     let input_file = matches.get_one::<String>("input").unwrap();
@@ -89,6 +97,27 @@ fn main() {
         std::process::exit(1);
     }
 
+    if let Some(kib) = matches.get_one::<String>("seek-index") {
+        let interval = match u32::from_str(kib) {
+            Ok(kib) if kib > 0 => kib * 1024,
+            _ => {
+                eprintln!("Error: Invalid seek index interval '{}'", kib);
+                std::process::exit(1);
+            }
+        };
+        let index = match szs::build_seek_index(&encoded_data, interval) {
+            Ok(index) => index,
+            Err(err) => {
+                eprintln!("Error building seek index: {:?}", err);
+                std::process::exit(1);
+            }
+        };
+        if let Err(err) = fs::write(format!("{}.idx", output_file), &index) {
+            eprintln!("Error writing seek index: {}", err);
+            std::process::exit(1);
+        }
+    }
+
     println!("Data encoded successfully.");
     println!("Time taken for compression: {:?}", duration);
     println!("Compression rate: {:.2}", compression_rate);
@@ -0,0 +1,231 @@
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <librii/kcol/Builder.hpp>
+#include <librii/kcol/Query.hpp>
+#include <random>
+
+namespace {
+
+using namespace librii::kcol;
+
+constexpr KclBuildOptions SoupOptions{.max_prisms_per_leaf = 8,
+                                      .min_leaf_width = 128};
+
+//! A fixed-seed soup of triangles of mixed size and slope over a course-sized
+//! area, plus a large ground quad that spans many leaves.
+std::vector<KclTriangle> TriangleSoup() {
+  std::mt19937 rng(0x4B434C);
+  std::uniform_real_distribution<float> pos(-6000.0f, 6000.0f);
+  std::uniform_real_distribution<float> edge(-1500.0f, 1500.0f);
+
+  std::vector<KclTriangle> tris;
+  const glm::vec3 g[4] = {{-7000.0f, -2000.0f, -7000.0f},
+                          {7000.0f, -2000.0f, -7000.0f},
+                          {7000.0f, -2000.0f, 7000.0f},
+                          {-7000.0f, -2000.0f, 7000.0f}};
+  tris.push_back({.verts = {g[0], g[2], g[1]}, .attribute = 0});
+  tris.push_back({.verts = {g[0], g[3], g[2]}, .attribute = 0});
+  while (tris.size() < 400) {
+    const glm::vec3 a(pos(rng), pos(rng) * 0.25f, pos(rng));
+    const glm::vec3 b = a + glm::vec3(edge(rng), edge(rng), edge(rng));
+    const glm::vec3 c = a + glm::vec3(edge(rng), edge(rng), edge(rng));
+    // Slivers are legal but make the sampling below meaningless.
+    if (glm::length(glm::cross(b - a, c - a)) < 1.0e5f) {
+      continue;
+    }
+    tris.push_back({.verts = {a, b, c},
+                    .attribute = static_cast<u16>(tris.size() % 32)});
+  }
+  return tris;
+}
+
+//! Builds the soup's octree and reads it back from the written file.
+Result<KCollisionData> BuildAndReload(std::span<const KclTriangle> tris) {
+  auto built = TRY(BuildKCollisionData(tris, SoupOptions));
+  auto bytes = WriteKCollisionData(built);
+  auto read = TRY(ReadKCollisionData(bytes, static_cast<u32>(bytes.size())));
+  if (read.prism_data.size() != built.prism_data.size() ||
+      read.block_data != built.block_data) {
+    return std::unexpected("KCL did not survive a write/read round trip");
+  }
+  return read;
+}
+
+//! Points covering `tri` with spacing below half the smallest leaf width.
+std::vector<glm::vec3> SamplePoints(const std::array<glm::vec3, 3>& tri) {
+  const float longest = std::max({glm::length(tri[1] - tri[0]),
+                                  glm::length(tri[2] - tri[0]),
+                                  glm::length(tri[2] - tri[1])});
+  const float spacing = SoupOptions.min_leaf_width / 2;
+  const int n = std::max(1, static_cast<int>(std::ceil(longest / spacing)));
+  std::vector<glm::vec3> points;
+  for (int i = 0; i <= n; ++i) {
+    for (int j = 0; i + j <= n; ++j) {
+      const float u = static_cast<float>(i) / n;
+      const float v = static_cast<float>(j) / n;
+      points.push_back(tri[0] + (tri[1] - tri[0]) * u + (tri[2] - tri[0]) * v);
+    }
+  }
+  return points;
+}
+
+//! Moller-Trumbore over every prism: the reference for KclQuery::raycast.
+std::optional<float> BruteForceRaycast(const KCollisionData& data,
+                                       const KclRay& ray) {
+  std::optional<float> best;
+  for (auto& prism : data.prism_data) {
+    const auto tri = FromPrism(data, prism);
+    const glm::vec3 e1 = tri[1] - tri[0];
+    const glm::vec3 e2 = tri[2] - tri[0];
+    const glm::vec3 p = glm::cross(ray.dir, e2);
+    const float det = glm::dot(e1, p);
+    if (det == 0.0f) {
+      continue;
+    }
+    const glm::vec3 s = ray.origin - tri[0];
+    const float u = glm::dot(s, p) / det;
+    const glm::vec3 q = glm::cross(s, e1);
+    const float v = glm::dot(ray.dir, q) / det;
+    const float t = glm::dot(e2, q) / det;
+    if (u < 0.0f || v < 0.0f || u + v > 1.0f || t < 0.0f || t > ray.max_t) {
+      continue;
+    }
+    if (!best || t < *best) {
+      best = t;
+    }
+  }
+  return best;
+}
+
+float DistanceToSegment(const glm::vec3& p, const glm::vec3& a,
+                        const glm::vec3& b) {
+  const float t =
+      std::clamp(glm::dot(p - a, b - a) / glm::dot(b - a, b - a), 0.0f, 1.0f);
+  return glm::length(p - (a + (b - a) * t));
+}
+
+//! How far inside (positive) or outside the sphere `prism` is, following the
+//! rules documented on KclQuery::checkSphere.
+float SphereOverlap(const KCollisionData& data,
+                    const KCollisionPrismData& prism, const glm::vec3& center,
+                    float radius) {
+  const auto tri = FromPrism(data, prism);
+  const glm::vec3& n = data.nrm_data[prism.fnrm_i];
+  const float plane = glm::dot(center - tri[0], n);
+  const float slab = std::min(radius - plane, plane + data.prism_thickness);
+  // Inside the triangle's footprint: only the distance to the plane matters.
+  const glm::vec3 proj = center - n * plane;
+  bool inside = true;
+  for (int i = 0; i < 3; ++i) {
+    const glm::vec3& a = tri[i];
+    const glm::vec3& b = tri[(i + 1) % 3];
+    const glm::vec3& c = tri[(i + 2) % 3];
+    inside &= glm::dot(glm::cross(b - a, proj - a), glm::cross(b - a, c - a)) >=
+              0.0f;
+  }
+  if (inside) {
+    return slab;
+  }
+  // Edges and corners only collide from above.
+  const float dist = std::min({DistanceToSegment(center, tri[0], tri[1]),
+                               DistanceToSegment(center, tri[1], tri[2]),
+                               DistanceToSegment(center, tri[2], tri[0])});
+  return std::min({slab, plane, radius - dist});
+}
+
+} // namespace
+
+// Every leaf a triangle passes through must list it: otherwise the game (and
+// KclQuery) misses the triangle there. Leaves only touched by the triangle's
+// AABB may omit it, so the samples are taken on the triangle itself.
+UNIT_TEST(KclBuilderLeavesCoverTriangles) {
+  const auto tris = TriangleSoup();
+  auto data = BuildAndReload(tris);
+  REQUIRE(data.has_value());
+  REQUIRE(data->prism_data.size() == tris.size());
+  auto query = KclQuery::Create(*data);
+  REQUIRE(query.has_value());
+
+  size_t missed = 0;
+  for (size_t i = 0; i < tris.size(); ++i) {
+    for (const auto& p : SamplePoints(tris[i].verts)) {
+      auto prisms = query->prismsAt(p);
+      missed += std::ranges::find(prisms, static_cast<u16>(i)) == prisms.end();
+    }
+  }
+  CHECK(missed == 0);
+}
+
+// The octree only prunes the search: raycasts and sphere checks must find
+// exactly what a scan over every prism finds.
+UNIT_TEST(KclQueryMatchesBruteForce) {
+  const auto tris = TriangleSoup();
+  auto data = BuildAndReload(tris);
+  REQUIRE(data.has_value());
+  auto query = KclQuery::Create(*data);
+  REQUIRE(query.has_value());
+
+  std::mt19937 rng(0x5152);
+  std::uniform_real_distribution<float> pos(-7500.0f, 7500.0f);
+  std::uniform_real_distribution<float> dir(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> radius(50.0f, 1500.0f);
+
+  std::vector<KclRay> rays;
+  for (int i = 0; i < 2000; ++i) {
+    KclRay ray{.origin = {pos(rng), pos(rng) * 0.5f, pos(rng)},
+               .dir = {dir(rng), dir(rng), dir(rng)}};
+    // Straight down, like groundBelow()
+    if (i % 4 == 0) {
+      ray.dir = {0.0f, -1.0f, 0.0f};
+    }
+    // Unnormalized, and sometimes too short to reach anything
+    ray.dir *= 1.0f + 9.0f * (i % 3);
+    if (i % 5 == 0) {
+      ray.max_t = 100.0f;
+    }
+    rays.push_back(ray);
+  }
+  const auto batch = query->raycastBatch(rays);
+  REQUIRE(batch.size() == rays.size());
+  size_t ray_hits = 0, ray_mismatches = 0;
+  for (size_t i = 0; i < rays.size(); ++i) {
+    const auto expected = BruteForceRaycast(*data, rays[i]);
+    const auto hit = query->raycast(rays[i]);
+    ray_hits += expected.has_value();
+    ray_mismatches += hit.has_value() != expected.has_value() ||
+                      (hit && std::abs(hit->t - *expected) >
+                                  1.0e-4f * std::max(1.0f, *expected)) ||
+                      batch[i].has_value() != hit.has_value() ||
+                      (hit && batch[i]->t != hit->t);
+  }
+  CHECK(ray_hits > rays.size() / 4);
+  CHECK(ray_mismatches == 0);
+
+  // Prisms within `Eps` of the sphere's surface may go either way.
+  constexpr float Eps = 0.01f;
+  size_t sphere_hits = 0, sphere_mismatches = 0;
+  for (int i = 0; i < 2000; ++i) {
+    const glm::vec3 center(pos(rng), pos(rng) * 0.5f, pos(rng));
+    const float r = radius(rng);
+    auto hits = query->checkSphere(center, r);
+    std::vector<u32> found;
+    for (auto& hit : hits) {
+      found.push_back(hit.prism);
+    }
+    std::ranges::sort(found);
+    sphere_mismatches +=
+        std::ranges::adjacent_find(found) != found.end(); // Duplicates
+    for (u32 p = 0; p < data->prism_data.size(); ++p) {
+      const float overlap =
+          SphereOverlap(*data, data->prism_data[p], center, r);
+      const bool listed = std::ranges::binary_search(found, p);
+      sphere_hits += listed;
+      sphere_mismatches +=
+          (overlap > Eps && !listed) || (overlap < -Eps && listed);
+    }
+  }
+  CHECK(sphere_hits > 1000);
+  CHECK(sphere_mismatches == 0);
+}
@@ -0,0 +1,154 @@
+#include "UnitTest.hpp"
+
+#include <librii/trig/WiiTrig.hpp>
+#include <random>
+
+namespace {
+
+using librii::g3d::BoneMatrixCache;
+using librii::g3d::ScalingRule;
+using librii::math::SRT3;
+
+struct TestBone {
+  SRT3 srt;
+  bool ssc = false;
+  s32 parent = -1;
+};
+SRT3 getSrt(const TestBone& b) { return b.srt; }
+bool ssc(const TestBone& b) { return b.ssc; }
+s32 parentOf(const TestBone& b) { return b.parent; }
+
+constexpr ScalingRule AllRules[] = {ScalingRule::Standard, ScalingRule::XSI,
+                                    ScalingRule::Maya};
+
+SRT3 RandomSrt(std::mt19937& rng) {
+  std::uniform_real_distribution<float> d(-3.0f, 3.0f);
+  return {.scale = {d(rng), d(rng), d(rng)},
+          .rotation = {d(rng) * 60.0f, d(rng) * 60.0f, d(rng) * 60.0f},
+          .translation = {d(rng) * 100.0f, d(rng) * 100.0f, d(rng) * 100.0f}};
+}
+
+//! A forest whose parents may come after their children in the bone list.
+std::vector<TestBone> RandomSkeleton(std::mt19937& rng, u32 n) {
+  std::vector<u32> slot(n);
+  for (u32 i = 0; i < n; ++i) {
+    slot[i] = i;
+  }
+  std::shuffle(slot.begin(), slot.end(), rng);
+  std::vector<TestBone> bones(n);
+  for (u32 i = 0; i < n; ++i) {
+    auto& bone = bones[slot[i]];
+    bone.srt = RandomSrt(rng);
+    bone.ssc = rng() % 4 == 0;
+    bone.parent = i == 0 || rng() % 10 == 0 ? -1 : slot[rng() % i];
+  }
+  return bones;
+}
+
+bool MatchesCalcSrtMtx(std::span<const glm::mat4> matrices,
+                       std::span<const TestBone> bones, ScalingRule rule) {
+  for (size_t i = 0; i < bones.size(); ++i) {
+    if (matrices[i] != librii::g3d::calcSrtMtx(bones[i], bones, rule)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsDescendant(std::span<const TestBone> bones, s32 bone, s32 ancestor) {
+  for (; bone >= 0; bone = bones[bone].parent) {
+    if (bone == ancestor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+UNIT_TEST(BoneMatrixCacheMatchesCalcSrtMtx) {
+  std::mt19937 rng(0x5254);
+  for (int trial = 0; trial < 30; ++trial) {
+    const u32 n = 1 + rng() % 120;
+    auto bones = RandomSkeleton(rng, n);
+    for (auto rule : AllRules) {
+      BoneMatrixCache cache;
+      CHECK(cache.update(bones, rule) == n);
+      CHECK(MatchesCalcSrtMtx(cache.matrices(), bones, rule));
+      CHECK(cache.update(bones, rule) == 0);
+
+      // Only the edited joint and its descendants are recomputed
+      const s32 k = static_cast<s32>(rng() % n);
+      auto edited = bones;
+      edited[k].srt.translation.x += 1.0f;
+      u32 expected = 0;
+      for (u32 i = 0; i < n; ++i) {
+        expected += IsDescendant(edited, i, k);
+      }
+      CHECK(cache.update(edited, rule) == expected);
+      CHECK(MatchesCalcSrtMtx(cache.matrices(), edited, rule));
+    }
+  }
+}
+
+UNIT_TEST(BoneMatrixCacheSolvePoses) {
+  std::mt19937 rng(0x504f);
+  const u32 n = 40;
+  auto bones = RandomSkeleton(rng, n);
+  for (auto rule : AllRules) {
+    BoneMatrixCache cache;
+    cache.update(bones, rule);
+    const std::vector<glm::mat4> cached(cache.matrices().begin(),
+                                        cache.matrices().end());
+
+    constexpr u32 NumPoses = 4;
+    std::vector<std::vector<TestBone>> frames(NumPoses, bones);
+    std::vector<SRT3> poses;
+    for (auto& frame : frames) {
+      for (auto& bone : frame) {
+        bone.srt = RandomSrt(rng);
+        poses.push_back(bone.srt);
+      }
+    }
+    std::vector<glm::mat4> out(poses.size());
+    cache.solvePoses(poses, out);
+    for (u32 f = 0; f < NumPoses; ++f) {
+      CHECK(MatchesCalcSrtMtx(std::span(out).subspan(f * n, n), frames[f],
+                              rule));
+    }
+    // The cached pose is left alone
+    CHECK(std::ranges::equal(cache.matrices(), cached));
+    CHECK(cache.update(bones, rule) == 0);
+  }
+}
+
+// calcSrtMtx() never terminates on a parent loop, so compare against the
+// skeleton with each loop broken where sortTopologically() breaks it.
+UNIT_TEST(BoneMatrixCacheCyclicParents) {
+  std::mt19937 rng(0x4359);
+  std::vector<TestBone> bones(6);
+  for (auto& bone : bones) {
+    bone.srt = RandomSrt(rng);
+  }
+  bones[0].parent = 2; // 0 -> 2 -> 1 -> 0
+  bones[1].parent = 0;
+  bones[2].parent = 1;
+  bones[3].parent = 2; // Hangs off the loop
+  bones[4].parent = 4; // Its own parent
+  bones[5].parent = 9; // Out of range: a root
+
+  auto broken = bones;
+  broken[0].parent = -1;
+  broken[4].parent = -1;
+  for (auto rule : AllRules) {
+    BoneMatrixCache cache;
+    CHECK(cache.update(bones, rule) == bones.size());
+    CHECK(MatchesCalcSrtMtx(cache.matrices(), broken, rule));
+
+    // Dirty flags still reach the rest of the loop
+    bones[0].srt.rotation.y += 10.0f;
+    broken[0].srt = bones[0].srt;
+    CHECK(cache.update(bones, rule) == 4);
+    CHECK(MatchesCalcSrtMtx(cache.matrices(), broken, rule));
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// Minimal self-registering unit tests, run by `tests unit`.
+//
+//   UNIT_TEST(Example) {
+//     auto x = Parse(...);
+//     REQUIRE(x.has_value()); // Stops the test on failure
+//     CHECK(x->size() == 2);
+//   }
+
+namespace unit_test {
+
+struct Case {
+  const char* name;
+  void (*fn)();
+};
+
+inline std::vector<Case>& Registry() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+inline int gFailures = 0;
+
+struct Register {
+  Register(const char* name, void (*fn)()) { Registry().push_back({name, fn}); }
+};
+
+//! Runs every registered test. Returns the number of failed checks.
+inline int RunAll() {
+  for (auto& c : Registry()) {
+    const int before = gFailures;
+    c.fn();
+    printf("[%s] %s\n", gFailures == before ? "PASS" : "FAIL", c.name);
+  }
+  return gFailures;
+}
+
+} // namespace unit_test
+
+#define UNIT_TEST(NAME)                                                        \
+  static void NAME();                                                          \
+  static unit_test::Register NAME##_register(#NAME, NAME);                     \
+  static void NAME()
+
+#define CHECK(COND)                                                            \
+  do {                                                                         \
+    if (!(COND)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,         \
+              #COND);                                                          \
+      ++unit_test::gFailures;                                                  \
+    }                                                                          \
+  } while (0)
+
+#define REQUIRE(COND)                                                          \
+  do {                                                                         \
+    if (!(COND)) {                                                             \
+      fprintf(stderr, "%s:%d: REQUIRE(%s) failed\n", __FILE__, __LINE__,       \
+              #COND);                                                          \
+      ++unit_test::gFailures;                                                  \
+      return;                                                                  \
+    }                                                                          \
+  } while (0)
@@ -11,6 +11,7 @@
 #include <plugins/j3d/J3dIo.hpp>
 #include <rsl/InitLLVM.hpp>
 #include <rsl/Ranges.hpp>
+#include <tests/UnitTest.hpp>
 
 IMPORT_STD;
 
@@ -50,7 +51,8 @@ void rebuild(std::string from, const std::string_view to, bool check,
         writer.add_bp<u32>(bp);
       }
     }
-    oishii::BinaryReader reader(*file, from, std::endian::big);
+    auto reader =
+        oishii::BinaryReader::FromBorrowedSpan(*file, from, std::endian::big);
     for (auto bp : bps) {
       if (bp < 0)
         reader.add_bp<u32>(-bp);
@@ -219,10 +221,16 @@ int main(int argc, const char** argv) {
   ANNOUNCE("Initializing LLVM");
   rsl::InitLLVM init_llvm(argc, argv);
 
+  if (argc == 2 && !strcmp(argv[1], "unit")) {
+    ANNOUNCE("Running unit tests");
+    return unit_test::RunAll() == 0 ? 0 : 1;
+  }
+
   ANNOUNCE("Performing tasks");
   if (argc < 3) {
     fprintf(stderr,
-            "Error: Too few arguments:\ntests.exe <from> <to> [check?]\n");
+            "Error: Too few arguments:\ntests.exe <from> <to> [check?]\n"
+            "tests.exe unit\n");
   } else {
     std::vector<s32> bps;
     for (int i = 4; i < argc; ++i) {